@@ -0,0 +1,49 @@
+/*
+ * bench.h — Utilidades compartidas por los microbenchmarks de bench/.
+ *
+ * Cada resultado se emite como una línea JSON (JSON Lines) en stdout:
+ *   {"bench":"codec","case":"decode/ping","ns_per_op":21.4,"bytes_per_op":4,"ops":500000}
+ * Dos corridas se comparan uniendo por (bench, case), p. ej. con jq. Los
+ * textos informativos van a stderr para no mezclarse con los resultados.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Impide que el compilador descarte un resultado que no se usa
+static inline void bench_escape(const void *p) {
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+/*
+ * bench_emit / bench_emit_extra
+ * -----------------------------
+ * Una línea JSON por resultado. bytes_per_op < 0 omite el campo (no aplica);
+ * 'extra' agrega una métrica propia del benchmark (NULL = ninguna).
+ */
+static inline void bench_emit_extra(const char *bench, const char *name, double ns_per_op,
+                                    double bytes_per_op, uint64_t ops,
+                                    const char *extra, double extra_value) {
+    printf("{\"bench\":\"%s\",\"case\":\"%s\",\"ns_per_op\":%.2f", bench, name, ns_per_op);
+    if (bytes_per_op >= 0) printf(",\"bytes_per_op\":%.0f", bytes_per_op);
+    printf(",\"ops\":%llu", (unsigned long long)ops);
+    if (extra) printf(",\"%s\":%.2f", extra, extra_value);
+    printf("}\n");
+    fflush(stdout);
+}
+
+static inline void bench_emit(const char *bench, const char *name, double ns_per_op,
+                              double bytes_per_op, uint64_t ops) {
+    bench_emit_extra(bench, name, ns_per_op, bytes_per_op, ops, NULL, 0);
+}
+
+#endif // BENCH_H
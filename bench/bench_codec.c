@@ -0,0 +1,207 @@
+/*
+ * bench_codec.c — Microbenchmark del codec CoAP por forma de mensaje.
+ *
+ * Formas representativas del tráfico real:
+ * - ping: CON vacío (4 bytes, sin token ni opciones).
+ * - small_post: POST de telemetría (token de 4 bytes, Uri-Path
+ *   api/v1/telemetry, Content-Format JSON y un JSON pequeño).
+ * - max_options: 16 opciones (el máximo de CoapMessage) con deltas y
+ *   longitudes extendidas.
+ * - max_payload: POST de telemetría que llena COAP_MAX_MESSAGE_SIZE.
+ * Para cada forma mide coap_decode (fast path + respaldo), coap_decode_generic
+ * y coap_encode (bytes/op = tamaño en el cable), más el costo por llamada de
+ * coap_message_add_option insertando en orden y en orden inverso (peor caso:
+ * cada inserción desplaza las anteriores).
+ */
+#include "bench.h"
+#include "coap.h"
+#include "coap_codec.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define ITERATIONS 200000
+#define ROUNDS     5
+#define MAX_SHAPE_OPTIONS 16
+
+typedef int (*DecodeFn)(CoapMessage *msg, const uint8_t *buffer, size_t length);
+
+typedef struct {
+    const char *name;
+    CoapMessage msg;
+    uint8_t wire[COAP_MAX_MESSAGE_SIZE];
+    size_t wire_len;
+} Shape;
+
+static void add_uri_path(CoapMessage *msg) {
+    const char *segs[] = {"api", "v1", "telemetry"};
+    for (size_t i = 0; i < 3; i++) {
+        coap_message_add_option(msg, COAP_OPTION_URI_PATH, (const uint8_t *)segs[i],
+                                strlen(segs[i]));
+    }
+    uint8_t fmt = COAP_FORMAT_JSON;
+    coap_message_add_option(msg, COAP_OPTION_CONTENT_FORMAT, &fmt, 1);
+}
+
+static void init_request(CoapMessage *msg, CoapCode code) {
+    coap_message_init(msg);
+    msg->type = COAP_TYPE_CONFIRMABLE;
+    msg->code = code;
+    msg->message_id = 0x1234;
+    msg->token_length = 4;
+    memcpy(msg->token, "\x01\x02\x03\x04", 4);
+}
+
+static void build_ping(CoapMessage *msg) {
+    coap_message_init(msg);
+    msg->type = COAP_TYPE_CONFIRMABLE;
+    msg->code = (CoapCode)0;  // 0.00 vacío
+    msg->message_id = 0x1234;
+}
+
+static void build_small_post(CoapMessage *msg) {
+    init_request(msg, COAP_METHOD_POST);
+    add_uri_path(msg);
+    const char *json =
+        "{\"temperatura\":25.5,\"humedad\":60.2,\"voltaje\":3.7,\"cantidad_producida\":150}";
+    msg->payload = msg->payload_buffer;
+    msg->payload_length = strlen(json);
+    memcpy(msg->payload_buffer, json, msg->payload_length);
+}
+
+// 16 opciones: Uri-Host, Uri-Port, 3 Uri-Path, Content-Format, 8 Uri-Query
+// (una de 40 bytes => longitud extendida), Accept y Size1 (delta extendido)
+static void build_max_options(CoapMessage *msg) {
+    init_request(msg, COAP_METHOD_GET);
+    coap_message_add_option(msg, COAP_OPTION_URI_HOST, (const uint8_t *)"sensors.plant.local", 19);
+    const uint8_t port[2] = {0x16, 0x33};
+    coap_message_add_option(msg, COAP_OPTION_URI_PORT, port, 2);
+    add_uri_path(msg);
+    char query[48];
+    for (int i = 0; i < 8; i++) {
+        int n = i == 0 ? snprintf(query, sizeof(query), "device=esp32-%032d", i)
+                       : snprintf(query, sizeof(query), "f%d=%d", i, i * 7);
+        coap_message_add_option(msg, COAP_OPTION_URI_QUERY, (const uint8_t *)query, (size_t)n);
+    }
+    uint8_t accept = COAP_FORMAT_JSON;
+    coap_message_add_option(msg, COAP_OPTION_ACCEPT, &accept, 1);
+    const uint8_t size1[2] = {0x05, 0xC0};
+    coap_message_add_option(msg, COAP_OPTION_SIZE1, size1, 2);
+    assert(msg->option_count == MAX_SHAPE_OPTIONS);
+}
+
+static void build_max_payload(CoapMessage *msg) {
+    init_request(msg, COAP_METHOD_POST);
+    add_uri_path(msg);
+    uint8_t probe[COAP_MAX_MESSAGE_SIZE];
+    int header = coap_encode(msg, probe, sizeof(probe));
+    assert(header > 0);
+    // Marcador 0xFF + payload hasta el máximo del datagrama
+    msg->payload = msg->payload_buffer;
+    msg->payload_length = COAP_MAX_MESSAGE_SIZE - (size_t)header - 1;
+    memset(msg->payload_buffer, 'x', msg->payload_length);
+}
+
+// Mejor de ROUNDS rondas (ns/op) para reducir el ruido del scheduler
+static double run_decode(DecodeFn fn, const Shape *s) {
+    static CoapMessage msg;
+    double best = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        uint64_t t0 = bench_now_ns();
+        for (int i = 0; i < ITERATIONS; i++) {
+            int rc = fn(&msg, s->wire, s->wire_len);
+            assert(rc == COAP_CODEC_OK);
+            (void)rc;
+            bench_escape(&msg);
+        }
+        double ns = (double)(bench_now_ns() - t0) / ITERATIONS;
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+static double run_encode(const Shape *s) {
+    static uint8_t out[COAP_MAX_MESSAGE_SIZE];
+    double best = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        uint64_t t0 = bench_now_ns();
+        for (int i = 0; i < ITERATIONS; i++) {
+            int n = coap_encode(&s->msg, out, sizeof(out));
+            assert(n == (int)s->wire_len);
+            (void)n;
+            bench_escape(out);
+        }
+        double ns = (double)(bench_now_ns() - t0) / ITERATIONS;
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+// ns por llamada a coap_message_add_option al reconstruir las opciones de
+// 's' (en orden o invertidas); bytes/op = valor medio de la opción
+static double run_add_option(const Shape *s, bool reverse, double *bytes) {
+    static CoapMessage msg;
+    const size_t n = s->msg.option_count;
+    size_t total = 0;
+    for (size_t k = 0; k < n; k++) total += s->msg.options[k].length;
+    *bytes = (double)total / (double)n;
+
+    const int iterations = ITERATIONS / 4;
+    double best = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        uint64_t t0 = bench_now_ns();
+        for (int i = 0; i < iterations; i++) {
+            msg.option_count = 0;
+            for (size_t k = 0; k < n; k++) {
+                const CoapOptionDef *opt = &s->msg.options[reverse ? n - 1 - k : k];
+                int rc = coap_message_add_option(&msg, opt->number, opt->value, opt->length);
+                assert(rc == 0);
+                (void)rc;
+            }
+            bench_escape(&msg);
+        }
+        double ns = (double)(bench_now_ns() - t0) / ((double)iterations * (double)n);
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+int main(void) {
+    static Shape shapes[] = {
+        { "ping", {0}, {0}, 0 },
+        { "small_post", {0}, {0}, 0 },
+        { "max_options", {0}, {0}, 0 },
+        { "max_payload", {0}, {0}, 0 },
+    };
+    build_ping(&shapes[0].msg);
+    build_small_post(&shapes[1].msg);
+    build_max_options(&shapes[2].msg);
+    build_max_payload(&shapes[3].msg);
+
+    char name[64];
+    for (size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); i++) {
+        Shape *s = &shapes[i];
+        int n = coap_encode(&s->msg, s->wire, sizeof(s->wire));
+        assert(n > 0);
+        s->wire_len = (size_t)n;
+        const double bytes = (double)s->wire_len;
+
+        snprintf(name, sizeof(name), "decode/%s", s->name);
+        bench_emit("codec", name, run_decode(coap_decode, s), bytes, ITERATIONS);
+        snprintf(name, sizeof(name), "decode_generic/%s", s->name);
+        bench_emit("codec", name, run_decode(coap_decode_generic, s), bytes, ITERATIONS);
+        snprintf(name, sizeof(name), "encode/%s", s->name);
+        bench_emit("codec", name, run_encode(s), bytes, ITERATIONS);
+
+        if (s->msg.option_count == 0) continue;
+        double opt_bytes;
+        snprintf(name, sizeof(name), "add_option/%s", s->name);
+        double ns = run_add_option(s, false, &opt_bytes);
+        bench_emit("codec", name, ns, opt_bytes, (uint64_t)(ITERATIONS / 4) * s->msg.option_count);
+        snprintf(name, sizeof(name), "add_option_reverse/%s", s->name);
+        ns = run_add_option(s, true, &opt_bytes);
+        bench_emit("codec", name, ns, opt_bytes, (uint64_t)(ITERATIONS / 4) * s->msg.option_count);
+    }
+    return 0;
+}
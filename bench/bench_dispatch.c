@@ -0,0 +1,124 @@
+/*
+ * bench_dispatch.c — Costo de una request completa por ruta.
+ *
+ * Para cada ruta de k_routes (más una sin handler, 4.04) mide el camino que
+ * recorre un datagrama en el hilo de I/O sin el socket: coap_decode +
+ * dispatcher_handle_request_routed + coap_encode de la respuesta. bytes/op es
+ * request + respuesta en el cable. El GET de telemetría se mide con
+ * GET_ENTRIES entradas en el storage (las que caben en un datagrama).
+ */
+#include "bench.h"
+#include "coap_codec.h"
+#include "dispatcher.h"
+#include "log.h"
+#include "telemetry_storage.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ITERATIONS 20000
+#define ROUNDS     3
+#define GET_ENTRIES 12
+
+typedef struct {
+    DispatchRoute route;
+    CoapCode method;
+    const char *path;
+    const char *payload;
+} RouteCase;
+
+static const char *k_json =
+    "{\"temperatura\":25.5,\"humedad\":60.2,\"voltaje\":3.7,\"cantidad_producida\":150}";
+
+static size_t build_request(const RouteCase *rc, uint8_t *wire, size_t cap) {
+    static CoapMessage req;
+    coap_message_init(&req);
+    req.type = COAP_TYPE_CONFIRMABLE;
+    req.code = rc->method;
+    req.message_id = 0x4242;
+    req.token_length = 4;
+    memcpy(req.token, "\xde\xad\xbe\xef", 4);
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s", rc->path);
+    for (char *seg = strtok(path, "/"); seg; seg = strtok(NULL, "/")) {
+        coap_message_add_option(&req, COAP_OPTION_URI_PATH, (const uint8_t *)seg, strlen(seg));
+    }
+    if (rc->payload) {
+        uint8_t fmt = COAP_FORMAT_JSON;
+        coap_message_add_option(&req, COAP_OPTION_CONTENT_FORMAT, &fmt, 1);
+        req.payload = req.payload_buffer;
+        req.payload_length = strlen(rc->payload);
+        memcpy(req.payload_buffer, rc->payload, req.payload_length);
+    }
+    int n = coap_encode(&req, wire, cap);
+    assert(n > 0);
+    return (size_t)n;
+}
+
+// Mejor de ROUNDS rondas; 'resp_bytes' recibe el tamaño de la respuesta
+static double run_route(const RouteCase *rc, const uint8_t *wire, size_t len, size_t *resp_bytes) {
+    static CoapMessage req, resp;
+    static uint8_t out[COAP_MAX_MESSAGE_SIZE];
+    double best = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        uint64_t t0 = bench_now_ns();
+        for (int i = 0; i < ITERATIONS; i++) {
+            int rc_dec = coap_decode(&req, wire, len);
+            assert(rc_dec == COAP_CODEC_OK);
+            (void)rc_dec;
+            DispatchRoute route;
+            if (dispatcher_handle_request_routed(&req, &resp, &route) != 0 ||
+                route != rc->route) {
+                fprintf(stderr, "dispatch/%s: ruta inesperada\n", dispatcher_route_name(rc->route));
+                exit(1);
+            }
+            int n = coap_encode(&resp, out, sizeof(out));
+            assert(n > 0);
+            *resp_bytes = (size_t)n;
+            bench_escape(out);
+        }
+        double ns = (double)(bench_now_ns() - t0) / ITERATIONS;
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+int main(void) {
+    // Los handlers loguean cada request: sólo errores durante la medición
+    log_set_level(LOG_LEVEL_ERROR);
+    telemetry_storage_init();
+
+    static const RouteCase cases[] = {
+        { DISPATCH_ROUTE_TELEMETRY_POST, COAP_METHOD_POST, "api/v1/telemetry", NULL },
+        { DISPATCH_ROUTE_TELEMETRY_GET,  COAP_METHOD_GET,  "api/v1/telemetry", NULL },
+        { DISPATCH_ROUTE_HEALTH,         COAP_METHOD_GET,  "api/v1/health",    NULL },
+        { DISPATCH_ROUTE_STATUS,         COAP_METHOD_GET,  "api/v1/status",    NULL },
+        { DISPATCH_ROUTE_METRICS,        COAP_METHOD_GET,  "api/v1/metrics",   NULL },
+        { DISPATCH_ROUTE_TEST_ECHO,      COAP_METHOD_POST, "test/echo",        NULL },
+        { DISPATCH_ROUTE_TEST_SEPARATE,  COAP_METHOD_POST, "test/separate",    NULL },
+        { DISPATCH_ROUTE_HELLO,          COAP_METHOD_GET,  "hello",            NULL },
+        { DISPATCH_ROUTE_TIME,           COAP_METHOD_GET,  "time",             NULL },
+        { DISPATCH_ROUTE_ECHO,           COAP_METHOD_POST, "echo",             NULL },
+        { DISPATCH_ROUTE_UNMATCHED,      COAP_METHOD_GET,  "api/v1/missing",   NULL },
+    };
+
+    static uint8_t wire[COAP_MAX_MESSAGE_SIZE];
+    char name[64];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        RouteCase rc = cases[i];
+        // POST de ingesta y echos con el JSON típico de un dispositivo
+        if (rc.method == COAP_METHOD_POST) rc.payload = k_json;
+        if (rc.route == DISPATCH_ROUTE_TELEMETRY_GET) {
+            telemetry_storage_clear();
+            for (int k = 0; k < GET_ENTRIES; k++) telemetry_storage_add(k_json, strlen(k_json));
+        }
+        size_t len = build_request(&rc, wire, sizeof(wire));
+        size_t resp_bytes = 0;
+        double ns = run_route(&rc, wire, len, &resp_bytes);
+        snprintf(name, sizeof(name), "dispatch/%s", dispatcher_route_name(rc.route));
+        bench_emit("dispatch", name, ns, (double)(len + resp_bytes), ITERATIONS);
+    }
+    return 0;
+}
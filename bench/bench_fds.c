@@ -0,0 +1,72 @@
+/*
+ * bench_fds.c — Costo del event loop con miles de fds registrados.
+ *
+ * Registra N pipes (de 1k a 8k, más allá del antiguo límite de 1024 fds),
+ * mide el costo de add+remove por fd y el de una iteración en la que 64 de
+ * ellos están listos. Con la tabla paginada ambos deben ser independientes
+ * de N. Casos: add_remove/<N>fds e iteration/<N>fds (con events_per_iter).
+ */
+#include "bench.h"
+#include "event_loop.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define MAX_PIPES  8192
+#define READY      64
+#define ITERATIONS 2000
+
+static void on_ready(int fd, EventType events, void *user_data) {
+    (void)events; (void)fd;
+    (*(uint64_t *)user_data)++; // no lee: los fds listos siguen listos
+}
+
+int main(void) {
+    static int rd[MAX_PIPES], wr[MAX_PIPES];
+    struct rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    getrlimit(RLIMIT_NOFILE, &rl);
+
+    int max_pipes = 0;
+    while (max_pipes < MAX_PIPES && (rlim_t)(2 * max_pipes + 64) < rl.rlim_cur) {
+        int p[2];
+        if (pipe(p) != 0) break;
+        fcntl(p[0], F_SETFL, fcntl(p[0], F_GETFL, 0) | O_NONBLOCK);
+        rd[max_pipes] = p[0];
+        wr[max_pipes] = p[1];
+        max_pipes++;
+    }
+    for (int i = 0; i < READY && i < max_pipes; i++) {
+        if (write(wr[i], "x", 1) != 1) return 1;
+    }
+
+    char name[64];
+    for (int n = 1024; n <= max_pipes; n *= 2) {
+        EventLoop *loop = event_loop_create();
+        if (!loop) return 1;
+        uint64_t events = 0;
+
+        uint64_t t0 = bench_now_ns();
+        for (int i = 0; i < n; i++) event_loop_add_fd(loop, rd[i], EVENT_READ, on_ready, &events);
+        for (int i = 0; i < n; i++) event_loop_remove_fd(loop, rd[i]);
+        double reg_ns = (double)(bench_now_ns() - t0) / n;
+
+        for (int i = 0; i < n; i++) event_loop_add_fd(loop, rd[i], EVENT_READ, on_ready, &events);
+        t0 = bench_now_ns();
+        for (int i = 0; i < ITERATIONS; i++) event_loop_run(loop, 0);
+        double iter_ns = (double)(bench_now_ns() - t0) / ITERATIONS;
+
+        snprintf(name, sizeof(name), "add_remove/%dfds", n);
+        bench_emit("fds", name, reg_ns, -1, (uint64_t)n);
+        snprintf(name, sizeof(name), "iteration/%dfds", n);
+        bench_emit_extra("fds", name, iter_ns, -1, ITERATIONS,
+                         "events_per_iter", (double)events / ITERATIONS);
+        event_loop_destroy(loop);
+    }
+    for (int i = 0; i < max_pipes; i++) { close(rd[i]); close(wr[i]); }
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * bench_storage.c — Throughput de ingesta concurrente en telemetry_storage.
+ *
+ * Lanza de 1 a N hilos productores que insertan JSON de telemetría típicos y
+ * reporta inserciones por segundo para cada cantidad de hilos, en modo
+ * compartido (un ring) y sharded (un ring por hilo). Casos:
+ * ingest_<modo>/<N>threads con ns/op de pared y ops_per_sec agregadas.
+ */
+#include "bench.h"
+#include "telemetry_storage.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#define OPS_PER_THREAD 500000
+#define MAX_THREADS    16
+
+static const char *k_json =
+    "{\"temperatura\":25.5,\"humedad\":60.2,\"voltaje\":3.7,\"cantidad_producida\":150}";
+
+static void *producer(void *arg) {
+    (void)arg;
+    size_t len = strlen(k_json);
+    for (int i = 0; i < OPS_PER_THREAD; i++) telemetry_storage_add(k_json, len);
+    return NULL;
+}
+
+int main(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cpus > 4 ? (int)cpus : 4;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+    const TelemetryStorageMode modes[] = {TELEMETRY_MODE_SHARED, TELEMETRY_MODE_SHARDED};
+    for (size_t m = 0; m < 2; m++) {
+        const char *mode = modes[m] == TELEMETRY_MODE_SHARDED ? "sharded" : "shared";
+        for (int n = 1; n <= max_threads; n *= 2) {
+            telemetry_storage_init_mode(modes[m]);
+            pthread_t th[MAX_THREADS];
+            uint64_t t0 = bench_now_ns();
+            for (int i = 0; i < n; i++) pthread_create(&th[i], NULL, producer, NULL);
+            for (int i = 0; i < n; i++) pthread_join(th[i], NULL);
+            double secs = (double)(bench_now_ns() - t0) / 1e9;
+            double ops = (double)n * OPS_PER_THREAD;
+            char name[64];
+            snprintf(name, sizeof(name), "ingest_%s/%dthreads", mode, n);
+            bench_emit_extra("storage", name, secs * 1e9 / ops, (double)strlen(k_json),
+                             (uint64_t)ops, "ops_per_sec", ops / secs);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * bench_timers.c — Costo del event loop según la cantidad de timers armados.
+ *
+ * Arma de 10 a 100k timers lejanos (no vencen durante la medición) y mide el
+ * costo de una iteración vacía de event_loop_run, más el costo de armar y
+ * cancelar un timer. Con el heap de timers ambos deben mantenerse planos.
+ * Casos: iteration/<N>timers y add_cancel/<N>timers.
+ */
+#include "bench.h"
+#include "event_loop.h"
+
+#include <stdlib.h>
+
+#define ITERATIONS 20000
+#define CHURN      100000
+#define MAX_ARMED  100000
+
+static void never(void *user_data) {
+    (void)user_data;
+}
+
+int main(void) {
+    static int ids[MAX_ARMED];
+    char name[64];
+    for (int armed = 10; armed <= MAX_ARMED; armed *= 10) {
+        EventLoop *loop = event_loop_create();
+        if (!loop) return 1;
+        for (int i = 0; i < armed; i++) {
+            ids[i] = event_loop_add_timer(loop, 3600000 + (uint64_t)(i % 1000), false, never, NULL);
+        }
+
+        uint64_t t0 = bench_now_ns();
+        for (int i = 0; i < ITERATIONS; i++) event_loop_run(loop, 0);
+        double iter_ns = (double)(bench_now_ns() - t0) / ITERATIONS;
+
+        t0 = bench_now_ns();
+        for (int i = 0; i < CHURN; i++) {
+            event_loop_remove_timer(loop, event_loop_add_timer(loop, 1000 + (uint64_t)(i % 512), false, never, NULL));
+        }
+        double churn_ns = (double)(bench_now_ns() - t0) / CHURN;
+
+        snprintf(name, sizeof(name), "iteration/%dtimers", armed);
+        bench_emit("timers", name, iter_ns, -1, ITERATIONS);
+        snprintf(name, sizeof(name), "add_cancel/%dtimers", armed);
+        bench_emit("timers", name, churn_ns, -1, CHURN);
+        for (int i = 0; i < armed; i++) event_loop_remove_timer(loop, ids[i]);
+        event_loop_destroy(loop);
+    }
+    return 0;
+}
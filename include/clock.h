@@ -0,0 +1,31 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fuentes de tiempo
+// - Monotónica: para timers, timeouts y latencias. No retrocede ni salta
+//   cuando NTP (o un operador) ajusta la hora del sistema.
+// - Pared (UTC desde epoch): sólo para timestamps visibles (telemetría, logs).
+uint64_t clock_monotonic_ns(void);
+uint64_t clock_monotonic_ms(void);
+uint64_t clock_wall_ms(void);
+
+// "Ahora" cacheado por hilo. El event loop llama a clock_refresh() una vez por
+// despertar; los callbacks leen clock_now_* sin syscalls y ven todos el mismo
+// instante. Fuera del loop (o antes del primer refresh) se lee el reloj real.
+void clock_refresh(void);
+void clock_invalidate(void);   // El hilo deja de usar el valor cacheado
+uint64_t clock_now_ns(void);   // Monotónico
+uint64_t clock_now_ms(void);   // Monotónico
+uint64_t clock_wall_now_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CLOCK_H
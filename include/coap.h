@@ -13,6 +13,11 @@
 #define COAP_PAYLOAD_MARKER 0xFF
 #define COAP_MAX_MESSAGE_SIZE 1472
 
+// Parámetros de transmisión de mensajes CON (RFC 7252 §4.8)
+#define COAP_ACK_TIMEOUT_MS 2000
+#define COAP_ACK_RANDOM_FACTOR_PCT 150   // ACK_RANDOM_FACTOR = 1.5
+#define COAP_MAX_RETRANSMIT 4
+
 // Tipos de mensaje
 typedef enum {
     COAP_TYPE_CONFIRMABLE = 0,      // CON
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/uio.h>
 
 #include "coap.h"
 
@@ -24,8 +25,14 @@ typedef enum {
 // - buffer: bytes del mensaje (datagrama UDP)
 // - length: tamaño del buffer
 // Retorna 0 en éxito o < 0 en error.
+// Usa un fast path para requests CON/NON comunes y recurre al decodificador
+// genérico ante cualquier caso inusual (los errores siempre los reporta éste).
 int coap_decode(CoapMessage *msg, const uint8_t *buffer, size_t length);
 
+// Decodificador genérico (sin fast path). Mismo contrato que coap_decode; se
+// expone para pruebas de equivalencia y benchmarks.
+int coap_decode_generic(CoapMessage *msg, const uint8_t *buffer, size_t length);
+
 // Codifica un CoapMessage en el buffer de salida.
 // - msg: mensaje a serializar
 // - out: buffer destino
@@ -33,6 +40,15 @@ int coap_decode(CoapMessage *msg, const uint8_t *buffer, size_t length);
 // Retorna cantidad de bytes escritos (>0) o <0 en error (p.ej., COAP_CODEC_E2SMALL).
 int coap_encode(const CoapMessage *msg, uint8_t *out, size_t out_size);
 
+// Codificación scatter/gather (sin copiar el payload).
+// - hdr/hdr_size: buffer para header, token, opciones y payload marker
+// - iov: recibe hasta COAP_ENCODE_IOV_MAX elementos; iov[1] apunta a msg->payload
+// - iov_count: cantidad de elementos usados (1 sin payload, 2 con payload)
+// Retorna el tamaño total del datagrama (>0) o <0 en error.
+#define COAP_ENCODE_IOV_MAX 2
+int coap_encode_iov(const CoapMessage *msg, uint8_t *hdr, size_t hdr_size,
+                    struct iovec iov[COAP_ENCODE_IOV_MAX], size_t *iov_count);
+
 // Validación ligera previa al encode
 bool coap_message_can_encode(const CoapMessage *msg);
 
@@ -0,0 +1,82 @@
+#ifndef COAP_OUTBOUND_H
+#define COAP_OUTBOUND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include "coap.h"
+#include "event_loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Motor de transmisión confiable de mensajes CON originados por el servidor
+// (respuestas separadas, notificaciones). Estado por peer (tabla hash por
+// dirección) y por mensaje (tabla hash por peer + message ID):
+// - Retransmisión con backoff (RFC 7252 §4.2) y timeout inicial aleatorizado.
+// - NSTART: a lo sumo 'nstart' CON en vuelo por peer; el resto espera en cola.
+// - RTO por peer al estilo CoCoA (draft-ietf-core-cocoa): estimadores fuerte
+//   y débil, backoff variable y envejecimiento del RTO.
+// - Pacing por peer con token bucket (primeras transmisiones).
+// Todo corre en el hilo del loop; sin locking interno.
+typedef struct CoapOutbound CoapOutbound;
+
+typedef enum {
+    OUTBOUND_ACKED = 0,     // ACK (vacío o piggyback) del peer
+    OUTBOUND_RESET,         // RST del peer
+    OUTBOUND_TIMEOUT,       // MAX_RETRANSMIT agotado sin ACK
+    OUTBOUND_CANCELLED      // Motor destruido con el mensaje pendiente
+} OutboundResult;
+
+// Resultado final de un CON (una única vez, en el hilo del loop)
+typedef void (*OutboundDone)(void *user_data, OutboundResult result);
+
+typedef struct {
+    uint32_t ack_timeout_ms;    // RTO inicial de un peer sin muestras
+    uint32_t ack_random_pct;    // ACK_RANDOM_FACTOR en % (150 = 1.5)
+    unsigned max_retransmit;
+    unsigned nstart;            // CON en vuelo por peer
+    size_t max_queue;           // CON en espera por peer (extra => EAGAIN)
+    uint32_t pace_rate;         // Primeras transmisiones por segundo y peer (0 = sin pacing)
+    uint32_t pace_burst;
+} OutboundConfig;
+
+// Valores de RFC 7252 (2 s, 1.5, 4, NSTART 1), cola de 64 y pacing de
+// 100 msg/s con ráfaga de 20 por peer.
+void coap_outbound_config_default(OutboundConfig *cfg);
+
+// 'sock' es el socket UDP por el que se envía. cfg NULL => valores por defecto.
+CoapOutbound *coap_outbound_create(EventLoop *loop, int sock, const OutboundConfig *cfg);
+
+// Cancela lo pendiente (done con OUTBOUND_CANCELLED) y libera.
+void coap_outbound_destroy(CoapOutbound *ob);
+
+// Envía un CON ya codificado. El motor asigna el message ID (lo escribe en
+// wire[2..3] de su copia) y lo retorna (>= 0), o PLATFORM_EAGAIN si la cola
+// del peer está llena, PLATFORM_ENOMEM o PLATFORM_EINVAL.
+int coap_outbound_send(CoapOutbound *ob, const struct sockaddr *peer, socklen_t peer_len,
+                       const uint8_t *wire, size_t wire_len,
+                       OutboundDone done, void *user_data);
+
+// Próximo message ID para 'peer' (mensajes NON sin seguimiento). <0 en error.
+int coap_outbound_next_mid(CoapOutbound *ob, const struct sockaddr *peer, socklen_t peer_len);
+
+// Procesa un ACK/RST entrante. Retorna true si cerró un CON pendiente.
+bool coap_outbound_on_message(CoapOutbound *ob, const CoapMessage *msg,
+                              const struct sockaddr *peer, socklen_t peer_len);
+
+// Observabilidad (y tests)
+size_t coap_outbound_inflight(const CoapOutbound *ob);
+size_t coap_outbound_queued(const CoapOutbound *ob);
+size_t coap_outbound_peer_count(const CoapOutbound *ob);
+// RTO actual del peer en ms (0 si el peer no existe)
+uint32_t coap_outbound_peer_rto_ms(const CoapOutbound *ob, const struct sockaddr *peer,
+                                   socklen_t peer_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COAP_OUTBOUND_H
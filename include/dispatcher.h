@@ -6,8 +6,86 @@
 #include <stdbool.h>
 #include "coap.h"
 
+// Rutas conocidas (path + método). Identifican la request en métricas.
+typedef enum {
+    DISPATCH_ROUTE_TELEMETRY_POST = 0,
+    DISPATCH_ROUTE_TELEMETRY_GET,
+    DISPATCH_ROUTE_HEALTH,
+    DISPATCH_ROUTE_STATUS,
+    DISPATCH_ROUTE_METRICS,
+    DISPATCH_ROUTE_TEST_ECHO,
+    DISPATCH_ROUTE_TEST_SEPARATE,
+    DISPATCH_ROUTE_HELLO,
+    DISPATCH_ROUTE_TIME,
+    DISPATCH_ROUTE_ECHO,
+    DISPATCH_ROUTE_UNMATCHED,   // 4.00 / 4.04 / 4.05 o request inválida
+    DISPATCH_ROUTE_COUNT
+} DispatchRoute;
+
+// Prioridad de una ruta bajo sobrecarga: la ingesta se atiende siempre; las
+// lecturas (dashboards, legacy, status) son las primeras en descartarse.
+typedef enum {
+    DISPATCH_PRIORITY_HIGH = 0, // Ingesta de telemetría y health
+    DISPATCH_PRIORITY_NORMAL,   // Rutas de testing y requests sin ruta
+    DISPATCH_PRIORITY_LOW,      // GET de telemetría, status, métricas, legacy
+    DISPATCH_PRIORITY_COUNT
+} DispatchPriority;
+
+// Retorno de un handler (y del dispatcher) que difirió su respuesta
+#define DISPATCH_DEFERRED 1
+
 // Procesa una request CoAP y construye la respuesta en 'resp'.
 // - Retorna 0 si se pudo enrutar y responder, <0 si ocurrió un error.
+// - Retorna DISPATCH_DEFERRED si el handler difirió la respuesta ('resp' no
+//   se usa; llegará por dispatcher_complete).
 int dispatcher_handle_request(const CoapMessage *req, CoapMessage *resp);
 
+// Igual que dispatcher_handle_request; además informa en 'route' (opcional)
+// la ruta resuelta (DISPATCH_ROUTE_UNMATCHED si no hubo handler).
+int dispatcher_handle_request_routed(const CoapMessage *req, CoapMessage *resp,
+                                     DispatchRoute *route);
+
+// Resuelve sólo la ruta (path + método) sin ejecutar el handler.
+// DISPATCH_ROUTE_UNMATCHED si la request es inválida o no tiene handler.
+DispatchRoute dispatcher_match_route(const CoapMessage *req);
+
+// true si la ruta es costosa en CPU (serialización de rangos, formateo de
+// métricas) y conviene ejecutarla fuera del hilo de I/O (pool de workers).
+// Su handler debe ser seguro desde cualquier hilo.
+bool dispatcher_route_offload(DispatchRoute route);
+
+// Prioridad de la ruta (DISPATCH_PRIORITY_NORMAL si es desconocida).
+DispatchPriority dispatcher_route_priority(DispatchRoute route);
+
+// Prioridad de un datagrama sin decodificarlo: lee sólo cabecera, método y
+// Uri-Path. ACK/RST y mensajes vacíos son HIGH (liberan estado propio); un
+// datagrama malformado es NORMAL (el decode completo lo rechazará).
+DispatchPriority dispatcher_peek_priority(const uint8_t *buf, size_t len);
+
+// Nombre corto de una prioridad ("high", "normal", "low"), para métricas.
+const char *dispatcher_priority_name(DispatchPriority priority);
+
+// Respuestas separadas (RFC 7252 §5.2.2). Un handler lento llama
+// dispatcher_defer(req); si obtiene un handle, retorna DISPATCH_DEFERRED y
+// más tarde (desde cualquier hilo) llama dispatcher_complete exactamente una
+// vez con la respuesta (code, opciones y payload; tipo, MID y token los pone
+// el transporte). El transporte confirma la request de inmediato (ACK vacío
+// para CON) y envía la respuesta después como mensaje propio.
+typedef struct DispatchDeferred DispatchDeferred;
+struct DispatchDeferred {
+    void (*complete)(DispatchDeferred *deferred, const CoapMessage *resp);
+};
+
+// Proveedor de handles que el transporte instala en el hilo actual mientras
+// despacha. Sin proveedor (fn NULL) dispatcher_defer retorna NULL y el
+// handler debe responder en línea.
+typedef DispatchDeferred *(*DispatchDeferFn)(void *ctx, const CoapMessage *req);
+void dispatcher_set_defer(DispatchDeferFn fn, void *ctx);
+
+DispatchDeferred *dispatcher_defer(const CoapMessage *req);
+void dispatcher_complete(DispatchDeferred *deferred, const CoapMessage *resp);
+
+// Nombre corto y estable de una ruta (p.ej. "telemetry_get"), para métricas.
+const char *dispatcher_route_name(DispatchRoute route);
+
 #endif // DISPATCHER_H
\ No newline at end of file
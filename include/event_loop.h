@@ -5,10 +5,18 @@
 #include <stdint.h>
 
 // Tipos de eventos (bitmask)
+// - EVENT_EDGE: notificación por flanco (EPOLLET / EV_CLEAR). El callback debe
+//   drenar el fd hasta EAGAIN o, si corta antes (presupuesto agotado), llamar
+//   a event_loop_mark_pending; si no, no se vuelve a notificar hasta que
+//   lleguen datos nuevos.
+// - EVENT_EXCLUSIVE: para un fd compartido entre varios loops, despierta sólo
+//   a uno por evento (EPOLLEXCLUSIVE). Sin efecto en kqueue.
 typedef enum {
-	EVENT_READ  = 0x01,
-	EVENT_WRITE = 0x02,
-	EVENT_ERROR = 0x04
+	EVENT_READ      = 0x01,
+	EVENT_WRITE     = 0x02,
+	EVENT_ERROR     = 0x04,
+	EVENT_EDGE      = 0x08,
+	EVENT_EXCLUSIVE = 0x10
 } EventType;
 
 // Callback para FD
@@ -17,6 +25,9 @@ typedef void (*EventCallback)(int fd, EventType events, void *user_data);
 // Callback para timer
 typedef void (*TimerCallback)(void *user_data);
 
+// Tarea encolada con event_loop_post
+typedef void (*TaskCallback)(void *arg);
+
 // Estructura opaca del event loop
 typedef struct EventLoop EventLoop;
 
@@ -31,8 +42,40 @@ int event_loop_modify_fd(EventLoop *loop, int fd, EventType events);
 
 int event_loop_add_timer(EventLoop *loop, uint64_t timeout_ms,
 						  bool periodic, TimerCallback callback, void *user_data);
+// Igual que event_loop_add_timer con resolución de microsegundos (epoll:
+// timerfd; kqueue: timeout de kevent en ns)
+int event_loop_add_timer_us(EventLoop *loop, uint64_t timeout_us,
+							bool periodic, TimerCallback callback, void *user_data);
+// Cancelar un ID ya vencido o cancelado no hace nada: un ID sólo podría
+// volver a coincidir con el de otro timer tras ~16M timers armados y
+// liberados después de él (ver timer_heap.h).
 void event_loop_remove_timer(EventLoop *loop, int timer_id);
 
+// Encola fn(arg) para ejecutarse en el hilo del loop. Seguro desde cualquier
+// hilo (cola MPSC sin locks + eventfd/pipe para despertar). Orden FIFO por
+// hilo productor; se drenan hasta EVENT_LOOP_POST_BATCH tareas por despertar.
+// Retorna PLATFORM_OK, PLATFORM_ENOMEM o PLATFORM_EINVAL. Las tareas pendientes
+// al destruir el loop se descartan sin ejecutarse.
+#define EVENT_LOOP_POST_BATCH 256
+int event_loop_post(EventLoop *loop, TaskCallback fn, void *arg);
+
+// Pide volver a invocar el callback de 'fd' (con EVENT_READ) en la próxima
+// vuelta, después de los timers y del resto de la I/O, sin bloquear en la
+// espera. Es el re-armado de un callback que cortó por presupuesto. Varias
+// llamadas antes de esa vuelta cuentan como una. Sólo desde el hilo del loop.
+// Retorna PLATFORM_OK, PLATFORM_EINVAL (fd no registrado) o PLATFORM_ENOMEM.
+int event_loop_mark_pending(EventLoop *loop, int fd);
+
+// Utilización del loop: tiempo despachando (timers, callbacks, tareas) vs
+// bloqueado en la espera de eventos, acumulado desde la creación. Sólo el
+// tiempo dentro de event_loop_run; leer desde el hilo del loop.
+typedef struct {
+	uint64_t busy_ns;
+	uint64_t idle_ns;
+	uint64_t iterations;
+} EventLoopStats;
+void event_loop_get_stats(EventLoop *loop, EventLoopStats *out);
+
 // Ejecuta el loop:
 // - timeout_ms < 0 => corre hasta event_loop_stop()
 // - timeout_ms >= 0 => procesa una iteración con ese timeout y retorna
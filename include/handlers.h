@@ -21,9 +21,19 @@ int handle_health(const CoapMessage *req, CoapMessage *resp);
 // GET /api/v1/status - Estadísticas del servidor
 int handle_status(const CoapMessage *req, CoapMessage *resp);
 
+// GET /api/v1/metrics - Contadores, latencia por etapa y por clase
+int handle_metrics(const CoapMessage *req, CoapMessage *resp);
+// GET /api/v1/metrics/routes - Latencia por ruta
+int handle_metrics_routes(const CoapMessage *req, CoapMessage *resp);
+// GET /api/v1/metrics/queues - Espera y profundidad de las colas de recepción
+int handle_metrics_queues(const CoapMessage *req, CoapMessage *resp);
+
 // === Rutas de Testing ===
 // POST /test/echo - Echo para debugging
 int handle_test_echo(const CoapMessage *req, CoapMessage *resp);
+// POST /test/separate - Echo como respuesta separada (dispatcher_defer); sin
+// soporte del transporte responde en línea como /test/echo
+int handle_test_separate(const CoapMessage *req, CoapMessage *resp);
 
 // === Rutas Legacy (deprecadas, mantener para compatibilidad) ===
 int handle_hello(const CoapMessage *req, CoapMessage *resp);
@@ -0,0 +1,36 @@
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "event_loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Límites del listener HTTP
+#define HTTP_MAX_CONNECTIONS 64        // Conexiones simultáneas (extra => se cierran)
+#define HTTP_REQUEST_MAX 4096          // Bytes de request (línea + headers)
+#define HTTP_MAX_REQUESTS_PER_EVENT 8  // Requests procesadas por callback
+#define HTTP_HEADER_TIMEOUT_MS 5000    // Cabecera incompleta => se cierra
+#define HTTP_IDLE_TIMEOUT_MS 30000     // Sin lecturas ni escrituras => se cierra
+
+// Listener HTTP/1.1 de sólo lectura (métricas y consultas) sobre un EventLoop
+typedef struct HttpServer HttpServer;
+
+// Crea el listener TCP en 'port' (0 = efímero) y lo registra en 'loop'.
+// Retorna NULL en error.
+HttpServer *http_server_create(EventLoop *loop, uint16_t port, bool verbose);
+
+// Cierra todas las conexiones y el socket de escucha.
+void http_server_destroy(HttpServer *http);
+
+// Puerto efectivamente enlazado
+uint16_t http_server_get_port(const HttpServer *http);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_H
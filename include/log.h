@@ -3,6 +3,8 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <sys/socket.h>
 
 #include "coap.h"
@@ -18,9 +20,35 @@ typedef enum {
     LOG_LEVEL_DEBUG = 3
 } LogLevel;
 
+// Nivel mínimo en tiempo de compilación: los LOG_* por debajo se eliminan
+// (argumentos incluidos) por ser una condición constante falsa. Se fija con
+// -DLOG_COMPILE_LEVEL=<0..3>; por defecto se compila todo (DEBUG).
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 3
+#endif
+
+// Nivel en tiempo de ejecución. Se lee inline en cada sitio de log para que un
+// mensaje filtrado no cueste una llamada ni evaluar sus argumentos. Modificar
+// sólo con log_set_level (típicamente al arrancar).
+extern LogLevel log_runtime_level;
+
+static inline bool log_level_enabled(LogLevel level) {
+    return (int)level <= LOG_COMPILE_LEVEL && level <= log_runtime_level;
+}
+
 void log_set_level(LogLevel level);
 void log_set_stream(FILE *stream);
-void log_printf(LogLevel level, const char *fmt, ...);
+void log_printf(LogLevel level, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Modo asíncrono: los registros se encolan en un ring por hilo (sin locks) y
+// un hilo en segundo plano los formatea y escribe. 'fmt' debe ser un literal
+// (duración estática). Cadenas %s se copian hasta LOG_MAX_STRING_ARG bytes.
+#define LOG_MAX_STRING_ARG 512
+int log_start_async(void);        // 0 en éxito, -1 si no se pudo crear el hilo
+void log_stop_async(void);        // Drena lo pendiente y vuelve a modo síncrono
+uint64_t log_dropped_count(void); // Registros descartados por ring lleno
+size_t log_ring_count(void);      // Rings creados (hilos simultáneos que loguearon)
 
 // Logs auxiliares para CoAP
 // - RX: registra requests CoAP válidas (método, path, peer, MID, TKL, payload bytes)
@@ -28,10 +56,54 @@ void log_printf(LogLevel level, const char *fmt, ...);
 void log_coap_rx(const CoapMessage *msg, const struct sockaddr *peer, socklen_t peer_len);
 void log_coap_tx(const CoapMessage *msg, const struct sockaddr *peer, socklen_t peer_len);
 
-#define LOG_ERROR(...) log_printf(LOG_LEVEL_ERROR, __VA_ARGS__)
-#define LOG_WARN(...)  log_printf(LOG_LEVEL_WARN,  __VA_ARGS__)
-#define LOG_INFO(...)  log_printf(LOG_LEVEL_INFO,  __VA_ARGS__)
-#define LOG_DEBUG(...) log_printf(LOG_LEVEL_DEBUG, __VA_ARGS__)
+// Rate limiting por sitio de llamada (token bucket, implementado como GCRA
+// sobre un único contador atómico). Cada macro LOG_*_RL tiene su propio
+// estado estático. Los mensajes suprimidos se cuentan y se reportan como
+// "N messages suppressed at archivo:línea" cuando el sitio vuelve a emitir o,
+// si sigue suprimiendo o calla, en el siguiente log_rate_limit_flush.
+typedef struct LogRateLimit {
+    _Atomic uint64_t tat_ns;      // Theoretical arrival time (GCRA)
+    _Atomic uint64_t suppressed;  // Suprimidos desde la última emisión
+    _Atomic bool registered;      // Ya está en la lista de sitios a vaciar
+    struct LogRateLimit *next;    // Siguiente sitio registrado
+    const char *file;             // Sitio (fijado al registrarse)
+    int line;
+    LogLevel level;
+} LogRateLimit;
+
+#define LOG_RL_DEFAULT_RATE 10    // Mensajes por segundo sostenidos
+#define LOG_RL_DEFAULT_BURST 20   // Ráfaga máxima
+#define LOG_RL_FLUSH_MS 1000      // Período mínimo entre vaciados de suprimidos
+
+// true si el sitio puede emitir (y reporta los suprimidos pendientes)
+bool log_rate_limit_allow(LogRateLimit *rl, uint32_t per_sec, uint32_t burst,
+                          LogLevel level, const char *file, int line);
+
+// Reporta los suprimidos pendientes de todos los sitios que alguna vez
+// suprimieron. Llamadas más seguidas que LOG_RL_FLUSH_MS no hacen nada. El
+// escritor asíncrono la invoca solo; en modo síncrono, un timer del llamador.
+void log_rate_limit_flush(void);
+
+#define LOG_AT(level, ...) do { \
+    if (log_level_enabled(level)) log_printf((level), __VA_ARGS__); \
+} while (0)
+
+#define LOG_AT_RL(level, per_sec, burst, ...) do { \
+    if (log_level_enabled(level)) { \
+        static LogRateLimit log_rl_site_; \
+        if (log_rate_limit_allow(&log_rl_site_, (per_sec), (burst), (level), __FILE__, __LINE__)) \
+            log_printf((level), __VA_ARGS__); \
+    } \
+} while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN,  __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO,  __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#define LOG_ERROR_RL(...) LOG_AT_RL(LOG_LEVEL_ERROR, LOG_RL_DEFAULT_RATE, LOG_RL_DEFAULT_BURST, __VA_ARGS__)
+#define LOG_WARN_RL(...)  LOG_AT_RL(LOG_LEVEL_WARN,  LOG_RL_DEFAULT_RATE, LOG_RL_DEFAULT_BURST, __VA_ARGS__)
+#define LOG_INFO_RL(...)  LOG_AT_RL(LOG_LEVEL_INFO,  LOG_RL_DEFAULT_RATE, LOG_RL_DEFAULT_BURST, __VA_ARGS__)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,124 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "coap.h"
+#include "dispatcher.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Histogramas log-lineales (estilo HDR): 2^METRICS_SUB_BITS sub-buckets
+// lineales por potencia de dos => error relativo <= 1/16 (6.25%).
+#define METRICS_SUB_BITS 4
+#define METRICS_MAX_EXPONENT 40   // valores >= 2^40 ns (~18 min) se saturan
+#define METRICS_HIST_BUCKETS ((METRICS_MAX_EXPONENT - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS)
+
+// Contadores (descartes y volumen)
+typedef enum {
+    METRIC_RX_DATAGRAMS = 0,    // Datagramas recibidos
+    METRIC_DROP_DECODE,         // coap_decode falló (datagrama descartado)
+    METRIC_DROP_DISPATCH,       // dispatcher retornó error (respuesta 4.00)
+    METRIC_DROP_ENCODE,         // coap_encode falló (respuesta descartada)
+    METRIC_DROP_SEND,           // sendmsg falló
+    METRIC_BUSY_POLL_SPIN_NS,   // Tiempo girando en recv no bloqueante (busy-poll)
+    METRIC_BUSY_POLL_SLEEP_NS,  // Tiempo en espera bloqueante del loop (busy-poll)
+    METRIC_BUSY_POLL_RX,        // Datagramas obtenidos durante el giro
+    METRIC_BUSY_POLL_SLEEPS,    // Veces que se agotó el giro y se durmió
+    METRIC_OFFLOADED,           // Requests delegadas al pool de workers
+    METRIC_SEPARATE,            // Respuestas separadas enviadas
+    METRIC_RETRANSMIT,          // Retransmisiones de mensajes CON propios
+    METRIC_SEPARATE_TIMEOUT,    // Respuestas separadas CON abandonadas sin ACK
+    METRIC_OUTBOUND_QUEUED,     // CON propios que esperaron por NSTART o pacing
+    METRIC_RATE_LIMITED,        // Datagramas rechazados por la admisión por peer
+    METRIC_SHED,                // Requests respondidas con 5.03 por sobrecarga
+    METRIC_OVERLOADED_NS,       // Tiempo con el control de sobrecarga activo
+    METRIC_LOOP_BUSY_NS,        // Tiempo del loop despachando (timers, I/O, tareas)
+    METRIC_LOOP_IDLE_NS,        // Tiempo del loop bloqueado esperando eventos
+    METRIC_RX_BUDGET_EXHAUSTED, // Lecturas cortadas por presupuesto (re-armadas)
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+// Etapas de process_datagram
+typedef enum {
+    METRIC_STAGE_DECODE = 0,
+    METRIC_STAGE_DISPATCH,
+    METRIC_STAGE_ENCODE,
+    METRIC_STAGE_SEND,
+    METRIC_STAGE_COUNT
+} MetricStage;
+
+// Clase de la respuesta (código CoAP c.dd)
+typedef enum {
+    METRIC_CLASS_2XX = 0,
+    METRIC_CLASS_4XX,
+    METRIC_CLASS_5XX,
+    METRIC_CLASS_OTHER,
+    METRIC_CLASS_COUNT
+} MetricClass;
+
+// Resumen de un histograma (valores en ns)
+typedef struct {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+} MetricsSummary;
+
+// Registro (hot path). Cada hilo escribe en su propio shard: sin contención
+// ni operaciones read-modify-write atómicas.
+void metrics_count(MetricCounter counter, uint64_t n);
+void metrics_record_stage(MetricStage stage, uint64_t ns);
+// Latencia total de una request por ruta y por clase de respuesta.
+void metrics_record_request(DispatchRoute route, CoapCode code, uint64_t ns);
+
+// Cola de recepción por prioridad: espera de cada datagrama entre su lectura
+// del socket y su proceso, y profundidad de la clase en cada lote leído.
+void metrics_record_queue_wait(DispatchPriority priority, uint64_t ns);
+void metrics_record_queue_depth(DispatchPriority priority, size_t depth);
+
+// Lectura: suma todos los shards (valores aproximados bajo escritura concurrente).
+uint64_t metrics_counter_value(MetricCounter counter);
+void metrics_stage_summary(MetricStage stage, MetricsSummary *out);
+void metrics_route_summary(DispatchRoute route, MetricsSummary *out);
+void metrics_class_summary(MetricClass cls, MetricsSummary *out);
+void metrics_queue_wait_summary(DispatchPriority priority, MetricsSummary *out);
+// Profundidad en datagramas (en los campos *_ns del resumen).
+void metrics_queue_depth_summary(DispatchPriority priority, MetricsSummary *out);
+
+// Clase de un código de respuesta CoAP.
+MetricClass metrics_class_of(CoapCode code);
+const char *metrics_class_name(MetricClass cls);
+const char *metrics_stage_name(MetricStage stage);
+const char *metrics_counter_name(MetricCounter counter);
+
+// Secciones del JSON de métricas (una por recurso CoAP); cada una cabe en un
+// datagrama con el registro completo poblado.
+typedef enum {
+    METRICS_JSON_PIPELINE = 0,  // Contadores no nulos, etapas y clases
+    METRICS_JSON_ROUTES,        // Latencia por ruta
+    METRICS_JSON_QUEUES,        // Espera y profundidad de las colas por prioridad
+    METRICS_JSON_SECTION_COUNT
+} MetricsJsonSection;
+
+// Serializa una sección como JSON compacto (latencias en µs, histogramas como
+// [n,p50,p99,p999,max], se omiten los vacíos). Retorna longitud escrita o
+// negativo en error.
+int metrics_format_json(MetricsJsonSection section, char *out, size_t out_size);
+
+// Serializa las métricas en formato de texto de Prometheus (summaries con
+// cuantiles 0.5/0.99/0.999, en segundos). Retorna longitud o negativo.
+int metrics_format_prometheus(char *out, size_t out_size);
+
+// Pone a cero todos los shards (testing; no usar con escritores activos).
+void metrics_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,56 @@
+#ifndef OVERLOAD_H
+#define OVERLOAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dispatcher.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Niveles del controlador: cada uno descarta una prioridad más
+#define OVERLOAD_LEVEL_NONE 0   // Todo se atiende
+#define OVERLOAD_LEVEL_SHED_LOW 1    // 5.03 para DISPATCH_PRIORITY_LOW
+#define OVERLOAD_LEVEL_SHED_NORMAL 2 // ... y DISPATCH_PRIORITY_NORMAL
+// Max-Age máximo sugerido en un 5.03 por sobrecarga (s)
+#define OVERLOAD_MAX_AGE_S 60
+
+// Detector de sobrecarga: combina el lag del loop (retraso con el que dispara
+// un timer periódico) y el backlog por despertar (datagramas drenados de una
+// vez) en una presión relativa a sus umbrales. La presión sube de nivel al
+// cruzar 1x y 2x y baja con histéresis (a la mitad del umbral del nivel). No
+// es thread-safe: se usa desde el hilo del loop.
+typedef struct OverloadController OverloadController;
+
+typedef struct {
+    uint32_t lag_threshold_us;  // Lag sostenido que se considera sobrecarga
+    uint32_t backlog_threshold; // Datagramas por despertar sostenidos
+} OverloadConfig;
+
+OverloadController *overload_create(const OverloadConfig *cfg);
+void overload_destroy(OverloadController *oc);
+
+// Muestras (promedios móviles exponenciales)
+void overload_record_lag(OverloadController *oc, uint64_t lag_us);
+void overload_record_backlog(OverloadController *oc, size_t datagrams);
+
+// Recalcula el nivel con las muestras acumuladas. Retorna el nivel nuevo.
+unsigned overload_update(OverloadController *oc);
+unsigned overload_level(const OverloadController *oc);
+// Presión actual en % del umbral (100 = en el umbral)
+uint32_t overload_pressure_pct(const OverloadController *oc);
+
+// true si una request de esa prioridad debe recibir 5.03 en el nivel actual.
+bool overload_should_shed(const OverloadController *oc, DispatchPriority priority);
+
+// Max-Age (s) para el 5.03: proporcional a la presión, con jitter para que
+// los dispositivos no reintenten todos a la vez. 1..OVERLOAD_MAX_AGE_S.
+uint32_t overload_max_age(OverloadController *oc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OVERLOAD_H
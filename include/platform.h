@@ -6,6 +6,7 @@
 #include <stddef.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 // Detección de plataforma
 #if defined(__APPLE__) && defined(__MACH__)
@@ -37,6 +38,10 @@ int platform_socket_create_udp(void);
 int platform_socket_bind(int sock, uint16_t port);
 int platform_socket_set_nonblocking(int sock);
 int platform_socket_set_reuseaddr(int sock);
+// Busy polling del kernel (SO_BUSY_POLL + SO_PREFER_BUSY_POLL, Linux): el
+// recv no bloqueante sondea la cola del driver hasta 'usec'. Retorna
+// PLATFORM_ERROR si no está soportado o falta CAP_NET_ADMIN.
+int platform_socket_set_busy_poll(int sock, unsigned usec);
 void platform_socket_close(int sock);
 
 // I/O de red
@@ -44,11 +49,21 @@ ssize_t platform_socket_recvfrom(int sock, void *buffer, size_t len,
                                  struct sockaddr *addr, socklen_t *addrlen);
 ssize_t platform_socket_sendto(int sock, const void *buffer, size_t len,
                                const struct sockaddr *addr, socklen_t addrlen);
+ssize_t platform_socket_sendmsg(int sock, const struct iovec *iov, size_t iovcnt,
+                                const struct sockaddr *addr, socklen_t addrlen);
+
+// Sockets TCP (listener HTTP)
+int platform_socket_create_tcp(void);
+int platform_socket_listen(int sock, int backlog);
+int platform_socket_accept(int sock);
+ssize_t platform_socket_recv(int sock, void *buffer, size_t len);
+ssize_t platform_socket_send(int sock, const void *buffer, size_t len);
 
 // Utilidades
 void platform_init(void);
 void platform_cleanup(void);
 uint64_t platform_get_time_ms(void);
+uint64_t platform_get_monotonic_ns(void);
 const char *platform_error_string(int error);
 
 #endif // PLATFORM_H
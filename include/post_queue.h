@@ -0,0 +1,35 @@
+#ifndef POST_QUEUE_H
+#define POST_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Cola MPSC sin locks (Vyukov, intrusiva) de tareas para el event loop.
+// Cualquier hilo encola; sólo el hilo del loop drena. La señal de despertar
+// (eventfd / pipe) la gestiona el backend: la cola sólo indica cuándo hace
+// falta, coalesciendo posts consecutivos en un único despertar.
+typedef struct PostQueue PostQueue;
+
+PostQueue *post_queue_create(void);
+// Libera la cola y las tareas pendientes sin ejecutarlas.
+void post_queue_destroy(PostQueue *queue);
+
+// Encola fn(arg). Retorna PLATFORM_OK o PLATFORM_ENOMEM. '*need_wake' indica
+// si el llamador debe señalar al loop (nadie lo hizo desde el último drenado).
+int post_queue_push(PostQueue *queue, TaskCallback fn, void *arg, bool *need_wake);
+
+// Ejecuta hasta 'max' tareas en orden FIFO (por productor). '*more' es true si
+// quedaron tareas (o un productor a medio encolar): el backend debe volver a
+// señalarse para no dejarlas varadas. Retorna la cantidad ejecutada.
+size_t post_queue_drain(PostQueue *queue, size_t max, bool *more);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POST_QUEUE_H
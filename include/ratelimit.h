@@ -0,0 +1,55 @@
+#ifndef RATELIMIT_H
+#define RATELIMIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Peers listados por ratelimit_top_offenders / /api/v1/status
+#define RATELIMIT_TOP_N 5
+// Slots por defecto de la tabla (potencia de dos)
+#define RATELIMIT_DEFAULT_SLOTS 4096
+
+// Admisión por peer (dirección IP, sin puerto) con token bucket. La tabla
+// es de tamaño fijo (slots de 32 bytes, direccionamiento abierto con una
+// ventana de sondeo corta): si la ventana está llena se recicla el peer con
+// más tiempo sin tráfico. No es thread-safe: se usa desde el hilo del loop.
+typedef struct RateLimiter RateLimiter;
+
+typedef struct {
+    char peer[INET6_ADDRSTRLEN];
+    uint32_t limited;           // Datagramas rechazados (saturado)
+} RateLimitOffender;
+
+// 'rate' datagramas por segundo y peer con ráfaga 'burst' (0 => rate).
+// 'slots' se redondea a potencia de dos (0 => RATELIMIT_DEFAULT_SLOTS).
+// Retorna NULL si rate == 0 o sin memoria.
+RateLimiter *ratelimit_create(uint32_t rate, uint32_t burst, size_t slots);
+void ratelimit_destroy(RateLimiter *rl);
+
+// Consume una ficha del peer. Retorna 0 si se admite; si no, los segundos
+// (>= 1) hasta la próxima ficha, útiles como Max-Age de un 5.03.
+uint32_t ratelimit_check(RateLimiter *rl, const struct sockaddr *peer, uint64_t now_ms);
+
+// Hasta 'max' peers con más rechazos (orden descendente). Retorna cuántos.
+size_t ratelimit_top_offenders(const RateLimiter *rl, RateLimitOffender *out, size_t max);
+
+// Limitador publicado en /api/v1/status (NULL => ninguno). El servidor lo
+// registra al habilitarlo y lo retira antes de destruirlo.
+void ratelimit_set_active(RateLimiter *rl);
+RateLimiter *ratelimit_active(void);
+
+// JSON array con los top offenders del limitador activo ("[]" si no hay).
+// Retorna bytes escritos o -1 si no entra.
+int ratelimit_format_offenders(char *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RATELIMIT_H
@@ -22,7 +22,47 @@ int server_run(Server *srv, int run_timeout_ms);
 // Señal para detener el loop (si está corriendo en modo infinito)
 void server_stop(Server *srv);
 
+// Modo busy-poll (opt-in): server_run gira sobre recv no bloqueante hasta
+// 'budget_us' sin tráfico antes de dormir en el event loop, y pide
+// SO_BUSY_POLL/SO_PREFER_BUSY_POLL al kernel (best effort). 0 lo deshabilita.
+// El tiempo girando vs durmiendo se publica en métricas (busy_poll_*).
+int server_set_busy_poll(Server *srv, uint32_t budget_us);
+
+// Pool de workers (opt-in) para rutas costosas (dispatcher_route_offload):
+// el hilo de I/O sólo decodifica y encola; un worker ejecuta el handler y la
+// respuesta vuelve al loop para enviarse. 0 lo deshabilita (todo inline).
+// Máximo WORK_POOL_MAX_WORKERS. Retorna PLATFORM_OK o error.
+int server_set_workers(Server *srv, unsigned workers);
+
+// Admisión por peer (opt-in): token bucket de 'rate' datagramas/s con ráfaga
+// 'burst' (0 => rate) por dirección IP, consultado antes de decodificar. Al
+// excederlo, una request CON recibe 5.03 con Max-Age y el resto se descarta
+// (contador rate_limited). Los peers más rechazados se listan en
+// /api/v1/status. rate == 0 lo deshabilita. Retorna PLATFORM_OK o error.
+int server_set_rate_limit(Server *srv, uint32_t rate, uint32_t burst);
+
+// Control de sobrecarga (opt-in): con lag del loop >= 'lag_ms' o backlog
+// >= 'backlog' datagramas por despertar (0 => 256) sostenidos, las rutas de
+// prioridad baja (y, con el doble, las normales; ver
+// dispatcher_route_priority) reciben 5.03 con Max-Age proporcional a la
+// presión. La ingesta nunca se descarta. lag_ms == 0 lo deshabilita.
+int server_set_overload(Server *srv, uint32_t lag_ms, uint32_t backlog);
+
+// Presupuesto de cada despertar del socket CoAP: a lo sumo 'max_datagrams'
+// datagramas o 'max_us' µs (revisado entre lotes); al agotarse se cede el
+// hilo a timers, HTTP y tareas y el socket se re-arma para la vuelta
+// siguiente (contador rx_budget_exhausted). 0 = sin límite en esa dimensión.
+// Por defecto 256 datagramas / 1000 µs. Retorna PLATFORM_OK o error.
+int server_set_rx_budget(Server *srv, uint32_t max_datagrams, uint32_t max_us);
+
 // Puerto efectivamente enlazado por el socket del servidor
 uint16_t server_get_port(const Server *srv);
 
+// Habilita el listener HTTP/1.1 (métricas Prometheus y consultas de sólo
+// lectura) en el mismo event loop. port=0 => efímero. Retorna PLATFORM_OK o error.
+int server_enable_http(Server *srv, uint16_t port);
+
+// Puerto TCP del listener HTTP (0 si no está habilitado)
+uint16_t server_get_http_port(const Server *srv);
+
 #endif // SERVER_H
\ No newline at end of file
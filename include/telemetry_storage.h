@@ -11,6 +11,15 @@
 // Tamaño máximo de un JSON de telemetría (bytes)
 #define TELEMETRY_MAX_JSON_SIZE 512
 
+// Cantidad máxima de shards en modo TELEMETRY_MODE_SHARDED
+#define TELEMETRY_MAX_SHARDS 16
+
+// Modo de almacenamiento
+typedef enum {
+    TELEMETRY_MODE_SHARED = 0,  // Un ring compartido por todos los productores
+    TELEMETRY_MODE_SHARDED = 1  // Un ring por hilo productor; lecturas con merge
+} TelemetryStorageMode;
+
 // Estructura para una entrada de telemetría
 typedef struct {
     char json[TELEMETRY_MAX_JSON_SIZE];
@@ -26,14 +35,33 @@ typedef struct {
     uint64_t last_received_ms; // Timestamp del último mensaje
 } TelemetryStats;
 
-// Inicializa el módulo de storage
+// Vista consistente del storage (ver telemetry_storage_snapshot)
+typedef struct {
+    TelemetryStats stats;
+    uint64_t generation;     // Generación leída antes de copiar (apta para ETag)
+    size_t entry_count;      // Entradas copiadas
+    bool consistent;         // false: clears continuos agotaron los reintentos
+} TelemetrySnapshot;
+
+// Inicializa el módulo de storage (modo compartido)
 void telemetry_storage_init(void);
 
+// Inicializa el módulo de storage con el modo indicado. En modo sharded cada
+// hilo que inserta recibe su propio ring (hasta TELEMETRY_MAX_SHARDS; a partir
+// de ahí los hilos comparten shards) y las lecturas siguen devolviendo una
+// única vista global ordenada por timestamp con las últimas
+// TELEMETRY_MAX_ENTRIES entradas.
+void telemetry_storage_init_mode(TelemetryStorageMode mode);
+
 // Agrega un nuevo JSON de telemetría
+// Seguro para múltiples hilos productores (sin locks).
 // Retorna 0 en éxito, <0 en error
 int telemetry_storage_add(const char *json, size_t json_len);
 
 // Obtiene todas las entradas almacenadas
+// Puede ejecutarse concurrentemente con telemetry_storage_add: las entradas que
+// se están sobrescribiendo durante la copia se omiten. Retorna 0 si no logra
+// una vista consistente (ver telemetry_storage_snapshot).
 // Retorna el número de entradas copiadas
 // out: buffer de salida (array de TelemetryEntry)
 // max_entries: capacidad del buffer out
@@ -42,13 +70,32 @@ size_t telemetry_storage_get_all(TelemetryEntry *out, size_t max_entries);
 // Obtiene estadísticas del storage
 void telemetry_storage_get_stats(TelemetryStats *stats);
 
+// Toma un snapshot consistente: generación, entradas (si out != NULL) y
+// estadísticas, sin mezclar estado previo y posterior a un clear y sin
+// bloquear a los escritores. La generación se lee antes que los datos.
+// Si los clears concurrentes agotan los reintentos, snap->consistent es false
+// y no se devuelven entradas (el llamador debe tratarlo como error); las
+// estadísticas quedan las del último intento.
+// Retorna la cantidad de entradas copiadas en 'out'.
+size_t telemetry_storage_snapshot(TelemetryEntry *out, size_t max_entries,
+                                  TelemetrySnapshot *snap);
+
 // Limpia todo el storage (para testing)
 void telemetry_storage_clear(void);
 
+// Contador de generación: cambia con cada telemetry_storage_add/clear.
+// Permite derivar ETags y detectar que el contenido no cambió.
+uint64_t telemetry_storage_get_generation(void);
+
 // Serializa todas las entradas a un JSON array
 // Retorna el tamaño del JSON generado, o <0 en error
 // out: buffer de salida
 // out_size: capacidad del buffer
 int telemetry_storage_serialize_json(char *out, size_t out_size);
 
+// Igual que telemetry_storage_serialize_json; además devuelve en 'generation'
+// (opcional) la generación del snapshot serializado, para usar como ETag.
+// Retorna -3 si no logra un snapshot consistente (clears continuos).
+int telemetry_storage_serialize_snapshot(char *out, size_t out_size, uint64_t *generation);
+
 #endif // TELEMETRY_STORAGE_H
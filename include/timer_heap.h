@@ -0,0 +1,54 @@
+#ifndef TIMER_HEAP_H
+#define TIMER_HEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "event_loop.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// IDs de timer: bits 0..16 = slot + 1, bits 17..30 = generación del slot.
+// Un slot liberado sólo se reutiliza cuando hay TIMER_HEAP_REUSE_MIN libres
+// (en orden FIFO): entre dos usos del mismo slot se liberan al menos
+// TIMER_HEAP_REUSE_MIN - 1 timers más. Un ID cancelado o vencido no afecta a
+// otro timer hasta que su generación dé la vuelta, es decir tras al menos
+// 2^14 * 1024 (~16M) timers armados y liberados.
+#define TIMER_HEAP_SLOT_BITS 17
+#define TIMER_HEAP_GEN_BITS  (31 - TIMER_HEAP_SLOT_BITS)
+#define TIMER_HEAP_MAX_TIMERS ((1u << TIMER_HEAP_SLOT_BITS) - 1)
+#define TIMER_HEAP_REUSE_MIN 1024u
+
+// Min-heap de timers con cancelación perezosa, usado por los backends del
+// event loop. Tiempos en ns del reloj monotónico. Sin locking interno.
+typedef struct TimerHeap TimerHeap;
+
+TimerHeap *timer_heap_create(void);
+void timer_heap_destroy(TimerHeap *heap);
+
+// Arma un timer que vence en 'deadline_ns'; si period_ns > 0 se rearma cada
+// period_ns. Retorna ID (>0) o -1 (sin memoria / límite de timers).
+int timer_heap_add(TimerHeap *heap, uint64_t deadline_ns, uint64_t period_ns,
+                   TimerCallback callback, void *user_data);
+
+// Cancela en O(1) (la entrada del heap se descarta al llegar a la cima).
+// Retorna false si el ID no corresponde a un timer armado.
+bool timer_heap_cancel(TimerHeap *heap, int timer_id);
+
+// Próximo vencimiento de un timer armado. Retorna false si no hay ninguno.
+bool timer_heap_next_deadline(TimerHeap *heap, uint64_t *deadline_ns);
+
+// Dispara los timers con vencimiento <= now_ns. Los armados desde un callback
+// no se disparan en la misma pasada. Retorna la cantidad de callbacks.
+size_t timer_heap_run_expired(TimerHeap *heap, uint64_t now_ns);
+
+// Timers armados (excluye entradas canceladas pendientes de descarte)
+size_t timer_heap_count(const TimerHeap *heap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMER_HEAP_H
@@ -0,0 +1,43 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WORK_POOL_MAX_WORKERS 64
+
+// Tarea ejecutada en un hilo del pool
+typedef void (*WorkFn)(void *arg);
+
+// Pool de hilos con work stealing: cada worker tiene su propio deque. El
+// dueño apila y desapila por el fondo (LIFO, caché caliente); los workers
+// ociosos roban por el tope (FIFO, la tarea más antigua) de los demás.
+typedef struct WorkPool WorkPool;
+
+// Crea 'workers' hilos (1..WORK_POOL_MAX_WORKERS). Retorna NULL en error.
+WorkPool *work_pool_create(unsigned workers);
+
+// Ejecuta las tareas pendientes, detiene y une los hilos y libera el pool.
+// No debe haber llamadas concurrentes a work_pool_submit.
+void work_pool_destroy(WorkPool *pool);
+
+// Encola fn(arg). Desde un worker del pool va a su propio deque; desde otro
+// hilo, a los deques en round-robin. Retorna PLATFORM_OK, PLATFORM_ENOMEM o
+// PLATFORM_EINVAL.
+int work_pool_submit(WorkPool *pool, WorkFn fn, void *arg);
+
+unsigned work_pool_size(const WorkPool *pool);
+
+// Tareas ejecutadas y cuántas de ellas fueron robadas (aproximado).
+uint64_t work_pool_completed(const WorkPool *pool);
+uint64_t work_pool_steals(const WorkPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WORK_POOL_H
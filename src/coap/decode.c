@@ -3,10 +3,26 @@
  *
  * Valida versión, TKL, tipos, orden y límites de opciones. Soporta extensiones
  * 13/14 en delta/length; 15 es inválido. El payload se separa mediante 0xFF.
+ *
+ * coap_decode intenta primero un fast path especializado en la forma habitual
+ * de las requests (CON/NON, token corto, pocas opciones); ante cualquier caso
+ * inusual recurre al decodificador genérico, que reporta el error preciso.
  */
 #include "coap_codec.h"
 #include <string.h>
 
+// Resultado interno del fast path: "no aplica, usar el decodificador genérico"
+#define DECODE_FAST_FALLBACK 1
+
+// Bytes extendidos y valor base por nibble de delta/length (RFC 7252 §3.1).
+// -1 marca el nibble 15 (reservado).
+static const int8_t k_ext_bytes[16] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, -1
+};
+static const uint16_t k_ext_base[16] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 269, 0
+};
+
 /*
  * read_extended
  * -------------
@@ -19,7 +35,6 @@
 static int read_extended(const uint8_t *buf, size_t len, size_t *offset,
                          uint8_t nibble, uint32_t *out_value) {
 	if (!buf || !offset || !out_value) return COAP_CODEC_EINVAL;
-	if (*offset >= len) return COAP_CODEC_EMALFORMED;
 
 	if (nibble <= 12) {
 		*out_value = nibble;
@@ -44,9 +59,102 @@ static int read_extended(const uint8_t *buf, size_t len, size_t *offset,
 	}
 }
 
+/*
+ * decode_fast
+ * -----------
+ * Fast path para requests CON/NON bien formadas. A diferencia del genérico:
+ * - No limpia la estructura completa (sólo header, contador de opciones y
+ *   payload); las opciones se anexan en orden sin pasar por la inserción
+ *   ordenada de coap_message_add_option, ya que el formato las trae ascendentes.
+ * - Resuelve los nibbles con tablas en lugar de ramas por cada extensión.
+ *
+ * Retorna COAP_CODEC_OK en éxito o DECODE_FAST_FALLBACK si el mensaje requiere
+ * el decodificador genérico (respuestas, formato inválido, límites excedidos).
+ */
+static int decode_fast(CoapMessage *msg, const uint8_t *buffer, size_t length) {
+	uint8_t b0 = buffer[0];
+	uint8_t tkl = (uint8_t)(b0 & 0x0F);
+	uint8_t type = (uint8_t)((b0 >> 4) & 0x03);
+	uint8_t code = buffer[1];
+	if ((b0 >> 6) != COAP_VERSION) return DECODE_FAST_FALLBACK;
+	if (type > COAP_TYPE_NON_CONFIRMABLE) return DECODE_FAST_FALLBACK;
+	if (code == 0 || (code >> 5) != 0) return DECODE_FAST_FALLBACK;
+	if (tkl > COAP_MAX_TOKEN_LENGTH || (size_t)4 + tkl > length) return DECODE_FAST_FALLBACK;
+
+	msg->version = COAP_VERSION;
+	msg->type = (CoapType)type;
+	msg->token_length = tkl;
+	msg->code = (CoapCode)code;
+	msg->message_id = (uint16_t)((buffer[2] << 8) | buffer[3]);
+	memset(msg->token, 0, sizeof msg->token);
+	memcpy(msg->token, buffer + 4, tkl);
+	msg->option_count = 0;
+	msg->payload = NULL;
+	msg->payload_length = 0;
+
+	const size_t max_options = sizeof msg->options / sizeof msg->options[0];
+	size_t off = 4 + (size_t)tkl;
+	uint32_t number = 0;
+	while (off < length) {
+		uint8_t byte = buffer[off++];
+		if (byte == COAP_PAYLOAD_MARKER) {
+			size_t remaining = length - off;
+			if (remaining > sizeof(msg->payload_buffer)) return DECODE_FAST_FALLBACK;
+			if (remaining > 0) {
+				memcpy(msg->payload_buffer, buffer + off, remaining);
+				msg->payload = msg->payload_buffer;
+				msg->payload_length = remaining;
+			}
+			return COAP_CODEC_OK;
+		}
+
+		uint8_t dn = (uint8_t)(byte >> 4);
+		uint8_t ln = (uint8_t)(byte & 0x0F);
+		int dx = k_ext_bytes[dn];
+		int lx = k_ext_bytes[ln];
+		if ((dx | lx) < 0) return DECODE_FAST_FALLBACK;
+		if (off + (size_t)dx + (size_t)lx > length) return DECODE_FAST_FALLBACK;
+
+		uint32_t delta = k_ext_base[dn];
+		if (dx == 1) delta += buffer[off];
+		else if (dx == 2) delta += (uint32_t)((buffer[off] << 8) | buffer[off + 1]);
+		off += (size_t)dx;
+		uint32_t opt_len = k_ext_base[ln];
+		if (lx == 1) opt_len += buffer[off];
+		else if (lx == 2) opt_len += (uint32_t)((buffer[off] << 8) | buffer[off + 1]);
+		off += (size_t)lx;
+
+		number += delta;
+		if (number > 0xFFFFu || opt_len > COAP_MAX_OPTION_VALUE_LENGTH) return DECODE_FAST_FALLBACK;
+		if (msg->option_count >= max_options) return DECODE_FAST_FALLBACK;
+		if (off + opt_len > length) return DECODE_FAST_FALLBACK;
+
+		// Anexar: el orden ascendente está garantizado por la codificación delta
+		CoapOptionDef *opt = &msg->options[msg->option_count++];
+		opt->number = (uint16_t)number;
+		opt->length = (uint16_t)opt_len;
+		memcpy(opt->value, buffer + off, opt_len);
+		off += opt_len;
+	}
+	return COAP_CODEC_OK;
+}
+
 /*
  * coap_decode
  * -----------
+ * Punto de entrada: fast path para la forma común de requests y, si no aplica,
+ * el decodificador genérico.
+ */
+int coap_decode(CoapMessage *msg, const uint8_t *buffer, size_t length) {
+	if (!msg || !buffer) return COAP_CODEC_EINVAL;
+	if (length < 4) return COAP_CODEC_EMALFORMED;
+	if (decode_fast(msg, buffer, length) == COAP_CODEC_OK) return COAP_CODEC_OK;
+	return coap_decode_generic(msg, buffer, length);
+}
+
+/*
+ * coap_decode_generic
+ * -------------------
  * Parsea un buffer de bytes en una estructura CoapMessage.
  *
  * Retorna
@@ -56,7 +164,7 @@ static int read_extended(const uint8_t *buf, size_t len, size_t *offset,
  * - Asegura orden ascendente de opciones y límites de longitud.
  * - Si hay payload marker 0xFF, copia el payload en el buffer interno.
  */
-int coap_decode(CoapMessage *msg, const uint8_t *buffer, size_t length) {
+int coap_decode_generic(CoapMessage *msg, const uint8_t *buffer, size_t length) {
 	if (!msg || !buffer) return COAP_CODEC_EINVAL;
 	if (length < 4) return COAP_CODEC_EMALFORMED;
 
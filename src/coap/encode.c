@@ -73,15 +73,12 @@ static int write_extended(uint32_t value,
 }
 
 /*
- * coap_encode
+ * encode_head
  * -----------
- * Serializa un CoapMessage a un buffer. Retorna la cantidad de bytes escritos o
- * un código COAP_CODEC_E* en error (buffer pequeño, mensaje inválido, etc.).
+ * Serializa header fijo, token y opciones (sin payload) en 'out'. Retorna la
+ * cantidad de bytes escritos o un código COAP_CODEC_E* en error.
  */
-int coap_encode(const CoapMessage *msg, uint8_t *out, size_t out_size) {
-	if (!msg || !out) return COAP_CODEC_EINVAL;
-	if (!coap_message_can_encode(msg)) return COAP_CODEC_EINVAL;
-
+static int encode_head(const CoapMessage *msg, uint8_t *out, size_t out_size) {
 	uint8_t *p = out;
 	uint8_t *end = out + out_size;
 	if ((size_t)(end - p) < 4) return COAP_CODEC_E2SMALL;
@@ -117,7 +114,7 @@ int coap_encode(const CoapMessage *msg, uint8_t *out, size_t out_size) {
 		p++;
 
 		int rc;
-rc = write_extended(delta, &p, end, &delta_nibble);
+		rc = write_extended(delta, &p, end, &delta_nibble);
 		if (rc != COAP_CODEC_OK) return rc;
 		rc = write_extended(length, &p, end, &len_nibble);
 		if (rc != COAP_CODEC_OK) return rc;
@@ -132,6 +129,24 @@ rc = write_extended(delta, &p, end, &delta_nibble);
 		last = number;
 	}
 
+	return (int)(p - out);
+}
+
+/*
+ * coap_encode
+ * -----------
+ * Serializa un CoapMessage a un buffer. Retorna la cantidad de bytes escritos o
+ * un código COAP_CODEC_E* en error (buffer pequeño, mensaje inválido, etc.).
+ */
+int coap_encode(const CoapMessage *msg, uint8_t *out, size_t out_size) {
+	if (!msg || !out) return COAP_CODEC_EINVAL;
+	if (!coap_message_can_encode(msg)) return COAP_CODEC_EINVAL;
+
+	int head = encode_head(msg, out, out_size);
+	if (head < 0) return head;
+	uint8_t *p = out + head;
+	uint8_t *end = out + out_size;
+
 	// Payload
 	if (msg->payload && msg->payload_length > 0) {
 		if ((size_t)(end - p) < (1 + msg->payload_length)) return COAP_CODEC_E2SMALL;
@@ -141,4 +156,38 @@ rc = write_extended(delta, &p, end, &delta_nibble);
 	}
 
 	return (int)(p - out);
-}
\ No newline at end of file
+}
+
+/*
+ * coap_encode_iov
+ * ---------------
+ * Variante scatter/gather de coap_encode: sólo header, token, opciones y el
+ * payload marker se escriben en 'hdr'; el payload se referencia desde iov[1]
+ * apuntando directamente a msg->payload, sin copiarlo.
+ *
+ * Retorna el tamaño total del datagrama (hdr + payload) o un código
+ * COAP_CODEC_E* en error. 'msg' y su payload deben seguir vivos hasta que el
+ * vector se haya enviado.
+ */
+int coap_encode_iov(const CoapMessage *msg, uint8_t *hdr, size_t hdr_size,
+                    struct iovec iov[COAP_ENCODE_IOV_MAX], size_t *iov_count) {
+	if (!msg || !hdr || !iov || !iov_count) return COAP_CODEC_EINVAL;
+	if (!coap_message_can_encode(msg)) return COAP_CODEC_EINVAL;
+
+	int head = encode_head(msg, hdr, hdr_size);
+	if (head < 0) return head;
+	size_t hdr_len = (size_t)head;
+
+	iov[0].iov_base = hdr;
+	iov[0].iov_len = hdr_len;
+	*iov_count = 1;
+	if (!msg->payload || msg->payload_length == 0) return (int)hdr_len;
+
+	if (hdr_len >= hdr_size) return COAP_CODEC_E2SMALL;
+	hdr[hdr_len++] = COAP_PAYLOAD_MARKER;
+	iov[0].iov_len = hdr_len;
+	iov[1].iov_base = msg->payload;
+	iov[1].iov_len = msg->payload_length;
+	*iov_count = 2;
+	return (int)(hdr_len + msg->payload_length);
+}
@@ -53,6 +53,7 @@ const char *coap_code_to_string(CoapCode code) {
  */
 const char *coap_option_to_string(uint16_t option_number) {
     switch (option_number) {
+        case COAP_OPTION_ETAG: return "ETag";
         case COAP_OPTION_URI_PATH: return "Uri-Path";
         case COAP_OPTION_CONTENT_FORMAT: return "Content-Format";
         case COAP_OPTION_URI_QUERY: return "Uri-Query";
@@ -4,7 +4,11 @@
  * Responsabilidades
  * - Construir respuesta base (mirror de token/message_id, tipo piggyback/ NON).
  * - Resolver path (Uri-Path) y método, validando 404 y 405 cuando corresponda.
- * - Separar rutas de producción, testing y legacy.
+ * - Separar rutas de producción, testing y legacy (tabla k_routes).
+ * - Identificar la ruta resuelta (DispatchRoute) para métricas.
+ * - Marcar rutas costosas como "offload" (se ejecutan en el pool de workers).
+ * - Respuestas separadas: puente entre handlers que difieren su respuesta
+ *   (dispatcher_defer/dispatcher_complete) y el transporte que las envía.
  */
 #include "dispatcher.h"
 #include "handlers.h"
@@ -49,15 +53,263 @@ static int method_from_code(CoapCode code) {
     return (int)code;
 }
 
+typedef int (*RouteHandler)(const CoapMessage *req, CoapMessage *resp);
+
+typedef struct {
+    const char *path;       // Uri-Path sin '/' inicial
+    int method;             // COAP_METHOD_*
+    DispatchRoute route;
+    RouteHandler handler;
+} RouteDef;
+
+// Tabla de routing: producción (API v1), testing y legacy (deprecado, se
+// mantiene por compatibilidad). Un mismo path puede aparecer con varios métodos.
+static const RouteDef k_routes[] = {
+    { "api/v1/telemetry", COAP_METHOD_POST, DISPATCH_ROUTE_TELEMETRY_POST, handle_telemetry_post },
+    { "api/v1/telemetry", COAP_METHOD_GET,  DISPATCH_ROUTE_TELEMETRY_GET,  handle_telemetry_get },
+    { "api/v1/health",    COAP_METHOD_GET,  DISPATCH_ROUTE_HEALTH,         handle_health },
+    { "api/v1/status",    COAP_METHOD_GET,  DISPATCH_ROUTE_STATUS,         handle_status },
+    { "api/v1/metrics",   COAP_METHOD_GET,  DISPATCH_ROUTE_METRICS,        handle_metrics },
+    { "api/v1/metrics/routes", COAP_METHOD_GET,  DISPATCH_ROUTE_METRICS,   handle_metrics_routes },
+    { "api/v1/metrics/queues", COAP_METHOD_GET,  DISPATCH_ROUTE_METRICS,   handle_metrics_queues },
+    { "test/echo",        COAP_METHOD_POST, DISPATCH_ROUTE_TEST_ECHO,      handle_test_echo },
+    { "test/separate",    COAP_METHOD_POST, DISPATCH_ROUTE_TEST_SEPARATE,  handle_test_separate },
+    { "hello",            COAP_METHOD_GET,  DISPATCH_ROUTE_HELLO,          handle_hello },
+    { "time",             COAP_METHOD_GET,  DISPATCH_ROUTE_TIME,           handle_time },
+    { "echo",             COAP_METHOD_POST, DISPATCH_ROUTE_ECHO,           handle_echo },
+};
+
+static const char *const k_route_names[DISPATCH_ROUTE_COUNT] = {
+    [DISPATCH_ROUTE_TELEMETRY_POST] = "telemetry_post",
+    [DISPATCH_ROUTE_TELEMETRY_GET] = "telemetry_get",
+    [DISPATCH_ROUTE_HEALTH] = "health",
+    [DISPATCH_ROUTE_STATUS] = "status",
+    [DISPATCH_ROUTE_METRICS] = "metrics",
+    [DISPATCH_ROUTE_TEST_ECHO] = "test_echo",
+    [DISPATCH_ROUTE_TEST_SEPARATE] = "test_separate",
+    [DISPATCH_ROUTE_HELLO] = "hello",
+    [DISPATCH_ROUTE_TIME] = "time",
+    [DISPATCH_ROUTE_ECHO] = "echo",
+    [DISPATCH_ROUTE_UNMATCHED] = "unmatched",
+};
+
+// Rutas pesadas en CPU que el servidor delega al pool de workers (si existe).
+// Sus handlers sólo leen storage/métricas, seguros desde cualquier hilo.
+static const bool k_route_offload[DISPATCH_ROUTE_COUNT] = {
+    [DISPATCH_ROUTE_TELEMETRY_GET] = true,
+    [DISPATCH_ROUTE_METRICS] = true,
+};
+
+// Prioridad bajo sobrecarga: primero se descartan las lecturas grandes, el
+// status y las rutas legacy; la ingesta nunca.
+static const DispatchPriority k_route_priority[DISPATCH_ROUTE_COUNT] = {
+    [DISPATCH_ROUTE_TELEMETRY_POST] = DISPATCH_PRIORITY_HIGH,
+    [DISPATCH_ROUTE_TELEMETRY_GET] = DISPATCH_PRIORITY_LOW,
+    [DISPATCH_ROUTE_HEALTH] = DISPATCH_PRIORITY_HIGH,
+    [DISPATCH_ROUTE_STATUS] = DISPATCH_PRIORITY_LOW,
+    [DISPATCH_ROUTE_METRICS] = DISPATCH_PRIORITY_LOW,
+    [DISPATCH_ROUTE_TEST_ECHO] = DISPATCH_PRIORITY_NORMAL,
+    [DISPATCH_ROUTE_TEST_SEPARATE] = DISPATCH_PRIORITY_NORMAL,
+    [DISPATCH_ROUTE_HELLO] = DISPATCH_PRIORITY_LOW,
+    [DISPATCH_ROUTE_TIME] = DISPATCH_PRIORITY_LOW,
+    [DISPATCH_ROUTE_ECHO] = DISPATCH_PRIORITY_LOW,
+    [DISPATCH_ROUTE_UNMATCHED] = DISPATCH_PRIORITY_NORMAL,
+};
+
+// Proveedor de respuestas diferidas del hilo actual (ver dispatcher_set_defer)
+static _Thread_local DispatchDeferFn t_defer_fn;
+static _Thread_local void *t_defer_ctx;
+
+/*
+ * find_route
+ * ----------
+ * Busca path + método en k_routes. 'path_known' indica si el path existe con
+ * algún método (405 vs 404).
+ */
+static const RouteDef *find_route(const char *path, int method, bool *path_known) {
+    *path_known = false;
+    for (size_t i = 0; i < sizeof(k_routes) / sizeof(k_routes[0]); i++) {
+        const RouteDef *def = &k_routes[i];
+        if (strcmp(path, def->path) != 0) continue;
+        *path_known = true;
+        if (def->method == method) return def;
+    }
+    return NULL;
+}
+
+/*
+ * dispatcher_match_route
+ * ----------------------
+ * Resuelve la ruta sin ejecutar el handler ni loggear.
+ */
+DispatchRoute dispatcher_match_route(const CoapMessage *req) {
+    if (!req || !coap_message_is_valid(req) || !coap_message_is_request(req)) {
+        return DISPATCH_ROUTE_UNMATCHED;
+    }
+    char path[128];
+    int method = method_from_code(req->code);
+    if (method == 0 || coap_message_get_uri_path(req, path, sizeof(path)) < 0) {
+        return DISPATCH_ROUTE_UNMATCHED;
+    }
+    bool path_known;
+    const RouteDef *def = find_route(path, method, &path_known);
+    return def ? def->route : DISPATCH_ROUTE_UNMATCHED;
+}
+
+/*
+ * dispatcher_route_offload
+ * ------------------------
+ * true si la ruta debe ejecutarse fuera del hilo de I/O.
+ */
+bool dispatcher_route_offload(DispatchRoute route) {
+    return (unsigned)route < DISPATCH_ROUTE_COUNT && k_route_offload[route];
+}
+
+/*
+ * dispatcher_route_priority
+ * -------------------------
+ * Prioridad de la ruta para el descarte bajo sobrecarga.
+ */
+DispatchPriority dispatcher_route_priority(DispatchRoute route) {
+    return (unsigned)route < DISPATCH_ROUTE_COUNT ? k_route_priority[route] : DISPATCH_PRIORITY_NORMAL;
+}
+
+/*
+ * dispatcher_peek_priority
+ * ------------------------
+ * Recorre los deltas de opciones hasta pasar Uri-Path (11) armando el path,
+ * y resuelve la prioridad con la misma tabla de rutas que el dispatch. No
+ * valida el resto del mensaje ni copia el payload.
+ */
+DispatchPriority dispatcher_peek_priority(const uint8_t *buf, size_t len) {
+    if (!buf || len < 4) return DISPATCH_PRIORITY_NORMAL;
+    unsigned version = buf[0] >> 6;
+    unsigned type = (buf[0] >> 4) & 0x3;
+    size_t tkl = buf[0] & 0x0F;
+    uint8_t code = buf[1];
+    if (version != COAP_VERSION || tkl > COAP_MAX_TOKEN_LENGTH) return DISPATCH_PRIORITY_NORMAL;
+    if (type == COAP_TYPE_ACKNOWLEDGMENT || type == COAP_TYPE_RESET || code == 0) {
+        return DISPATCH_PRIORITY_HIGH;
+    }
+    int method = method_from_code((CoapCode)code);
+    if (method == 0) return DISPATCH_PRIORITY_NORMAL;
+
+    char path[128];
+    size_t path_len = 0;
+    size_t pos = 4 + tkl;
+    unsigned number = 0;
+    while (pos < len && buf[pos] != COAP_PAYLOAD_MARKER) {
+        unsigned delta = buf[pos] >> 4;
+        size_t opt_len = buf[pos] & 0x0F;
+        pos++;
+        if (delta == 15 || opt_len == 15) return DISPATCH_PRIORITY_NORMAL;
+        if (delta == 13) {
+            if (pos >= len) return DISPATCH_PRIORITY_NORMAL;
+            delta = 13u + buf[pos++];
+        } else if (delta == 14) {
+            if (pos + 1 >= len) return DISPATCH_PRIORITY_NORMAL;
+            delta = 269u + (((unsigned)buf[pos] << 8) | buf[pos + 1]);
+            pos += 2;
+        }
+        if (opt_len == 13) {
+            if (pos >= len) return DISPATCH_PRIORITY_NORMAL;
+            opt_len = 13u + buf[pos++];
+        } else if (opt_len == 14) {
+            if (pos + 1 >= len) return DISPATCH_PRIORITY_NORMAL;
+            opt_len = 269u + (((size_t)buf[pos] << 8) | buf[pos + 1]);
+            pos += 2;
+        }
+        if (opt_len > len - pos) return DISPATCH_PRIORITY_NORMAL;
+        number += delta;
+        if (number > COAP_OPTION_URI_PATH) break;
+        if (number == COAP_OPTION_URI_PATH) {
+            size_t need = opt_len + (path_len ? 1 : 0);
+            if (path_len + need >= sizeof(path)) return DISPATCH_PRIORITY_NORMAL;
+            if (path_len) path[path_len++] = '/';
+            memcpy(path + path_len, buf + pos, opt_len);
+            path_len += opt_len;
+        }
+        pos += opt_len;
+    }
+    path[path_len] = '\0';
+
+    bool path_known;
+    const RouteDef *def = find_route(path, method, &path_known);
+    return dispatcher_route_priority(def ? def->route : DISPATCH_ROUTE_UNMATCHED);
+}
+
+/*
+ * dispatcher_priority_name
+ * ------------------------
+ * Nombre corto de la prioridad, usado como etiqueta en métricas.
+ */
+const char *dispatcher_priority_name(DispatchPriority priority) {
+    static const char *const names[DISPATCH_PRIORITY_COUNT] = { "high", "normal", "low" };
+    return (unsigned)priority < DISPATCH_PRIORITY_COUNT ? names[priority] : "unknown";
+}
+
+/*
+ * dispatcher_set_defer
+ * --------------------
+ * Instala (o quita, con fn NULL) el proveedor de handles del hilo actual.
+ */
+void dispatcher_set_defer(DispatchDeferFn fn, void *ctx) {
+    t_defer_fn = fn;
+    t_defer_ctx = fn ? ctx : NULL;
+}
+
+/*
+ * dispatcher_defer
+ * ----------------
+ * Pide al transporte un handle para responder más tarde. NULL si el
+ * transporte no soporta respuestas separadas.
+ */
+DispatchDeferred *dispatcher_defer(const CoapMessage *req) {
+    if (!req || !t_defer_fn) return NULL;
+    return t_defer_fn(t_defer_ctx, req);
+}
+
+/*
+ * dispatcher_complete
+ * -------------------
+ * Entrega la respuesta diferida al transporte (que libera el handle).
+ */
+void dispatcher_complete(DispatchDeferred *deferred, const CoapMessage *resp) {
+    if (deferred && deferred->complete) deferred->complete(deferred, resp);
+}
+
+/*
+ * dispatcher_route_name
+ * ---------------------
+ * Nombre corto de la ruta, usado como etiqueta en métricas.
+ */
+const char *dispatcher_route_name(DispatchRoute route) {
+    if ((unsigned)route >= DISPATCH_ROUTE_COUNT) return "unknown";
+    return k_route_names[route];
+}
+
 /*
  * dispatcher_handle_request
  * -------------------------
- * Punto de entrada del routing. Valida que la request sea válida y de clase
- * método, extrae el path y decide el handler correspondiente. En errores de
- * routing, establece resp->code con 4.04/4.05/4.00 y retorna 0 (respuesta
- * válida codificable). Retorna <0 sólo ante errores no recuperables.
+ * Punto de entrada del routing sin información de ruta. Ver
+ * dispatcher_handle_request_routed.
  */
 int dispatcher_handle_request(const CoapMessage *req, CoapMessage *resp) {
+    return dispatcher_handle_request_routed(req, resp, NULL);
+}
+
+/*
+ * dispatcher_handle_request_routed
+ * --------------------------------
+ * Punto de entrada del routing. Valida que la request sea válida y de clase
+ * método, extrae el path y decide el handler correspondiente según k_routes.
+ * En errores de routing, establece resp->code con 4.04/4.05/4.00 y retorna 0
+ * (respuesta válida codificable). Retorna <0 sólo ante errores no
+ * recuperables. Si 'route' no es NULL, recibe la ruta resuelta.
+ */
+int dispatcher_handle_request_routed(const CoapMessage *req, CoapMessage *resp,
+                                     DispatchRoute *route) {
+    if (route) *route = DISPATCH_ROUTE_UNMATCHED;
     if (!req || !resp) {
         LOG_ERROR("dispatcher: NULL pointer (req=%p, resp=%p)\n", (void*)req, (void*)resp);
         return -1;
@@ -79,91 +331,35 @@ int dispatcher_handle_request(const CoapMessage *req, CoapMessage *resp) {
     char path[128];
     int path_len = coap_message_get_uri_path(req, path, sizeof(path));
     if (path_len < 0) {
-        LOG_WARN("dispatcher: failed to extract uri_path\n");
+        LOG_WARN_RL("dispatcher: failed to extract uri_path\n");
         resp->code = COAP_ERROR_BAD_REQUEST;
         return 0;
     }
 
     int method = method_from_code(req->code);
     if (method == 0) {
-        LOG_WARN("dispatcher: invalid method (code=%u)\n", req->code);
+        LOG_WARN_RL("dispatcher: invalid method (code=%u)\n", req->code);
         resp->code = COAP_ERROR_BAD_REQUEST;
         return 0;
     }
 
     LOG_INFO("dispatcher: method=%d path=\"%s\"\n", method, path);
 
-    // === Routing API v1 (Producción) ===
-    if (strcmp(path, "api/v1/telemetry") == 0) {
-        if (method == COAP_METHOD_POST) {
-            return handle_telemetry_post(req, resp);
-        } else if (method == COAP_METHOD_GET) {
-            return handle_telemetry_get(req, resp);
-        } else {
-            LOG_WARN("dispatcher: 405 Method Not Allowed for /api/v1/telemetry (method=%d)\n", method);
-            resp->code = COAP_ERROR_METHOD_NOT_ALLOWED;
-            return 0;
-        }
-    }
-    
-    if (strcmp(path, "api/v1/health") == 0) {
-        if (method != COAP_METHOD_GET) {
-            LOG_WARN("dispatcher: 405 Method Not Allowed for /api/v1/health (method=%d)\n", method);
-            resp->code = COAP_ERROR_METHOD_NOT_ALLOWED;
-            return 0;
-        }
-        return handle_health(req, resp);
-    }
-    
-    if (strcmp(path, "api/v1/status") == 0) {
-        if (method != COAP_METHOD_GET) {
-            LOG_WARN("dispatcher: 405 Method Not Allowed for /api/v1/status (method=%d)\n", method);
-            resp->code = COAP_ERROR_METHOD_NOT_ALLOWED;
-            return 0;
-        }
-        return handle_status(req, resp);
-    }
-
-    // === Routing de Testing ===
-    if (strcmp(path, "test/echo") == 0) {
-        if (method != COAP_METHOD_POST) {
-            LOG_WARN("dispatcher: 405 Method Not Allowed for /test/echo (method=%d)\n", method);
-            resp->code = COAP_ERROR_METHOD_NOT_ALLOWED;
-            return 0;
-        }
-        return handle_test_echo(req, resp);
+    bool path_known;
+    const RouteDef *def = find_route(path, method, &path_known);
+    if (def) {
+        if (route) *route = def->route;
+        return def->handler(req, resp);
     }
 
-    // === Routing Legacy (deprecado, mantener para compatibilidad) ===
-    if (strcmp(path, "hello") == 0) {
-        if (method != COAP_METHOD_GET) {
-            LOG_WARN("dispatcher: 405 Method Not Allowed for /hello (method=%d)\n", method);
-            resp->code = COAP_ERROR_METHOD_NOT_ALLOWED;
-            return 0;
-        }
-        return handle_hello(req, resp);
-    }
-    
-    if (strcmp(path, "time") == 0) {
-        if (method != COAP_METHOD_GET) {
-            LOG_WARN("dispatcher: 405 Method Not Allowed for /time (method=%d)\n", method);
-            resp->code = COAP_ERROR_METHOD_NOT_ALLOWED;
-            return 0;
-        }
-        return handle_time(req, resp);
-    }
-    
-    if (strcmp(path, "echo") == 0) {
-        if (method != COAP_METHOD_POST) {
-            LOG_WARN("dispatcher: 405 Method Not Allowed for /echo (method=%d)\n", method);
-            resp->code = COAP_ERROR_METHOD_NOT_ALLOWED;
-            return 0;
-        }
-        return handle_echo(req, resp);
+    if (path_known) {
+        LOG_WARN_RL("dispatcher: 405 Method Not Allowed for /%s (method=%d)\n", path, method);
+        resp->code = COAP_ERROR_METHOD_NOT_ALLOWED;
+        return 0;
     }
 
     // No encontrado
-    LOG_WARN("dispatcher: 404 Not Found for path=\"%s\"\n", path);
+    LOG_WARN_RL("dispatcher: 404 Not Found for path=\"%s\"\n", path);
     resp->code = COAP_ERROR_NOT_FOUND;
     return 0;
 }
@@ -6,8 +6,11 @@
  * <0 ante errores internos irreparables (p.ej., buffers insuficientes).
  */
 #include "handlers.h"
+#include "dispatcher.h"
 #include "time_source.h"
 #include "telemetry_storage.h"
+#include "metrics.h"
+#include "ratelimit.h"
 #include "log.h"
 #include <stdio.h>
 #include <string.h>
@@ -103,6 +106,74 @@ static int set_content_format_json(CoapMessage *resp) {
     return coap_message_add_option(resp, COAP_OPTION_CONTENT_FORMAT, &json_fmt, 1);
 }
 
+/*
+ * etag_from_generation
+ * --------------------
+ * Codifica la generación del storage como ETag: entero big-endian de longitud
+ * mínima (1..8 bytes). Retorna la cantidad de bytes escritos en 'out'.
+ */
+static size_t etag_from_generation(uint64_t generation, uint8_t out[8]) {
+    size_t len = 1;
+    while (len < 8 && (generation >> (len * 8)) != 0) len++;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (uint8_t)(generation >> ((len - 1 - i) * 8));
+    }
+    return len;
+}
+
+/*
+ * request_has_etag
+ * ----------------
+ * Indica si alguna de las opciones ETag de la request (puede repetirse en
+ * requests, RFC 7252 §5.10.6.2) coincide con el ETag actual del recurso.
+ */
+static bool request_has_etag(const CoapMessage *req, const uint8_t *etag, size_t len) {
+    if (!req) return false;
+    for (size_t i = 0; i < req->option_count; i++) {
+        const CoapOptionDef *opt = &req->options[i];
+        if (opt->number > COAP_OPTION_ETAG) break; // opciones ordenadas
+        if (opt->number == COAP_OPTION_ETAG && opt->length == len &&
+            memcmp(opt->value, etag, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * request_has_current_etag
+ * ------------------------
+ * Indica si la request presenta el ETag correspondiente a 'generation'.
+ */
+static bool request_has_current_etag(const CoapMessage *req, uint64_t generation) {
+    uint8_t etag[8];
+    size_t etag_len = etag_from_generation(generation, etag);
+    return request_has_etag(req, etag, etag_len);
+}
+
+/*
+ * set_etag
+ * --------
+ * Agrega a la respuesta el ETag derivado de 'generation'.
+ */
+static void set_etag(CoapMessage *resp, uint64_t generation) {
+    uint8_t etag[8];
+    size_t etag_len = etag_from_generation(generation, etag);
+    (void)coap_message_add_option(resp, COAP_OPTION_ETAG, etag, etag_len);
+}
+
+/*
+ * respond_valid
+ * -------------
+ * Deja la respuesta como 2.03 Valid sin payload, con el ETag validado.
+ */
+static void respond_valid(CoapMessage *resp, uint64_t generation) {
+    set_etag(resp, generation);
+    resp->code = COAP_RESPONSE_VALID; // 2.03
+    resp->payload = NULL;
+    resp->payload_length = 0;
+}
+
 /*
  * is_valid_json
  * -------------
@@ -188,14 +259,24 @@ int handle_telemetry_post(const CoapMessage *req, CoapMessage *resp) {
  * handle_telemetry_get
  * --------------------
  * GET /api/v1/telemetry — retorna todas las entradas en un arreglo JSON.
+ * Incluye ETag (generación del storage); si la request presenta el mismo ETag
+ * responde 2.03 Valid sin serializar.
  */
 int handle_telemetry_get(const CoapMessage *req, CoapMessage *resp) {
-    (void)req;
     if (!resp) return -1;
 
-    // Serializar todas las entradas a JSON array
-    int json_len = telemetry_storage_serialize_json(
-        (char *)resp->payload_buffer, sizeof(resp->payload_buffer));
+    // Conditional GET: si el cliente ya tiene esta generación, 2.03 sin payload
+    uint64_t generation = telemetry_storage_get_generation();
+    if (request_has_current_etag(req, generation)) {
+        respond_valid(resp, generation);
+        LOG_DEBUG("telemetry_get: 2.03 Valid (etag match)\n");
+        return 0;
+    }
+
+    // Serializar un snapshot consistente; el ETag es el de ese snapshot (no el
+    // leído arriba), así nunca etiqueta datos distintos a los enviados.
+    int json_len = telemetry_storage_serialize_snapshot(
+        (char *)resp->payload_buffer, sizeof(resp->payload_buffer), &generation);
     
     if (json_len < 0) {
         resp->code = COAP_ERROR_INTERNAL;
@@ -212,6 +293,7 @@ int handle_telemetry_get(const CoapMessage *req, CoapMessage *resp) {
     resp->code = COAP_RESPONSE_CONTENT; // 2.05
     resp->payload = resp->payload_buffer;
     resp->payload_length = (size_t)json_len;
+    set_etag(resp, generation);
     (void)set_content_format_json(resp);
     LOG_INFO("telemetry_get: returned %d bytes\n", json_len);
     return 0;
@@ -241,22 +323,31 @@ int handle_health(const CoapMessage *req, CoapMessage *resp) {
  * handle_status
  * -------------
  * GET /api/v1/status — estadísticas del servidor: uptime, conteos y capacidad.
+ * Sin ETag ni conditional GET: uptime_ms y los top offenders cambian sin que
+ * cambie la generación del storage, así que cada request recibe el estado
+ * actual.
  */
 int handle_status(const CoapMessage *req, CoapMessage *resp) {
     (void)req;
     if (!resp) return -1;
 
-    TelemetryStats stats;
-    telemetry_storage_get_stats(&stats);
+    TelemetrySnapshot snap;
+    telemetry_storage_snapshot(NULL, 0, &snap);
+    const TelemetryStats stats = snap.stats;
     uint64_t now = time_source_now_ms();
 
+    // Top offenders de la admisión por peer
+    char offenders[512];
+    if (ratelimit_format_offenders(offenders, sizeof(offenders)) < 0) return -1;
+
     int n = snprintf((char *)resp->payload_buffer, sizeof(resp->payload_buffer),
                      "{\"uptime_ms\":%llu,\"telemetry_received\":%zu,"
-                     "\"telemetry_stored\":%zu,\"capacity\":%zu}",
+                     "\"telemetry_stored\":%zu,\"capacity\":%zu,\"rate_limited\":%s}",
                      (unsigned long long)now,
                      stats.total_received,
                      stats.current_count,
-                     stats.capacity);
+                     stats.capacity,
+                     offenders);
     if (n < 0 || (size_t)n >= sizeof(resp->payload_buffer)) return -1;
     
     resp->payload = resp->payload_buffer;
@@ -266,6 +357,56 @@ int handle_status(const CoapMessage *req, CoapMessage *resp) {
     return 0;
 }
 
+/*
+ * respond_metrics
+ * ---------------
+ * Responde 2.05 con una sección del JSON de métricas (o 5.00 si no entra).
+ */
+static int respond_metrics(MetricsJsonSection section, CoapMessage *resp) {
+    if (!resp) return -1;
+
+    int n = metrics_format_json(section, (char *)resp->payload_buffer, sizeof(resp->payload_buffer));
+    if (n < 0) {
+        resp->code = COAP_ERROR_INTERNAL;
+        const char *msg = "{\"error\":\"serialization error\"}";
+        size_t len = strlen(msg);
+        memcpy(resp->payload_buffer, msg, len);
+        resp->payload = resp->payload_buffer;
+        resp->payload_length = len;
+        (void)set_content_format_json(resp);
+        LOG_ERROR("metrics: serialization error\n");
+        return 0;
+    }
+
+    resp->payload = resp->payload_buffer;
+    resp->payload_length = (size_t)n;
+    (void)set_content_format_json(resp);
+    resp->code = COAP_RESPONSE_CONTENT;
+    return 0;
+}
+
+/*
+ * handle_metrics / handle_metrics_routes / handle_metrics_queues
+ * ---------------------------------------------------------------
+ * GET /api/v1/metrics[/routes|/queues] — contadores de descarte e histogramas
+ * de latencia (n/p50/p99/p999/max en µs), repartidos en tres recursos para
+ * que cada respuesta quepa en un datagrama.
+ */
+int handle_metrics(const CoapMessage *req, CoapMessage *resp) {
+    (void)req;
+    return respond_metrics(METRICS_JSON_PIPELINE, resp);
+}
+
+int handle_metrics_routes(const CoapMessage *req, CoapMessage *resp) {
+    (void)req;
+    return respond_metrics(METRICS_JSON_ROUTES, resp);
+}
+
+int handle_metrics_queues(const CoapMessage *req, CoapMessage *resp) {
+    (void)req;
+    return respond_metrics(METRICS_JSON_QUEUES, resp);
+}
+
 /*
  * handle_test_echo (Testing)
  * -------------------------
@@ -275,3 +416,18 @@ int handle_test_echo(const CoapMessage *req, CoapMessage *resp) {
     // Idéntico a handle_echo (mantener separado para semántica)
     return handle_echo(req, resp);
 }
+
+/*
+ * handle_test_separate (Testing)
+ * ------------------------------
+ * POST /test/separate — echo entregado como respuesta separada: ejercita el
+ * camino ACK vacío + respuesta CON con retransmisión del transporte.
+ */
+int handle_test_separate(const CoapMessage *req, CoapMessage *resp) {
+    DispatchDeferred *deferred = dispatcher_defer(req);
+    int rc = handle_echo(req, resp);
+    if (!deferred) return rc;
+    if (rc != 0) resp->code = COAP_ERROR_INTERNAL;
+    dispatcher_complete(deferred, resp);
+    return DISPATCH_DEFERRED;
+}
@@ -0,0 +1,552 @@
+/*
+ * metrics.c — Contadores e histogramas de latencia por hilo, sin contención.
+ *
+ * Diseño
+ * - Cada hilo que registra obtiene (perezosamente) su propio shard, que se
+ *   enlaza a una lista global con un push lock-free. El hot path sólo escribe
+ *   en el shard propio: carga + store relajados, sin RMW atómicos ni locks.
+ * - Los lectores (endpoint /api/v1/metrics) suman todos los shards. Los
+ *   valores son aproximados bajo escritura concurrente, pero nunca se
+ *   corrompen (cada palabra es atómica).
+ * - Los shards no se liberan: un hilo que termina conserva sus contadores.
+ * - Histogramas log-lineales (estilo HDR): 16 sub-buckets lineales por
+ *   potencia de dos, de 0 ns a 2^40 ns; error relativo <= 6.25%.
+ */
+#include "metrics.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SUB_COUNT (1u << METRICS_SUB_BITS)
+
+typedef struct {
+    _Atomic uint64_t sum_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[METRICS_HIST_BUCKETS];
+} Histogram;
+
+typedef struct MetricsShard {
+    _Atomic uint64_t counters[METRIC_COUNTER_COUNT];
+    Histogram stages[METRIC_STAGE_COUNT];
+    Histogram routes[DISPATCH_ROUTE_COUNT];
+    Histogram classes[METRIC_CLASS_COUNT];
+    Histogram queue_wait[DISPATCH_PRIORITY_COUNT];
+    Histogram queue_depth[DISPATCH_PRIORITY_COUNT];    // En datagramas
+    struct MetricsShard *next;
+} MetricsShard;
+
+static _Atomic(MetricsShard *) g_shards;
+static _Thread_local MetricsShard *t_shard;
+
+/*
+ * local_shard
+ * -----------
+ * Shard del hilo actual; lo crea y registra en la primera llamada. Retorna
+ * NULL si no hay memoria (las métricas de ese hilo se pierden).
+ */
+static MetricsShard *local_shard(void) {
+    MetricsShard *shard = t_shard;
+    if (shard) return shard;
+
+    shard = (MetricsShard *)calloc(1, sizeof(*shard));
+    if (!shard) return NULL;
+    MetricsShard *head = atomic_load_explicit(&g_shards, memory_order_relaxed);
+    do {
+        shard->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&g_shards, &head, shard,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+    t_shard = shard;
+    return shard;
+}
+
+// Incremento de un solo escritor: no necesita fetch_add
+static inline void bump(_Atomic uint64_t *v, uint64_t n) {
+    atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+/*
+ * bucket_index / bucket_value
+ * ---------------------------
+ * Mapeo valor <-> bucket log-lineal. Valores < 16 tienen bucket exacto; luego
+ * cada potencia de dos 2^e se divide en 16 buckets de ancho 2^(e-4).
+ * bucket_value devuelve el mayor valor equivalente del bucket.
+ */
+static size_t bucket_index(uint64_t v) {
+    if (v < SUB_COUNT) return (size_t)v;
+    unsigned e = 63u - (unsigned)__builtin_clzll(v);
+    if (e >= METRICS_MAX_EXPONENT) return METRICS_HIST_BUCKETS - 1;
+    size_t sub = (size_t)(v >> (e - METRICS_SUB_BITS)) & (SUB_COUNT - 1);
+    return ((size_t)(e - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS) + sub;
+}
+
+static uint64_t bucket_value(size_t idx) {
+    if (idx < SUB_COUNT) return idx;
+    unsigned e = (unsigned)(idx >> METRICS_SUB_BITS) + METRICS_SUB_BITS - 1;
+    uint64_t sub = idx & (SUB_COUNT - 1);
+    uint64_t width = 1ull << (e - METRICS_SUB_BITS);
+    return ((SUB_COUNT + sub) << (e - METRICS_SUB_BITS)) + width - 1;
+}
+
+static void hist_record(Histogram *h, uint64_t ns) {
+    bump(&h->buckets[bucket_index(ns)], 1);
+    bump(&h->sum_ns, ns);
+    if (ns > atomic_load_explicit(&h->max_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&h->max_ns, ns, memory_order_relaxed);
+    }
+}
+
+void metrics_count(MetricCounter counter, uint64_t n) {
+    if ((unsigned)counter >= METRIC_COUNTER_COUNT) return;
+    MetricsShard *shard = local_shard();
+    if (shard) bump(&shard->counters[counter], n);
+}
+
+void metrics_record_stage(MetricStage stage, uint64_t ns) {
+    if ((unsigned)stage >= METRIC_STAGE_COUNT) return;
+    MetricsShard *shard = local_shard();
+    if (shard) hist_record(&shard->stages[stage], ns);
+}
+
+void metrics_record_request(DispatchRoute route, CoapCode code, uint64_t ns) {
+    if ((unsigned)route >= DISPATCH_ROUTE_COUNT) route = DISPATCH_ROUTE_UNMATCHED;
+    MetricsShard *shard = local_shard();
+    if (!shard) return;
+    hist_record(&shard->routes[route], ns);
+    hist_record(&shard->classes[metrics_class_of(code)], ns);
+}
+
+void metrics_record_queue_wait(DispatchPriority priority, uint64_t ns) {
+    if ((unsigned)priority >= DISPATCH_PRIORITY_COUNT) return;
+    MetricsShard *shard = local_shard();
+    if (shard) hist_record(&shard->queue_wait[priority], ns);
+}
+
+void metrics_record_queue_depth(DispatchPriority priority, size_t depth) {
+    if ((unsigned)priority >= DISPATCH_PRIORITY_COUNT) return;
+    MetricsShard *shard = local_shard();
+    if (shard) hist_record(&shard->queue_depth[priority], depth);
+}
+
+uint64_t metrics_counter_value(MetricCounter counter) {
+    if ((unsigned)counter >= METRIC_COUNTER_COUNT) return 0;
+    uint64_t total = 0;
+    for (MetricsShard *s = atomic_load_explicit(&g_shards, memory_order_acquire); s; s = s->next) {
+        total += atomic_load_explicit(&s->counters[counter], memory_order_relaxed);
+    }
+    return total;
+}
+
+/*
+ * summarize
+ * ---------
+ * Suma el histograma seleccionado (por offset dentro del shard) de todos los
+ * shards y calcula percentiles recorriendo los buckets acumulados.
+ */
+static void summarize(size_t offset, MetricsSummary *out) {
+    static _Thread_local uint64_t merged[METRICS_HIST_BUCKETS];
+    MetricsSummary sum = {0};
+    for (size_t i = 0; i < METRICS_HIST_BUCKETS; i++) merged[i] = 0;
+
+    for (MetricsShard *s = atomic_load_explicit(&g_shards, memory_order_acquire); s; s = s->next) {
+        Histogram *h = (Histogram *)((char *)s + offset);
+        uint64_t max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+        sum.sum_ns += atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+        if (max > sum.max_ns) sum.max_ns = max;
+        for (size_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+            uint64_t c = atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+            merged[i] += c;
+            sum.count += c; // contar desde buckets: coherente con los percentiles
+        }
+    }
+
+    if (sum.count > 0) {
+        // Rango (1-based) de cada percentil: ceil(q * count)
+        const uint64_t r50 = (sum.count * 500 + 999) / 1000;
+        const uint64_t r99 = (sum.count * 990 + 999) / 1000;
+        const uint64_t r999 = (sum.count * 999 + 999) / 1000;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+            if (merged[i] == 0) continue;
+            uint64_t prev = seen;
+            seen += merged[i];
+            uint64_t v = bucket_value(i);
+            if (v > sum.max_ns) v = sum.max_ns;
+            if (prev < r50 && seen >= r50) sum.p50_ns = v;
+            if (prev < r99 && seen >= r99) sum.p99_ns = v;
+            if (seen >= r999) { sum.p999_ns = v; break; }
+        }
+    }
+    *out = sum;
+}
+
+void metrics_stage_summary(MetricStage stage, MetricsSummary *out) {
+    if (!out) return;
+    if ((unsigned)stage >= METRIC_STAGE_COUNT) { *out = (MetricsSummary){0}; return; }
+    summarize(offsetof(MetricsShard, stages) + (size_t)stage * sizeof(Histogram), out);
+}
+
+void metrics_route_summary(DispatchRoute route, MetricsSummary *out) {
+    if (!out) return;
+    if ((unsigned)route >= DISPATCH_ROUTE_COUNT) { *out = (MetricsSummary){0}; return; }
+    summarize(offsetof(MetricsShard, routes) + (size_t)route * sizeof(Histogram), out);
+}
+
+void metrics_class_summary(MetricClass cls, MetricsSummary *out) {
+    if (!out) return;
+    if ((unsigned)cls >= METRIC_CLASS_COUNT) { *out = (MetricsSummary){0}; return; }
+    summarize(offsetof(MetricsShard, classes) + (size_t)cls * sizeof(Histogram), out);
+}
+
+void metrics_queue_wait_summary(DispatchPriority priority, MetricsSummary *out) {
+    if (!out) return;
+    if ((unsigned)priority >= DISPATCH_PRIORITY_COUNT) { *out = (MetricsSummary){0}; return; }
+    summarize(offsetof(MetricsShard, queue_wait) + (size_t)priority * sizeof(Histogram), out);
+}
+
+void metrics_queue_depth_summary(DispatchPriority priority, MetricsSummary *out) {
+    if (!out) return;
+    if ((unsigned)priority >= DISPATCH_PRIORITY_COUNT) { *out = (MetricsSummary){0}; return; }
+    summarize(offsetof(MetricsShard, queue_depth) + (size_t)priority * sizeof(Histogram), out);
+}
+
+MetricClass metrics_class_of(CoapCode code) {
+    switch (coap_code_class(code)) {
+        case 2: return METRIC_CLASS_2XX;
+        case 4: return METRIC_CLASS_4XX;
+        case 5: return METRIC_CLASS_5XX;
+        default: return METRIC_CLASS_OTHER;
+    }
+}
+
+const char *metrics_class_name(MetricClass cls) {
+    static const char *const names[METRIC_CLASS_COUNT] = { "2xx", "4xx", "5xx", "other" };
+    return (unsigned)cls < METRIC_CLASS_COUNT ? names[cls] : "unknown";
+}
+
+const char *metrics_stage_name(MetricStage stage) {
+    static const char *const names[METRIC_STAGE_COUNT] = { "decode", "dispatch", "encode", "send" };
+    return (unsigned)stage < METRIC_STAGE_COUNT ? names[stage] : "unknown";
+}
+
+const char *metrics_counter_name(MetricCounter counter) {
+    static const char *const names[METRIC_COUNTER_COUNT] = {
+        "rx", "drop_decode", "drop_dispatch", "drop_encode", "drop_send",
+        "busy_poll_spin_ns", "busy_poll_sleep_ns", "busy_poll_rx", "busy_poll_sleeps",
+        "offloaded", "separate", "retransmit", "separate_timeout",
+        "outbound_queued", "rate_limited", "shed", "overloaded_ns",
+        "loop_busy_ns", "loop_idle_ns", "rx_budget_exhausted"
+    };
+    return (unsigned)counter < METRIC_COUNTER_COUNT ? names[counter] : "unknown";
+}
+
+/*
+ * append / append_summary
+ * -----------------------
+ * Helpers de serialización: escriben en out+*pos y fallan si no hay espacio.
+ */
+__attribute__((format(printf, 4, 5)))
+static bool append(char *out, size_t out_size, size_t *pos, const char *fmt, ...) {
+    if (*pos >= out_size) return false;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(out + *pos, out_size - *pos, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)n >= out_size - *pos) return false;
+    *pos += (size_t)n;
+    return true;
+}
+
+// Histograma como "nombre":[n,p50,p99,p999,max]; los vacíos se omiten
+static bool append_summary_scaled(char *out, size_t out_size, size_t *pos, bool *first,
+                                  const char *name, const MetricsSummary *s, uint64_t div) {
+    if (s->count == 0) return true;
+    bool ok = append(out, out_size, pos, "%s\"%s\":[%llu,%llu,%llu,%llu,%llu]",
+                     *first ? "" : ",", name,
+                     (unsigned long long)s->count,
+                     (unsigned long long)(s->p50_ns / div),
+                     (unsigned long long)(s->p99_ns / div),
+                     (unsigned long long)(s->p999_ns / div),
+                     (unsigned long long)(s->max_ns / div));
+    *first = false;
+    return ok;
+}
+
+static bool append_summary(char *out, size_t out_size, size_t *pos, bool *first,
+                           const char *name, const MetricsSummary *s) {
+    return append_summary_scaled(out, out_size, pos, first, name, s, 1000);
+}
+
+/*
+ * metrics_format_json
+ * -------------------
+ * Una sección del JSON de métricas, de modo que cada documento quepa en un
+ * datagrama CoAP aun con todos los contadores e histogramas poblados:
+ * - METRICS_JSON_PIPELINE: {"unit":"us","counters":{...},"stages":{...},
+ *   "classes":{...}} (sólo contadores no nulos).
+ * - METRICS_JSON_ROUTES: {"unit":"us","routes":{...}}
+ * - METRICS_JSON_QUEUES: {"unit":"us","queue_wait":{...},"queue_depth":{...}}
+ *   (queue_depth en datagramas).
+ * Cada histograma es [n,p50,p99,p999,max]; se omiten los vacíos.
+ */
+int metrics_format_json(MetricsJsonSection section, char *out, size_t out_size) {
+    if (!out || out_size == 0) return -1;
+    size_t pos = 0;
+    MetricsSummary s;
+    bool first = true;
+    bool ok = append(out, out_size, &pos, "{\"unit\":\"us\"");
+
+    switch (section) {
+        case METRICS_JSON_PIPELINE:
+            ok = ok && append(out, out_size, &pos, ",\"counters\":{");
+            for (int c = 0; ok && c < METRIC_COUNTER_COUNT; c++) {
+                uint64_t v = metrics_counter_value((MetricCounter)c);
+                if (v == 0) continue;
+                ok = append(out, out_size, &pos, "%s\"%s\":%llu", first ? "" : ",",
+                            metrics_counter_name((MetricCounter)c), (unsigned long long)v);
+                first = false;
+            }
+            first = true;
+            ok = ok && append(out, out_size, &pos, "},\"stages\":{");
+            for (int i = 0; ok && i < METRIC_STAGE_COUNT; i++) {
+                metrics_stage_summary((MetricStage)i, &s);
+                ok = append_summary(out, out_size, &pos, &first, metrics_stage_name((MetricStage)i), &s);
+            }
+            first = true;
+            ok = ok && append(out, out_size, &pos, "},\"classes\":{");
+            for (int i = 0; ok && i < METRIC_CLASS_COUNT; i++) {
+                metrics_class_summary((MetricClass)i, &s);
+                ok = append_summary(out, out_size, &pos, &first, metrics_class_name((MetricClass)i), &s);
+            }
+            break;
+        case METRICS_JSON_ROUTES:
+            ok = ok && append(out, out_size, &pos, ",\"routes\":{");
+            for (int i = 0; ok && i < DISPATCH_ROUTE_COUNT; i++) {
+                metrics_route_summary((DispatchRoute)i, &s);
+                ok = append_summary(out, out_size, &pos, &first, dispatcher_route_name((DispatchRoute)i), &s);
+            }
+            break;
+        case METRICS_JSON_QUEUES:
+            ok = ok && append(out, out_size, &pos, ",\"queue_wait\":{");
+            for (int i = 0; ok && i < DISPATCH_PRIORITY_COUNT; i++) {
+                metrics_queue_wait_summary((DispatchPriority)i, &s);
+                ok = append_summary(out, out_size, &pos, &first, dispatcher_priority_name((DispatchPriority)i), &s);
+            }
+            first = true;
+            ok = ok && append(out, out_size, &pos, "},\"queue_depth\":{");
+            for (int i = 0; ok && i < DISPATCH_PRIORITY_COUNT; i++) {
+                metrics_queue_depth_summary((DispatchPriority)i, &s);
+                ok = append_summary_scaled(out, out_size, &pos, &first,
+                                           dispatcher_priority_name((DispatchPriority)i), &s, 1);
+            }
+            break;
+        default:
+            return -1;
+    }
+    ok = ok && append(out, out_size, &pos, "}}");
+    return ok ? (int)pos : -2;
+}
+
+/*
+ * append_prom_summary
+ * -------------------
+ * Serie de tipo summary en formato de texto Prometheus: cuantiles 0.5, 0.99 y
+ * 0.999 más _sum y _count, en segundos ('seconds') o en la unidad cruda.
+ */
+static bool append_prom_summary_unit(char *out, size_t out_size, size_t *pos,
+                                     const char *metric, const char *label,
+                                     const char *value, const MetricsSummary *s,
+                                     bool seconds) {
+    static const struct { const char *q; size_t off; } quantiles[] = {
+        { "0.5", offsetof(MetricsSummary, p50_ns) },
+        { "0.99", offsetof(MetricsSummary, p99_ns) },
+        { "0.999", offsetof(MetricsSummary, p999_ns) },
+    };
+    bool ok = true;
+    for (size_t i = 0; ok && i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        uint64_t ns = *(const uint64_t *)((const char *)s + quantiles[i].off);
+        if (s->count == 0) { // sin muestras: convención de Prometheus
+            ok = append(out, out_size, pos, "%s{%s=\"%s\",quantile=\"%s\"} NaN\n",
+                        metric, label, value, quantiles[i].q);
+            continue;
+        }
+        if (seconds) {
+            ok = append(out, out_size, pos, "%s{%s=\"%s\",quantile=\"%s\"} %.9f\n",
+                        metric, label, value, quantiles[i].q, (double)ns / 1e9);
+        } else {
+            ok = append(out, out_size, pos, "%s{%s=\"%s\",quantile=\"%s\"} %llu\n",
+                        metric, label, value, quantiles[i].q, (unsigned long long)ns);
+        }
+    }
+    if (!seconds) {
+        return ok &&
+               append(out, out_size, pos, "%s_sum{%s=\"%s\"} %llu\n%s_count{%s=\"%s\"} %llu\n",
+                      metric, label, value, (unsigned long long)s->sum_ns,
+                      metric, label, value, (unsigned long long)s->count);
+    }
+    return ok &&
+           append(out, out_size, pos, "%s_sum{%s=\"%s\"} %.9f\n%s_count{%s=\"%s\"} %llu\n",
+                  metric, label, value, (double)s->sum_ns / 1e9,
+                  metric, label, value, (unsigned long long)s->count);
+}
+
+static bool append_prom_summary(char *out, size_t out_size, size_t *pos,
+                                const char *metric, const char *label,
+                                const char *value, const MetricsSummary *s) {
+    return append_prom_summary_unit(out, out_size, pos, metric, label, value, s, true);
+}
+
+/*
+ * metrics_format_prometheus
+ * -------------------------
+ * Exposición en formato de texto de Prometheus (0.0.4): contadores de
+ * datagramas y descartes, y summaries de latencia por etapa, ruta y clase.
+ * Retorna longitud escrita o negativo si no cabe.
+ */
+int metrics_format_prometheus(char *out, size_t out_size) {
+    if (!out || out_size == 0) return -1;
+    size_t pos = 0;
+    bool ok = append(out, out_size, &pos,
+                     "# HELP teleserver_datagrams_received_total Datagramas UDP recibidos.\n"
+                     "# TYPE teleserver_datagrams_received_total counter\n"
+                     "teleserver_datagrams_received_total %llu\n"
+                     "# HELP teleserver_datagrams_dropped_total Datagramas o respuestas descartados por etapa.\n"
+                     "# TYPE teleserver_datagrams_dropped_total counter\n",
+                     (unsigned long long)metrics_counter_value(METRIC_RX_DATAGRAMS));
+    static const struct { MetricCounter c; const char *reason; } drops[] = {
+        { METRIC_DROP_DECODE, "decode" }, { METRIC_DROP_DISPATCH, "dispatch" },
+        { METRIC_DROP_ENCODE, "encode" }, { METRIC_DROP_SEND, "send" },
+    };
+    for (size_t i = 0; ok && i < sizeof(drops) / sizeof(drops[0]); i++) {
+        ok = append(out, out_size, &pos, "teleserver_datagrams_dropped_total{reason=\"%s\"} %llu\n",
+                    drops[i].reason, (unsigned long long)metrics_counter_value(drops[i].c));
+    }
+
+    ok = ok && append(out, out_size, &pos,
+                      "# HELP teleserver_busy_poll_seconds_total Tiempo del modo busy-poll girando vs durmiendo.\n"
+                      "# TYPE teleserver_busy_poll_seconds_total counter\n"
+                      "teleserver_busy_poll_seconds_total{state=\"spin\"} %.9f\n"
+                      "teleserver_busy_poll_seconds_total{state=\"sleep\"} %.9f\n"
+                      "# HELP teleserver_busy_poll_datagrams_total Datagramas recibidos durante el giro.\n"
+                      "# TYPE teleserver_busy_poll_datagrams_total counter\n"
+                      "teleserver_busy_poll_datagrams_total %llu\n"
+                      "# HELP teleserver_busy_poll_sleeps_total Giros agotados sin tráfico (caída a espera bloqueante).\n"
+                      "# TYPE teleserver_busy_poll_sleeps_total counter\n"
+                      "teleserver_busy_poll_sleeps_total %llu\n"
+                      "# HELP teleserver_offloaded_requests_total Requests ejecutadas en el pool de workers.\n"
+                      "# TYPE teleserver_offloaded_requests_total counter\n"
+                      "teleserver_offloaded_requests_total %llu\n"
+                      "# HELP teleserver_separate_responses_total Respuestas separadas (ACK vacío + respuesta posterior).\n"
+                      "# TYPE teleserver_separate_responses_total counter\n"
+                      "teleserver_separate_responses_total %llu\n"
+                      "# HELP teleserver_retransmissions_total Retransmisiones de mensajes CON originados por el servidor.\n"
+                      "# TYPE teleserver_retransmissions_total counter\n"
+                      "teleserver_retransmissions_total %llu\n"
+                      "# HELP teleserver_separate_timeouts_total Respuestas separadas CON abandonadas sin ACK.\n"
+                      "# TYPE teleserver_separate_timeouts_total counter\n"
+                      "teleserver_separate_timeouts_total %llu\n"
+                      "# HELP teleserver_outbound_queued_total CON propios demorados por NSTART o pacing.\n"
+                      "# TYPE teleserver_outbound_queued_total counter\n"
+                      "teleserver_outbound_queued_total %llu\n"
+                      "# HELP teleserver_rate_limited_total Datagramas rechazados por la admisión por peer.\n"
+                      "# TYPE teleserver_rate_limited_total counter\n"
+                      "teleserver_rate_limited_total %llu\n"
+                      "# HELP teleserver_shed_requests_total Requests descartadas (5.03) por sobrecarga.\n"
+                      "# TYPE teleserver_shed_requests_total counter\n"
+                      "teleserver_shed_requests_total %llu\n"
+                      "# HELP teleserver_overloaded_seconds_total Tiempo en estado de sobrecarga.\n"
+                      "# TYPE teleserver_overloaded_seconds_total counter\n"
+                      "teleserver_overloaded_seconds_total %.3f\n"
+                      "# HELP teleserver_loop_seconds_total Tiempo del event loop ocupado vs esperando eventos.\n"
+                      "# TYPE teleserver_loop_seconds_total counter\n"
+                      "teleserver_loop_seconds_total{state=\"busy\"} %.9f\n"
+                      "teleserver_loop_seconds_total{state=\"idle\"} %.9f\n"
+                      "# HELP teleserver_rx_budget_exhausted_total Lecturas del socket cortadas por presupuesto.\n"
+                      "# TYPE teleserver_rx_budget_exhausted_total counter\n"
+                      "teleserver_rx_budget_exhausted_total %llu\n",
+                      (double)metrics_counter_value(METRIC_BUSY_POLL_SPIN_NS) / 1e9,
+                      (double)metrics_counter_value(METRIC_BUSY_POLL_SLEEP_NS) / 1e9,
+                      (unsigned long long)metrics_counter_value(METRIC_BUSY_POLL_RX),
+                      (unsigned long long)metrics_counter_value(METRIC_BUSY_POLL_SLEEPS),
+                      (unsigned long long)metrics_counter_value(METRIC_OFFLOADED),
+                      (unsigned long long)metrics_counter_value(METRIC_SEPARATE),
+                      (unsigned long long)metrics_counter_value(METRIC_RETRANSMIT),
+                      (unsigned long long)metrics_counter_value(METRIC_SEPARATE_TIMEOUT),
+                      (unsigned long long)metrics_counter_value(METRIC_OUTBOUND_QUEUED),
+                      (unsigned long long)metrics_counter_value(METRIC_RATE_LIMITED),
+                      (unsigned long long)metrics_counter_value(METRIC_SHED),
+                      (double)metrics_counter_value(METRIC_OVERLOADED_NS) / 1e9,
+                      (double)metrics_counter_value(METRIC_LOOP_BUSY_NS) / 1e9,
+                      (double)metrics_counter_value(METRIC_LOOP_IDLE_NS) / 1e9,
+                      (unsigned long long)metrics_counter_value(METRIC_RX_BUDGET_EXHAUSTED));
+
+    MetricsSummary s;
+    ok = ok && append(out, out_size, &pos,
+                      "# HELP teleserver_stage_duration_seconds Latencia por etapa del pipeline CoAP.\n"
+                      "# TYPE teleserver_stage_duration_seconds summary\n");
+    for (int i = 0; ok && i < METRIC_STAGE_COUNT; i++) {
+        metrics_stage_summary((MetricStage)i, &s);
+        ok = append_prom_summary(out, out_size, &pos, "teleserver_stage_duration_seconds",
+                                 "stage", metrics_stage_name((MetricStage)i), &s);
+    }
+    ok = ok && append(out, out_size, &pos,
+                      "# HELP teleserver_request_duration_seconds Latencia de request por ruta.\n"
+                      "# TYPE teleserver_request_duration_seconds summary\n");
+    for (int i = 0; ok && i < DISPATCH_ROUTE_COUNT; i++) {
+        metrics_route_summary((DispatchRoute)i, &s);
+        ok = append_prom_summary(out, out_size, &pos, "teleserver_request_duration_seconds",
+                                 "route", dispatcher_route_name((DispatchRoute)i), &s);
+    }
+    ok = ok && append(out, out_size, &pos,
+                      "# HELP teleserver_response_duration_seconds Latencia de request por clase de respuesta.\n"
+                      "# TYPE teleserver_response_duration_seconds summary\n");
+    for (int i = 0; ok && i < METRIC_CLASS_COUNT; i++) {
+        metrics_class_summary((MetricClass)i, &s);
+        ok = append_prom_summary(out, out_size, &pos, "teleserver_response_duration_seconds",
+                                 "class", metrics_class_name((MetricClass)i), &s);
+    }
+    ok = ok && append(out, out_size, &pos,
+                      "# HELP teleserver_queue_wait_seconds Espera en la cola de recepción por prioridad.\n"
+                      "# TYPE teleserver_queue_wait_seconds summary\n");
+    for (int i = 0; ok && i < DISPATCH_PRIORITY_COUNT; i++) {
+        metrics_queue_wait_summary((DispatchPriority)i, &s);
+        ok = append_prom_summary(out, out_size, &pos, "teleserver_queue_wait_seconds",
+                                 "class", dispatcher_priority_name((DispatchPriority)i), &s);
+    }
+    ok = ok && append(out, out_size, &pos,
+                      "# HELP teleserver_queue_depth Datagramas encolados por prioridad en cada lote leído.\n"
+                      "# TYPE teleserver_queue_depth summary\n");
+    for (int i = 0; ok && i < DISPATCH_PRIORITY_COUNT; i++) {
+        metrics_queue_depth_summary((DispatchPriority)i, &s);
+        ok = append_prom_summary_unit(out, out_size, &pos, "teleserver_queue_depth",
+                                      "class", dispatcher_priority_name((DispatchPriority)i), &s, false);
+    }
+    return ok ? (int)pos : -2;
+}
+
+/*
+ * metrics_reset
+ * -------------
+ * Pone a cero todos los shards registrados. Pensado para tests: no debe
+ * ejecutarse con escritores activos.
+ */
+void metrics_reset(void) {
+    for (MetricsShard *s = atomic_load_explicit(&g_shards, memory_order_acquire); s; s = s->next) {
+        for (size_t i = 0; i < METRIC_COUNTER_COUNT; i++) atomic_store(&s->counters[i], 0);
+        Histogram *hists[] = { s->stages, s->routes, s->classes, s->queue_wait, s->queue_depth };
+        size_t counts[] = { METRIC_STAGE_COUNT, DISPATCH_ROUTE_COUNT, METRIC_CLASS_COUNT,
+                            DISPATCH_PRIORITY_COUNT, DISPATCH_PRIORITY_COUNT };
+        for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+            for (size_t j = 0; j < counts[k]; j++) {
+                Histogram *h = &hists[k][j];
+                atomic_store(&h->sum_ns, 0);
+                atomic_store(&h->max_ns, 0);
+                for (size_t b = 0; b < METRICS_HIST_BUCKETS; b++) atomic_store(&h->buckets[b], 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/*
+ * overload.c — Detector de sobrecarga con histéresis para descarte por prioridad.
+ *
+ * Señales
+ * - Lag del loop: cuánto tarda en disparar un timer periódico respecto de su
+ *   deadline. Crece cuando los callbacks de I/O acaparan el hilo.
+ * - Backlog: datagramas drenados por despertar. Crece cuando el socket se
+ *   llena más rápido de lo que se vacía (antes de que el kernel descarte en
+ *   silencio).
+ * Ambas se suavizan con EWMA (alfa 1/4) y se normalizan por su umbral; la
+ * presión es la mayor de las dos.
+ *
+ * Niveles
+ * - Sube al nivel N cuando la presión alcanza N*100%; baja del nivel N
+ *   cuando cae por debajo de N*50%. La banda evita oscilar en el borde.
+ */
+#include "overload.h"
+
+#include <stdlib.h>
+
+#define OVERLOAD_EWMA_SHIFT 2   // alfa = 1/4
+#define OVERLOAD_MAX_LEVEL OVERLOAD_LEVEL_SHED_NORMAL
+
+struct OverloadController {
+    OverloadConfig cfg;
+    uint64_t lag_ewma_us;
+    uint64_t backlog_ewma_x16;  // Punto fijo: 1/16 de datagrama
+    unsigned level;
+    uint32_t pressure_pct;
+    uint32_t rng;
+};
+
+/*
+ * overload_create
+ * ---------------
+ * Umbrales en 0 toman valores por defecto (20 ms de lag, 256 datagramas).
+ */
+OverloadController *overload_create(const OverloadConfig *cfg) {
+    OverloadController *oc = calloc(1, sizeof(*oc));
+    if (!oc) return NULL;
+    if (cfg) oc->cfg = *cfg;
+    if (oc->cfg.lag_threshold_us == 0) oc->cfg.lag_threshold_us = 20000;
+    if (oc->cfg.backlog_threshold == 0) oc->cfg.backlog_threshold = 256;
+    oc->rng = (uint32_t)(uintptr_t)oc | 1u;
+    return oc;
+}
+
+void overload_destroy(OverloadController *oc) {
+    free(oc);
+}
+
+static void ewma(uint64_t *avg, uint64_t sample) {
+    if (sample >= *avg) *avg += (sample - *avg + (1u << OVERLOAD_EWMA_SHIFT) - 1) >> OVERLOAD_EWMA_SHIFT;
+    else *avg -= (*avg - sample) >> OVERLOAD_EWMA_SHIFT;
+}
+
+void overload_record_lag(OverloadController *oc, uint64_t lag_us) {
+    if (oc) ewma(&oc->lag_ewma_us, lag_us);
+}
+
+void overload_record_backlog(OverloadController *oc, size_t datagrams) {
+    if (oc) ewma(&oc->backlog_ewma_x16, (uint64_t)datagrams * 16);
+}
+
+/*
+ * overload_update
+ * ---------------
+ * Presión = max(lag/umbral, backlog/umbral) en %; ajusta el nivel con
+ * histéresis (a lo sumo un paso hacia abajo por llamada).
+ */
+unsigned overload_update(OverloadController *oc) {
+    if (!oc) return OVERLOAD_LEVEL_NONE;
+    uint64_t lag_pct = oc->lag_ewma_us * 100 / oc->cfg.lag_threshold_us;
+    uint64_t backlog_pct = oc->backlog_ewma_x16 * 100 / ((uint64_t)oc->cfg.backlog_threshold * 16);
+    uint64_t pressure = lag_pct > backlog_pct ? lag_pct : backlog_pct;
+    oc->pressure_pct = pressure > UINT32_MAX ? UINT32_MAX : (uint32_t)pressure;
+
+    unsigned target = (unsigned)(pressure / 100);
+    if (target > OVERLOAD_MAX_LEVEL) target = OVERLOAD_MAX_LEVEL;
+    if (target > oc->level) {
+        oc->level = target;
+    } else if (oc->level > 0 && pressure < (uint64_t)oc->level * 50) {
+        oc->level--;
+    }
+    return oc->level;
+}
+
+unsigned overload_level(const OverloadController *oc) {
+    return oc ? oc->level : OVERLOAD_LEVEL_NONE;
+}
+
+uint32_t overload_pressure_pct(const OverloadController *oc) {
+    return oc ? oc->pressure_pct : 0;
+}
+
+/*
+ * overload_should_shed
+ * --------------------
+ * Nivel 1 descarta LOW; nivel 2, también NORMAL. HIGH nunca.
+ */
+bool overload_should_shed(const OverloadController *oc, DispatchPriority priority) {
+    if (!oc || oc->level == OVERLOAD_LEVEL_NONE) return false;
+    if (priority == DISPATCH_PRIORITY_LOW) return true;
+    return priority == DISPATCH_PRIORITY_NORMAL && oc->level >= OVERLOAD_LEVEL_SHED_NORMAL;
+}
+
+/*
+ * overload_max_age
+ * ----------------
+ * Base = 2 s por cada 100% de presión (acotada), más un jitter uniforme de
+ * hasta el 50% de la base.
+ */
+uint32_t overload_max_age(OverloadController *oc) {
+    if (!oc) return 1;
+    uint64_t base = (uint64_t)oc->pressure_pct * 2 / 100;
+    if (base < 1) base = 1;
+    if (base > OVERLOAD_MAX_AGE_S) base = OVERLOAD_MAX_AGE_S;
+    uint32_t x = oc->rng;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    oc->rng = x;
+    uint64_t age = base + x % (base / 2 + 1);
+    return age > OVERLOAD_MAX_AGE_S ? OVERLOAD_MAX_AGE_S : (uint32_t)age;
+}
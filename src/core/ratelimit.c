@@ -0,0 +1,243 @@
+/*
+ * ratelimit.c — Token bucket por peer en una tabla de tamaño fijo.
+ *
+ * Diseño
+ * - Clave: dirección IP de 16 bytes (IPv4 como ::ffff:a.b.c.d), sin puerto:
+ *   un dispositivo que reabre el socket no obtiene un bucket nuevo.
+ * - Slots de 32 bytes (dos por línea de caché). Un peer se busca en una
+ *   ventana de RATELIMIT_PROBE slots contiguos desde su hash; si no está y no
+ *   hay libres, se recicla el slot con más tiempo sin tráfico. La memoria es
+ *   fija aunque una tormenta use miles de direcciones.
+ * - Fichas en milésimas y tiempo en ms (32 bits, diferencias módulo 2^32):
+ *   recargar es una multiplicación, sin divisiones en el camino admitido.
+ */
+#include "ratelimit.h"
+
+#include <arpa/inet.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RATELIMIT_PROBE 8
+
+typedef struct {
+    uint8_t key[16];        // Todo cero => slot libre
+    uint32_t tokens_milli;
+    uint32_t last_ms;       // Última recarga (ms, truncado)
+    uint32_t limited;
+    uint32_t tag;           // Bits altos del hash: descarta claves sin memcmp
+} RateSlot;
+
+struct RateLimiter {
+    RateSlot *slots;
+    size_t mask;
+    uint32_t rate;          // Fichas por segundo = milésimas por ms
+    uint32_t cap_milli;
+};
+
+static _Atomic(RateLimiter *) g_active;
+
+/*
+ * peer_key
+ * --------
+ * Normaliza la dirección a 16 bytes. Retorna false si la familia no es IP.
+ */
+static bool peer_key(const struct sockaddr *sa, uint8_t key[16]) {
+    if (!sa) return false;
+    if (sa->sa_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)sa;
+        memset(key, 0, 10);
+        key[10] = key[11] = 0xFF;
+        memcpy(key + 12, &in->sin_addr, 4);
+        return true;
+    }
+    if (sa->sa_family == AF_INET6) {
+        memcpy(key, &((const struct sockaddr_in6 *)sa)->sin6_addr, 16);
+        return true;
+    }
+    return false;
+}
+
+static uint64_t key_hash(const uint8_t key[16]) {
+    uint64_t a, b;
+    memcpy(&a, key, 8);
+    memcpy(&b, key + 8, 8);
+    uint64_t x = a ^ (b * 0x9e3779b97f4a7c15ull);
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+static bool key_empty(const uint8_t key[16]) {
+    static const uint8_t zero[16];
+    return memcmp(key, zero, 16) == 0;
+}
+
+/*
+ * ratelimit_create
+ * ----------------
+ * Reserva la tabla (slots redondeados a potencia de dos, mínimo la ventana).
+ */
+RateLimiter *ratelimit_create(uint32_t rate, uint32_t burst, size_t slots) {
+    if (rate == 0) return NULL;
+    if (burst == 0) burst = rate;
+    if (slots == 0) slots = RATELIMIT_DEFAULT_SLOTS;
+    size_t n = RATELIMIT_PROBE;
+    while (n < slots && n < ((size_t)1 << 24)) n <<= 1;
+
+    RateLimiter *rl = calloc(1, sizeof(*rl));
+    if (!rl) return NULL;
+    rl->slots = calloc(n, sizeof(RateSlot));
+    if (!rl->slots) {
+        free(rl);
+        return NULL;
+    }
+    rl->mask = n - 1;
+    rl->rate = rate;
+    uint64_t cap = (uint64_t)burst * 1000;
+    rl->cap_milli = cap > UINT32_MAX ? UINT32_MAX : (uint32_t)cap;
+    return rl;
+}
+
+void ratelimit_destroy(RateLimiter *rl) {
+    if (!rl) return;
+    RateLimiter *expected = rl;
+    atomic_compare_exchange_strong(&g_active, &expected, NULL);
+    free(rl->slots);
+    free(rl);
+}
+
+/*
+ * find_slot
+ * ---------
+ * Slot del peer dentro de su ventana; si no está, uno libre o el de tráfico
+ * más antiguo, reiniciado con el bucket lleno.
+ */
+static RateSlot *find_slot(RateLimiter *rl, const uint8_t key[16], uint32_t now) {
+    uint64_t h = key_hash(key);
+    uint32_t tag = (uint32_t)(h >> 32);
+    size_t base = (size_t)h;
+    RateSlot *free_slot = NULL, *oldest = NULL;
+    uint32_t oldest_idle = 0;
+    for (size_t i = 0; i < RATELIMIT_PROBE; i++) {
+        RateSlot *s = &rl->slots[(base + i) & rl->mask];
+        if (s->tag == tag && memcmp(s->key, key, 16) == 0) return s;
+        if (key_empty(s->key)) {
+            if (!free_slot) free_slot = s;
+            continue;
+        }
+        uint32_t idle = now - s->last_ms;
+        if (!oldest || idle > oldest_idle) {
+            oldest = s;
+            oldest_idle = idle;
+        }
+    }
+    RateSlot *victim = free_slot ? free_slot : oldest;
+    memcpy(victim->key, key, 16);
+    victim->tag = tag;
+    victim->tokens_milli = rl->cap_milli;
+    victim->last_ms = now;
+    victim->limited = 0;
+    return victim;
+}
+
+/*
+ * ratelimit_check
+ * ---------------
+ * Recarga y consume una ficha; sin fichas retorna la espera en segundos.
+ */
+uint32_t ratelimit_check(RateLimiter *rl, const struct sockaddr *peer, uint64_t now_ms) {
+    uint8_t key[16];
+    if (!rl || !peer_key(peer, key)) return 0;
+    const uint32_t now = (uint32_t)now_ms;
+    RateSlot *s = find_slot(rl, key, now);
+
+    uint64_t refill = (uint64_t)(now - s->last_ms) * rl->rate;
+    uint64_t tokens = s->tokens_milli + refill;
+    s->tokens_milli = tokens > rl->cap_milli ? rl->cap_milli : (uint32_t)tokens;
+    s->last_ms = now;
+    if (s->tokens_milli >= 1000) {
+        s->tokens_milli -= 1000;
+        return 0;
+    }
+    if (s->limited != UINT32_MAX) s->limited++;
+    uint32_t wait_ms = (1000 - s->tokens_milli + rl->rate - 1) / rl->rate;
+    return (wait_ms + 999) / 1000;
+}
+
+/*
+ * format_key
+ * ----------
+ * Dirección legible (IPv4 para claves ::ffff:a.b.c.d).
+ */
+static void format_key(const uint8_t key[16], char *out, size_t out_size) {
+    static const uint8_t v4_prefix[12] = { 0,0,0,0,0,0,0,0,0,0,0xFF,0xFF };
+    if (memcmp(key, v4_prefix, 12) == 0) {
+        inet_ntop(AF_INET, key + 12, out, (socklen_t)out_size);
+    } else {
+        inet_ntop(AF_INET6, key, out, (socklen_t)out_size);
+    }
+}
+
+/*
+ * ratelimit_top_offenders
+ * -----------------------
+ * Recorre la tabla manteniendo los 'max' con más rechazos (inserción
+ * ordenada; max es chico).
+ */
+size_t ratelimit_top_offenders(const RateLimiter *rl, RateLimitOffender *out, size_t max) {
+    if (!rl || !out || max == 0) return 0;
+    const RateSlot *top[RATELIMIT_TOP_N];
+    if (max > RATELIMIT_TOP_N) max = RATELIMIT_TOP_N;
+    size_t count = 0;
+    for (size_t i = 0; i <= rl->mask; i++) {
+        const RateSlot *s = &rl->slots[i];
+        if (s->limited == 0 || key_empty(s->key)) continue;
+        if (count == max && s->limited <= top[count - 1]->limited) continue;
+        size_t pos = count < max ? count++ : max - 1;
+        while (pos > 0 && top[pos - 1]->limited < s->limited) {
+            top[pos] = top[pos - 1];
+            pos--;
+        }
+        top[pos] = s;
+    }
+    for (size_t i = 0; i < count; i++) {
+        format_key(top[i]->key, out[i].peer, sizeof(out[i].peer));
+        out[i].limited = top[i]->limited;
+    }
+    return count;
+}
+
+void ratelimit_set_active(RateLimiter *rl) {
+    atomic_store(&g_active, rl);
+}
+
+RateLimiter *ratelimit_active(void) {
+    return atomic_load(&g_active);
+}
+
+/*
+ * ratelimit_format_offenders
+ * --------------------------
+ * [{"peer":"10.0.0.7","limited":1234},...] del limitador activo.
+ */
+int ratelimit_format_offenders(char *out, size_t out_size) {
+    if (!out || out_size == 0) return -1;
+    RateLimitOffender top[RATELIMIT_TOP_N];
+    size_t n = ratelimit_top_offenders(ratelimit_active(), top, RATELIMIT_TOP_N);
+    size_t pos = 0;
+    int w = snprintf(out, out_size, "[");
+    if (w < 0 || (size_t)w >= out_size) return -1;
+    pos = (size_t)w;
+    for (size_t i = 0; i < n; i++) {
+        w = snprintf(out + pos, out_size - pos, "%s{\"peer\":\"%s\",\"limited\":%u}",
+                     i ? "," : "", top[i].peer, (unsigned)top[i].limited);
+        if (w < 0 || (size_t)w >= out_size - pos) return -1;
+        pos += (size_t)w;
+    }
+    w = snprintf(out + pos, out_size - pos, "]");
+    if (w < 0 || (size_t)w >= out_size - pos) return -1;
+    return (int)(pos + (size_t)w);
+}
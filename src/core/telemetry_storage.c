@@ -5,36 +5,163 @@
  * - Capacidad fija (TELEMETRY_MAX_ENTRIES) con inserción circular.
  * - Cada entrada conserva el JSON (texto) y un timestamp en ms.
  * - API sin dependencias de CoAP.
+ *
+ * Concurrencia (multi-productor, sin locks)
+ * - Cada inserción reclama un ticket con fetch_add sobre 'head' del ring; el
+ *   slot es ticket % TELEMETRY_MAX_ENTRIES. Escritores en distintos cores nunca
+ *   toman un lock: sólo esperan (spin) si la vuelta anterior del mismo slot aún
+ *   no terminó de publicarse.
+ * - Cada slot lleva un sello de secuencia: 2t+1 mientras el ticket t escribe,
+ *   2t+2 cuando está publicado. Los lectores copian la entrada y validan el
+ *   sello antes y después (estilo seqlock); si cambió, la entrada se estaba
+ *   sobrescribiendo y se omite.
+ * - clear no toca los slots: mueve 'base' al ticket actual y los tickets
+ *   anteriores dejan de ser visibles.
+ * - Lecturas por snapshot: los metadatos que sólo cambia clear (base de cada
+ *   ring) se protegen con un seqlock ('meta_seq'). Un lector toma la
+ *   generación, copia entradas y calcula estadísticas, y reintenta si hubo un
+ *   clear en medio; así nunca mezcla estado previo y posterior a un clear ni
+ *   bloquea a los escritores, que no tocan el seqlock.
+ *
+ * Modos
+ * - TELEMETRY_MODE_SHARED: un único ring compartido por todos los productores.
+ * - TELEMETRY_MODE_SHARDED: cada hilo productor obtiene su propio ring (shard),
+ *   evitando que 'head' y los contadores reboten entre cores. Las lecturas
+ *   hacen un k-way merge por timestamp y las estadísticas suman los shards, de
+ *   modo que la vista global sigue siendo una sola secuencia ordenada.
  */
 #include "telemetry_storage.h"
 #include "time_source.h"
+#include <stdatomic.h>
+#include <sched.h>
 #include <string.h>
 #include <stdio.h>
 
+#define CACHE_LINE 64
+#define SNAPSHOT_ATTEMPTS 8  // Reintentos de snapshot ante clears concurrentes
+
+// Slot del ring: sello de secuencia + entrada
+typedef struct {
+    _Atomic uint64_t seq;   // 0 => vacío; 2t+1 => escribiendo t; 2t+2 => t publicado
+    TelemetryEntry entry;
+} TelemetrySlot;
+
+// Ring (shard): slots + índices y estadísticas propias
+typedef struct {
+    TelemetrySlot slots[TELEMETRY_MAX_ENTRIES];
+    _Alignas(CACHE_LINE) _Atomic uint64_t head; // Próximo ticket a reclamar
+    _Alignas(CACHE_LINE) _Atomic uint64_t base; // Primer ticket visible (clear)
+    _Atomic uint64_t published;                 // Inserciones publicadas
+    _Atomic uint64_t base_published;            // 'published' al último clear
+} TelemetryRing;
+
 // Estado interno del storage (singleton)
 typedef struct {
-    TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
-    size_t head;            // Índice donde se inserta el siguiente
-    size_t count;           // Cantidad actual de entradas
-    size_t total_received;  // Total de mensajes recibidos
-    uint64_t last_received_ms;
+    TelemetryRing rings[TELEMETRY_MAX_SHARDS];
+    TelemetryStorageMode mode;
+    size_t ring_count;                  // 1 (shared) o TELEMETRY_MAX_SHARDS
+    uint64_t generation_seed;
+    _Atomic uint64_t clears;
+    _Atomic uint64_t meta_seq;          // Seqlock de metadatos (impar => clear en curso)
+    _Atomic unsigned next_shard;        // Asignación de shards a hilos
 } TelemetryStorage;
 
-static TelemetryStorage g_storage = {0};
+static TelemetryStorage g_storage;
+
+// Shard del hilo actual (-1 => aún sin asignar)
+static _Thread_local int t_shard = -1;
+
+/*
+ * telemetry_storage_init_mode
+ * ---------------------------
+ * Inicializa/zera el estado interno con el modo indicado. No debe ejecutarse
+ * concurrentemente con otras operaciones.
+ */
+void telemetry_storage_init_mode(TelemetryStorageMode mode) {
+    memset(&g_storage, 0, sizeof(g_storage));
+    g_storage.mode = mode;
+    g_storage.ring_count = mode == TELEMETRY_MODE_SHARDED ? TELEMETRY_MAX_SHARDS : 1;
+    // Sembrar la generación con el reloj evita que un ETag emitido por un
+    // proceso anterior coincida tras un reinicio.
+    g_storage.generation_seed = time_source_now_ms();
+}
 
 /*
  * telemetry_storage_init
  * ----------------------
- * Inicializa/zera el estado interno del almacenamiento.
+ * Inicializa el storage en modo compartido (TELEMETRY_MODE_SHARED).
  */
 void telemetry_storage_init(void) {
-    memset(&g_storage, 0, sizeof(g_storage));
+    telemetry_storage_init_mode(TELEMETRY_MODE_SHARED);
+}
+
+/*
+ * current_ring
+ * ------------
+ * Ring donde escribe el hilo actual: el único en modo compartido o el shard
+ * asignado al hilo (round-robin al primer uso) en modo sharded.
+ */
+static TelemetryRing *current_ring(void) {
+    if (g_storage.mode != TELEMETRY_MODE_SHARDED) return &g_storage.rings[0];
+    if (t_shard < 0) {
+        unsigned id = atomic_fetch_add_explicit(&g_storage.next_shard, 1, memory_order_relaxed);
+        t_shard = (int)(id % TELEMETRY_MAX_SHARDS);
+    }
+    return &g_storage.rings[t_shard];
+}
+
+/*
+ * slot_wait_turn
+ * --------------
+ * Espera a que la vuelta anterior (ticket t - capacidad) haya publicado el
+ * slot, de modo que dos escritores nunca escriban el mismo slot a la vez.
+ */
+static void slot_wait_turn(TelemetrySlot *slot, uint64_t ticket) {
+    uint64_t prev = ticket >= TELEMETRY_MAX_ENTRIES
+                        ? 2 * (ticket - TELEMETRY_MAX_ENTRIES) + 2
+                        : 0;
+    unsigned spins = 0;
+    while (atomic_load_explicit(&slot->seq, memory_order_acquire) != prev) {
+        if (++spins % 64 == 0) sched_yield();
+    }
+}
+
+/*
+ * slot_read
+ * ---------
+ * Copia la entrada del ticket indicado si está publicada y no fue
+ * sobrescrita durante la copia. Retorna true si 'out' es consistente.
+ */
+static bool slot_read(const TelemetrySlot *slot, uint64_t ticket, TelemetryEntry *out) {
+    uint64_t want = 2 * ticket + 2;
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != want) return false;
+    memcpy(out, &slot->entry, sizeof(*out));
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != want) return false;
+    return out->json_length < TELEMETRY_MAX_JSON_SIZE;
+}
+
+/*
+ * slot_peek_timestamp
+ * -------------------
+ * Lee sólo el timestamp de un ticket publicado (misma validación que
+ * slot_read). Usado por el merge para decidir el orden sin copiar entradas.
+ */
+static bool slot_peek_timestamp(const TelemetrySlot *slot, uint64_t ticket, uint64_t *ts) {
+    uint64_t want = 2 * ticket + 2;
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != want) return false;
+    uint64_t v = slot->entry.timestamp_ms;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != want) return false;
+    *ts = v;
+    return true;
 }
 
 /*
  * telemetry_storage_add
  * ---------------------
- * Inserta un JSON crudo en el ring buffer asignando timestamp actual.
+ * Inserta un JSON crudo en el ring del hilo actual asignando timestamp
+ * actual. Seguro para múltiples productores concurrentes.
  *
  * Retorna 0 en éxito; negativo en error (longitud inválida o args nulos).
  */
@@ -42,76 +169,327 @@ int telemetry_storage_add(const char *json, size_t json_len) {
     if (!json || json_len == 0) return -1;
     if (json_len >= TELEMETRY_MAX_JSON_SIZE) return -2;
 
-    // Copiar JSON al siguiente slot del ring buffer
-    TelemetryEntry *entry = &g_storage.entries[g_storage.head];
+    // Reclamar ticket y slot
+    TelemetryRing *ring = current_ring();
+    uint64_t ticket = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed);
+    TelemetrySlot *slot = &ring->slots[ticket % TELEMETRY_MAX_ENTRIES];
+    slot_wait_turn(slot, ticket);
+
+    // Marcar "escribiendo" antes de tocar los datos (seqlock del slot)
+    atomic_store_explicit(&slot->seq, 2 * ticket + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Copiar JSON al slot
+    TelemetryEntry *entry = &slot->entry;
     memcpy(entry->json, json, json_len);
     entry->json[json_len] = '\0';
     entry->json_length = json_len;
     entry->timestamp_ms = time_source_now_ms();
 
-    // Actualizar índices del ring buffer
-    g_storage.head = (g_storage.head + 1) % TELEMETRY_MAX_ENTRIES;
-    if (g_storage.count < TELEMETRY_MAX_ENTRIES) {
-        g_storage.count++;
-    }
-    g_storage.total_received++;
-    g_storage.last_received_ms = entry->timestamp_ms;
+    // Publicar
+    atomic_store_explicit(&slot->seq, 2 * ticket + 2, memory_order_release);
+    atomic_fetch_add_explicit(&ring->published, 1, memory_order_release);
 
     return 0;
 }
 
 /*
- * telemetry_storage_get_all
- * -------------------------
- * Copia hasta max_entries elementos en 'out' en orden cronológico (antiguo →
- * reciente). Devuelve la cantidad copiada.
+ * ring_visible_range
+ * ------------------
+ * Calcula el rango de tickets [lo, hi) visible de un ring: a lo sumo los
+ * últimos TELEMETRY_MAX_ENTRIES posteriores al último clear.
  */
-size_t telemetry_storage_get_all(TelemetryEntry *out, size_t max_entries) {
+static void ring_visible_range(TelemetryRing *ring, uint64_t *lo, uint64_t *hi) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t base = atomic_load_explicit(&ring->base, memory_order_acquire);
+    if (base > head) base = head;
+    uint64_t start = head > TELEMETRY_MAX_ENTRIES ? head - TELEMETRY_MAX_ENTRIES : 0;
+    *lo = start > base ? start : base;
+    *hi = head;
+}
+
+/*
+ * ring_copy
+ * ---------
+ * Copia en orden de tickets (cronológico) hasta max_entries entradas
+ * consistentes de un ring.
+ */
+static size_t ring_copy(TelemetryRing *ring, TelemetryEntry *out, size_t max_entries) {
+    uint64_t lo, hi;
+    ring_visible_range(ring, &lo, &hi);
+
+    size_t copied = 0;
+    for (uint64_t t = lo; t < hi && copied < max_entries; t++) {
+        const TelemetrySlot *slot = &ring->slots[t % TELEMETRY_MAX_ENTRIES];
+        if (slot_read(slot, t, &out[copied])) copied++;
+    }
+    return copied;
+}
+
+/*
+ * merge_shards
+ * ------------
+ * K-way merge por timestamp de todos los shards. Primera pasada (de más
+ * reciente a más antiguo, sólo timestamps): determina desde qué ticket de cada
+ * shard comienzan las TELEMETRY_MAX_ENTRIES entradas más recientes. Segunda
+ * pasada (de antiguo a reciente): copia en orden global hasta max_entries.
+ */
+static size_t merge_shards(TelemetryEntry *out, size_t max_entries) {
+    uint64_t lo[TELEMETRY_MAX_SHARDS], hi[TELEMETRY_MAX_SHARDS];
+    uint64_t cur[TELEMETRY_MAX_SHARDS];
+    size_t k = g_storage.ring_count;
+    for (size_t i = 0; i < k; i++) {
+        ring_visible_range(&g_storage.rings[i], &lo[i], &hi[i]);
+        cur[i] = hi[i];
+    }
+
+    // Pasada 1: retroceder cursores tomando siempre el timestamp mayor
+    for (size_t kept = 0; kept < TELEMETRY_MAX_ENTRIES;) {
+        int best = -1;
+        uint64_t best_ts = 0;
+        for (size_t i = 0; i < k; i++) {
+            uint64_t ts = 0;
+            while (cur[i] > lo[i] &&
+                   !slot_peek_timestamp(&g_storage.rings[i].slots[(cur[i] - 1) % TELEMETRY_MAX_ENTRIES],
+                                        cur[i] - 1, &ts)) {
+                cur[i]--; // en escritura o sobrescrito: omitir
+            }
+            if (cur[i] > lo[i] && (best < 0 || ts >= best_ts)) {
+                best = (int)i;
+                best_ts = ts;
+            }
+        }
+        if (best < 0) break;
+        cur[best]--;
+        kept++;
+    }
+
+    // Pasada 2: avanzar desde los cursores tomando siempre el timestamp menor
+    size_t copied = 0;
+    while (copied < max_entries) {
+        int best = -1;
+        uint64_t best_ts = 0;
+        for (size_t i = 0; i < k; i++) {
+            uint64_t ts = 0;
+            while (cur[i] < hi[i] &&
+                   !slot_peek_timestamp(&g_storage.rings[i].slots[cur[i] % TELEMETRY_MAX_ENTRIES],
+                                        cur[i], &ts)) {
+                cur[i]++;
+            }
+            if (cur[i] < hi[i] && (best < 0 || ts < best_ts)) {
+                best = (int)i;
+                best_ts = ts;
+            }
+        }
+        if (best < 0) break;
+        TelemetryRing *ring = &g_storage.rings[best];
+        if (slot_read(&ring->slots[cur[best] % TELEMETRY_MAX_ENTRIES], cur[best], &out[copied])) {
+            copied++;
+        }
+        cur[best]++;
+    }
+    return copied;
+}
+
+/*
+ * copy_entries
+ * ------------
+ * Copia las entradas visibles (ring único o merge de shards) sin validar
+ * metadatos; los llamadores lo hacen dentro de un snapshot.
+ */
+static size_t copy_entries(TelemetryEntry *out, size_t max_entries) {
     if (!out || max_entries == 0) return 0;
+    if (g_storage.mode != TELEMETRY_MODE_SHARDED) {
+        return ring_copy(&g_storage.rings[0], out, max_entries);
+    }
+    return merge_shards(out, max_entries);
+}
 
-    size_t copy_count = g_storage.count < max_entries ? g_storage.count : max_entries;
-    
-    // Si el buffer no está lleno, las entradas están al principio (0..count-1)
-    if (g_storage.count < TELEMETRY_MAX_ENTRIES) {
-        memcpy(out, g_storage.entries, copy_count * sizeof(TelemetryEntry));
-    } else {
-        // Buffer lleno: copiar desde head (más antiguo) hasta el final, luego desde 0
-        size_t first_part = TELEMETRY_MAX_ENTRIES - g_storage.head;
-        if (first_part > copy_count) first_part = copy_count;
-        memcpy(out, &g_storage.entries[g_storage.head], first_part * sizeof(TelemetryEntry));
-        
-        if (copy_count > first_part) {
-            size_t second_part = copy_count - first_part;
-            memcpy(&out[first_part], g_storage.entries, second_part * sizeof(TelemetryEntry));
+/*
+ * compute_stats
+ * -------------
+ * Calcula estadísticas a partir de los slots realmente publicados: la
+ * cantidad almacenada y el último timestamp salen del mismo recorrido que ve
+ * un lector, por lo que son coherentes con get_all.
+ */
+static void compute_stats(TelemetryStats *stats) {
+    uint64_t total = 0, stored = 0, last = 0;
+    for (size_t i = 0; i < g_storage.ring_count; i++) {
+        TelemetryRing *ring = &g_storage.rings[i];
+        uint64_t lo, hi;
+        ring_visible_range(ring, &lo, &hi);
+        uint64_t visible = 0;
+        for (uint64_t t = lo; t < hi; t++) {
+            uint64_t ts;
+            if (!slot_peek_timestamp(&ring->slots[t % TELEMETRY_MAX_ENTRIES], t, &ts)) continue;
+            visible++;
+            if (ts > last) last = ts;
         }
+        uint64_t published = atomic_load_explicit(&ring->published, memory_order_acquire);
+        uint64_t base = atomic_load_explicit(&ring->base_published, memory_order_acquire);
+        uint64_t received = published > base ? published - base : 0;
+        total += received > visible ? received : visible;
+        stored += visible;
     }
+    stats->total_received = (size_t)total;
+    stats->current_count = stored < TELEMETRY_MAX_ENTRIES ? (size_t)stored : TELEMETRY_MAX_ENTRIES;
+    stats->capacity = TELEMETRY_MAX_ENTRIES;
+    stats->last_received_ms = last;
+}
 
-    return copy_count;
+/*
+ * meta_read_begin / meta_read_retry
+ * ---------------------------------
+ * Lado lector del seqlock de metadatos: espera a que no haya un clear en
+ * curso y, al terminar, indica si hubo uno durante la lectura.
+ */
+static uint64_t meta_read_begin(void) {
+    uint64_t s;
+    unsigned spins = 0;
+    while ((s = atomic_load_explicit(&g_storage.meta_seq, memory_order_acquire)) & 1u) {
+        if (++spins % 64 == 0) sched_yield();
+    }
+    return s;
+}
+
+static bool meta_read_retry(uint64_t s) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&g_storage.meta_seq, memory_order_relaxed) != s;
+}
+
+/*
+ * stats_from_entries
+ * ------------------
+ * Ajusta cantidad almacenada y último timestamp a las entradas copiadas, para
+ * que coincidan con entry_count aunque haya ingesta entre ambas pasadas.
+ */
+static void stats_from_entries(TelemetryStats *stats, const TelemetryEntry *entries,
+                               size_t count) {
+    uint64_t last = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i].timestamp_ms > last) last = entries[i].timestamp_ms;
+    }
+    stats->current_count = count;
+    stats->last_received_ms = last;
+    if (stats->total_received < count) stats->total_received = count;
+}
+
+/*
+ * telemetry_storage_snapshot
+ * --------------------------
+ * Vista consistente del storage: generación, entradas (si out != NULL) y
+ * estadísticas. La generación se lee antes de copiar, de modo que el ETag
+ * derivado nunca es más nuevo que los datos devueltos. Si un clear ocurre
+ * durante la lectura, se reintenta; si todos los intentos chocan con un
+ * clear, el snapshot se marca inconsistente y no devuelve entradas (las
+ * estadísticas quedan las del último intento). Nunca bloquea a los escritores.
+ *
+ * Con 'out' de capacidad completa, current_count y last_received_ms se
+ * derivan de las entradas copiadas; si no, salen de un recorrido aparte de
+ * los slots y son aproximados bajo ingesta concurrente.
+ *
+ * Retorna la cantidad de entradas copiadas en 'out'.
+ */
+size_t telemetry_storage_snapshot(TelemetryEntry *out, size_t max_entries,
+                                  TelemetrySnapshot *snap) {
+    TelemetrySnapshot local;
+    if (!snap) snap = &local;
+
+    snap->consistent = false;
+    for (int attempt = 0; attempt < SNAPSHOT_ATTEMPTS; attempt++) {
+        uint64_t s = meta_read_begin();
+        snap->generation = telemetry_storage_get_generation();
+        snap->entry_count = copy_entries(out, max_entries);
+        compute_stats(&snap->stats);
+        if (!meta_read_retry(s)) {
+            snap->consistent = true;
+            break;
+        }
+    }
+    if (!snap->consistent) {
+        snap->entry_count = 0;
+        return 0;
+    }
+    if (out && max_entries >= TELEMETRY_MAX_ENTRIES) {
+        stats_from_entries(&snap->stats, out, snap->entry_count);
+    }
+    return snap->entry_count;
+}
+
+/*
+ * telemetry_storage_get_all
+ * -------------------------
+ * Copia hasta max_entries elementos en 'out' en orden cronológico (antiguo →
+ * reciente). Devuelve la cantidad copiada. Slots que se están escribiendo o
+ * sobrescribiendo durante la lectura se omiten.
+ */
+size_t telemetry_storage_get_all(TelemetryEntry *out, size_t max_entries) {
+    if (!out || max_entries == 0) return 0;
+    TelemetrySnapshot snap;
+    return telemetry_storage_snapshot(out, max_entries, &snap);
 }
 
 /*
  * telemetry_storage_get_stats
  * ---------------------------
- * Lee métricas básicas del almacenamiento.
+ * Lee métricas básicas del almacenamiento sumando los contadores de cada
+ * shard (uno solo en modo compartido).
  */
 void telemetry_storage_get_stats(TelemetryStats *stats) {
     if (!stats) return;
-    stats->total_received = g_storage.total_received;
-    stats->current_count = g_storage.count;
-    stats->capacity = TELEMETRY_MAX_ENTRIES;
-    stats->last_received_ms = g_storage.last_received_ms;
+    TelemetrySnapshot snap;
+    telemetry_storage_snapshot(NULL, 0, &snap);
+    *stats = snap.stats;
 }
 
 /*
  * telemetry_storage_clear
  * -----------------------
- * Limpia el contenido del ring buffer.
+ * Limpia el contenido ocultando todos los tickets emitidos hasta ahora en
+ * cada shard. Los slots no se tocan, por lo que no interfiere con escritores;
+ * sólo los lectores en curso reintentan su snapshot.
  */
 void telemetry_storage_clear(void) {
-    g_storage.head = 0;
-    g_storage.count = 0;
-    g_storage.total_received = 0;
-    g_storage.last_received_ms = 0;
+    // Tomar el lado escritor del seqlock (clears concurrentes se serializan)
+    uint64_t s = atomic_load_explicit(&g_storage.meta_seq, memory_order_relaxed);
+    for (;;) {
+        if ((s & 1u) == 0 &&
+            atomic_compare_exchange_weak_explicit(&g_storage.meta_seq, &s, s + 1,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            break;
+        }
+        sched_yield();
+        s = atomic_load_explicit(&g_storage.meta_seq, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    for (size_t i = 0; i < g_storage.ring_count; i++) {
+        TelemetryRing *ring = &g_storage.rings[i];
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t published = atomic_load_explicit(&ring->published, memory_order_acquire);
+        atomic_store_explicit(&ring->base, head, memory_order_relaxed);
+        atomic_store_explicit(&ring->base_published, published, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&g_storage.clears, 1, memory_order_relaxed);
+    atomic_store_explicit(&g_storage.meta_seq, s + 2, memory_order_release);
+}
+
+/*
+ * telemetry_storage_get_generation
+ * --------------------------------
+ * Devuelve el contador de generación actual: semilla + clears + inserciones
+ * publicadas de cada shard (todos monótonos, por lo que cualquier cambio lo
+ * incrementa). Dos lecturas con el mismo valor implican que el contenido (y
+ * las estadísticas de conteo) no cambió entre ellas.
+ */
+uint64_t telemetry_storage_get_generation(void) {
+    uint64_t gen = g_storage.generation_seed +
+                   atomic_load_explicit(&g_storage.clears, memory_order_acquire);
+    for (size_t i = 0; i < g_storage.ring_count; i++) {
+        gen += atomic_load_explicit(&g_storage.rings[i].published, memory_order_acquire);
+    }
+    return gen;
 }
 
 /*
@@ -121,10 +499,25 @@ void telemetry_storage_clear(void) {
  * Retorna longitud escrita o negativo en error.
  */
 int telemetry_storage_serialize_json(char *out, size_t out_size) {
+    return telemetry_storage_serialize_snapshot(out, out_size, NULL);
+}
+
+/*
+ * telemetry_storage_serialize_snapshot
+ * ------------------------------------
+ * Igual que telemetry_storage_serialize_json, pero además devuelve en
+ * 'generation' (si no es NULL) la generación del snapshot serializado, apta
+ * para usarse como ETag del resultado.
+ */
+int telemetry_storage_serialize_snapshot(char *out, size_t out_size, uint64_t *generation) {
     if (!out || out_size == 0) return -1;
 
-    TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
-    size_t count = telemetry_storage_get_all(entries, TELEMETRY_MAX_ENTRIES);
+    // Buffer por hilo (~50 KB): fuera del stack de los workers que serializan
+    static _Thread_local TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
+    TelemetrySnapshot snap;
+    size_t count = telemetry_storage_snapshot(entries, TELEMETRY_MAX_ENTRIES, &snap);
+    if (!snap.consistent) return -3;
+    if (generation) *generation = snap.generation;
 
     // Construir JSON array manualmente (sin dependencias externas)
     size_t offset = 0;
@@ -5,17 +5,18 @@
  * determinísticas.
  */
 #include "time_source.h"
-#include "platform.h"
+#include "clock.h"
 
 static TimeSource *g_ts = 0;
 
 /*
  * default_now_ms
  * --------------
- * Implementación por defecto basada en platform_get_time_ms().
+ * Implementación por defecto: reloj de pared cacheado por iteración del
+ * event loop (clock_wall_now_ms), sin syscall por entrada almacenada.
  */
 static uint64_t default_now_ms(void) {
-    return platform_get_time_ms();
+    return clock_wall_now_ms();
 }
 
 /*
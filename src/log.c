@@ -3,18 +3,55 @@
  *
  * Permite redirigir salida y controlar el nivel. Incluye funciones para
  * formatear endpoints y registrar RX/TX de CoAP con información relevante.
+ *
+ * Modo asíncrono (log_start_async)
+ * - Cada hilo productor escribe registros binarios compactos en su propio
+ *   ring SPSC sin locks: puntero al formato + argumentos tipados según la
+ *   cadena de formato (los %s se copian inline, acotados a LOG_MAX_STRING_ARG).
+ * - Un hilo escritor en segundo plano drena todos los rings, formatea cada
+ *   especificador con snprintf y escribe al stream. Ni el formateo ni la E/S
+ *   bloqueante ocurren en el hilo que loguea.
+ * - Si el ring está lleno el registro se descarta y se cuenta
+ *   (log_dropped_count); el escritor reporta los descartes periódicamente.
+ * - Sin registros el escritor se bloquea en una condvar. Marca g_writer_idle
+ *   antes de revisar los rings por última vez y el productor, tras publicar,
+ *   lo lee (ambos con fence seq_cst): o el escritor ve el registro o el
+ *   productor lo despierta. Con sitios de rate limit registrados la espera
+ *   vence cada LOG_RL_FLUSH_MS para reportar suprimidos.
+ * - Al terminar un hilo su ring queda libre (destructor de pthread_key) y lo
+ *   adopta el próximo hilo que loguee: hay tantos rings como hilos
+ *   simultáneos, no como hilos que alguna vez loguearon.
+ * - El formato debe tener duración estática (literales, como en LOG_*).
+ *   Especificadores no soportados (%n, %Lf, %ls...) se formatean en el
+ *   productor como texto plano.
+ * - El orden se preserva por hilo; entre hilos puede intercalarse.
+ *
+ * Filtrado y rate limiting
+ * - LOG_* comprueban el nivel inline (log_level_enabled) antes de evaluar
+ *   argumentos; con LOG_COMPILE_LEVEL los niveles inferiores desaparecen.
+ * - LOG_*_RL limitan cada sitio con un token bucket (GCRA): una sola CAS
+ *   sobre el instante teórico de llegada, sin locks, segura entre hilos.
+ * - Un sitio que suprime por primera vez se registra (push lock-free) en una
+ *   lista global; log_rate_limit_flush la recorre a lo sumo cada
+ *   LOG_RL_FLUSH_MS y reporta los pendientes, de modo que un sitio que deja
+ *   de dispararse no se lleva su resumen.
  */
 #include "log.h"
 
 #include <time.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 
 #include "coap.h"
 
-static LogLevel g_level = LOG_LEVEL_INFO; // por defecto: INFO
+LogLevel log_runtime_level = LOG_LEVEL_INFO; // por defecto: INFO
 static FILE *g_stream = NULL;             // NULL => usar stderr
 
 /*
@@ -23,7 +60,7 @@ static FILE *g_stream = NULL;             // NULL => usar stderr
  * Establece el nivel mínimo que será impreso por log_printf.
  */
 void log_set_level(LogLevel level) {
-    g_level = level;
+    log_runtime_level = level;
 }
 
 /*
@@ -50,25 +87,674 @@ static const char *level_to_str(LogLevel lvl) {
     }
 }
 
+// ===================== Modo asíncrono =====================
+
+#define LOG_RING_SIZE 65536u             // Bytes por hilo (potencia de dos)
+#define LOG_RING_MASK (LOG_RING_SIZE - 1)
+#define LOG_MAX_RECORD 2048u             // Tamaño máximo de un registro
+#define LOG_LINE_MAX 4096u               // Línea formateada por el escritor
+
+typedef enum {
+    LOG_REC_FORMAT = 1,   // fmt + argumentos binarios
+    LOG_REC_TEXT = 2,     // texto ya formateado (fallback)
+    LOG_REC_PAD = 3       // relleno hasta el final del ring
+} LogRecordKind;
+
+// Cabecera de registro (16 bytes). 'size' y 'kind' caben en los primeros 8
+// bytes para que un relleno mínimo (8 bytes) sea legible.
+typedef struct {
+    uint32_t size;        // Bytes totales del registro (múltiplo de 8)
+    uint8_t level;
+    uint8_t kind;
+    uint16_t reserved;
+    const char *fmt;
+} LogRecordHeader;
+
+typedef struct LogRing {
+    _Alignas(64) _Atomic uint64_t head;   // Escribe el productor
+    _Alignas(64) _Atomic uint64_t tail;   // Escribe el hilo escritor
+    struct LogRing *next;
+    _Atomic bool in_use;                  // Tomado por un hilo vivo
+    _Alignas(64) uint8_t buf[LOG_RING_SIZE];
+} LogRing;
+
+static _Atomic(LogRing *) g_rings;
+static _Thread_local LogRing *t_ring;
+static atomic_bool g_async;
+static atomic_bool g_writer_stop;
+static _Atomic uint64_t g_dropped;
+static _Atomic size_t g_ring_count;
+static pthread_t g_writer;
+static pthread_mutex_t g_writer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_writer_cond = PTHREAD_COND_INITIALIZER;
+static atomic_bool g_writer_idle;            // Escritor a punto de esperar o esperando
+static pthread_once_t g_ring_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_ring_key;             // Libera el ring al terminar el hilo
+static bool g_ring_key_ok;
+
+static _Atomic(LogRateLimit *) g_rl_sites;   // Sitios que alguna vez suprimieron
+static _Atomic uint64_t g_rl_flush_ns;       // Último vaciado de suprimidos
+
+// Clases de argumento según el especificador
+typedef enum {
+    ARG_NONE,       // %%
+    ARG_INT, ARG_UINT, ARG_LONG, ARG_ULONG, ARG_LLONG, ARG_ULLONG,
+    ARG_SIZE, ARG_SSIZE, ARG_INTMAX, ARG_UINTMAX, ARG_PTRDIFF,
+    ARG_DOUBLE, ARG_PTR, ARG_STR,
+    ARG_UNSUPPORTED
+} ArgType;
+
+typedef struct {
+    size_t len;         // Longitud del especificador (desde '%')
+    int stars;          // '*' en ancho/precisión (argumentos int extra)
+    int precision;      // Precisión literal (-1 si no hay o es '*')
+    bool star_precision; // La última '*' es la precisión ("%.*s")
+    ArgType type;
+} FmtSpec;
+
+/*
+ * parse_spec
+ * ----------
+ * Analiza el especificador que empieza en p ('%'): flags, ancho, precisión,
+ * modificador de longitud y conversión.
+ */
+static void parse_spec(const char *p, FmtSpec *spec) {
+    const char *s = p + 1;
+    spec->stars = 0;
+    spec->precision = -1;
+    spec->star_precision = false;
+    while (*s && strchr("-+ #0'", *s)) s++;
+    if (*s == '*') { spec->stars++; s++; } else { while (*s >= '0' && *s <= '9') s++; }
+    if (*s == '.') {
+        s++;
+        if (*s == '*') { spec->stars++; spec->star_precision = true; s++; }
+        else {
+            spec->precision = 0;
+            while (*s >= '0' && *s <= '9') spec->precision = spec->precision * 10 + (*s++ - '0');
+        }
+    }
+
+    enum { L_NONE, L_L, L_LL, L_Z, L_J, L_T, L_BIGL } len = L_NONE;
+    if (s[0] == 'h') { s += (s[1] == 'h') ? 2 : 1; }
+    else if (s[0] == 'l' && s[1] == 'l') { len = L_LL; s += 2; }
+    else if (s[0] == 'l') { len = L_L; s++; }
+    else if (s[0] == 'q') { len = L_LL; s++; }
+    else if (s[0] == 'z') { len = L_Z; s++; }
+    else if (s[0] == 'j') { len = L_J; s++; }
+    else if (s[0] == 't') { len = L_T; s++; }
+    else if (s[0] == 'L') { len = L_BIGL; s++; }
+
+    char conv = *s;
+    spec->len = (size_t)(s - p) + (conv ? 1 : 0);
+    bool is_signed = conv == 'd' || conv == 'i';
+    switch (conv) {
+        case '%': spec->type = ARG_NONE; break;
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+            switch (len) {
+                case L_NONE: spec->type = is_signed ? ARG_INT : ARG_UINT; break;
+                case L_L: spec->type = is_signed ? ARG_LONG : ARG_ULONG; break;
+                case L_LL: spec->type = is_signed ? ARG_LLONG : ARG_ULLONG; break;
+                case L_Z: spec->type = is_signed ? ARG_SSIZE : ARG_SIZE; break;
+                case L_J: spec->type = is_signed ? ARG_INTMAX : ARG_UINTMAX; break;
+                case L_T: spec->type = ARG_PTRDIFF; break;
+                default: spec->type = ARG_UNSUPPORTED; break;
+            }
+            break;
+        case 'c': spec->type = len == L_NONE ? ARG_INT : ARG_UNSUPPORTED; break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            spec->type = (len == L_NONE || len == L_L) ? ARG_DOUBLE : ARG_UNSUPPORTED;
+            break;
+        case 'p': spec->type = ARG_PTR; break;
+        case 's': spec->type = len == L_NONE ? ARG_STR : ARG_UNSUPPORTED; break;
+        default: spec->type = ARG_UNSUPPORTED; break;
+    }
+}
+
+// Escritura de argumentos en el registro (slots de 8 bytes)
+static bool put_u64(uint8_t *rec, size_t *pos, uint64_t v) {
+    if (*pos + 8 > LOG_MAX_RECORD) return false;
+    memcpy(rec + *pos, &v, 8);
+    *pos += 8;
+    return true;
+}
+
+static bool put_str(uint8_t *rec, size_t *pos, const char *str, int precision) {
+    if (!str) str = "(null)";
+    size_t n = precision >= 0 ? strnlen(str, (size_t)precision) : strlen(str);
+    if (n > LOG_MAX_STRING_ARG) n = LOG_MAX_STRING_ARG;
+    size_t padded = (4 + n + 1 + 7) & ~(size_t)7;
+    if (*pos + padded > LOG_MAX_RECORD) return false;
+    uint32_t len32 = (uint32_t)n;
+    memcpy(rec + *pos, &len32, 4);
+    memcpy(rec + *pos + 4, str, n);
+    rec[*pos + 4 + n] = '\0';
+    *pos += padded;
+    return true;
+}
+
+/*
+ * encode_record
+ * -------------
+ * Construye en 'rec' un registro LOG_REC_FORMAT recorriendo el formato y
+ * extrayendo cada argumento con su tipo. Retorna el tamaño o 0 si el formato
+ * no es soportado o el registro no cabe (el llamador usa el fallback).
+ */
+static size_t encode_record(uint8_t *rec, LogLevel level, const char *fmt, va_list ap) {
+    size_t pos = sizeof(LogRecordHeader);
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%') continue;
+        FmtSpec spec;
+        parse_spec(p, &spec);
+        int precision = spec.precision;
+        for (int i = 0; i < spec.stars; i++) {
+            int v = va_arg(ap, int);
+            if (i == spec.stars - 1 && spec.star_precision) precision = v;
+            if (!put_u64(rec, &pos, (uint64_t)(int64_t)v)) return 0;
+        }
+        bool ok = true;
+        switch (spec.type) {
+            case ARG_NONE: break;
+            case ARG_INT: ok = put_u64(rec, &pos, (uint64_t)(int64_t)va_arg(ap, int)); break;
+            case ARG_UINT: ok = put_u64(rec, &pos, va_arg(ap, unsigned int)); break;
+            case ARG_LONG: ok = put_u64(rec, &pos, (uint64_t)(int64_t)va_arg(ap, long)); break;
+            case ARG_ULONG: ok = put_u64(rec, &pos, va_arg(ap, unsigned long)); break;
+            case ARG_LLONG: ok = put_u64(rec, &pos, (uint64_t)va_arg(ap, long long)); break;
+            case ARG_ULLONG: ok = put_u64(rec, &pos, va_arg(ap, unsigned long long)); break;
+            case ARG_SIZE: ok = put_u64(rec, &pos, va_arg(ap, size_t)); break;
+            case ARG_SSIZE: ok = put_u64(rec, &pos, (uint64_t)va_arg(ap, ssize_t)); break;
+            case ARG_INTMAX: ok = put_u64(rec, &pos, (uint64_t)va_arg(ap, intmax_t)); break;
+            case ARG_UINTMAX: ok = put_u64(rec, &pos, va_arg(ap, uintmax_t)); break;
+            case ARG_PTRDIFF: ok = put_u64(rec, &pos, (uint64_t)va_arg(ap, ptrdiff_t)); break;
+            case ARG_PTR: ok = put_u64(rec, &pos, (uint64_t)(uintptr_t)va_arg(ap, void *)); break;
+            case ARG_DOUBLE: {
+                double d = va_arg(ap, double);
+                uint64_t bits; memcpy(&bits, &d, 8);
+                ok = put_u64(rec, &pos, bits);
+                break;
+            }
+            case ARG_STR: ok = put_str(rec, &pos, va_arg(ap, const char *), precision); break;
+            case ARG_UNSUPPORTED: return 0;
+        }
+        if (!ok) return 0;
+        p += spec.len - 1;
+        if (!*p) break;
+    }
+
+    LogRecordHeader hdr = { (uint32_t)pos, (uint8_t)level, LOG_REC_FORMAT, 0, fmt };
+    memcpy(rec, &hdr, sizeof(hdr));
+    return pos;
+}
+
+/*
+ * encode_text
+ * -----------
+ * Fallback: formatea en el productor y guarda el texto como LOG_REC_TEXT.
+ */
+static size_t encode_text(uint8_t *rec, LogLevel level, const char *fmt, va_list ap) {
+    size_t cap = LOG_MAX_RECORD - sizeof(LogRecordHeader);
+    int n = vsnprintf((char *)rec + sizeof(LogRecordHeader), cap, fmt, ap);
+    if (n < 0) return 0;
+    size_t len = (size_t)n < cap ? (size_t)n : cap - 1;
+    size_t size = (sizeof(LogRecordHeader) + len + 1 + 7) & ~(size_t)7;
+    LogRecordHeader hdr = { (uint32_t)size, (uint8_t)level, LOG_REC_TEXT, 0, NULL };
+    memcpy(rec, &hdr, sizeof(hdr));
+    return size;
+}
+
+/*
+ * release_ring
+ * ------------
+ * (Destructor de g_ring_key) El hilo termina: su ring queda libre para otro.
+ * Lo pendiente en él se sigue drenando; el próximo dueño escribe a
+ * continuación (la adquisición sincroniza con este release).
+ */
+static void release_ring(void *arg) {
+    LogRing *ring = (LogRing *)arg;
+    t_ring = NULL;
+    atomic_store_explicit(&ring->in_use, false, memory_order_release);
+}
+
+static void create_ring_key(void) {
+    g_ring_key_ok = pthread_key_create(&g_ring_key, release_ring) == 0;
+}
+
+/*
+ * local_ring
+ * ----------
+ * Ring del hilo actual. En el primer uso adopta uno libre (de un hilo que
+ * terminó) o crea uno nuevo y lo registra (push lock-free).
+ */
+static LogRing *local_ring(void) {
+    if (t_ring) return t_ring;
+    pthread_once(&g_ring_key_once, create_ring_key);
+    LogRing *ring = NULL;
+    for (LogRing *r = atomic_load_explicit(&g_rings, memory_order_acquire); r; r = r->next) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong_explicit(&r->in_use, &expected, true,
+                                                    memory_order_acquire,
+                                                    memory_order_relaxed)) {
+            ring = r;
+            break;
+        }
+    }
+    if (!ring) {
+        ring = (LogRing *)aligned_alloc(64, sizeof(LogRing));
+        if (!ring) return NULL;
+        atomic_init(&ring->head, 0);
+        atomic_init(&ring->tail, 0);
+        atomic_init(&ring->in_use, true);
+        LogRing *head = atomic_load_explicit(&g_rings, memory_order_relaxed);
+        do {
+            ring->next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&g_rings, &head, ring,
+                                                        memory_order_release,
+                                                        memory_order_relaxed));
+        atomic_fetch_add_explicit(&g_ring_count, 1, memory_order_relaxed);
+    }
+    if (g_ring_key_ok) (void)pthread_setspecific(g_ring_key, ring);
+    t_ring = ring;
+    return ring;
+}
+
+/*
+ * ring_push
+ * ---------
+ * Copia un registro al ring sin bloquear. Si no cabe contiguo antes del final,
+ * escribe un relleno y continúa desde el inicio. Retorna false si no hay espacio.
+ */
+static bool ring_push(LogRing *ring, const uint8_t *rec, size_t size) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t off = (size_t)(head & LOG_RING_MASK);
+    size_t to_end = LOG_RING_SIZE - off;
+    size_t need = size + (to_end < size ? to_end : 0);
+    if (LOG_RING_SIZE - (size_t)(head - tail) < need) return false;
+
+    if (to_end < size) {
+        LogRecordHeader pad = { (uint32_t)to_end, 0, LOG_REC_PAD, 0, NULL };
+        memcpy(ring->buf + off, &pad, to_end < sizeof(pad) ? 8 : sizeof(pad));
+        head += to_end;
+        off = 0;
+    }
+    memcpy(ring->buf + off, rec, size);
+    atomic_store_explicit(&ring->head, head + size, memory_order_release);
+    return true;
+}
+
+// Lectura de argumentos en el escritor
+static uint64_t get_u64(const uint8_t *rec, size_t *pos) {
+    uint64_t v;
+    memcpy(&v, rec + *pos, 8);
+    *pos += 8;
+    return v;
+}
+
+/*
+ * format_one
+ * ----------
+ * Formatea un especificador con sus argumentos (0..2 estrellas + valor).
+ */
+#define FORMAT_WITH_STARS(out, cap, spec, stars, st, value) \
+    ((stars) == 0 ? snprintf((out), (cap), (spec), (value)) : \
+     (stars) == 1 ? snprintf((out), (cap), (spec), (st)[0], (value)) : \
+                    snprintf((out), (cap), (spec), (st)[0], (st)[1], (value)))
+
+static int format_one(char *out, size_t cap, const char *spec, const FmtSpec *fs,
+                      const uint8_t *rec, size_t *pos) {
+    int st[2] = { 0, 0 };
+    for (int i = 0; i < fs->stars && i < 2; i++) st[i] = (int)(int64_t)get_u64(rec, pos);
+
+    switch (fs->type) {
+        case ARG_INT: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (int)(int64_t)get_u64(rec, pos));
+        case ARG_UINT: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (unsigned int)get_u64(rec, pos));
+        case ARG_LONG: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (long)(int64_t)get_u64(rec, pos));
+        case ARG_ULONG: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (unsigned long)get_u64(rec, pos));
+        case ARG_LLONG: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (long long)get_u64(rec, pos));
+        case ARG_ULLONG: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (unsigned long long)get_u64(rec, pos));
+        case ARG_SIZE: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (size_t)get_u64(rec, pos));
+        case ARG_SSIZE: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (ssize_t)get_u64(rec, pos));
+        case ARG_INTMAX: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (intmax_t)get_u64(rec, pos));
+        case ARG_UINTMAX: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (uintmax_t)get_u64(rec, pos));
+        case ARG_PTRDIFF: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (ptrdiff_t)get_u64(rec, pos));
+        case ARG_PTR: return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, (void *)(uintptr_t)get_u64(rec, pos));
+        case ARG_DOUBLE: {
+            uint64_t bits = get_u64(rec, pos);
+            double d; memcpy(&d, &bits, 8);
+            return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, d);
+        }
+        case ARG_STR: {
+            uint32_t len;
+            memcpy(&len, rec + *pos, 4);
+            const char *str = (const char *)rec + *pos + 4;
+            *pos += (4 + len + 1 + 7) & ~(size_t)7;
+            return FORMAT_WITH_STARS(out, cap, spec, fs->stars, st, str);
+        }
+        case ARG_NONE: return snprintf(out, cap, "%%");
+        default: return 0;
+    }
+}
+
+/*
+ * write_record
+ * ------------
+ * Reconstruye la línea de un registro (prefijo de nivel + formato) y la
+ * escribe en 'out'.
+ */
+static void write_record(FILE *out, const uint8_t *rec) {
+    LogRecordHeader hdr;
+    memcpy(&hdr, rec, sizeof(hdr));
+    char line[LOG_LINE_MAX];
+    int pos = snprintf(line, sizeof(line), "[%s] ", level_to_str((LogLevel)hdr.level));
+
+    if (hdr.kind == LOG_REC_TEXT) {
+        fputs(line, out);
+        fputs((const char *)rec + sizeof(hdr), out);
+        return;
+    }
+
+    size_t argpos = sizeof(hdr);
+    for (const char *p = hdr.fmt; *p && (size_t)pos < sizeof(line) - 1; p++) {
+        if (*p != '%') { line[pos++] = *p; continue; }
+        FmtSpec fs;
+        parse_spec(p, &fs);
+        char spec[32];
+        if (fs.len == 0 || fs.len >= sizeof(spec)) break;
+        memcpy(spec, p, fs.len);
+        spec[fs.len] = '\0';
+        int n = format_one(line + pos, sizeof(line) - (size_t)pos, spec, &fs, rec, &argpos);
+        if (n > 0) pos += n;
+        if ((size_t)pos >= sizeof(line)) pos = (int)sizeof(line) - 1; // truncado
+        p += fs.len - 1;
+    }
+    fwrite(line, 1, (size_t)pos, out);
+}
+
+/*
+ * drain_rings
+ * -----------
+ * Consume todos los registros disponibles de todos los rings. Retorna la
+ * cantidad escrita. Sólo debe ejecutarse desde un único consumidor.
+ */
+static size_t drain_rings(FILE *out) {
+    size_t written = 0;
+    for (LogRing *r = atomic_load_explicit(&g_rings, memory_order_acquire); r; r = r->next) {
+        uint64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        while (tail < head) {
+            const uint8_t *rec = r->buf + (tail & LOG_RING_MASK);
+            uint32_t size;
+            memcpy(&size, rec, 4);
+            if (rec[5] != LOG_REC_PAD) {
+                write_record(out, rec);
+                written++;
+            }
+            tail += size;
+            atomic_store_explicit(&r->tail, tail, memory_order_release);
+        }
+    }
+    return written;
+}
+
+/*
+ * report_dropped
+ * --------------
+ * Escribe una línea resumen si hubo descartes desde el último reporte.
+ */
+static void report_dropped(FILE *out, uint64_t *reported) {
+    uint64_t dropped = atomic_load_explicit(&g_dropped, memory_order_relaxed);
+    if (dropped == *reported) return;
+    fprintf(out, "[WARN] log: %llu records dropped (ring full)\n",
+            (unsigned long long)(dropped - *reported));
+    *reported = dropped;
+}
+
+/*
+ * wake_writer
+ * -----------
+ * (Productor, tras publicar un registro) Despierta al escritor si está
+ * esperando. El fence ordena la publicación del head antes de leer
+ * g_writer_idle (par del fence en wait_for_records).
+ */
+static void wake_writer(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&g_writer_idle, memory_order_relaxed)) return;
+    pthread_mutex_lock(&g_writer_mutex);
+    pthread_cond_signal(&g_writer_cond);
+    pthread_mutex_unlock(&g_writer_mutex);
+}
+
+static bool rings_empty(void) {
+    for (LogRing *r = atomic_load_explicit(&g_rings, memory_order_acquire); r; r = r->next) {
+        if (atomic_load_explicit(&r->head, memory_order_acquire) !=
+            atomic_load_explicit(&r->tail, memory_order_relaxed)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * wait_for_records
+ * ----------------
+ * Bloquea al escritor hasta que un productor publique, se pida la parada o,
+ * si hay sitios de rate limit registrados, venza LOG_RL_FLUSH_MS.
+ */
+static void wait_for_records(void) {
+    pthread_mutex_lock(&g_writer_mutex);
+    atomic_store_explicit(&g_writer_idle, true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (rings_empty() && !atomic_load_explicit(&g_writer_stop, memory_order_acquire)) {
+        if (atomic_load_explicit(&g_rl_sites, memory_order_relaxed)) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += LOG_RL_FLUSH_MS / 1000;
+            deadline.tv_nsec += (long)(LOG_RL_FLUSH_MS % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) { deadline.tv_sec++; deadline.tv_nsec -= 1000000000L; }
+            (void)pthread_cond_timedwait(&g_writer_cond, &g_writer_mutex, &deadline);
+        } else {
+            (void)pthread_cond_wait(&g_writer_cond, &g_writer_mutex);
+        }
+    }
+    atomic_store_explicit(&g_writer_idle, false, memory_order_relaxed);
+    pthread_mutex_unlock(&g_writer_mutex);
+}
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    uint64_t reported = atomic_load(&g_dropped);
+    for (;;) {
+        bool stop = atomic_load_explicit(&g_writer_stop, memory_order_acquire);
+        FILE *out = g_stream ? g_stream : stderr;
+        log_rate_limit_flush();
+        size_t n = drain_rings(out);
+        report_dropped(out, &reported);
+        if (n > 0) fflush(out);
+        if (stop) break;
+        if (n == 0) wait_for_records();
+    }
+    return NULL;
+}
+
+/*
+ * log_start_async
+ * ---------------
+ * Activa el modo asíncrono y lanza el hilo escritor. Retorna 0 en éxito o -1.
+ */
+int log_start_async(void) {
+    if (atomic_load(&g_async)) return 0;
+    atomic_store(&g_writer_stop, false);
+    if (pthread_create(&g_writer, NULL, writer_main, NULL) != 0) return -1;
+    atomic_store_explicit(&g_async, true, memory_order_release);
+    return 0;
+}
+
+/*
+ * log_stop_async
+ * --------------
+ * Vuelve al modo síncrono: detiene el escritor tras drenar lo pendiente y
+ * escribe lo que haya llegado durante la parada.
+ */
+void log_stop_async(void) {
+    if (!atomic_exchange(&g_async, false)) return;
+    atomic_store_explicit(&g_writer_stop, true, memory_order_release);
+    pthread_mutex_lock(&g_writer_mutex);
+    pthread_cond_signal(&g_writer_cond);
+    pthread_mutex_unlock(&g_writer_mutex);
+    pthread_join(g_writer, NULL);
+    FILE *out = g_stream ? g_stream : stderr;
+    (void)drain_rings(out);
+    fflush(out);
+}
+
+/*
+ * log_dropped_count
+ * -----------------
+ * Registros descartados por ring lleno desde el inicio del proceso.
+ */
+uint64_t log_dropped_count(void) {
+    return atomic_load_explicit(&g_dropped, memory_order_relaxed);
+}
+
+/*
+ * log_ring_count
+ * --------------
+ * Rings creados: el máximo de hilos simultáneos que loguearon en asíncrono.
+ */
+size_t log_ring_count(void) {
+    return atomic_load_explicit(&g_ring_count, memory_order_relaxed);
+}
+
 /*
  * log_printf
  * ----------
- * Imprime un mensaje con prefijo de nivel si 'level' es >= g_level. Acepta
- * formato printf y argumentos variables.
+ * Imprime un mensaje con prefijo de nivel si 'level' es >= log_runtime_level. Acepta
+ * formato printf y argumentos variables. En modo asíncrono sólo encola un
+ * registro binario en el ring del hilo (o lo cuenta como descartado).
  */
 void log_printf(LogLevel level, const char *fmt, ...) {
-    if (level > g_level) return;
+    if (level > log_runtime_level) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    if (atomic_load_explicit(&g_async, memory_order_acquire)) {
+        uint8_t rec[LOG_MAX_RECORD] __attribute__((aligned(8)));
+        va_list ap2;
+        va_copy(ap2, ap);
+        size_t size = encode_record(rec, level, fmt, ap);
+        if (size == 0) size = encode_text(rec, level, fmt, ap2);
+        va_end(ap2);
+        LogRing *ring = local_ring();
+        if (size == 0 || !ring || !ring_push(ring, rec, size)) {
+            atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+        } else {
+            wake_writer();
+        }
+        va_end(ap);
+        return;
+    }
+
     FILE *out = g_stream ? g_stream : stderr;
 
     // Prefijo simple con nivel
     fprintf(out, "[%s] ", level_to_str(level));
-
-    va_list ap;
-    va_start(ap, fmt);
     vfprintf(out, fmt, ap);
     va_end(ap);
 }
 
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * report_suppressed
+ * -----------------
+ * Toma los suprimidos pendientes del sitio y, si hay, emite el resumen.
+ */
+static void report_suppressed(LogRateLimit *rl, LogLevel level, const char *file, int line) {
+    uint64_t suppressed = atomic_exchange_explicit(&rl->suppressed, 0, memory_order_relaxed);
+    if (suppressed > 0) {
+        const char *base = strrchr(file, '/');
+        log_printf(level, "%llu messages suppressed at %s:%d\n",
+                   (unsigned long long)suppressed, base ? base + 1 : file, line);
+    }
+}
+
+/*
+ * register_site
+ * -------------
+ * Agrega el sitio (una sola vez) a la lista que recorre log_rate_limit_flush.
+ * El sitio queda publicado con file/line/level ya escritos (release).
+ */
+static void register_site(LogRateLimit *rl, LogLevel level, const char *file, int line) {
+    if (atomic_exchange_explicit(&rl->registered, true, memory_order_relaxed)) return;
+    rl->file = file;
+    rl->line = line;
+    rl->level = level;
+    LogRateLimit *head = atomic_load_explicit(&g_rl_sites, memory_order_relaxed);
+    do {
+        rl->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&g_rl_sites, &head, rl,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+/*
+ * log_rate_limit_allow
+ * --------------------
+ * Token bucket de 'burst' fichas recargado a 'per_sec' por segundo, en forma
+ * GCRA: cada emisión adelanta 'tat' un intervalo; se rechaza si eso lo deja a
+ * más de 'burst' intervalos del presente. Al volver a emitir tras haber
+ * suprimido, reporta cuántos mensajes se descartaron en este sitio.
+ */
+bool log_rate_limit_allow(LogRateLimit *rl, uint32_t per_sec, uint32_t burst,
+                          LogLevel level, const char *file, int line) {
+    if (per_sec == 0) per_sec = 1;
+    if (burst == 0) burst = 1;
+    const uint64_t now = monotonic_ns();
+    const uint64_t interval = 1000000000ULL / per_sec;
+    const uint64_t limit = now + (uint64_t)burst * interval;
+
+    uint64_t tat = atomic_load_explicit(&rl->tat_ns, memory_order_relaxed);
+    for (;;) {
+        uint64_t next = (tat > now ? tat : now) + interval;
+        if (next > limit) {
+            atomic_fetch_add_explicit(&rl->suppressed, 1, memory_order_relaxed);
+            register_site(rl, level, file, line);
+            return false;
+        }
+        if (atomic_compare_exchange_weak_explicit(&rl->tat_ns, &tat, next,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    report_suppressed(rl, level, file, line);
+    return true;
+}
+
+/*
+ * log_rate_limit_flush
+ * --------------------
+ * Reporta los suprimidos pendientes de cada sitio registrado. Sólo un
+ * llamador por período LOG_RL_FLUSH_MS gana la CAS y recorre la lista; el
+ * resto retorna sin hacer nada, así que puede invocarse desde timers rápidos.
+ */
+void log_rate_limit_flush(void) {
+    const uint64_t now = monotonic_ns();
+    uint64_t last = atomic_load_explicit(&g_rl_flush_ns, memory_order_relaxed);
+    if (now - last < (uint64_t)LOG_RL_FLUSH_MS * 1000000ULL) return;
+    if (!atomic_compare_exchange_strong_explicit(&g_rl_flush_ns, &last, now,
+                                                 memory_order_relaxed, memory_order_relaxed)) {
+        return;
+    }
+    for (LogRateLimit *rl = atomic_load_explicit(&g_rl_sites, memory_order_acquire); rl;
+         rl = rl->next) {
+        report_suppressed(rl, rl->level, rl->file, rl->line);
+    }
+}
+
 /*
  * format_sockaddr
  * ----------------
@@ -106,7 +792,7 @@ static void format_sockaddr(const struct sockaddr *sa, socklen_t sa_len,
  * payload. Requiere msg != NULL.
  */
 void log_coap_rx(const CoapMessage *msg, const struct sockaddr *peer, socklen_t peer_len) {
-    if (!msg) return;
+    if (!msg || !log_level_enabled(LOG_LEVEL_INFO)) return;
     char peer_str[64]; format_sockaddr(peer, peer_len, peer_str, sizeof(peer_str));
     char path[128];
     int pl = coap_message_get_uri_path(msg, path, sizeof(path));
@@ -125,7 +811,7 @@ void log_coap_rx(const CoapMessage *msg, const struct sockaddr *peer, socklen_t
  * tamaño de payload. Requiere msg != NULL.
  */
 void log_coap_tx(const CoapMessage *msg, const struct sockaddr *peer, socklen_t peer_len) {
-    if (!msg) return;
+    if (!msg || !log_level_enabled(LOG_LEVEL_INFO)) return;
     if (coap_code_class(msg->code) != 2) return; // solo éxitos 2.xx
     char peer_str[64]; format_sockaddr(peer, peer_len, peer_str, sizeof(peer_str));
     const char *rstr = coap_code_to_string(msg->code);
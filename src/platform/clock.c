@@ -0,0 +1,113 @@
+/*
+ * clock.c — Relojes monotónico y de pared, con un "ahora" cacheado por hilo.
+ *
+ * El event loop refresca el caché una vez por despertar (clock_refresh) y lo
+ * invalida al retornar de event_loop_run, de modo que un hilo que deja de
+ * correr el loop nunca lee un valor viejo. El reloj de pared del caché se
+ * obtiene de forma perezosa: sólo se consulta si algún callback lo pide.
+ */
+#include "clock.h"
+
+#include <stdbool.h>
+#include <time.h>
+
+typedef struct {
+	bool valid;        // Hay un refresh vigente en este hilo
+	bool wall_valid;   // wall_ms ya se consultó desde el último refresh
+	uint64_t mono_ns;
+	uint64_t wall_ms;
+} ClockCache;
+
+static _Thread_local ClockCache t_cache;
+
+/*
+ * read_ns
+ * -------
+ * Lee 'id' con clock_gettime y lo expresa en nanosegundos.
+ */
+static uint64_t read_ns(clockid_t id) {
+	struct timespec ts;
+	clock_gettime(id, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * clock_monotonic_ns
+ * ------------------
+ * Reloj monotónico en nanosegundos (origen arbitrario).
+ */
+uint64_t clock_monotonic_ns(void) {
+	return read_ns(CLOCK_MONOTONIC);
+}
+
+/*
+ * clock_monotonic_ms
+ * ------------------
+ * Reloj monotónico en milisegundos.
+ */
+uint64_t clock_monotonic_ms(void) {
+	return read_ns(CLOCK_MONOTONIC) / 1000000ull;
+}
+
+/*
+ * clock_wall_ms
+ * -------------
+ * Milisegundos desde epoch (UTC). Puede saltar hacia atrás o adelante.
+ */
+uint64_t clock_wall_ms(void) {
+	return read_ns(CLOCK_REALTIME) / 1000000ull;
+}
+
+/*
+ * clock_refresh
+ * -------------
+ * Toma una nueva muestra monotónica para el hilo actual.
+ */
+void clock_refresh(void) {
+	t_cache.mono_ns = read_ns(CLOCK_MONOTONIC);
+	t_cache.wall_valid = false;
+	t_cache.valid = true;
+}
+
+/*
+ * clock_invalidate
+ * ----------------
+ * Descarta el valor cacheado: las lecturas vuelven al reloj real.
+ */
+void clock_invalidate(void) {
+	t_cache.valid = false;
+	t_cache.wall_valid = false;
+}
+
+/*
+ * clock_now_ns
+ * ------------
+ * Instante monotónico cacheado o, sin refresh vigente, el reloj real.
+ */
+uint64_t clock_now_ns(void) {
+	return t_cache.valid ? t_cache.mono_ns : read_ns(CLOCK_MONOTONIC);
+}
+
+/*
+ * clock_now_ms
+ * ------------
+ * Igual que clock_now_ns, en milisegundos.
+ */
+uint64_t clock_now_ms(void) {
+	return clock_now_ns() / 1000000ull;
+}
+
+/*
+ * clock_wall_now_ms
+ * -----------------
+ * Reloj de pared cacheado: se consulta una vez por refresh, en la primera
+ * lectura. Sin refresh vigente lee el reloj real.
+ */
+uint64_t clock_wall_now_ms(void) {
+	if (!t_cache.valid) return clock_wall_ms();
+	if (!t_cache.wall_valid) {
+		t_cache.wall_ms = clock_wall_ms();
+		t_cache.wall_valid = true;
+	}
+	return t_cache.wall_ms;
+}
@@ -4,18 +4,38 @@
  * event_loop_epoll.c — Implementación de EventLoop usando epoll (Linux).
  *
  * API uniforme (event_loop_*) con soporte de timers internos y parada cooperativa.
+ *
+ * Los timers viven en un heap (timer_heap.c) y se materializan en un único
+ * timerfd (CLOCK_MONOTONIC, vencimiento absoluto en ns) registrado en epoll:
+ * el kernel despierta al loop en el instante exacto del próximo vencimiento,
+ * con resolución sub-milisegundo, y los timers vencidos se disparan antes de
+ * despachar I/O aunque el socket esté siempre listo. Si timerfd no está
+ * disponible se recurre al timeout de epoll_wait en ms.
+ *
+ * event_loop_post: otros hilos encolan tareas en una cola MPSC sin locks
+ * (post_queue.c) y despiertan al loop escribiendo en un eventfd registrado en
+ * epoll; el loop drena las tareas por lotes en su propio hilo.
+ *
+ * event_loop_mark_pending: un callback que corta por presupuesto deja su fd
+ * en una lista de pendientes; la vuelta siguiente no bloquea y lo reinvoca
+ * después de timers y eventos, así un fd siempre listo no acapara el hilo.
  */
 #include "event_loop.h"
 #include "platform.h"
+#include "clock.h"
+#include "timer_heap.h"
+#include "post_queue.h"
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define MAX_EVENTS 64
-#define MAX_FDS    1024
-#define MAX_TIMERS 64
+#define FD_PAGE_SHIFT 8                  // Handlers por página: 256
+#define FD_PAGE_SIZE  (1 << FD_PAGE_SHIFT)
 
 typedef struct FdHandler {
     int fd;
@@ -23,24 +43,29 @@ typedef struct FdHandler {
     void *user_data;
     EventType events;
     bool active;
+    bool pending;           // En la lista de event_loop_mark_pending
+    uint64_t dispatched;    // Vuelta (stats.iterations) del último callback
 } FdHandler;
 
-typedef struct Timer {
-    int id;
-    uint64_t timeout_ms;
-    bool periodic;
-    TimerCallback callback;
-    void *user_data;
-    uint64_t next_fire;
-    bool active;
-} Timer;
-
 struct EventLoop {
     int epoll_fd;
     bool running;
-    FdHandler handlers[MAX_FDS];
-    Timer timers[MAX_TIMERS];
-    int next_timer_id;
+    // Tabla de handlers indexada por fd, en páginas que no se mueven (epoll
+    // guarda punteros a FdHandler); sólo crece el arreglo de páginas.
+    FdHandler **fd_pages;
+    size_t fd_page_count;
+    TimerHeap *timers;
+    int timer_fd;             // -1 => timeout de epoll_wait (fallback)
+    FdHandler timer_handler;  // Marca los eventos del timerfd
+    uint64_t armed_ns;        // Vencimiento programado en timer_fd (0 = desarmado)
+    PostQueue *posts;         // Tareas de event_loop_post
+    int wake_fd;              // eventfd para despertar al loop desde otros hilos
+    FdHandler wake_handler;
+    int *pending;             // fds a reinvocar en la próxima vuelta
+    size_t pending_count;
+    size_t pending_cap;
+    EventLoopStats stats;
+    uint64_t wake_ns;         // Fin de la última espera (0 = fuera de run)
 };
 
 /*
@@ -48,15 +73,18 @@ struct EventLoop {
  * --------------------
  * Determina el timeout para epoll_wait combinando el próximo disparo de los
  * timers internos y el timeout solicitado para una ejecución de una sola vuelta.
+ * Con fds pendientes (event_loop_mark_pending) sólo se sondea.
+ * El plazo al timer se redondea hacia arriba para no despertar antes de tiempo.
+ * Con timerfd los timers no acotan la espera: el propio fd despierta al loop.
  */
 static int compute_wait_timeout(EventLoop *loop, int run_timeout_ms) {
-    uint64_t now = platform_get_time_ms();
+    if (loop->pending_count > 0) return 0;
     int64_t ms_to_timer = -1;
-    for (int i = 0; i < MAX_TIMERS; i++) {
-        if (!loop->timers[i].active) continue;
-        int64_t delta = (int64_t)loop->timers[i].next_fire - (int64_t)now;
-        if (delta < 0) delta = 0;
-        if (ms_to_timer < 0 || delta < ms_to_timer) ms_to_timer = delta;
+    uint64_t deadline;
+    if (loop->timer_fd < 0 && timer_heap_next_deadline(loop->timers, &deadline)) {
+        uint64_t now = clock_monotonic_ns();
+        uint64_t delta = deadline > now ? (deadline - now + 999999) / 1000000 : 0;
+        ms_to_timer = delta > INT32_MAX ? INT32_MAX : (int64_t)delta;
     }
     if (run_timeout_ms >= 0 && ms_to_timer >= 0) return (run_timeout_ms < ms_to_timer) ? run_timeout_ms : (int)ms_to_timer;
     if (run_timeout_ms >= 0) return run_timeout_ms;
@@ -67,20 +95,160 @@ static int compute_wait_timeout(EventLoop *loop, int run_timeout_ms) {
 /*
  * process_timers
  * --------------
- * Dispara callbacks de timers vencidos y reprograma los periódicos.
+ * Dispara callbacks de timers vencidos y reprograma los periódicos. Usa el
+ * instante cacheado del despertar actual (monotónico).
  */
 static void process_timers(EventLoop *loop) {
-    uint64_t now = platform_get_time_ms();
-    for (int i = 0; i < MAX_TIMERS; i++) {
-        Timer *t = &loop->timers[i];
-        if (!t->active) continue;
-        if (t->next_fire <= now) {
-            t->callback(t->user_data);
-            if (t->periodic) t->next_fire = now + t->timeout_ms; else t->active = false;
-        }
+    timer_heap_run_expired(loop->timers, clock_now_ns());
+}
+
+/*
+ * arm_timer_fd
+ * ------------
+ * Programa el timerfd al próximo vencimiento del heap (absoluto, en ns). Sólo
+ * hace la syscall si el vencimiento cambió; un timer cancelado puede dejar el
+ * fd armado antes de tiempo, lo que sólo produce un despertar sin trabajo.
+ */
+static void arm_timer_fd(EventLoop *loop) {
+    if (loop->timer_fd < 0) return;
+    uint64_t deadline = 0;
+    if (!timer_heap_next_deadline(loop->timers, &deadline)) deadline = 0;
+    else if (deadline == 0) deadline = 1; // 0 desarmaría el timerfd
+    if (deadline == loop->armed_ns) return;
+    struct itimerspec its; memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = (time_t)(deadline / 1000000000ull);
+    its.it_value.tv_nsec = (long)(deadline % 1000000000ull);
+    if (timerfd_settime(loop->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == 0) {
+        loop->armed_ns = deadline;
     }
 }
 
+/*
+ * on_timer_fd
+ * -----------
+ * Consume las expiraciones del timerfd; los timers ya se procesaron al
+ * despertar.
+ */
+static void on_timer_fd(int fd, EventType events, void *user_data) {
+    (void)events;
+    EventLoop *loop = user_data;
+    uint64_t expirations;
+    while (read(fd, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations)) {}
+    loop->armed_ns = 0;
+}
+
+/*
+ * create_timer_fd
+ * ---------------
+ * Crea el timerfd y lo registra en epoll. Si falla, el loop usa timeouts.
+ */
+static void create_timer_fd(EventLoop *loop) {
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (loop->timer_fd < 0) return;
+    FdHandler *h = &loop->timer_handler;
+    h->fd = loop->timer_fd; h->callback = on_timer_fd; h->user_data = loop;
+    h->events = EVENT_READ; h->active = true;
+    struct epoll_event ev; memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = h;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->timer_fd, &ev) < 0) {
+        close(loop->timer_fd);
+        loop->timer_fd = -1;
+        h->active = false;
+    }
+}
+
+/*
+ * fd_handler
+ * ----------
+ * Retorna el handler de 'fd'. Con 'create', asigna la página si falta (y
+ * crece el arreglo de páginas); sin él, NULL si la página no existe.
+ */
+static FdHandler *fd_handler(EventLoop *loop, int fd, bool create) {
+    size_t page = (size_t)fd >> FD_PAGE_SHIFT;
+    if (page >= loop->fd_page_count) {
+        if (!create) return NULL;
+        size_t count = loop->fd_page_count ? loop->fd_page_count : 4;
+        while (count <= page) count *= 2;
+        FdHandler **pages = realloc(loop->fd_pages, count * sizeof(*pages));
+        if (!pages) return NULL;
+        memset(pages + loop->fd_page_count, 0, (count - loop->fd_page_count) * sizeof(*pages));
+        loop->fd_pages = pages;
+        loop->fd_page_count = count;
+    }
+    if (!loop->fd_pages[page]) {
+        if (!create) return NULL;
+        loop->fd_pages[page] = calloc(FD_PAGE_SIZE, sizeof(FdHandler));
+        if (!loop->fd_pages[page]) return NULL;
+    }
+    return &loop->fd_pages[page][fd & (FD_PAGE_SIZE - 1)];
+}
+
+/*
+ * to_epoll_events
+ * ---------------
+ * Traduce la máscara EVENT_* a flags de epoll.
+ */
+static uint32_t to_epoll_events(EventType events) {
+    uint32_t ev = 0;
+    if (events & EVENT_READ) ev |= EPOLLIN;
+    if (events & EVENT_WRITE) ev |= EPOLLOUT;
+    if (events & EVENT_EDGE) ev |= EPOLLET;
+#ifdef EPOLLEXCLUSIVE
+    if (events & EVENT_EXCLUSIVE) ev |= EPOLLEXCLUSIVE;
+#endif
+    return ev;
+}
+
+/*
+ * signal_wake
+ * -----------
+ * Despierta al loop (seguro desde cualquier hilo).
+ */
+static void signal_wake(EventLoop *loop) {
+    uint64_t one = 1;
+    ssize_t rc = write(loop->wake_fd, &one, sizeof(one));
+    (void)rc; // EAGAIN => el contador ya está en el máximo: el loop despertará
+}
+
+/*
+ * on_wake_fd
+ * ----------
+ * Consume la señal y ejecuta hasta EVENT_LOOP_POST_BATCH tareas; si quedan,
+ * se vuelve a señalar para continuar en la próxima vuelta sin postergar la I/O.
+ */
+static void on_wake_fd(int fd, EventType events, void *user_data) {
+    (void)events;
+    EventLoop *loop = user_data;
+    uint64_t count;
+    while (read(fd, &count, sizeof(count)) == (ssize_t)sizeof(count)) {}
+    bool more = false;
+    post_queue_drain(loop->posts, EVENT_LOOP_POST_BATCH, &more);
+    if (more) signal_wake(loop);
+}
+
+/*
+ * create_wake_fd
+ * --------------
+ * Crea el eventfd de despertar y lo registra en epoll.
+ */
+static int create_wake_fd(EventLoop *loop) {
+    loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loop->wake_fd < 0) return PLATFORM_ERROR;
+    FdHandler *h = &loop->wake_handler;
+    h->fd = loop->wake_fd; h->callback = on_wake_fd; h->user_data = loop;
+    h->events = EVENT_READ; h->active = true;
+    struct epoll_event ev; memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = h;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev) < 0) {
+        close(loop->wake_fd);
+        loop->wake_fd = -1;
+        return PLATFORM_ERROR;
+    }
+    return PLATFORM_OK;
+}
+
 /*
  * event_loop_create
  * -----------------
@@ -89,9 +257,17 @@ static void process_timers(EventLoop *loop) {
 EventLoop *event_loop_create(void) {
     EventLoop *loop = calloc(1, sizeof(EventLoop));
     if (!loop) return NULL;
+    loop->timer_fd = -1;
+    loop->wake_fd = -1;
     loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
     if (loop->epoll_fd < 0) { free(loop); return NULL; }
-    loop->next_timer_id = 1;
+    loop->timers = timer_heap_create();
+    loop->posts = post_queue_create();
+    if (!loop->timers || !loop->posts || create_wake_fd(loop) != PLATFORM_OK) {
+        event_loop_destroy(loop);
+        return NULL;
+    }
+    create_timer_fd(loop);
     return loop;
 }
 
@@ -102,23 +278,32 @@ EventLoop *event_loop_create(void) {
  */
 void event_loop_destroy(EventLoop *loop) {
     if (!loop) return;
+    if (loop->timer_fd >= 0) close(loop->timer_fd);
+    if (loop->wake_fd >= 0) close(loop->wake_fd);
     if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+    timer_heap_destroy(loop->timers);
+    post_queue_destroy(loop->posts);
+    free(loop->pending);
+    for (size_t i = 0; i < loop->fd_page_count; i++) free(loop->fd_pages[i]);
+    free(loop->fd_pages);
     free(loop);
 }
 
 /*
  * event_loop_add_fd
  * -----------------
- * Registra un FD en epoll con intereses de lectura/escritura.
+ * Registra un FD en epoll con intereses de lectura/escritura (y opcionalmente
+ * EVENT_EDGE / EVENT_EXCLUSIVE). No hay límite fijo de fd: la tabla crece.
  */
 int event_loop_add_fd(EventLoop *loop, int fd, EventType events,
                       EventCallback callback, void *user_data) {
-    if (!loop || fd < 0 || fd >= MAX_FDS || !callback) return PLATFORM_EINVAL;
-    FdHandler *h = &loop->handlers[fd];
+    if (!loop || fd < 0 || !callback) return PLATFORM_EINVAL;
+    FdHandler *h = fd_handler(loop, fd, true);
+    if (!h) return PLATFORM_ERROR;
+    if (h->active) return PLATFORM_EINVAL;
     h->fd = fd; h->callback = callback; h->user_data = user_data; h->events = events; h->active = true;
     struct epoll_event ev; memset(&ev, 0, sizeof(ev));
-    if (events & EVENT_READ) ev.events |= EPOLLIN;
-    if (events & EVENT_WRITE) ev.events |= EPOLLOUT;
+    ev.events = to_epoll_events(events);
     ev.data.ptr = h;
     if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) { h->active = false; return PLATFORM_ERROR; }
     return PLATFORM_OK;
@@ -130,27 +315,35 @@ int event_loop_add_fd(EventLoop *loop, int fd, EventType events,
  * Quita un FD previamente agregado.
  */
 int event_loop_remove_fd(EventLoop *loop, int fd) {
-    if (!loop || fd < 0 || fd >= MAX_FDS) return PLATFORM_EINVAL;
-    FdHandler *h = &loop->handlers[fd];
-    if (!h->active) return PLATFORM_OK;
+    if (!loop || fd < 0) return PLATFORM_EINVAL;
+    FdHandler *h = fd_handler(loop, fd, false);
+    if (!h || !h->active) return PLATFORM_OK;
     epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
-    h->active = false; return PLATFORM_OK;
+    h->active = false; h->pending = false; return PLATFORM_OK;
 }
 
 /*
  * event_loop_modify_fd
  * --------------------
- * Modifica los intereses de un FD activo en epoll.
+ * Modifica los intereses de un FD activo en epoll. epoll no admite
+ * EPOLL_CTL_MOD sobre registros EPOLLEXCLUSIVE: en ese caso se re-registra.
  */
 int event_loop_modify_fd(EventLoop *loop, int fd, EventType events) {
-    if (!loop || fd < 0 || fd >= MAX_FDS) return PLATFORM_EINVAL;
-    FdHandler *h = &loop->handlers[fd];
-    if (!h->active) return PLATFORM_EINVAL;
+    if (!loop || fd < 0) return PLATFORM_EINVAL;
+    FdHandler *h = fd_handler(loop, fd, false);
+    if (!h || !h->active) return PLATFORM_EINVAL;
     struct epoll_event ev; memset(&ev, 0, sizeof(ev));
-    if (events & EVENT_READ) ev.events |= EPOLLIN;
-    if (events & EVENT_WRITE) ev.events |= EPOLLOUT;
+    ev.events = to_epoll_events(events);
     ev.data.ptr = h;
-    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) return PLATFORM_ERROR;
+    if ((h->events | events) & EVENT_EXCLUSIVE) {
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL) < 0 ||
+            epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            h->active = false;
+            return PLATFORM_ERROR;
+        }
+    } else if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+        return PLATFORM_ERROR;
+    }
     h->events = events; return PLATFORM_OK;
 }
 
@@ -161,51 +354,134 @@ int event_loop_modify_fd(EventLoop *loop, int fd, EventType events) {
  */
 int event_loop_add_timer(EventLoop *loop, uint64_t timeout_ms,
                          bool periodic, TimerCallback callback, void *user_data) {
+    return event_loop_add_timer_us(loop, timeout_ms * 1000ull, periodic, callback, user_data);
+}
+
+/*
+ * event_loop_add_timer_us
+ * -----------------------
+ * Igual que event_loop_add_timer con resolución de microsegundos. Si el timer
+ * vence antes que el programado en el timerfd, lo reprograma.
+ */
+int event_loop_add_timer_us(EventLoop *loop, uint64_t timeout_us,
+                            bool periodic, TimerCallback callback, void *user_data) {
     if (!loop || !callback) return -1;
-    for (int i = 0; i < MAX_TIMERS; i++) {
-        if (!loop->timers[i].active) {
-            loop->timers[i].id = loop->next_timer_id++;
-            loop->timers[i].timeout_ms = timeout_ms;
-            loop->timers[i].periodic = periodic;
-            loop->timers[i].callback = callback;
-            loop->timers[i].user_data = user_data;
-            loop->timers[i].next_fire = platform_get_time_ms() + timeout_ms;
-            loop->timers[i].active = true;
-            return loop->timers[i].id;
-        }
-    }
-    return -1;
+    uint64_t timeout_ns = timeout_us * 1000ull;
+    int id = timer_heap_add(loop->timers, clock_now_ns() + timeout_ns,
+                            periodic ? (timeout_ns ? timeout_ns : 1) : 0, callback, user_data);
+    if (id > 0) arm_timer_fd(loop);
+    return id;
 }
 
 /*
  * event_loop_remove_timer
  * -----------------------
- * Desactiva un timer por su identificador.
+ * Desactiva un timer por su identificador (O(1)).
  */
 void event_loop_remove_timer(EventLoop *loop, int timer_id) {
     if (!loop) return;
-    for (int i = 0; i < MAX_TIMERS; i++) {
-        if (loop->timers[i].active && loop->timers[i].id == timer_id) { loop->timers[i].active = false; break; }
+    timer_heap_cancel(loop->timers, timer_id);
+}
+
+/*
+ * event_loop_post
+ * ---------------
+ * Encola una tarea para el hilo del loop y lo despierta si hace falta.
+ */
+int event_loop_post(EventLoop *loop, TaskCallback fn, void *arg) {
+    if (!loop || !fn) return PLATFORM_EINVAL;
+    bool need_wake = false;
+    int rc = post_queue_push(loop->posts, fn, arg, &need_wake);
+    if (rc == PLATFORM_OK && need_wake) signal_wake(loop);
+    return rc;
+}
+
+/*
+ * event_loop_mark_pending
+ * -----------------------
+ * Agrega el fd a la lista de pendientes (una vez hasta que se reinvoque).
+ */
+int event_loop_mark_pending(EventLoop *loop, int fd) {
+    if (!loop || fd < 0) return PLATFORM_EINVAL;
+    FdHandler *h = fd_handler(loop, fd, false);
+    if (!h || !h->active) return PLATFORM_EINVAL;
+    if (h->pending) return PLATFORM_OK;
+    if (loop->pending_count == loop->pending_cap) {
+        size_t cap = loop->pending_cap ? loop->pending_cap * 2 : 8;
+        int *grown = realloc(loop->pending, cap * sizeof(*grown));
+        if (!grown) return PLATFORM_ENOMEM;
+        loop->pending = grown;
+        loop->pending_cap = cap;
     }
+    loop->pending[loop->pending_count++] = fd;
+    h->pending = true;
+    return PLATFORM_OK;
+}
+
+/*
+ * run_pending
+ * -----------
+ * Reinvoca los primeros 'n' fds marcados (los de antes de esta vuelta). Los
+ * marcados durante la vuelta, incluso por estos mismos callbacks, quedan para
+ * la siguiente: antes se vuelven a procesar los timers. Los quitados se
+ * saltean, y también los que ya recibieron su callback en esta vuelta (por
+ * un evento): esa entrada quedó vieja y, si el callback volvió a marcar el
+ * fd, la nueva está después de 'n'. Así cada fd recibe a lo sumo un callback
+ * por vuelta y la lista no acumula duplicados.
+ */
+static void run_pending(EventLoop *loop, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        FdHandler *h = fd_handler(loop, loop->pending[i], false);
+        if (!h || !h->active || !h->pending) continue;
+        if (h->dispatched == loop->stats.iterations) continue;
+        h->pending = false;
+        h->dispatched = loop->stats.iterations;
+        h->callback(h->fd, EVENT_READ, h->user_data);
+    }
+    loop->pending_count -= n;
+    memmove(loop->pending, loop->pending + n, loop->pending_count * sizeof(*loop->pending));
+}
+
+/*
+ * event_loop_get_stats
+ * --------------------
+ * Copia los acumulados de utilización.
+ */
+void event_loop_get_stats(EventLoop *loop, EventLoopStats *out) {
+    if (!out) return;
+    if (!loop) { memset(out, 0, sizeof(*out)); return; }
+    *out = loop->stats;
 }
 
 /*
  * event_loop_run
  * --------------
- * Bucle principal usando epoll_wait. Despacha eventos y procesa timers.
- * Si timeout_ms >= 0, ejecuta una sola vuelta y retorna.
+ * Bucle principal usando epoll_wait. Tras cada despertar dispara primero los
+ * timers vencidos, luego despacha la I/O y los fds pendientes; al final
+ * reprograma el timerfd. Si timeout_ms >= 0, ejecuta una sola vuelta y retorna.
+ * El tiempo en epoll_wait cuenta como ocioso; el resto, como ocupado.
  */
 int event_loop_run(EventLoop *loop, int timeout_ms) {
     if (!loop) return PLATFORM_EINVAL;
     loop->running = true;
     do {
         int wait_ms = compute_wait_timeout(loop, timeout_ms);
+        const size_t pending_before = loop->pending_count;
         struct epoll_event evs[MAX_EVENTS];
+        const uint64_t wait_start = clock_monotonic_ns();
+        if (loop->wake_ns) loop->stats.busy_ns += wait_start - loop->wake_ns;
         int n = epoll_wait(loop->epoll_fd, evs, MAX_EVENTS, wait_ms);
+        clock_refresh(); // Un único "ahora" por despertar para callbacks y timers
+        loop->wake_ns = clock_now_ns();
+        loop->stats.idle_ns += loop->wake_ns - wait_start;
+        loop->stats.iterations++;
         if (n < 0) {
-            if (errno == EINTR) { process_timers(loop); if (timeout_ms >= 0) break; else continue; }
+            if (errno == EINTR) { process_timers(loop); arm_timer_fd(loop); if (timeout_ms >= 0) break; else continue; }
+            loop->wake_ns = 0;
+            clock_invalidate();
             return PLATFORM_ERROR;
         }
+        process_timers(loop);
         for (int i = 0; i < n; i++) {
             FdHandler *h = (FdHandler *)evs[i].data.ptr;
             if (!h || !h->active) continue;
@@ -213,11 +489,17 @@ int event_loop_run(EventLoop *loop, int timeout_ms) {
             if (evs[i].events & EPOLLIN)  et |= EVENT_READ;
             if (evs[i].events & EPOLLOUT) et |= EVENT_WRITE;
             if (evs[i].events & EPOLLERR) et |= EVENT_ERROR;
+            h->pending = false; // Esta invocación atiende también el re-armado
+            h->dispatched = loop->stats.iterations;
             h->callback(h->fd, et, h->user_data);
         }
-        process_timers(loop);
+        if (pending_before > 0) run_pending(loop, pending_before);
+        arm_timer_fd(loop);
         if (timeout_ms >= 0) break;
     } while (loop->running);
+    loop->stats.busy_ns += clock_monotonic_ns() - loop->wake_ns;
+    loop->wake_ns = 0;
+    clock_invalidate();
     return PLATFORM_OK;
 }
 
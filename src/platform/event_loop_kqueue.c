@@ -4,20 +4,27 @@
  * event_loop_kqueue.c — Implementación de EventLoop usando kqueue (macOS).
  *
  * Proporciona una API uniforme (event_loop_*) para registro de FDs, timers,
- * ejecución del bucle y parada cooperativa.
+ * ejecución del bucle y parada cooperativa. event_loop_post encola tareas en
+ * una cola MPSC (post_queue.c) y despierta al loop con un pipe no bloqueante.
+ * event_loop_mark_pending reinvoca un callback que cortó por presupuesto en
+ * la vuelta siguiente, sin bloquear en kevent.
  */
 #include "event_loop.h"
 #include "platform.h"
+#include "clock.h"
+#include "timer_heap.h"
+#include "post_queue.h"
 #include <sys/event.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <stdlib.h>
 
 #define MAX_EVENTS 64
-#define MAX_FDS    1024
-#define MAX_TIMERS 64
+#define FD_PAGE_SHIFT 8                  // Handlers por página: 256
+#define FD_PAGE_SIZE  (1 << FD_PAGE_SHIFT)
 
 typedef struct FdHandler {
 	int fd;
@@ -25,24 +32,26 @@ typedef struct FdHandler {
 	void *user_data;
 	EventType events;
 	bool active;
+	bool pending;          // En la lista de event_loop_mark_pending
+	uint64_t dispatched;   // Vuelta (stats.iterations) del último callback
 } FdHandler;
 
-typedef struct Timer {
-	int id;
-	uint64_t timeout_ms;
-	bool periodic;
-	TimerCallback callback;
-	void *user_data;
-	uint64_t next_fire;
-	bool active;
-} Timer;
-
 struct EventLoop {
 	int kqueue_fd;
 	bool running;
-	FdHandler handlers[MAX_FDS];
-	Timer timers[MAX_TIMERS];
-	int next_timer_id;
+	// Tabla de handlers indexada por fd, en páginas que no se mueven (udata
+	// guarda punteros a FdHandler); sólo crece el arreglo de páginas.
+	FdHandler **fd_pages;
+	size_t fd_page_count;
+	TimerHeap *timers;
+	PostQueue *posts;      // Tareas de event_loop_post
+	int wake_pipe[2];      // Despertar desde otros hilos ([0] en kqueue)
+	FdHandler wake_handler;
+	int *pending;          // fds a reinvocar en la próxima vuelta
+	size_t pending_count;
+	size_t pending_cap;
+	EventLoopStats stats;
+	uint64_t wake_ns;      // Fin de la última espera (0 = fuera de run)
 };
 
 /*
@@ -55,33 +64,109 @@ struct EventLoop {
  */
 static void compute_timespec_for_wait(EventLoop *loop, int run_timeout_ms,
                                      struct timespec *out_ts, struct timespec **out_pts) {
-	// Calcula el timeout a usar considerando timers pendientes
-	uint64_t now = platform_get_time_ms();
-	int64_t ms_to_timer = -1; // -1 => no timers activos
-	for (int i = 0; i < MAX_TIMERS; i++) {
-		if (!loop->timers[i].active) continue;
-		int64_t delta = (int64_t)loop->timers[i].next_fire - (int64_t)now;
-		if (delta < 0) delta = 0;
-		if (ms_to_timer < 0 || delta < ms_to_timer) {
-			ms_to_timer = delta;
-		}
+	// Calcula el timeout a usar considerando timers pendientes (en ns: kevent
+	// acepta timespec, así que los timers de microsegundos no se redondean)
+	int64_t ns_to_timer = -1; // -1 => no timers activos
+	uint64_t deadline;
+	if (timer_heap_next_deadline(loop->timers, &deadline)) {
+		uint64_t now = clock_monotonic_ns();
+		ns_to_timer = deadline > now ? (int64_t)(deadline - now) : 0;
 	}
 
-	int use_ms;
-	if (run_timeout_ms >= 0 && ms_to_timer >= 0)
-		use_ms = (run_timeout_ms < ms_to_timer) ? run_timeout_ms : (int)ms_to_timer;
-	else if (run_timeout_ms >= 0)
-		use_ms = run_timeout_ms;
-	else if (ms_to_timer >= 0)
-		use_ms = (int)ms_to_timer;
+	int64_t run_ns = run_timeout_ms >= 0 ? (int64_t)run_timeout_ms * 1000000 : -1;
+	int64_t use_ns;
+	if (run_ns >= 0 && ns_to_timer >= 0)
+		use_ns = (run_ns < ns_to_timer) ? run_ns : ns_to_timer;
+	else if (run_ns >= 0)
+		use_ns = run_ns;
+	else if (ns_to_timer >= 0)
+		use_ns = ns_to_timer;
 	else
-		use_ms = 1000; // default 1s si no hay timers ni timeout de corrida
+		use_ns = 1000000000; // default 1s si no hay timers ni timeout de corrida
+	if (loop->pending_count > 0) use_ns = 0; // fds re-armados: sólo sondear
 
-	out_ts->tv_sec = use_ms / 1000;
-	out_ts->tv_nsec = (use_ms % 1000) * 1000000L;
+	out_ts->tv_sec = (time_t)(use_ns / 1000000000);
+	out_ts->tv_nsec = (long)(use_ns % 1000000000);
 	*out_pts = out_ts;
 }
 
+/*
+ * fd_handler
+ * ----------
+ * Retorna el handler de 'fd'. Con 'create', asigna la página si falta (y
+ * crece el arreglo de páginas); sin él, NULL si la página no existe.
+ */
+static FdHandler *fd_handler(EventLoop *loop, int fd, bool create) {
+	size_t page = (size_t)fd >> FD_PAGE_SHIFT;
+	if (page >= loop->fd_page_count) {
+		if (!create) return NULL;
+		size_t count = loop->fd_page_count ? loop->fd_page_count : 4;
+		while (count <= page) count *= 2;
+		FdHandler **pages = realloc(loop->fd_pages, count * sizeof(*pages));
+		if (!pages) return NULL;
+		memset(pages + loop->fd_page_count, 0, (count - loop->fd_page_count) * sizeof(*pages));
+		loop->fd_pages = pages;
+		loop->fd_page_count = count;
+	}
+	if (!loop->fd_pages[page]) {
+		if (!create) return NULL;
+		loop->fd_pages[page] = calloc(FD_PAGE_SIZE, sizeof(FdHandler));
+		if (!loop->fd_pages[page]) return NULL;
+	}
+	return &loop->fd_pages[page][fd & (FD_PAGE_SIZE - 1)];
+}
+
+/*
+ * signal_wake
+ * -----------
+ * Despierta al loop (seguro desde cualquier hilo).
+ */
+static void signal_wake(EventLoop *loop) {
+	char one = 1;
+	ssize_t rc = write(loop->wake_pipe[1], &one, 1);
+	(void)rc; // EAGAIN => pipe lleno: el loop ya tiene una señal pendiente
+}
+
+/*
+ * on_wake_pipe
+ * ------------
+ * Vacía el pipe y ejecuta hasta EVENT_LOOP_POST_BATCH tareas; si quedan,
+ * se vuelve a señalar para continuar en la próxima vuelta.
+ */
+static void on_wake_pipe(int fd, EventType events, void *user_data) {
+	(void)events;
+	EventLoop *loop = (EventLoop *)user_data;
+	char buf[64];
+	while (read(fd, buf, sizeof(buf)) > 0) {}
+	bool more = false;
+	post_queue_drain(loop->posts, EVENT_LOOP_POST_BATCH, &more);
+	if (more) signal_wake(loop);
+}
+
+/*
+ * create_wake_pipe
+ * ----------------
+ * Crea el pipe de despertar (ambos extremos no bloqueantes) y registra la
+ * lectura en kqueue.
+ */
+static int create_wake_pipe(EventLoop *loop) {
+	if (pipe(loop->wake_pipe) < 0) {
+		loop->wake_pipe[0] = loop->wake_pipe[1] = -1;
+		return PLATFORM_ERROR;
+	}
+	for (int i = 0; i < 2; i++) {
+		fcntl(loop->wake_pipe[i], F_SETFL, fcntl(loop->wake_pipe[i], F_GETFL, 0) | O_NONBLOCK);
+		fcntl(loop->wake_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	FdHandler *h = &loop->wake_handler;
+	h->fd = loop->wake_pipe[0]; h->callback = on_wake_pipe; h->user_data = loop;
+	h->events = EVENT_READ; h->active = true;
+	struct kevent kev;
+	EV_SET(&kev, loop->wake_pipe[0], EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, h);
+	if (kevent(loop->kqueue_fd, &kev, 1, NULL, 0, NULL) < 0) return PLATFORM_ERROR;
+	return PLATFORM_OK;
+}
+
 /*
  * event_loop_create
  * -----------------
@@ -90,13 +175,19 @@ static void compute_timespec_for_wait(EventLoop *loop, int run_timeout_ms,
 EventLoop *event_loop_create(void) {
 	EventLoop *loop = (EventLoop *)calloc(1, sizeof(EventLoop));
 	if (!loop) return NULL;
+	loop->wake_pipe[0] = loop->wake_pipe[1] = -1;
 
 	loop->kqueue_fd = kqueue();
 	if (loop->kqueue_fd < 0) {
 		free(loop);
 		return NULL;
 	}
-	loop->next_timer_id = 1;
+	loop->timers = timer_heap_create();
+	loop->posts = post_queue_create();
+	if (!loop->timers || !loop->posts || create_wake_pipe(loop) != PLATFORM_OK) {
+		event_loop_destroy(loop);
+		return NULL;
+	}
 	return loop;
 }
 
@@ -108,6 +199,13 @@ EventLoop *event_loop_create(void) {
 void event_loop_destroy(EventLoop *loop) {
 	if (!loop) return;
 	if (loop->kqueue_fd >= 0) close(loop->kqueue_fd);
+	for (int i = 0; i < 2; i++)
+		if (loop->wake_pipe[i] >= 0) close(loop->wake_pipe[i]);
+	timer_heap_destroy(loop->timers);
+	post_queue_destroy(loop->posts);
+	free(loop->pending);
+	for (size_t i = 0; i < loop->fd_page_count; i++) free(loop->fd_pages[i]);
+	free(loop->fd_pages);
 	free(loop);
 }
 
@@ -115,13 +213,16 @@ void event_loop_destroy(EventLoop *loop) {
  * event_loop_add_fd
  * -----------------
  * Registra un descriptor de archivo con interés en lectura/escritura.
- * user_data será pasado al callback cuando haya eventos.
+ * user_data será pasado al callback cuando haya eventos. EVENT_EDGE se mapea a
+ * EV_CLEAR; EVENT_EXCLUSIVE no tiene equivalente en kqueue y se ignora.
  */
 int event_loop_add_fd(EventLoop *loop, int fd, EventType events,
                       EventCallback callback, void *user_data) {
-	if (!loop || fd < 0 || fd >= MAX_FDS || !callback) return PLATFORM_EINVAL;
+	if (!loop || fd < 0 || !callback) return PLATFORM_EINVAL;
 
-	FdHandler *h = &loop->handlers[fd];
+	FdHandler *h = fd_handler(loop, fd, true);
+	if (!h) return PLATFORM_ERROR;
+	if (h->active) return PLATFORM_EINVAL;
 	h->fd = fd;
 	h->callback = callback;
 	h->user_data = user_data;
@@ -130,8 +231,9 @@ int event_loop_add_fd(EventLoop *loop, int fd, EventType events,
 
 	struct kevent changes[2];
 	int n = 0;
-	if (events & EVENT_READ)  EV_SET(&changes[n++], fd, EVFILT_READ,  EV_ADD | EV_ENABLE, 0, 0, h);
-	if (events & EVENT_WRITE) EV_SET(&changes[n++], fd, EVFILT_WRITE, EV_ADD | EV_ENABLE, 0, 0, h);
+	unsigned short flags = EV_ADD | EV_ENABLE | ((events & EVENT_EDGE) ? EV_CLEAR : 0);
+	if (events & EVENT_READ)  EV_SET(&changes[n++], fd, EVFILT_READ,  flags, 0, 0, h);
+	if (events & EVENT_WRITE) EV_SET(&changes[n++], fd, EVFILT_WRITE, flags, 0, 0, h);
 	if (kevent(loop->kqueue_fd, changes, n, NULL, 0, NULL) < 0) {
 		h->active = false;
 		return PLATFORM_ERROR;
@@ -145,9 +247,9 @@ int event_loop_add_fd(EventLoop *loop, int fd, EventType events,
  * Elimina el registro de un descriptor previamente agregado.
  */
 int event_loop_remove_fd(EventLoop *loop, int fd) {
-	if (!loop || fd < 0 || fd >= MAX_FDS) return PLATFORM_EINVAL;
-	FdHandler *h = &loop->handlers[fd];
-	if (!h->active) return PLATFORM_OK;
+	if (!loop || fd < 0) return PLATFORM_EINVAL;
+	FdHandler *h = fd_handler(loop, fd, false);
+	if (!h || !h->active) return PLATFORM_OK;
 
 	struct kevent changes[2];
 	int n = 0;
@@ -155,6 +257,7 @@ int event_loop_remove_fd(EventLoop *loop, int fd) {
 	if (h->events & EVENT_WRITE) EV_SET(&changes[n++], fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
 	kevent(loop->kqueue_fd, changes, n, NULL, 0, NULL);
 	h->active = false;
+	h->pending = false;
 	return PLATFORM_OK;
 }
 
@@ -164,9 +267,9 @@ int event_loop_remove_fd(EventLoop *loop, int fd) {
  * Actualiza los intereses (lectura/escritura) de un descriptor activo.
  */
 int event_loop_modify_fd(EventLoop *loop, int fd, EventType events) {
-	if (!loop || fd < 0 || fd >= MAX_FDS) return PLATFORM_EINVAL;
-	FdHandler *h = &loop->handlers[fd];
-	if (!h->active) return PLATFORM_EINVAL;
+	if (!loop || fd < 0) return PLATFORM_EINVAL;
+	FdHandler *h = fd_handler(loop, fd, false);
+	if (!h || !h->active) return PLATFORM_EINVAL;
 	// El enfoque simple: eliminar y volver a agregar
 	int rc = event_loop_remove_fd(loop, fd);
 	if (rc != PLATFORM_OK) return rc;
@@ -177,68 +280,123 @@ int event_loop_modify_fd(EventLoop *loop, int fd, EventType events) {
  * event_loop_add_timer
  * --------------------
  * Crea un timer interno (no de kqueue) gestionado por el bucle. Soporta timers
- * one-shot y periódicos. Retorna un ID (>0) o -1 si no hay espacio.
+ * one-shot y periódicos. Retorna un ID (>0) o -1 si no hay memoria.
  */
 int event_loop_add_timer(EventLoop *loop, uint64_t timeout_ms,
                          bool periodic, TimerCallback callback, void *user_data) {
+	return event_loop_add_timer_us(loop, timeout_ms * 1000ull, periodic, callback, user_data);
+}
+
+/*
+ * event_loop_add_timer_us
+ * -----------------------
+ * Igual que event_loop_add_timer con resolución de microsegundos.
+ */
+int event_loop_add_timer_us(EventLoop *loop, uint64_t timeout_us,
+                            bool periodic, TimerCallback callback, void *user_data) {
 	if (!loop || !callback) return -1;
-	for (int i = 0; i < MAX_TIMERS; i++) {
-		if (!loop->timers[i].active) {
-			loop->timers[i].id = loop->next_timer_id++;
-			loop->timers[i].timeout_ms = timeout_ms;
-			loop->timers[i].periodic = periodic;
-			loop->timers[i].callback = callback;
-			loop->timers[i].user_data = user_data;
-			loop->timers[i].next_fire = platform_get_time_ms() + timeout_ms;
-			loop->timers[i].active = true;
-			return loop->timers[i].id;
-		}
-	}
-	return -1;
+	uint64_t timeout_ns = timeout_us * 1000ull;
+	return timer_heap_add(loop->timers, clock_now_ns() + timeout_ns,
+	                      periodic ? (timeout_ns ? timeout_ns : 1) : 0, callback, user_data);
 }
 
 /*
  * event_loop_remove_timer
  * -----------------------
- * Desactiva un timer previamente agregado.
+ * Desactiva un timer previamente agregado (O(1)).
  */
 void event_loop_remove_timer(EventLoop *loop, int timer_id) {
 	if (!loop) return;
-	for (int i = 0; i < MAX_TIMERS; i++) {
-		if (loop->timers[i].active && loop->timers[i].id == timer_id) {
-			loop->timers[i].active = false;
-			break;
-		}
-	}
+	timer_heap_cancel(loop->timers, timer_id);
 }
 
 /*
  * process_timers
  * --------------
- * Recorre timers activos, dispara callbacks vencidos y reprograma los periódicos.
+ * Dispara timers vencidos y reprograma los periódicos. Usa el instante
+ * cacheado del despertar actual (monotónico).
  */
 static void process_timers(EventLoop *loop) {
-	uint64_t now = platform_get_time_ms();
-	for (int i = 0; i < MAX_TIMERS; i++) {
-		Timer *t = &loop->timers[i];
-		if (!t->active) continue;
-		if (t->next_fire <= now) {
-			t->callback(t->user_data);
-			if (t->periodic) {
-				t->next_fire = now + t->timeout_ms;
-			} else {
-				t->active = false;
-			}
-		}
+	timer_heap_run_expired(loop->timers, clock_now_ns());
+}
+
+/*
+ * event_loop_post
+ * ---------------
+ * Encola una tarea para el hilo del loop y lo despierta si hace falta.
+ */
+int event_loop_post(EventLoop *loop, TaskCallback fn, void *arg) {
+	if (!loop || !fn) return PLATFORM_EINVAL;
+	bool need_wake = false;
+	int rc = post_queue_push(loop->posts, fn, arg, &need_wake);
+	if (rc == PLATFORM_OK && need_wake) signal_wake(loop);
+	return rc;
+}
+
+/*
+ * event_loop_mark_pending
+ * -----------------------
+ * Agrega el fd a la lista de pendientes (una vez hasta que se reinvoque).
+ */
+int event_loop_mark_pending(EventLoop *loop, int fd) {
+	if (!loop || fd < 0) return PLATFORM_EINVAL;
+	FdHandler *h = fd_handler(loop, fd, false);
+	if (!h || !h->active) return PLATFORM_EINVAL;
+	if (h->pending) return PLATFORM_OK;
+	if (loop->pending_count == loop->pending_cap) {
+		size_t cap = loop->pending_cap ? loop->pending_cap * 2 : 8;
+		int *grown = realloc(loop->pending, cap * sizeof(*grown));
+		if (!grown) return PLATFORM_ENOMEM;
+		loop->pending = grown;
+		loop->pending_cap = cap;
+	}
+	loop->pending[loop->pending_count++] = fd;
+	h->pending = true;
+	return PLATFORM_OK;
+}
+
+/*
+ * run_pending
+ * -----------
+ * Reinvoca los primeros 'n' fds marcados (los de antes de esta vuelta). Los
+ * marcados durante la vuelta, incluso por estos mismos callbacks, quedan para
+ * la siguiente: antes se vuelven a procesar los timers. Los quitados se
+ * saltean, y también los que ya recibieron su callback en esta vuelta (por
+ * un evento): esa entrada quedó vieja y, si el callback volvió a marcar el
+ * fd, la nueva está después de 'n'. Así cada fd recibe a lo sumo un callback
+ * por vuelta y la lista no acumula duplicados.
+ */
+static void run_pending(EventLoop *loop, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		FdHandler *h = fd_handler(loop, loop->pending[i], false);
+		if (!h || !h->active || !h->pending) continue;
+		if (h->dispatched == loop->stats.iterations) continue;
+		h->pending = false;
+		h->dispatched = loop->stats.iterations;
+		h->callback(h->fd, EVENT_READ, h->user_data);
 	}
+	loop->pending_count -= n;
+	memmove(loop->pending, loop->pending + n, loop->pending_count * sizeof(*loop->pending));
+}
+
+/*
+ * event_loop_get_stats
+ * --------------------
+ * Copia los acumulados de utilización.
+ */
+void event_loop_get_stats(EventLoop *loop, EventLoopStats *out) {
+	if (!out) return;
+	if (!loop) { memset(out, 0, sizeof(*out)); return; }
+	*out = loop->stats;
 }
 
 /*
  * event_loop_run
  * --------------
  * Ejecuta el bucle principal: espera eventos kqueue, despacha callbacks y
- * procesa timers. Si timeout_ms >= 0, realiza una única iteración con ese
- * timeout efectivo y retorna.
+ * procesa timers; al final reinvoca los fds pendientes. Si timeout_ms >= 0,
+ * realiza una única iteración con ese timeout efectivo y retorna. El tiempo
+ * en kevent cuenta como ocioso; el resto, como ocupado.
  */
 int event_loop_run(EventLoop *loop, int timeout_ms) {
 	if (!loop) return PLATFORM_EINVAL;
@@ -247,11 +405,20 @@ int event_loop_run(EventLoop *loop, int timeout_ms) {
 	do {
 		struct timespec ts; struct timespec *pts = NULL;
 		compute_timespec_for_wait(loop, timeout_ms, &ts, &pts);
+		const size_t pending_before = loop->pending_count;
 
 		struct kevent events[MAX_EVENTS];
+		const uint64_t wait_start = clock_monotonic_ns();
+		if (loop->wake_ns) loop->stats.busy_ns += wait_start - loop->wake_ns;
 		int n = kevent(loop->kqueue_fd, NULL, 0, events, MAX_EVENTS, pts);
+		clock_refresh(); // Un único "ahora" por despertar para callbacks y timers
+		loop->wake_ns = clock_now_ns();
+		loop->stats.idle_ns += loop->wake_ns - wait_start;
+		loop->stats.iterations++;
 		if (n < 0) {
 			if (errno == EINTR) { process_timers(loop); if (timeout_ms >= 0) break; else continue; }
+			loop->wake_ns = 0;
+			clock_invalidate();
 			return PLATFORM_ERROR;
 		}
 
@@ -264,13 +431,19 @@ int event_loop_run(EventLoop *loop, int timeout_ms) {
 			if (ev->filter == EVFILT_READ)  et |= EVENT_READ;
 			if (ev->filter == EVFILT_WRITE) et |= EVENT_WRITE;
 			if (ev->flags & EV_ERROR)       et |= EVENT_ERROR;
+			h->pending = false; // Esta invocación atiende también el re-armado
+			h->dispatched = loop->stats.iterations;
 			h->callback(h->fd, et, h->user_data);
 		}
 
 		process_timers(loop);
+		if (pending_before > 0) run_pending(loop, pending_before);
 		if (timeout_ms >= 0) break; // single-iteration mode
 	} while (loop->running);
+	loop->stats.busy_ns += clock_monotonic_ns() - loop->wake_ns;
+	loop->wake_ns = 0;
 
+	clock_invalidate();
 	return PLATFORM_OK;
 }
 
@@ -0,0 +1,155 @@
+/*
+ * post_queue.c — Cola MPSC intrusiva (Vyukov) para event_loop_post.
+ *
+ * - push: un único atomic_exchange sobre 'head' y un store release del enlace;
+ *   sin CAS ni reintentos, wait-free para los productores.
+ * - pop: sólo el consumidor toca 'tail'. Entre el exchange y el enlace de un
+ *   productor la cola queda momentáneamente "cortada": pop retorna NULL y el
+ *   drenado reporta 'more' para que el loop reintente en la próxima vuelta.
+ * - wake_pending coalesce señales: sólo el primer post tras un drenado pide
+ *   despertar al loop.
+ */
+#include "post_queue.h"
+#include "platform.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+typedef struct PostNode {
+	_Atomic(struct PostNode *) next;
+	TaskCallback fn;
+	void *arg;
+} PostNode;
+
+struct PostQueue {
+	_Alignas(64) _Atomic(PostNode *) head;   // Productores
+	_Alignas(64) PostNode *tail;             // Consumidor
+	PostNode stub;
+	_Alignas(64) atomic_bool wake_pending;
+};
+
+/*
+ * push_node
+ * ---------
+ * Enlaza 'node' al final de la cola (lado productor).
+ */
+static void push_node(PostQueue *q, PostNode *node) {
+	atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+	PostNode *prev = atomic_exchange_explicit(&q->head, node, memory_order_acq_rel);
+	atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+/*
+ * pop_node
+ * --------
+ * Extrae el nodo más antiguo o NULL si la cola está vacía o cortada.
+ */
+static PostNode *pop_node(PostQueue *q, bool *cut) {
+	*cut = false;
+	PostNode *tail = q->tail;
+	PostNode *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+	if (tail == &q->stub) {
+		if (!next) {
+			*cut = atomic_load_explicit(&q->head, memory_order_acquire) != &q->stub;
+			return NULL;
+		}
+		q->tail = next;
+		tail = next;
+		next = atomic_load_explicit(&next->next, memory_order_acquire);
+	}
+	if (next) {
+		q->tail = next;
+		return tail;
+	}
+	if (tail != atomic_load_explicit(&q->head, memory_order_acquire)) {
+		*cut = true; // Un productor hizo el exchange pero aún no enlazó
+		return NULL;
+	}
+	push_node(q, &q->stub);
+	next = atomic_load_explicit(&tail->next, memory_order_acquire);
+	if (next) {
+		q->tail = next;
+		return tail;
+	}
+	*cut = true;
+	return NULL;
+}
+
+/*
+ * post_queue_create
+ * -----------------
+ * Crea una cola vacía (head y tail apuntan al nodo stub).
+ */
+PostQueue *post_queue_create(void) {
+	PostQueue *q = aligned_alloc(64, sizeof(PostQueue));
+	if (!q) return NULL;
+	atomic_init(&q->stub.next, NULL);
+	atomic_init(&q->head, &q->stub);
+	q->tail = &q->stub;
+	atomic_init(&q->wake_pending, false);
+	return q;
+}
+
+/*
+ * post_queue_destroy
+ * ------------------
+ * Libera tareas pendientes (sin ejecutarlas) y la cola. No debe haber
+ * productores activos.
+ */
+void post_queue_destroy(PostQueue *queue) {
+	if (!queue) return;
+	bool cut;
+	PostNode *node;
+	while ((node = pop_node(queue, &cut)) != NULL) {
+		if (node != &queue->stub) free(node);
+	}
+	free(queue);
+}
+
+/*
+ * post_queue_push
+ * ---------------
+ * Encola una tarea. Seguro desde cualquier hilo.
+ */
+int post_queue_push(PostQueue *queue, TaskCallback fn, void *arg, bool *need_wake) {
+	if (need_wake) *need_wake = false;
+	if (!queue || !fn) return PLATFORM_EINVAL;
+	PostNode *node = malloc(sizeof(PostNode));
+	if (!node) return PLATFORM_ENOMEM;
+	node->fn = fn;
+	node->arg = arg;
+	push_node(queue, node);
+	bool was_pending = atomic_exchange(&queue->wake_pending, true);
+	if (need_wake) *need_wake = !was_pending;
+	return PLATFORM_OK;
+}
+
+/*
+ * post_queue_drain
+ * ----------------
+ * Ejecuta hasta 'max' tareas. Limpia wake_pending antes de drenar: un post
+ * concurrente que llegue después volverá a pedir despertar.
+ */
+size_t post_queue_drain(PostQueue *queue, size_t max, bool *more) {
+	*more = false;
+	if (!queue) return 0;
+	atomic_store(&queue->wake_pending, false);
+	size_t ran = 0;
+	while (ran < max) {
+		bool cut;
+		PostNode *node = pop_node(queue, &cut);
+		if (!node) {
+			*more = cut;
+			return ran;
+		}
+		TaskCallback fn = node->fn;
+		void *arg = node->arg;
+		free(node);
+		fn(arg);
+		ran++;
+	}
+	// Presupuesto agotado: 'tail' es el próximo nodo a extraer (o el stub)
+	*more = queue->tail != &queue->stub ||
+	        atomic_load_explicit(&queue->head, memory_order_acquire) != &queue->stub;
+	return ran;
+}
@@ -1,8 +1,9 @@
 /*
  * socket.c — Wrappers de sockets UDP (POSIX) con manejo de errores uniforme.
  *
- * Provee funciones para crear, configurar y operar sockets UDP de manera
- * portátil entre macOS y Linux, devolviendo códigos PLATFORM_*.
+ * Provee funciones para crear, configurar y operar sockets UDP (y TCP para el
+ * listener HTTP) de manera portátil entre macOS y Linux, devolviendo códigos
+ * PLATFORM_*.
  */
 #include "platform.h"
 #include "log.h"
@@ -84,6 +85,30 @@ LOG_ERROR("Error en SO_REUSEADDR: %s\n", strerror(errno));
 	return PLATFORM_OK;
 }
 
+/*
+ * platform_socket_set_busy_poll
+ * -----------------------------
+ * Activa el busy polling del kernel sobre el socket. SO_PREFER_BUSY_POLL
+ * (Linux >= 5.11) es opcional: si no existe, basta con SO_BUSY_POLL.
+ */
+int platform_socket_set_busy_poll(int sock, unsigned usec) {
+#if defined(SO_BUSY_POLL)
+	int value = (int)usec;
+	if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &value, sizeof(value)) < 0) {
+LOG_WARN("Error en SO_BUSY_POLL: %s\n", strerror(errno));
+		return PLATFORM_ERROR;
+	}
+#if defined(SO_PREFER_BUSY_POLL)
+	int one = 1;
+	(void)setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one));
+#endif
+	return PLATFORM_OK;
+#else
+	(void)sock; (void)usec;
+	return PLATFORM_ERROR;
+#endif
+}
+
 /*
  * platform_socket_close
  * ---------------------
@@ -131,3 +156,130 @@ LOG_WARN("Error en sendto: %s\n", strerror(errno));
 	}
 	return bytes;
 }
+
+/*
+ * platform_socket_sendmsg
+ * -----------------------
+ * Variante vectorizada de platform_socket_sendto basada en sendmsg: el kernel
+ * ensambla el datagrama desde 'iov' sin copias intermedias en espacio de
+ * usuario. Mismos códigos de retorno que platform_socket_sendto.
+ */
+ssize_t platform_socket_sendmsg(int sock, const struct iovec *iov, size_t iovcnt,
+                                const struct sockaddr *addr, socklen_t addrlen) {
+	struct msghdr mh;
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_name = (void *)addr;
+	mh.msg_namelen = addrlen;
+	mh.msg_iov = (struct iovec *)iov;
+	mh.msg_iovlen = iovcnt;
+
+	ssize_t bytes = sendmsg(sock, &mh, 0);
+	if (bytes < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return PLATFORM_EAGAIN;
+		}
+LOG_WARN("Error en sendmsg: %s\n", strerror(errno));
+		return PLATFORM_ERROR;
+	}
+	return bytes;
+}
+
+/*
+ * platform_socket_create_tcp
+ * --------------------------
+ * Crea un socket TCP IPv4 (stream). En macOS desactiva SIGPIPE por socket;
+ * en Linux se usa MSG_NOSIGNAL en cada envío.
+ */
+int platform_socket_create_tcp(void) {
+	int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sock < 0) {
+LOG_ERROR("Error creando socket TCP: %s\n", strerror(errno));
+		return PLATFORM_ERROR;
+	}
+#if defined(PLATFORM_MACOS)
+	int one = 1;
+	(void)setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+	return sock;
+}
+
+/*
+ * platform_socket_listen
+ * ----------------------
+ * Pone un socket TCP enlazado en modo escucha.
+ */
+int platform_socket_listen(int sock, int backlog) {
+	if (listen(sock, backlog) < 0) {
+LOG_ERROR("Error en listen: %s\n", strerror(errno));
+		return PLATFORM_ERROR;
+	}
+	return PLATFORM_OK;
+}
+
+/*
+ * platform_socket_accept
+ * ----------------------
+ * Acepta una conexión pendiente y la deja en modo no bloqueante. Retorna el
+ * descriptor, PLATFORM_EAGAIN si no hay conexiones o PLATFORM_ERROR.
+ */
+int platform_socket_accept(int sock) {
+#if defined(PLATFORM_LINUX)
+	int fd = accept4(sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+	int fd = accept(sock, NULL, NULL);
+#endif
+	if (fd < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED || errno == EINTR) {
+			return PLATFORM_EAGAIN;
+		}
+LOG_WARN("Error en accept: %s\n", strerror(errno));
+		return PLATFORM_ERROR;
+	}
+#if !defined(PLATFORM_LINUX)
+	int one = 1;
+	(void)setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+	if (platform_socket_set_nonblocking(fd) != PLATFORM_OK) {
+		close(fd);
+		return PLATFORM_ERROR;
+	}
+#endif
+	return fd;
+}
+
+/*
+ * platform_socket_recv
+ * --------------------
+ * Lee de un socket stream. Retorna bytes leídos, 0 si el peer cerró,
+ * PLATFORM_EAGAIN si no hay datos o PLATFORM_ERROR.
+ */
+ssize_t platform_socket_recv(int sock, void *buffer, size_t len) {
+	ssize_t bytes = recv(sock, buffer, len, 0);
+	if (bytes < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return PLATFORM_EAGAIN;
+		}
+		return PLATFORM_ERROR;
+	}
+	return bytes;
+}
+
+/*
+ * platform_socket_send
+ * --------------------
+ * Escribe en un socket stream sin generar SIGPIPE. Retorna bytes escritos
+ * (posiblemente parciales), PLATFORM_EAGAIN o PLATFORM_ERROR.
+ */
+ssize_t platform_socket_send(int sock, const void *buffer, size_t len) {
+#if defined(PLATFORM_LINUX)
+	ssize_t bytes = send(sock, buffer, len, MSG_NOSIGNAL);
+#else
+	ssize_t bytes = send(sock, buffer, len, 0);
+#endif
+	if (bytes < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return PLATFORM_EAGAIN;
+		}
+		return PLATFORM_ERROR;
+	}
+	return bytes;
+}
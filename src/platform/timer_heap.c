@@ -0,0 +1,308 @@
+/*
+ * timer_heap.c — Min-heap de timers con cancelación perezosa.
+ *
+ * - Cada timer ocupa un slot (arreglo creciente con free list intrusiva); el
+ *   ID codifica slot y generación, de modo que cancelar es O(1): se libera el
+ *   slot y se incrementa su generación.
+ * - La free list es FIFO y sólo se toma de ella con TIMER_HEAP_REUSE_MIN
+ *   slots libres: un slot no se reutiliza en seguida (con LIFO un único timer
+ *   de retransmisión rearmado daría la vuelta a la generación de su slot en
+ *   pocas reutilizaciones y un ID viejo cancelaría otro timer).
+ * - El heap guarda entradas {deadline, seq, slot, gen}. Las que ya no coinciden
+ *   con la generación del slot se descartan al llegar a la cima; si las
+ *   canceladas superan a las vivas, el heap se compacta en O(n).
+ * - 'seq' desempata vencimientos iguales por orden de armado y permite no
+ *   disparar en la misma pasada timers armados desde un callback.
+ */
+#include "timer_heap.h"
+
+#include <stdlib.h>
+
+#define SLOT_NONE UINT32_MAX
+#define GEN_MASK  ((1u << TIMER_HEAP_GEN_BITS) - 1)
+#define COMPACT_MIN_STALE 64
+
+typedef struct {
+	uint64_t deadline_ns;
+	uint64_t seq;
+	uint32_t slot;
+	uint32_t gen;
+} HeapEntry;
+
+typedef struct {
+	TimerCallback callback;
+	void *user_data;
+	uint64_t period_ns;
+	uint32_t gen;
+	uint32_t next_free;   // Free list (sólo si !active)
+	bool active;
+} TimerSlot;
+
+struct TimerHeap {
+	HeapEntry *entries;
+	size_t size;
+	size_t capacity;
+	TimerSlot *slots;
+	uint32_t slot_count;
+	uint32_t slot_capacity;
+	uint32_t free_head;   // FIFO de slots libres: se toma de la cabeza...
+	uint32_t free_tail;   // ...y se agrega por la cola
+	uint32_t free_count;
+	size_t active;
+	uint64_t next_seq;
+};
+
+/*
+ * entry_less
+ * ----------
+ * Orden del heap: vencimiento y, a igualdad, orden de armado.
+ */
+static bool entry_less(const HeapEntry *a, const HeapEntry *b) {
+	if (a->deadline_ns != b->deadline_ns) return a->deadline_ns < b->deadline_ns;
+	return a->seq < b->seq;
+}
+
+static bool entry_live(const TimerHeap *heap, const HeapEntry *e) {
+	const TimerSlot *s = &heap->slots[e->slot];
+	return s->active && s->gen == e->gen;
+}
+
+static void sift_up(TimerHeap *heap, size_t i) {
+	HeapEntry e = heap->entries[i];
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!entry_less(&e, &heap->entries[parent])) break;
+		heap->entries[i] = heap->entries[parent];
+		i = parent;
+	}
+	heap->entries[i] = e;
+}
+
+static void sift_down(TimerHeap *heap, size_t i) {
+	HeapEntry e = heap->entries[i];
+	for (;;) {
+		size_t child = 2 * i + 1;
+		if (child >= heap->size) break;
+		if (child + 1 < heap->size && entry_less(&heap->entries[child + 1], &heap->entries[child])) child++;
+		if (!entry_less(&heap->entries[child], &e)) break;
+		heap->entries[i] = heap->entries[child];
+		i = child;
+	}
+	heap->entries[i] = e;
+}
+
+static void pop_top(TimerHeap *heap) {
+	heap->entries[0] = heap->entries[--heap->size];
+	if (heap->size > 0) sift_down(heap, 0);
+}
+
+/*
+ * push_entry
+ * ----------
+ * Inserta una entrada para 'slot' (generación actual) con nuevo seq.
+ */
+static bool push_entry(TimerHeap *heap, uint32_t slot, uint64_t deadline_ns) {
+	if (heap->size == heap->capacity) {
+		size_t cap = heap->capacity ? heap->capacity * 2 : 64;
+		HeapEntry *e = realloc(heap->entries, cap * sizeof(*e));
+		if (!e) return false;
+		heap->entries = e;
+		heap->capacity = cap;
+	}
+	HeapEntry *e = &heap->entries[heap->size];
+	e->deadline_ns = deadline_ns;
+	e->seq = heap->next_seq++;
+	e->slot = slot;
+	e->gen = heap->slots[slot].gen;
+	sift_up(heap, heap->size++);
+	return true;
+}
+
+/*
+ * compact
+ * -------
+ * Elimina entradas canceladas y reconstruye el heap (heapify O(n)).
+ */
+static void compact(TimerHeap *heap) {
+	size_t n = 0;
+	for (size_t i = 0; i < heap->size; i++) {
+		if (entry_live(heap, &heap->entries[i])) heap->entries[n++] = heap->entries[i];
+	}
+	heap->size = n;
+	for (size_t i = n / 2; i-- > 0;) sift_down(heap, i);
+}
+
+/*
+ * free_slot
+ * ---------
+ * Devuelve el slot a la free list invalidando IDs y entradas previas.
+ */
+static void free_slot(TimerHeap *heap, uint32_t slot) {
+	TimerSlot *s = &heap->slots[slot];
+	s->active = false;
+	s->gen = (s->gen + 1) & GEN_MASK;
+	s->next_free = SLOT_NONE;
+	if (heap->free_tail != SLOT_NONE) heap->slots[heap->free_tail].next_free = slot;
+	else heap->free_head = slot;
+	heap->free_tail = slot;
+	heap->free_count++;
+	heap->active--;
+	// Un periódico en disparo no tiene entrada: size puede ser < active
+	size_t stale = heap->size > heap->active ? heap->size - heap->active : 0;
+	if (stale > COMPACT_MIN_STALE && stale > heap->active) compact(heap);
+}
+
+static uint32_t pop_free(TimerHeap *heap) {
+	uint32_t slot = heap->free_head;
+	heap->free_head = heap->slots[slot].next_free;
+	if (heap->free_head == SLOT_NONE) heap->free_tail = SLOT_NONE;
+	heap->free_count--;
+	return slot;
+}
+
+/*
+ * alloc_slot
+ * ----------
+ * Toma el slot libre más antiguo si hay TIMER_HEAP_REUSE_MIN libres; si no,
+ * crea uno nuevo (y recién sin memoria o sin slots reutiliza antes).
+ */
+static uint32_t alloc_slot(TimerHeap *heap) {
+	if (heap->free_count >= TIMER_HEAP_REUSE_MIN) return pop_free(heap);
+	if (heap->slot_count == heap->slot_capacity && heap->slot_capacity < TIMER_HEAP_MAX_TIMERS) {
+		uint32_t cap = heap->slot_capacity ? heap->slot_capacity * 2 : 64;
+		if (cap > TIMER_HEAP_MAX_TIMERS) cap = TIMER_HEAP_MAX_TIMERS;
+		TimerSlot *s = realloc(heap->slots, (size_t)cap * sizeof(*s));
+		if (s) {
+			heap->slots = s;
+			heap->slot_capacity = cap;
+		}
+	}
+	if (heap->slot_count < heap->slot_capacity) {
+		heap->slots[heap->slot_count].gen = 0;
+		return heap->slot_count++;
+	}
+	return heap->free_count > 0 ? pop_free(heap) : SLOT_NONE;
+}
+
+/*
+ * timer_heap_create
+ * -----------------
+ * Crea un heap vacío (la memoria crece bajo demanda).
+ */
+TimerHeap *timer_heap_create(void) {
+	TimerHeap *heap = calloc(1, sizeof(TimerHeap));
+	if (!heap) return NULL;
+	heap->free_head = SLOT_NONE;
+	heap->free_tail = SLOT_NONE;
+	return heap;
+}
+
+/*
+ * timer_heap_destroy
+ * ------------------
+ * Libera el heap y todos sus timers (sin invocar callbacks).
+ */
+void timer_heap_destroy(TimerHeap *heap) {
+	if (!heap) return;
+	free(heap->entries);
+	free(heap->slots);
+	free(heap);
+}
+
+/*
+ * timer_heap_add
+ * --------------
+ * Arma un timer en O(log n) y retorna su ID estable.
+ */
+int timer_heap_add(TimerHeap *heap, uint64_t deadline_ns, uint64_t period_ns,
+                   TimerCallback callback, void *user_data) {
+	if (!heap || !callback) return -1;
+	uint32_t slot = alloc_slot(heap);
+	if (slot == SLOT_NONE) return -1;
+	TimerSlot *s = &heap->slots[slot];
+	s->callback = callback;
+	s->user_data = user_data;
+	s->period_ns = period_ns;
+	s->active = true;
+	heap->active++;
+	if (!push_entry(heap, slot, deadline_ns)) {
+		free_slot(heap, slot);
+		return -1;
+	}
+	return (int)((s->gen << TIMER_HEAP_SLOT_BITS) | (slot + 1));
+}
+
+/*
+ * timer_heap_cancel
+ * -----------------
+ * Invalida el timer 'timer_id' si sigue armado.
+ */
+bool timer_heap_cancel(TimerHeap *heap, int timer_id) {
+	if (!heap || timer_id <= 0) return false;
+	uint32_t slot = ((uint32_t)timer_id & TIMER_HEAP_MAX_TIMERS) - 1;
+	uint32_t gen = ((uint32_t)timer_id >> TIMER_HEAP_SLOT_BITS) & GEN_MASK;
+	if (slot >= heap->slot_count) return false;
+	TimerSlot *s = &heap->slots[slot];
+	if (!s->active || s->gen != gen) return false;
+	free_slot(heap, slot);
+	return true;
+}
+
+/*
+ * timer_heap_next_deadline
+ * ------------------------
+ * Descarta entradas canceladas de la cima y reporta el próximo vencimiento.
+ */
+bool timer_heap_next_deadline(TimerHeap *heap, uint64_t *deadline_ns) {
+	if (!heap) return false;
+	while (heap->size > 0 && !entry_live(heap, &heap->entries[0])) pop_top(heap);
+	if (heap->size == 0) return false;
+	if (deadline_ns) *deadline_ns = heap->entries[0].deadline_ns;
+	return true;
+}
+
+/*
+ * timer_heap_run_expired
+ * ----------------------
+ * Extrae y dispara los timers vencidos. Los one-shot se liberan antes del
+ * callback (su ID deja de ser válido); los periódicos se rearman después si el
+ * callback no los canceló, sin ráfagas de recuperación si el loop se atrasó.
+ */
+size_t timer_heap_run_expired(TimerHeap *heap, uint64_t now_ns) {
+	if (!heap) return 0;
+	const uint64_t seq_limit = heap->next_seq;
+	size_t fired = 0;
+	while (heap->size > 0) {
+		HeapEntry top = heap->entries[0];
+		if (!entry_live(heap, &top)) { pop_top(heap); continue; }
+		if (top.deadline_ns > now_ns || top.seq >= seq_limit) break;
+		pop_top(heap);
+
+		TimerSlot *s = &heap->slots[top.slot];
+		TimerCallback cb = s->callback;
+		void *ud = s->user_data;
+		uint64_t period = s->period_ns;
+		if (period == 0) free_slot(heap, top.slot);
+
+		cb(ud);
+		fired++;
+
+		// 's' puede haberse movido si el callback armó timers (realloc)
+		s = &heap->slots[top.slot];
+		if (period > 0 && s->active && s->gen == top.gen) {
+			uint64_t next = top.deadline_ns + period;
+			if (next <= now_ns) next = now_ns + period;
+			if (!push_entry(heap, top.slot, next)) free_slot(heap, top.slot);
+		}
+	}
+	return fired;
+}
+
+/*
+ * timer_heap_count
+ * ----------------
+ * Cantidad de timers armados.
+ */
+size_t timer_heap_count(const TimerHeap *heap) {
+	return heap ? heap->active : 0;
+}
@@ -2,8 +2,8 @@
  * utils.c — Utilidades de plataforma: init/cleanup, tiempo y strings de error.
  */
 #include "platform.h"
+#include "clock.h"
 #include "log.h"
-#include <sys/time.h>
 
 /*
  * platform_init
@@ -28,13 +28,21 @@ void platform_cleanup(void) {
 /*
  * platform_get_time_ms
  * --------------------
- * Devuelve el tiempo en milisegundos desde epoch (UTC). Implementación basada
- * en gettimeofday (suficiente para propósitos de temporización del event loop).
+ * Devuelve el tiempo en milisegundos desde epoch (UTC). Es reloj de pared:
+ * no usar para timers ni timeouts (ver clock_now_ms en clock.h).
  */
 uint64_t platform_get_time_ms(void) {
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	return (uint64_t)tv.tv_sec * 1000 + (uint64_t)tv.tv_usec / 1000;
+	return clock_wall_ms();
+}
+
+/*
+ * platform_get_monotonic_ns
+ * -------------------------
+ * Reloj monotónico en nanosegundos (origen arbitrario). Apto para medir
+ * latencias: no retrocede ante ajustes del reloj de pared.
+ */
+uint64_t platform_get_monotonic_ns(void) {
+	return clock_monotonic_ns();
 }
 
 /*
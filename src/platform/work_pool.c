@@ -0,0 +1,249 @@
+/*
+ * work_pool.c — Pool de hilos con deques por worker y work stealing.
+ *
+ * - Cada worker tiene un deque (ring buffer creciente) protegido por su propio
+ *   mutex: las secciones críticas son de unas pocas instrucciones y sólo hay
+ *   contención cuando un ladrón coincide con el dueño o con un productor.
+ * - El dueño toma por el fondo (LIFO); los ladrones, por el tope (FIFO).
+ * - Los productores externos reparten en round-robin; un worker que encola
+ *   (tareas hijas) usa su propio deque.
+ * - Los workers sin trabajo duermen en una condición común. 'pending' y
+ *   'sleepers' son seq_cst: un productor que incrementa 'pending' y ve
+ *   sleepers == 0 tiene garantizado que ningún worker se dormirá sin verla.
+ */
+#include "work_pool.h"
+#include "platform.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define DEQUE_INITIAL_CAPACITY 64
+
+typedef struct {
+	WorkFn fn;
+	void *arg;
+} WorkItem;
+
+typedef struct {
+	pthread_mutex_t lock;
+	WorkItem *items;
+	size_t capacity;      // Potencia de dos
+	size_t top;           // Próximo a robar
+	size_t bottom;        // Próximo slot libre del dueño
+	pthread_t thread;
+	struct WorkPool *pool;
+	unsigned index;
+} Worker;
+
+struct WorkPool {
+	Worker *workers;
+	unsigned count;
+	unsigned started;           // Hilos lanzados (<= count)
+	atomic_uint next_submit;
+	atomic_size_t pending;      // Tareas encoladas aún no tomadas
+	atomic_uint sleepers;
+	atomic_bool stop;
+	atomic_uint_fast64_t completed;
+	atomic_uint_fast64_t steals;
+	pthread_mutex_t sleep_lock;
+	pthread_cond_t wake;
+};
+
+static _Thread_local Worker *t_worker;
+
+/*
+ * deque_push
+ * ----------
+ * Apila por el fondo (crece al doble si está lleno).
+ */
+static int deque_push(Worker *w, WorkFn fn, void *arg) {
+	pthread_mutex_lock(&w->lock);
+	if (w->bottom - w->top == w->capacity) {
+		size_t capacity = w->capacity * 2;
+		WorkItem *items = malloc(capacity * sizeof(*items));
+		if (!items) {
+			pthread_mutex_unlock(&w->lock);
+			return PLATFORM_ENOMEM;
+		}
+		for (size_t i = w->top; i != w->bottom; i++)
+			items[i & (capacity - 1)] = w->items[i & (w->capacity - 1)];
+		free(w->items);
+		w->items = items;
+		w->capacity = capacity;
+	}
+	w->items[w->bottom & (w->capacity - 1)] = (WorkItem){ fn, arg };
+	w->bottom++;
+	pthread_mutex_unlock(&w->lock);
+	return PLATFORM_OK;
+}
+
+/*
+ * deque_take
+ * ----------
+ * Extrae por el fondo (dueño) o por el tope (ladrón). Retorna false si vacío.
+ */
+static bool deque_take(Worker *w, bool steal, WorkItem *out) {
+	pthread_mutex_lock(&w->lock);
+	bool ok = w->bottom != w->top;
+	if (ok) {
+		if (steal) {
+			*out = w->items[w->top & (w->capacity - 1)];
+			w->top++;
+		} else {
+			w->bottom--;
+			*out = w->items[w->bottom & (w->capacity - 1)];
+		}
+	}
+	pthread_mutex_unlock(&w->lock);
+	return ok;
+}
+
+/*
+ * find_work
+ * ---------
+ * Deque propio primero; luego roba recorriendo a los demás desde el vecino.
+ */
+static bool find_work(WorkPool *pool, Worker *self, WorkItem *out) {
+	if (deque_take(self, false, out)) return true;
+	for (unsigned i = 1; i < pool->count; i++) {
+		Worker *victim = &pool->workers[(self->index + i) % pool->count];
+		if (deque_take(victim, true, out)) {
+			atomic_fetch_add_explicit(&pool->steals, 1, memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * worker_main
+ * -----------
+ * Ejecuta tareas hasta que se pide parar y no queda nada pendiente.
+ */
+static void *worker_main(void *arg) {
+	Worker *self = (Worker *)arg;
+	WorkPool *pool = self->pool;
+	t_worker = self;
+	for (;;) {
+		WorkItem item;
+		if (find_work(pool, self, &item)) {
+			atomic_fetch_sub(&pool->pending, 1);
+			item.fn(item.arg);
+			atomic_fetch_add_explicit(&pool->completed, 1, memory_order_relaxed);
+			continue;
+		}
+		pthread_mutex_lock(&pool->sleep_lock);
+		atomic_fetch_add(&pool->sleepers, 1);
+		while (atomic_load(&pool->pending) == 0 && !atomic_load(&pool->stop))
+			pthread_cond_wait(&pool->wake, &pool->sleep_lock);
+		atomic_fetch_sub(&pool->sleepers, 1);
+		bool done = atomic_load(&pool->stop) && atomic_load(&pool->pending) == 0;
+		pthread_mutex_unlock(&pool->sleep_lock);
+		if (done) break;
+	}
+	t_worker = NULL;
+	return NULL;
+}
+
+/*
+ * work_pool_create
+ * ----------------
+ * Reserva los deques y lanza los hilos.
+ */
+WorkPool *work_pool_create(unsigned workers) {
+	if (workers == 0 || workers > WORK_POOL_MAX_WORKERS) return NULL;
+	WorkPool *pool = calloc(1, sizeof(WorkPool));
+	if (!pool) return NULL;
+	pool->workers = calloc(workers, sizeof(Worker));
+	if (!pool->workers) {
+		free(pool);
+		return NULL;
+	}
+	pool->count = workers;
+	pthread_mutex_init(&pool->sleep_lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	bool ok = true;
+	for (unsigned i = 0; i < workers; i++) {
+		Worker *w = &pool->workers[i];
+		pthread_mutex_init(&w->lock, NULL);
+		w->pool = pool;
+		w->index = i;
+		w->capacity = DEQUE_INITIAL_CAPACITY;
+		w->items = malloc(w->capacity * sizeof(WorkItem));
+		if (!w->items) ok = false;
+	}
+	for (unsigned i = 0; ok && i < workers; i++) {
+		if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) break;
+		pool->started++;
+	}
+	if (pool->started != workers) {
+		work_pool_destroy(pool); // Une los hilos ya lanzados
+		return NULL;
+	}
+	return pool;
+}
+
+/*
+ * work_pool_destroy
+ * -----------------
+ * Pide parar, despierta a todos y une los hilos; los workers vacían las
+ * tareas pendientes antes de salir.
+ */
+void work_pool_destroy(WorkPool *pool) {
+	if (!pool) return;
+	pthread_mutex_lock(&pool->sleep_lock);
+	atomic_store(&pool->stop, true);
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->sleep_lock);
+	for (unsigned i = 0; i < pool->started; i++) pthread_join(pool->workers[i].thread, NULL);
+	for (unsigned i = 0; i < pool->count; i++) {
+		free(pool->workers[i].items);
+		pthread_mutex_destroy(&pool->workers[i].lock);
+	}
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->sleep_lock);
+	free(pool->workers);
+	free(pool);
+}
+
+/*
+ * work_pool_submit
+ * ----------------
+ * Encola en el deque elegido y despierta a un worker si hay alguno dormido.
+ */
+int work_pool_submit(WorkPool *pool, WorkFn fn, void *arg) {
+	if (!pool || !fn) return PLATFORM_EINVAL;
+	Worker *w = t_worker;
+	if (!w || w->pool != pool) {
+		unsigned i = atomic_fetch_add_explicit(&pool->next_submit, 1, memory_order_relaxed);
+		w = &pool->workers[i % pool->count];
+	}
+	// 'pending' sube antes de publicar la tarea: nunca es menor que las
+	// tareas visibles en los deques
+	atomic_fetch_add(&pool->pending, 1);
+	int rc = deque_push(w, fn, arg);
+	if (rc != PLATFORM_OK) {
+		atomic_fetch_sub(&pool->pending, 1);
+		return rc;
+	}
+	if (atomic_load(&pool->sleepers) > 0) {
+		pthread_mutex_lock(&pool->sleep_lock);
+		pthread_cond_signal(&pool->wake);
+		pthread_mutex_unlock(&pool->sleep_lock);
+	}
+	return PLATFORM_OK;
+}
+
+unsigned work_pool_size(const WorkPool *pool) {
+	return pool ? pool->count : 0;
+}
+
+uint64_t work_pool_completed(const WorkPool *pool) {
+	return pool ? (uint64_t)atomic_load_explicit(&pool->completed, memory_order_relaxed) : 0;
+}
+
+uint64_t work_pool_steals(const WorkPool *pool) {
+	return pool ? (uint64_t)atomic_load_explicit(&pool->steals, memory_order_relaxed) : 0;
+}
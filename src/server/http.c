@@ -0,0 +1,620 @@
+/*
+ * http.c — Listener HTTP/1.1 de sólo lectura sobre el EventLoop del servidor.
+ *
+ * Responsabilidades
+ * - Exponer /metrics en formato de texto de Prometheus para scraping.
+ * - Exponer consultas de sólo lectura (/api/v1/telemetry, /api/v1/status,
+ *   /api/v1/health) en JSON para dashboards (p. ej. Grafana).
+ *
+ * Diseño
+ * - Mismo EventLoop y mismo hilo que el socket UDP: sin hilo por conexión.
+ *   Sockets no bloqueantes; keep-alive y pipelining de HTTP/1.1.
+ * - Trabajo acotado por callback para no agregar latencia a la ingesta UDP:
+ *   una sola lectura (<= HTTP_REQUEST_MAX bytes) y a lo sumo
+ *   HTTP_MAX_REQUESTS_PER_EVENT requests por evento; si quedan requests en el
+ *   buffer se espera a la siguiente vuelta del loop (interés de escritura).
+ * - Tabla fija de HTTP_MAX_CONNECTIONS; las conexiones extra se cierran.
+ * - Con HTTP_OUT_BACKLOG_MAX bytes sin enviar se deja de leer y de atender
+ *   requests (backpressure de TCP): pipelining sin leer no acumula memoria.
+ * - Un timer de barrido cierra conexiones ociosas (HTTP_IDLE_TIMEOUT_MS) o
+ *   con una cabecera incompleta por más de HTTP_HEADER_TIMEOUT_MS, para que
+ *   clientes lentos o abandonados no ocupen la tabla.
+ * - Sólo GET/HEAD sin cuerpo; cualquier otra cosa responde 4xx y cierra.
+ */
+#include "http.h"
+#include "platform.h"
+#include "metrics.h"
+#include "telemetry_storage.h"
+#include "time_source.h"
+#include "ratelimit.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Cuerpo máximo: arreglo completo de telemetría o exposición de métricas
+#define HTTP_BODY_MAX (TELEMETRY_MAX_ENTRIES * (TELEMETRY_MAX_JSON_SIZE + 48) + 64)
+#define HTTP_HEADER_MAX 512
+// Respuestas encoladas sin enviar a partir de las cuales no se lee más
+#define HTTP_OUT_BACKLOG_MAX HTTP_BODY_MAX
+#define HTTP_SWEEP_MS 500
+
+typedef struct HttpConn {
+    HttpServer *owner;
+    int fd;                 // -1 => slot libre
+    bool close_after;       // Cerrar al terminar de enviar
+    EventType interest;     // Eventos registrados en el loop
+    uint64_t active_ms;     // Última lectura/escritura con progreso
+    uint64_t request_ms;    // Inicio de la request parcial en 'in'
+    size_t in_len;
+    char in[HTTP_REQUEST_MAX];
+    char *out;              // Respuestas pendientes de envío
+    size_t out_len;
+    size_t out_off;
+    size_t out_cap;
+} HttpConn;
+
+struct HttpServer {
+    EventLoop *loop;
+    int listen_fd;
+    int sweep_timer;
+    uint16_t port;
+    bool verbose;
+    char *body;                                   // Scratch de cuerpos (un solo hilo)
+    TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
+    HttpConn conns[HTTP_MAX_CONNECTIONS];
+};
+
+typedef struct {
+    char method[8];
+    char path[128];
+    char query[128];
+    bool http10;
+    bool conn_close;
+    bool conn_keep_alive;
+    bool has_body;
+    char if_none_match[32];
+} HttpRequest;
+
+typedef struct {
+    int status;
+    const char *content_type;
+    size_t body_len;
+    char etag[24];          // Vacío => sin ETag
+} HttpResult;
+
+/*
+ * find_header_end
+ * ---------------
+ * Retorna la longitud de la cabecera (incluyendo "\r\n\r\n") o 0 si aún no
+ * está completa.
+ */
+static size_t find_header_end(const char *buf, size_t len) {
+    for (size_t i = 3; i < len; i++) {
+        if (buf[i] == '\n' && buf[i - 1] == '\r' && buf[i - 2] == '\n' && buf[i - 3] == '\r') {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Copia [src, src+len) como string acotado; falla si no cabe
+static bool copy_token(char *dst, size_t dst_size, const char *src, size_t len) {
+    if (len >= dst_size) return false;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+    return true;
+}
+
+static bool value_equals(const char *v, size_t len, const char *token) {
+    return strlen(token) == len && strncasecmp(v, token, len) == 0;
+}
+
+/*
+ * parse_request
+ * -------------
+ * Parsea línea de request y headers relevantes (Connection, If-None-Match,
+ * Content-Length, Transfer-Encoding). Retorna 0 o -1 si está mal formada.
+ */
+static int parse_request(const char *buf, size_t hdr_len, HttpRequest *req) {
+    memset(req, 0, sizeof(*req));
+    const char *end = buf + hdr_len;
+    const char *eol = memchr(buf, '\r', hdr_len);
+    if (!eol) return -1;
+
+    // METHOD SP target SP HTTP/1.x
+    const char *sp1 = memchr(buf, ' ', (size_t)(eol - buf));
+    if (!sp1) return -1;
+    const char *sp2 = memchr(sp1 + 1, ' ', (size_t)(eol - sp1 - 1));
+    if (!sp2) return -1;
+    if (!copy_token(req->method, sizeof(req->method), buf, (size_t)(sp1 - buf))) return -1;
+
+    const char *target = sp1 + 1;
+    const char *q = memchr(target, '?', (size_t)(sp2 - target));
+    const char *path_end = q ? q : sp2;
+    if (!copy_token(req->path, sizeof(req->path), target, (size_t)(path_end - target))) return -1;
+    if (q && !copy_token(req->query, sizeof(req->query), q + 1, (size_t)(sp2 - q - 1))) return -1;
+
+    size_t vlen = (size_t)(eol - sp2 - 1);
+    if (vlen != 8 || strncmp(sp2 + 1, "HTTP/1.", 7) != 0) return -1;
+    req->http10 = sp2[8] == '0';
+
+    // Headers
+    const char *line = eol + 2;
+    while (line < end) {
+        const char *le = line;
+        while (le < end && *le != '\r') le++;
+        if (le == line) break; // línea vacía: fin de headers
+        const char *colon = memchr(line, ':', (size_t)(le - line));
+        if (colon) {
+            size_t nlen = (size_t)(colon - line);
+            const char *v = colon + 1;
+            while (v < le && (*v == ' ' || *v == '\t')) v++;
+            size_t len = (size_t)(le - v);
+            while (len > 0 && (v[len - 1] == ' ' || v[len - 1] == '\t')) len--;
+
+            if (value_equals(line, nlen, "Connection")) {
+                if (value_equals(v, len, "close")) req->conn_close = true;
+                if (value_equals(v, len, "keep-alive")) req->conn_keep_alive = true;
+            } else if (value_equals(line, nlen, "If-None-Match")) {
+                (void)copy_token(req->if_none_match, sizeof(req->if_none_match), v, len);
+            } else if (value_equals(line, nlen, "Content-Length")) {
+                if (!(len == 1 && v[0] == '0')) req->has_body = true;
+            } else if (value_equals(line, nlen, "Transfer-Encoding")) {
+                req->has_body = true;
+            }
+        }
+        line = le + 2;
+    }
+    return 0;
+}
+
+/*
+ * query_u64
+ * ---------
+ * Busca 'key=N' en la query string. Retorna true y el valor si existe.
+ */
+static bool query_u64(const char *query, const char *key, uint64_t *out) {
+    size_t klen = strlen(key);
+    const char *p = query;
+    while (p && *p) {
+        if (strncmp(p, key, klen) == 0 && p[klen] == '=') {
+            char *endp = NULL;
+            unsigned long long v = strtoull(p + klen + 1, &endp, 10);
+            if (endp == p + klen + 1) return false;
+            *out = (uint64_t)v;
+            return true;
+        }
+        p = strchr(p, '&');
+        if (p) p++;
+    }
+    return false;
+}
+
+static void set_text(HttpServer *http, HttpResult *res, int status, const char *json) {
+    size_t len = strlen(json);
+    memcpy(http->body, json, len);
+    res->status = status;
+    res->content_type = "application/json";
+    res->body_len = len;
+}
+
+/*
+ * route_telemetry
+ * ---------------
+ * GET /api/v1/telemetry[?since=MS][&limit=N] — entradas con timestamp > since
+ * (las 'limit' más recientes). ETag = generación del snapshot; If-None-Match
+ * igual => 304. Sin snapshot consistente (clears continuos) => 503.
+ */
+static void route_telemetry(HttpServer *http, const HttpRequest *req, HttpResult *res) {
+    TelemetrySnapshot snap;
+    size_t count = telemetry_storage_snapshot(http->entries, TELEMETRY_MAX_ENTRIES, &snap);
+    if (!snap.consistent) {
+        set_text(http, res, 503, "{\"error\":\"storage busy\"}");
+        return;
+    }
+    snprintf(res->etag, sizeof(res->etag), "\"%llx\"", (unsigned long long)snap.generation);
+    if (req->if_none_match[0] &&
+        (strcmp(req->if_none_match, res->etag) == 0 || strcmp(req->if_none_match, "*") == 0)) {
+        res->status = 304;
+        return;
+    }
+
+    uint64_t since = 0, limit = 0;
+    (void)query_u64(req->query, "since", &since);
+    (void)query_u64(req->query, "limit", &limit);
+
+    size_t first = 0;
+    while (first < count && http->entries[first].timestamp_ms <= since) first++;
+    if (limit > 0 && count - first > limit) first = count - (size_t)limit;
+
+    size_t pos = 0;
+    http->body[pos++] = '[';
+    for (size_t i = first; i < count; i++) {
+        const TelemetryEntry *e = &http->entries[i];
+        int n = snprintf(http->body + pos, HTTP_BODY_MAX - pos, "%s{\"data\":%.*s,\"timestamp\":%llu}",
+                         i == first ? "" : ",", (int)e->json_length, e->json,
+                         (unsigned long long)e->timestamp_ms);
+        if (n < 0 || (size_t)n >= HTTP_BODY_MAX - pos - 1) {
+            res->etag[0] = '\0';
+            set_text(http, res, 500, "{\"error\":\"serialization error\"}");
+            return;
+        }
+        pos += (size_t)n;
+    }
+    http->body[pos++] = ']';
+    res->status = 200;
+    res->content_type = "application/json";
+    res->body_len = pos;
+}
+
+/*
+ * route_request
+ * -------------
+ * Resuelve la ruta y deja el cuerpo en http->body.
+ */
+static void route_request(HttpServer *http, const HttpRequest *req, HttpResult *res) {
+    memset(res, 0, sizeof(*res));
+    if (strcmp(req->path, "/metrics") == 0) {
+        int n = metrics_format_prometheus(http->body, HTTP_BODY_MAX);
+        if (n < 0) {
+            set_text(http, res, 500, "{\"error\":\"serialization error\"}");
+            return;
+        }
+        res->status = 200;
+        res->content_type = "text/plain; version=0.0.4; charset=utf-8";
+        res->body_len = (size_t)n;
+    } else if (strcmp(req->path, "/api/v1/telemetry") == 0) {
+        route_telemetry(http, req, res);
+    } else if (strcmp(req->path, "/api/v1/status") == 0) {
+        TelemetrySnapshot snap;
+        telemetry_storage_snapshot(NULL, 0, &snap);
+        char offenders[512];
+        if (ratelimit_format_offenders(offenders, sizeof(offenders)) < 0) offenders[0] = '\0';
+        int n = snprintf(http->body, HTTP_BODY_MAX,
+                         "{\"uptime_ms\":%llu,\"telemetry_received\":%zu,"
+                         "\"telemetry_stored\":%zu,\"capacity\":%zu,\"rate_limited\":%s}",
+                         (unsigned long long)time_source_now_ms(),
+                         snap.stats.total_received, snap.stats.current_count,
+                         snap.stats.capacity, offenders[0] ? offenders : "[]");
+        res->status = 200;
+        res->content_type = "application/json";
+        res->body_len = (size_t)n;
+    } else if (strcmp(req->path, "/api/v1/health") == 0) {
+        set_text(http, res, 200, "{\"status\":\"ok\",\"service\":\"TeleServer\"}");
+    } else {
+        set_text(http, res, 404, "{\"error\":\"not found\"}");
+    }
+}
+
+static const char *status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+/*
+ * conn_append_response
+ * --------------------
+ * Agrega status line, headers y (salvo HEAD/304) el cuerpo al buffer de
+ * salida de la conexión. Retorna false si no hay memoria.
+ */
+static bool conn_append_response(HttpConn *c, const HttpResult *res, bool head_only) {
+    HttpServer *http = c->owner;
+    bool send_body = !head_only && res->status != 304;
+
+    char hdr[HTTP_HEADER_MAX];
+    char length[80] = "";
+    if (res->status != 304) {
+        snprintf(length, sizeof(length), "Content-Type: %s\r\nContent-Length: %zu\r\n",
+                 res->content_type ? res->content_type : "application/json", res->body_len);
+    }
+    int n = snprintf(hdr, sizeof(hdr),
+                     "HTTP/1.1 %d %s\r\n"
+                     "Server: TeleServer\r\n"
+                     "%s%s%s"
+                     "%s%s"
+                     "Connection: %s\r\n\r\n",
+                     res->status, status_text(res->status),
+                     res->etag[0] ? "ETag: " : "", res->etag, res->etag[0] ? "\r\n" : "",
+                     res->status == 405 ? "Allow: GET, HEAD\r\n" : "", length,
+                     c->close_after ? "close" : "keep-alive");
+    if (n < 0 || (size_t)n >= sizeof(hdr)) return false;
+
+    size_t need = c->out_len + (size_t)n + (send_body ? res->body_len : 0);
+    if (need > c->out_cap) {
+        char *p = (char *)realloc(c->out, need);
+        if (!p) return false;
+        c->out = p;
+        c->out_cap = need;
+    }
+    memcpy(c->out + c->out_len, hdr, (size_t)n);
+    c->out_len += (size_t)n;
+    if (send_body) {
+        memcpy(c->out + c->out_len, http->body, res->body_len);
+        c->out_len += res->body_len;
+    }
+    return true;
+}
+
+static void conn_close(HttpConn *c) {
+    if (c->fd < 0) return;
+    (void)event_loop_remove_fd(c->owner->loop, c->fd);
+    platform_socket_close(c->fd);
+    c->fd = -1;
+    c->in_len = 0;
+    c->out_len = c->out_off = 0;
+    c->close_after = false;
+    c->interest = EVENT_READ;
+    // Liberar el buffer de salida acota la memoria de conexiones ociosas
+    free(c->out);
+    c->out = NULL;
+    c->out_cap = 0;
+}
+
+/*
+ * conn_process_input
+ * ------------------
+ * Atiende hasta HTTP_MAX_REQUESTS_PER_EVENT requests completas del buffer de
+ * entrada, encolando sus respuestas. Retorna false si la conexión se cerró.
+ */
+static bool conn_backlogged(const HttpConn *c) {
+    return c->out_len - c->out_off >= HTTP_OUT_BACKLOG_MAX;
+}
+
+static bool conn_process_input(HttpConn *c) {
+    HttpServer *http = c->owner;
+    for (int i = 0; i < HTTP_MAX_REQUESTS_PER_EVENT && !c->close_after; i++) {
+        if (conn_backlogged(c)) break; // retomar cuando el cliente lea
+        size_t hdr_len = find_header_end(c->in, c->in_len);
+        HttpResult res;
+        bool head_only = false;
+
+        if (hdr_len == 0) {
+            if (c->in_len < HTTP_REQUEST_MAX) break; // esperar más datos
+            memset(&res, 0, sizeof(res));
+            set_text(http, &res, 431, "{\"error\":\"request too large\"}");
+            c->close_after = true;
+            hdr_len = c->in_len;
+        } else {
+            HttpRequest req;
+            if (parse_request(c->in, hdr_len, &req) != 0) {
+                memset(&res, 0, sizeof(res));
+                set_text(http, &res, 400, "{\"error\":\"bad request\"}");
+                c->close_after = true;
+            } else if (req.has_body) {
+                // API de sólo lectura: no se aceptan cuerpos
+                memset(&res, 0, sizeof(res));
+                set_text(http, &res, 400, "{\"error\":\"request body not supported\"}");
+                c->close_after = true;
+            } else if (strcmp(req.method, "GET") != 0 && strcmp(req.method, "HEAD") != 0) {
+                memset(&res, 0, sizeof(res));
+                set_text(http, &res, 405, "{\"error\":\"method not allowed\"}");
+            } else {
+                head_only = strcmp(req.method, "HEAD") == 0;
+                route_request(http, &req, &res);
+            }
+            if (req.conn_close || (req.http10 && !req.conn_keep_alive)) c->close_after = true;
+            if (http->verbose) {
+                LOG_INFO("http: %s %s -> %d\n", req.method, req.path, res.status);
+            }
+        }
+
+        if (!conn_append_response(c, &res, head_only)) {
+            conn_close(c);
+            return false;
+        }
+        memmove(c->in, c->in + hdr_len, c->in_len - hdr_len);
+        c->in_len -= hdr_len;
+        c->request_ms = time_source_now_ms();
+    }
+    return true;
+}
+
+/*
+ * conn_flush
+ * ----------
+ * Envía lo pendiente sin bloquear y ajusta el interés en el loop: se
+ * mantiene EVENT_WRITE mientras haya bytes por enviar o requests completas
+ * sin atender (para retomarlas en la próxima vuelta del loop), y se quita
+ * EVENT_READ mientras el backlog de salida supere HTTP_OUT_BACKLOG_MAX.
+ */
+static void conn_flush(HttpConn *c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = platform_socket_send(c->fd, c->out + c->out_off, c->out_len - c->out_off);
+        if (n == PLATFORM_EAGAIN) break;
+        if (n <= 0) { conn_close(c); return; }
+        c->out_off += (size_t)n;
+        c->active_ms = time_source_now_ms();
+    }
+    bool pending = c->out_off < c->out_len;
+    if (!pending) {
+        c->out_len = c->out_off = 0;
+        if (c->close_after) { conn_close(c); return; }
+    }
+
+    bool more = pending || (!c->close_after && find_header_end(c->in, c->in_len) > 0);
+    EventType ev = (EventType)((conn_backlogged(c) ? 0 : EVENT_READ) | (more ? EVENT_WRITE : 0));
+    if (ev != c->interest) {
+        if (event_loop_modify_fd(c->owner->loop, c->fd, ev) != PLATFORM_OK) {
+            conn_close(c);
+            return;
+        }
+        c->interest = ev;
+    }
+}
+
+/*
+ * on_conn_event
+ * -------------
+ * Callback de una conexión: una lectura acotada, atención de requests y envío.
+ */
+static void on_conn_event(int fd, EventType events, void *user_data) {
+    HttpConn *c = (HttpConn *)user_data;
+    if (!c || c->fd != fd) return;
+    if (events & EVENT_ERROR) { conn_close(c); return; }
+
+    if (events & EVENT_READ) {
+        if (c->close_after) {
+            // Respuesta final en curso: descartar lo que siga llegando
+            char discard[512];
+            ssize_t n = platform_socket_recv(fd, discard, sizeof(discard));
+            if (n == 0 || n == PLATFORM_ERROR) { conn_close(c); return; }
+        } else if (c->in_len < HTTP_REQUEST_MAX) {
+            ssize_t n = platform_socket_recv(fd, c->in + c->in_len, HTTP_REQUEST_MAX - c->in_len);
+            if (n == 0 || n == PLATFORM_ERROR) { conn_close(c); return; }
+            if (n > 0) {
+                c->active_ms = time_source_now_ms();
+                if (c->in_len == 0) c->request_ms = c->active_ms;
+                c->in_len += (size_t)n;
+            }
+        }
+    }
+
+    if (!conn_process_input(c)) return;
+    conn_flush(c);
+}
+
+/*
+ * on_sweep
+ * --------
+ * Timer periódico: cierra conexiones con una cabecera incompleta desde hace
+ * HTTP_HEADER_TIMEOUT_MS o sin progreso en HTTP_IDLE_TIMEOUT_MS.
+ */
+static void on_sweep(void *user_data) {
+    HttpServer *http = (HttpServer *)user_data;
+    uint64_t now = time_source_now_ms();
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        HttpConn *c = &http->conns[i];
+        if (c->fd < 0) continue;
+        bool partial = c->in_len > 0 && !c->close_after && find_header_end(c->in, c->in_len) == 0;
+        if (partial && now - c->request_ms >= HTTP_HEADER_TIMEOUT_MS) {
+            if (http->verbose) LOG_WARN("http: header timeout, closing fd %d\n", c->fd);
+            conn_close(c);
+        } else if (now - c->active_ms >= HTTP_IDLE_TIMEOUT_MS) {
+            if (http->verbose) LOG_INFO("http: idle timeout, closing fd %d\n", c->fd);
+            conn_close(c);
+        }
+    }
+}
+
+/*
+ * on_accept
+ * ---------
+ * Acepta conexiones pendientes y las registra en el loop. Sin slots libres,
+ * la conexión se cierra inmediatamente.
+ */
+static void on_accept(int fd, EventType events, void *user_data) {
+    (void)events;
+    HttpServer *http = (HttpServer *)user_data;
+    if (!http || fd != http->listen_fd) return;
+
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        int cfd = platform_socket_accept(http->listen_fd);
+        if (cfd < 0) break;
+
+        HttpConn *c = NULL;
+        for (int k = 0; k < HTTP_MAX_CONNECTIONS; k++) {
+            if (http->conns[k].fd < 0) { c = &http->conns[k]; break; }
+        }
+        if (!c) {
+            if (http->verbose) LOG_WARN("http: connection limit reached, closing fd %d\n", cfd);
+            platform_socket_close(cfd);
+            continue;
+        }
+        if (event_loop_add_fd(http->loop, cfd, EVENT_READ, on_conn_event, c) != PLATFORM_OK) {
+            platform_socket_close(cfd);
+            continue;
+        }
+        c->fd = cfd;
+        c->interest = EVENT_READ;
+        c->active_ms = c->request_ms = time_source_now_ms();
+    }
+}
+
+/*
+ * http_server_create
+ * ------------------
+ * Crea el socket TCP de escucha (SO_REUSEADDR, O_NONBLOCK), lo enlaza al
+ * puerto y lo registra en el loop junto con el timer de barrido.
+ */
+HttpServer *http_server_create(EventLoop *loop, uint16_t port, bool verbose) {
+    if (!loop) return NULL;
+    HttpServer *http = (HttpServer *)calloc(1, sizeof(HttpServer));
+    if (!http) return NULL;
+    http->body = (char *)malloc(HTTP_BODY_MAX);
+    if (!http->body) { free(http); return NULL; }
+    http->loop = loop;
+    http->verbose = verbose;
+    http->sweep_timer = -1;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        http->conns[i].owner = http;
+        http->conns[i].fd = -1;
+    }
+
+    int sock = platform_socket_create_tcp();
+    if (sock < 0) goto fail;
+    if (platform_socket_set_reuseaddr(sock) != PLATFORM_OK ||
+        platform_socket_set_nonblocking(sock) != PLATFORM_OK ||
+        platform_socket_bind(sock, port) != PLATFORM_OK ||
+        platform_socket_listen(sock, SOCKET_BACKLOG) != PLATFORM_OK) {
+        platform_socket_close(sock);
+        goto fail;
+    }
+
+    struct sockaddr_in addr;
+    socklen_t len = (socklen_t)sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    if (getsockname(sock, (struct sockaddr *)&addr, &len) == 0) {
+        http->port = ntohs(addr.sin_port);
+    }
+
+    if (event_loop_add_fd(loop, sock, EVENT_READ, on_accept, http) != PLATFORM_OK) {
+        platform_socket_close(sock);
+        goto fail;
+    }
+    http->listen_fd = sock;
+    http->sweep_timer = event_loop_add_timer(loop, HTTP_SWEEP_MS, true, on_sweep, http);
+    if (http->sweep_timer < 0) {
+        (void)event_loop_remove_fd(loop, sock);
+        platform_socket_close(sock);
+        goto fail;
+    }
+    return http;
+
+fail:
+    free(http->body);
+    free(http);
+    return NULL;
+}
+
+/*
+ * http_server_destroy
+ * -------------------
+ * Cierra conexiones abiertas y el socket de escucha, y libera memoria.
+ */
+void http_server_destroy(HttpServer *http) {
+    if (!http) return;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++) conn_close(&http->conns[i]);
+    if (http->sweep_timer > 0) event_loop_remove_timer(http->loop, http->sweep_timer);
+    (void)event_loop_remove_fd(http->loop, http->listen_fd);
+    platform_socket_close(http->listen_fd);
+    free(http->body);
+    free(http);
+}
+
+uint16_t http_server_get_port(const HttpServer *http) {
+    return http ? http->port : 0;
+}
@@ -5,7 +5,17 @@
  * - Parseo mínimo de argumentos de línea de comandos:
  *   --port N    Puerto UDP (por defecto 5683; 0 => efímero)
  *   --verbose   Habilita logging INFO y logs de CoAP RX/TX
- * - Inicializa plataforma y almacenamiento de telemetría.
+ *   --storage-sharded  Storage de telemetría con un shard por hilo productor
+ *   --http-port N  Listener HTTP (métricas Prometheus y consultas); 0 => efímero
+ *   --busy-poll US  Gira US µs sin tráfico sobre el socket antes de dormir
+ *   --workers N  Pool de N workers para rutas costosas (GET de telemetría,
+ *                métricas); 0 => todo en el hilo de I/O
+ *   --rate-limit R[:B]  Admisión por peer: R datagramas/s con ráfaga B
+ *   --overload MS[:N]  Descarte por prioridad con lag del loop >= MS ms o
+ *                      backlog >= N datagramas por despertar
+ *   --rx-budget N[:US]  Presupuesto por despertar del socket: N datagramas
+ *                       o US µs (0 = sin límite; por defecto 256:1000)
+ * - Inicializa plataforma, logging asíncrono y almacenamiento de telemetría.
  * - Crea el servidor y ejecuta el EventLoop hasta ser terminado externamente.
  */
 #include <stdio.h>
@@ -18,6 +28,7 @@
 #include "platform.h"
 #include "log.h"
 #include "telemetry_storage.h"
+#include "work_pool.h"
 
 /*
  * usage
@@ -25,7 +36,7 @@
  * Imprime la ayuda de línea de comandos.
  */
 static void usage(const char *prog) {
-    fprintf(stderr, "Usage: %s [--port N] [--verbose]\n", prog);
+    fprintf(stderr, "Usage: %s [--port N] [--verbose] [--storage-sharded] [--http-port N] [--busy-poll US] [--workers N] [--rate-limit R[:B]] [--overload MS[:N]] [--rx-budget N[:US]]\n", prog);
 }
 
 /*
@@ -42,10 +53,22 @@ static void usage(const char *prog) {
 int main(int argc, char *argv[]) {
     uint16_t port = 5683;
     bool verbose = false;
+    TelemetryStorageMode storage_mode = TELEMETRY_MODE_SHARED;
+    int http_port = -1; // deshabilitado
+    long busy_poll_us = 0; // deshabilitado
+    long workers = 0;      // todo inline
+    long rate_limit = 0;   // sin admisión por peer
+    long rate_burst = 0;   // 0 => igual a rate_limit
+    long overload_lag_ms = 0;  // sin control de sobrecarga
+    long overload_backlog = 0; // 0 => valor por defecto
+    long rx_budget = -1;       // -1 => presupuesto por defecto del servidor
+    long rx_budget_us = 0;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--verbose") == 0) {
             verbose = true;
+        } else if (strcmp(argv[i], "--storage-sharded") == 0) {
+            storage_mode = TELEMETRY_MODE_SHARDED;
         } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
             int p = atoi(argv[++i]);
             if (p < 0 || p > 65535) {
@@ -53,6 +76,51 @@ int main(int argc, char *argv[]) {
                 return EXIT_FAILURE;
             }
             port = (uint16_t)p;
+        } else if (strcmp(argv[i], "--http-port") == 0 && i + 1 < argc) {
+            http_port = atoi(argv[++i]);
+            if (http_port < 0 || http_port > 65535) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--busy-poll") == 0 && i + 1 < argc) {
+            busy_poll_us = atol(argv[++i]);
+            if (busy_poll_us <= 0 || busy_poll_us > 1000000) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = atol(argv[++i]);
+            if (workers < 0 || workers > WORK_POOL_MAX_WORKERS) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--rate-limit") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            rate_limit = strtol(argv[++i], &end, 10);
+            if (end && *end == ':') rate_burst = strtol(end + 1, &end, 10);
+            if (!end || *end != '\0' || rate_limit <= 0 || rate_limit > 1000000 ||
+                rate_burst < 0 || rate_burst > 1000000) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--overload") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            overload_lag_ms = strtol(argv[++i], &end, 10);
+            if (end && *end == ':') overload_backlog = strtol(end + 1, &end, 10);
+            if (!end || *end != '\0' || overload_lag_ms <= 0 || overload_lag_ms > 60000 ||
+                overload_backlog < 0 || overload_backlog > 1000000) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--rx-budget") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            rx_budget = strtol(argv[++i], &end, 10);
+            if (end && *end == ':') rx_budget_us = strtol(end + 1, &end, 10);
+            if (!end || *end != '\0' || rx_budget < 0 || rx_budget > 1000000 ||
+                rx_budget_us < 0 || rx_budget_us > 1000000) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
         } else {
             usage(argv[0]);
             return EXIT_FAILURE;
@@ -60,16 +128,58 @@ int main(int argc, char *argv[]) {
     }
 
     platform_init();
-    telemetry_storage_init();
+    // Logging asíncrono: el formateo y la escritura salen del hot path
+    if (log_start_async() != 0) {
+        LOG_WARN("async logger unavailable, logging synchronously\n");
+    }
+    telemetry_storage_init_mode(storage_mode);
 
     Server *srv = server_create(port, verbose);
     if (!srv) {
         fprintf(stderr, "Failed to create server on port %u\n", (unsigned)port);
+        log_stop_async();
+        return EXIT_FAILURE;
+    }
+
+    if (http_port >= 0 && server_enable_http(srv, (uint16_t)http_port) != PLATFORM_OK) {
+        fprintf(stderr, "Failed to start HTTP listener on port %d\n", http_port);
+        server_destroy(srv);
+        log_stop_async();
+        return EXIT_FAILURE;
+    }
+
+    if (busy_poll_us > 0) (void)server_set_busy_poll(srv, (uint32_t)busy_poll_us);
+
+    if (workers > 0 && server_set_workers(srv, (unsigned)workers) != PLATFORM_OK) {
+        fprintf(stderr, "Failed to start %ld workers\n", workers);
+        server_destroy(srv);
+        log_stop_async();
         return EXIT_FAILURE;
     }
 
+    if (rate_limit > 0 &&
+        server_set_rate_limit(srv, (uint32_t)rate_limit, (uint32_t)rate_burst) != PLATFORM_OK) {
+        fprintf(stderr, "Failed to enable rate limiting\n");
+        server_destroy(srv);
+        log_stop_async();
+        return EXIT_FAILURE;
+    }
+
+    if (overload_lag_ms > 0 &&
+        server_set_overload(srv, (uint32_t)overload_lag_ms, (uint32_t)overload_backlog) != PLATFORM_OK) {
+        fprintf(stderr, "Failed to enable overload control\n");
+        server_destroy(srv);
+        log_stop_async();
+        return EXIT_FAILURE;
+    }
+
+    if (rx_budget >= 0) (void)server_set_rx_budget(srv, (uint32_t)rx_budget, (uint32_t)rx_budget_us);
+
     if (verbose) {
         LOG_INFO("TeleServer running on UDP/%u\n", (unsigned)server_get_port(srv));
+        if (http_port >= 0) {
+            LOG_INFO("HTTP listener on TCP/%u\n", (unsigned)server_get_http_port(srv));
+        }
     }
 
     // Ejecutar hasta que el proceso sea terminado externamente
@@ -77,5 +187,6 @@ int main(int argc, char *argv[]) {
 
     server_destroy(srv);
     platform_cleanup();
+    log_stop_async();
     return EXIT_SUCCESS;
 }
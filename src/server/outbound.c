@@ -0,0 +1,659 @@
+/*
+ * outbound.c — Transmisión confiable de CON originados por el servidor.
+ *
+ * Estructuras
+ * - Tabla de peers (hash por familia/dirección/puerto, encadenada y creciente):
+ *   RTO CoCoA, contador de message IDs, cola NSTART y token bucket de pacing.
+ * - Tabla de mensajes (hash por peer + MID): localiza en O(1) el CON que
+ *   cierra un ACK/RST entrante, con miles de mensajes en vuelo.
+ * - Timers: cada CON en vuelo tiene un timer en el heap del event loop
+ *   (armar O(log n), cancelar O(1)); no hace falta una rueda propia.
+ *
+ * CoCoA (draft-ietf-core-cocoa)
+ * - Estimador fuerte (K=4): ACK sin retransmisiones. Débil (K=1): ACK tras 1 o
+ *   2 retransmisiones, RTT medido desde la primera transmisión.
+ * - RTO = 0.5*E_fuerte + 0.5*RTO, o 0.25*E_débil + 0.75*RTO.
+ * - Backoff variable según el RTO inicial del intercambio: x3 si < 1 s, x2
+ *   hasta 3 s, x1.5 por encima.
+ * - Envejecimiento: sin actualizaciones en 30 s, un RTO < 1 s se duplica y uno
+ *   > 3 s se acerca a ACK_TIMEOUT.
+ */
+#include "coap_outbound.h"
+#include "platform.h"
+#include "metrics.h"
+#include "clock.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#define OUTBOUND_INITIAL_BUCKETS 64
+#define OUTBOUND_RTO_MIN_MS 10
+#define OUTBOUND_RTO_MAX_MS 60000
+#define OUTBOUND_RTO_AGING_MS 30000
+// Peers sin mensajes pendientes ni uso en este tiempo se liberan
+#define OUTBOUND_PEER_IDLE_MS 300000
+#define OUTBOUND_SWEEP_MS 30000
+
+typedef struct OutboundPeer OutboundPeer;
+
+typedef struct OutboundMsg {
+    CoapOutbound *ob;
+    struct OutboundMsg *hnext;  // Cadena en la tabla de mensajes
+    struct OutboundMsg *qnext;  // Cola de espera del peer
+    OutboundPeer *peer;
+    uint16_t mid;
+    bool inflight;
+    unsigned retransmits;
+    uint32_t timeout_ms;
+    uint32_t backoff_pct;       // Factor de backoff variable (CoCoA)
+    uint64_t first_sent_ns;
+    int timer_id;
+    OutboundDone done;
+    void *user_data;
+    size_t len;
+    uint8_t wire[];
+} OutboundMsg;
+
+struct OutboundPeer {
+    OutboundPeer *hnext;
+    CoapOutbound *ob;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    uint64_t hash;
+    uint16_t next_mid;
+    unsigned inflight;
+    OutboundMsg *queue_head, *queue_tail;
+    size_t queued;
+    // CoCoA (µs)
+    uint32_t rto_ms;
+    uint64_t srtt_strong_us, rttvar_strong_us;
+    uint64_t srtt_weak_us, rttvar_weak_us;
+    bool strong_init, weak_init;
+    uint64_t rto_updated_ns;
+    // Pacing (milésimas de ficha)
+    uint64_t tokens_milli;
+    uint64_t tokens_ns;
+    int pace_timer;
+    uint64_t last_active_ns;
+};
+
+struct CoapOutbound {
+    EventLoop *loop;
+    int sock;
+    OutboundConfig cfg;
+    OutboundPeer **peers;
+    size_t peer_buckets;
+    size_t peer_count;
+    OutboundMsg **msgs;
+    size_t msg_buckets;
+    size_t msg_count;
+    size_t inflight;
+    size_t queued;
+    uint32_t rng;
+    int sweep_timer;
+};
+
+/*
+ * coap_outbound_config_default
+ * ----------------------------
+ * Parámetros de RFC 7252 y pacing conservador por peer.
+ */
+void coap_outbound_config_default(OutboundConfig *cfg) {
+    if (!cfg) return;
+    cfg->ack_timeout_ms = COAP_ACK_TIMEOUT_MS;
+    cfg->ack_random_pct = COAP_ACK_RANDOM_FACTOR_PCT;
+    cfg->max_retransmit = COAP_MAX_RETRANSMIT;
+    cfg->nstart = 1;
+    cfg->max_queue = 64;
+    cfg->pace_rate = 100;
+    cfg->pace_burst = 20;
+}
+
+/*
+ * mix64
+ * -----
+ * Finalizador de splitmix64: dispersa claves para las tablas hash.
+ */
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/*
+ * peer_key_hash / peer_key_equal
+ * ------------------------------
+ * Clave de peer: familia, dirección y puerto (IPv4/IPv6).
+ */
+static uint64_t peer_key_hash(const struct sockaddr *sa) {
+    if (sa->sa_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)sa;
+        return mix64(((uint64_t)in->sin_addr.s_addr << 16) ^ in->sin_port);
+    }
+    const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)sa;
+    uint64_t lo, hi;
+    memcpy(&lo, &in6->sin6_addr, 8);
+    memcpy(&hi, (const uint8_t *)&in6->sin6_addr + 8, 8);
+    return mix64(lo ^ mix64(hi ^ in6->sin6_port));
+}
+
+static bool peer_key_equal(const struct sockaddr *a, const struct sockaddr *b) {
+    if (a->sa_family != b->sa_family) return false;
+    if (a->sa_family == AF_INET) {
+        const struct sockaddr_in *x = (const struct sockaddr_in *)a;
+        const struct sockaddr_in *y = (const struct sockaddr_in *)b;
+        return x->sin_port == y->sin_port && x->sin_addr.s_addr == y->sin_addr.s_addr;
+    }
+    const struct sockaddr_in6 *x = (const struct sockaddr_in6 *)a;
+    const struct sockaddr_in6 *y = (const struct sockaddr_in6 *)b;
+    return x->sin6_port == y->sin6_port &&
+           memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr)) == 0;
+}
+
+static bool peer_addr_valid(const struct sockaddr *sa, socklen_t len) {
+    if (!sa) return false;
+    if (sa->sa_family == AF_INET) return (size_t)len >= sizeof(struct sockaddr_in);
+    if (sa->sa_family == AF_INET6) return (size_t)len >= sizeof(struct sockaddr_in6);
+    return false;
+}
+
+static uint64_t msg_key_hash(const OutboundPeer *peer, uint16_t mid) {
+    return mix64(peer->hash ^ ((uint64_t)mid << 48) ^ mid);
+}
+
+static uint32_t next_random(CoapOutbound *ob) {
+    uint32_t x = ob->rng;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    ob->rng = x;
+    return x;
+}
+
+/*
+ * rehash_peers / rehash_msgs
+ * --------------------------
+ * Duplican los buckets cuando el factor de carga supera 1. Sin memoria, la
+ * tabla sigue funcionando con cadenas más largas.
+ */
+static void rehash_peers(CoapOutbound *ob) {
+    size_t buckets = ob->peer_buckets * 2;
+    OutboundPeer **table = calloc(buckets, sizeof(*table));
+    if (!table) return;
+    for (size_t i = 0; i < ob->peer_buckets; i++) {
+        OutboundPeer *p = ob->peers[i];
+        while (p) {
+            OutboundPeer *next = p->hnext;
+            size_t b = p->hash & (buckets - 1);
+            p->hnext = table[b];
+            table[b] = p;
+            p = next;
+        }
+    }
+    free(ob->peers);
+    ob->peers = table;
+    ob->peer_buckets = buckets;
+}
+
+static void rehash_msgs(CoapOutbound *ob) {
+    size_t buckets = ob->msg_buckets * 2;
+    OutboundMsg **table = calloc(buckets, sizeof(*table));
+    if (!table) return;
+    for (size_t i = 0; i < ob->msg_buckets; i++) {
+        OutboundMsg *m = ob->msgs[i];
+        while (m) {
+            OutboundMsg *next = m->hnext;
+            size_t b = msg_key_hash(m->peer, m->mid) & (buckets - 1);
+            m->hnext = table[b];
+            table[b] = m;
+            m = next;
+        }
+    }
+    free(ob->msgs);
+    ob->msgs = table;
+    ob->msg_buckets = buckets;
+}
+
+/*
+ * peer_find / peer_get
+ * --------------------
+ * Busca el peer; peer_get lo crea si no existe (RTO inicial = ACK_TIMEOUT,
+ * MID inicial aleatorio, bucket lleno).
+ */
+static OutboundPeer *peer_find(const CoapOutbound *ob, const struct sockaddr *sa) {
+    uint64_t h = peer_key_hash(sa);
+    for (OutboundPeer *p = ob->peers[h & (ob->peer_buckets - 1)]; p; p = p->hnext) {
+        if (p->hash == h && peer_key_equal((const struct sockaddr *)&p->addr, sa)) return p;
+    }
+    return NULL;
+}
+
+static OutboundPeer *peer_get(CoapOutbound *ob, const struct sockaddr *sa, socklen_t len) {
+    OutboundPeer *p = peer_find(ob, sa);
+    if (p) return p;
+    p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    memcpy(&p->addr, sa, len);
+    p->addr_len = len;
+    p->ob = ob;
+    p->hash = peer_key_hash(sa);
+    p->next_mid = (uint16_t)next_random(ob);
+    p->rto_ms = ob->cfg.ack_timeout_ms;
+    p->rto_updated_ns = clock_monotonic_ns();
+    p->tokens_milli = (uint64_t)ob->cfg.pace_burst * 1000;
+    p->tokens_ns = p->rto_updated_ns;
+    p->pace_timer = -1;
+    p->last_active_ns = p->rto_updated_ns;
+    size_t b = p->hash & (ob->peer_buckets - 1);
+    p->hnext = ob->peers[b];
+    ob->peers[b] = p;
+    if (++ob->peer_count > ob->peer_buckets) rehash_peers(ob);
+    return p;
+}
+
+static void peer_remove(CoapOutbound *ob, OutboundPeer *peer) {
+    OutboundPeer **link = &ob->peers[peer->hash & (ob->peer_buckets - 1)];
+    while (*link && *link != peer) link = &(*link)->hnext;
+    if (*link) *link = peer->hnext;
+    ob->peer_count--;
+    free(peer);
+}
+
+/*
+ * msg_find / msg_remove
+ * ---------------------
+ * Tabla de mensajes indexada por (peer, MID).
+ */
+static OutboundMsg *msg_find(const CoapOutbound *ob, const OutboundPeer *peer, uint16_t mid) {
+    size_t b = msg_key_hash(peer, mid) & (ob->msg_buckets - 1);
+    for (OutboundMsg *m = ob->msgs[b]; m; m = m->hnext) {
+        if (m->peer == peer && m->mid == mid) return m;
+    }
+    return NULL;
+}
+
+static void msg_remove(CoapOutbound *ob, OutboundMsg *msg) {
+    OutboundMsg **link = &ob->msgs[msg_key_hash(msg->peer, msg->mid) & (ob->msg_buckets - 1)];
+    while (*link && *link != msg) link = &(*link)->hnext;
+    if (*link) *link = msg->hnext;
+    ob->msg_count--;
+}
+
+/*
+ * peer_rto
+ * --------
+ * RTO vigente del peer tras aplicar el envejecimiento de CoCoA.
+ */
+static uint32_t peer_rto(CoapOutbound *ob, OutboundPeer *peer, uint64_t now_ns) {
+    if (now_ns - peer->rto_updated_ns >= (uint64_t)OUTBOUND_RTO_AGING_MS * 1000000ull) {
+        if (peer->rto_ms < 1000) {
+            peer->rto_ms *= 2;
+        } else if (peer->rto_ms > 3000) {
+            peer->rto_ms = (ob->cfg.ack_timeout_ms + peer->rto_ms) / 2;
+        }
+        peer->rto_updated_ns = now_ns;
+    }
+    return peer->rto_ms;
+}
+
+/*
+ * update_estimator / record_rtt
+ * -----------------------------
+ * Actualiza SRTT/RTTVAR (RFC 6298) y combina la estimación con el RTO.
+ */
+static uint64_t update_estimator(uint64_t *srtt, uint64_t *rttvar, bool *init,
+                                 uint64_t rtt_us, unsigned k) {
+    if (!*init) {
+        *srtt = rtt_us;
+        *rttvar = rtt_us / 2;
+        *init = true;
+    } else {
+        uint64_t delta = *srtt > rtt_us ? *srtt - rtt_us : rtt_us - *srtt;
+        *rttvar = (3 * *rttvar + delta) / 4;
+        *srtt = (7 * *srtt + rtt_us) / 8;
+    }
+    return *srtt + k * *rttvar;
+}
+
+static void record_rtt(OutboundPeer *peer, const OutboundMsg *msg, uint64_t now_ns) {
+    uint64_t rtt_us = (now_ns - msg->first_sent_ns) / 1000;
+    uint64_t rto_us = (uint64_t)peer->rto_ms * 1000;
+    if (msg->retransmits == 0) {
+        uint64_t est = update_estimator(&peer->srtt_strong_us, &peer->rttvar_strong_us,
+                                        &peer->strong_init, rtt_us, 4);
+        rto_us = est / 2 + rto_us / 2;
+    } else if (msg->retransmits <= 2) {
+        uint64_t est = update_estimator(&peer->srtt_weak_us, &peer->rttvar_weak_us,
+                                        &peer->weak_init, rtt_us, 1);
+        rto_us = est / 4 + 3 * rto_us / 4;
+    } else {
+        return; // Muestra ambigua: no se usa
+    }
+    uint64_t rto_ms = rto_us / 1000;
+    if (rto_ms < OUTBOUND_RTO_MIN_MS) rto_ms = OUTBOUND_RTO_MIN_MS;
+    if (rto_ms > OUTBOUND_RTO_MAX_MS) rto_ms = OUTBOUND_RTO_MAX_MS;
+    peer->rto_ms = (uint32_t)rto_ms;
+    peer->rto_updated_ns = now_ns;
+}
+
+/*
+ * pace_take
+ * ---------
+ * Recarga el token bucket y consume una ficha. Si no hay, deja en
+ * '*wait_ms' cuánto falta para la próxima.
+ */
+static bool pace_take(CoapOutbound *ob, OutboundPeer *peer, uint64_t now_ns, uint32_t *wait_ms) {
+    if (ob->cfg.pace_rate == 0) return true;
+    const uint64_t cap = (uint64_t)(ob->cfg.pace_burst ? ob->cfg.pace_burst : 1) * 1000;
+    uint64_t elapsed = now_ns - peer->tokens_ns;
+    peer->tokens_ns = now_ns;
+    peer->tokens_milli += elapsed * ob->cfg.pace_rate / 1000000ull;
+    if (peer->tokens_milli > cap) peer->tokens_milli = cap;
+    if (peer->tokens_milli >= 1000) {
+        peer->tokens_milli -= 1000;
+        return true;
+    }
+    uint64_t missing_ns = (1000 - peer->tokens_milli) * 1000000ull / ob->cfg.pace_rate;
+    *wait_ms = (uint32_t)((missing_ns + 999999) / 1000000);
+    return false;
+}
+
+static void send_wire(CoapOutbound *ob, const OutboundMsg *msg) {
+    if (platform_socket_sendto(ob->sock, msg->wire, msg->len,
+                               (const struct sockaddr *)&msg->peer->addr,
+                               msg->peer->addr_len) < 0) {
+        metrics_count(METRIC_DROP_SEND, 1);
+    }
+}
+
+static void peer_pump(CoapOutbound *ob, OutboundPeer *peer);
+
+/*
+ * finish
+ * ------
+ * Cierra un mensaje (en vuelo o en cola): lo quita de las tablas, notifica
+ * el resultado y deja avanzar la cola del peer.
+ */
+static void finish(CoapOutbound *ob, OutboundMsg *msg, OutboundResult result) {
+    OutboundPeer *peer = msg->peer;
+    msg_remove(ob, msg);
+    if (msg->inflight) {
+        if (msg->timer_id > 0) event_loop_remove_timer(ob->loop, msg->timer_id);
+        peer->inflight--;
+        ob->inflight--;
+    } else {
+        OutboundMsg **link = &peer->queue_head;
+        OutboundMsg *prev = NULL;
+        while (*link && *link != msg) { prev = *link; link = &(*link)->qnext; }
+        if (*link) {
+            *link = msg->qnext;
+            if (peer->queue_tail == msg) peer->queue_tail = prev;
+            peer->queued--;
+            ob->queued--;
+        }
+    }
+    peer->last_active_ns = clock_monotonic_ns();
+    if (msg->done) msg->done(msg->user_data, result);
+    free(msg);
+    if (result != OUTBOUND_CANCELLED) peer_pump(ob, peer);
+}
+
+/*
+ * on_retransmit
+ * -------------
+ * (Timer) Reenvía con backoff variable o abandona tras max_retransmit.
+ */
+static void on_retransmit(void *user_data) {
+    OutboundMsg *msg = (OutboundMsg *)user_data;
+    CoapOutbound *ob = msg->ob;
+    msg->timer_id = -1;
+    if (msg->retransmits >= ob->cfg.max_retransmit) {
+        finish(ob, msg, OUTBOUND_TIMEOUT);
+        return;
+    }
+    msg->retransmits++;
+    uint64_t next = (uint64_t)msg->timeout_ms * msg->backoff_pct / 100;
+    msg->timeout_ms = next > UINT32_MAX ? UINT32_MAX : (uint32_t)next;
+    metrics_count(METRIC_RETRANSMIT, 1);
+    send_wire(ob, msg);
+    msg->timer_id = event_loop_add_timer(ob->loop, msg->timeout_ms, false, on_retransmit, msg);
+}
+
+/*
+ * transmit_first
+ * --------------
+ * Primera transmisión: timeout inicial RTO * [1, ACK_RANDOM_FACTOR) y
+ * factor de backoff según ese RTO.
+ */
+static void transmit_first(CoapOutbound *ob, OutboundMsg *msg, uint64_t now_ns) {
+    OutboundPeer *peer = msg->peer;
+    uint32_t rto = peer_rto(ob, peer, now_ns);
+    uint32_t spread = (uint32_t)((uint64_t)rto * (ob->cfg.ack_random_pct > 100 ? ob->cfg.ack_random_pct - 100 : 0) / 100);
+    msg->timeout_ms = rto + (spread ? next_random(ob) % spread : 0);
+    msg->backoff_pct = rto < 1000 ? 300 : (rto <= 3000 ? 200 : 150);
+    msg->inflight = true;
+    msg->first_sent_ns = now_ns;
+    peer->inflight++;
+    ob->inflight++;
+    peer->last_active_ns = now_ns;
+    send_wire(ob, msg);
+    msg->timer_id = event_loop_add_timer(ob->loop, msg->timeout_ms, false, on_retransmit, msg);
+}
+
+static void on_pace(void *user_data);
+
+/*
+ * peer_pump
+ * ---------
+ * Transmite mensajes en cola mientras haya lugar (NSTART) y fichas de
+ * pacing; si faltan fichas, arma un timer para reintentar.
+ */
+static void peer_pump(CoapOutbound *ob, OutboundPeer *peer) {
+    uint64_t now = clock_monotonic_ns();
+    while (peer->queue_head && peer->inflight < ob->cfg.nstart) {
+        uint32_t wait_ms = 0;
+        if (!pace_take(ob, peer, now, &wait_ms)) {
+            if (peer->pace_timer < 0) {
+                // El peer no se libera mientras tenga cola: el puntero es estable
+                peer->pace_timer = event_loop_add_timer(ob->loop, wait_ms ? wait_ms : 1, false,
+                                                        on_pace, peer);
+            }
+            return;
+        }
+        OutboundMsg *msg = peer->queue_head;
+        peer->queue_head = msg->qnext;
+        if (!peer->queue_head) peer->queue_tail = NULL;
+        msg->qnext = NULL;
+        peer->queued--;
+        ob->queued--;
+        transmit_first(ob, msg, now);
+    }
+}
+
+static void on_pace(void *user_data) {
+    OutboundPeer *peer = (OutboundPeer *)user_data;
+    peer->pace_timer = -1;
+    peer_pump(peer->ob, peer);
+}
+
+/*
+ * on_sweep
+ * --------
+ * (Timer periódico) Libera peers inactivos sin mensajes ni timers.
+ */
+static void on_sweep(void *user_data) {
+    CoapOutbound *ob = (CoapOutbound *)user_data;
+    uint64_t now = clock_monotonic_ns();
+    for (size_t i = 0; i < ob->peer_buckets; i++) {
+        OutboundPeer *p = ob->peers[i];
+        while (p) {
+            OutboundPeer *next = p->hnext;
+            if (p->inflight == 0 && p->queued == 0 && p->pace_timer < 0 &&
+                now - p->last_active_ns >= (uint64_t)OUTBOUND_PEER_IDLE_MS * 1000000ull) {
+                peer_remove(ob, p);
+            }
+            p = next;
+        }
+    }
+}
+
+/*
+ * coap_outbound_create
+ * --------------------
+ * Reserva las tablas y arma el barrido periódico de peers.
+ */
+CoapOutbound *coap_outbound_create(EventLoop *loop, int sock, const OutboundConfig *cfg) {
+    if (!loop || sock < 0) return NULL;
+    CoapOutbound *ob = calloc(1, sizeof(*ob));
+    if (!ob) return NULL;
+    ob->loop = loop;
+    ob->sock = sock;
+    if (cfg) ob->cfg = *cfg;
+    else coap_outbound_config_default(&ob->cfg);
+    if (ob->cfg.ack_timeout_ms == 0) ob->cfg.ack_timeout_ms = COAP_ACK_TIMEOUT_MS;
+    if (ob->cfg.nstart == 0) ob->cfg.nstart = 1;
+    ob->peer_buckets = OUTBOUND_INITIAL_BUCKETS;
+    ob->msg_buckets = OUTBOUND_INITIAL_BUCKETS;
+    ob->peers = calloc(ob->peer_buckets, sizeof(*ob->peers));
+    ob->msgs = calloc(ob->msg_buckets, sizeof(*ob->msgs));
+    uint64_t seed = clock_monotonic_ns() ^ (uint64_t)(uintptr_t)ob;
+    ob->rng = (uint32_t)(seed ^ (seed >> 32)) | 1u;
+    ob->sweep_timer = event_loop_add_timer(loop, OUTBOUND_SWEEP_MS, true, on_sweep, ob);
+    if (!ob->peers || !ob->msgs || ob->sweep_timer < 0) {
+        coap_outbound_destroy(ob);
+        return NULL;
+    }
+    return ob;
+}
+
+/*
+ * coap_outbound_destroy
+ * ---------------------
+ * Cancela todos los mensajes (done con OUTBOUND_CANCELLED), los timers y
+ * libera peers y tablas.
+ */
+void coap_outbound_destroy(CoapOutbound *ob) {
+    if (!ob) return;
+    if (ob->msgs) {
+        for (size_t i = 0; i < ob->msg_buckets; i++) {
+            while (ob->msgs[i]) finish(ob, ob->msgs[i], OUTBOUND_CANCELLED);
+        }
+    }
+    if (ob->peers) {
+        for (size_t i = 0; i < ob->peer_buckets; i++) {
+            while (ob->peers[i]) {
+                OutboundPeer *p = ob->peers[i];
+                if (p->pace_timer > 0) event_loop_remove_timer(ob->loop, p->pace_timer);
+                peer_remove(ob, p);
+            }
+        }
+    }
+    if (ob->sweep_timer > 0) event_loop_remove_timer(ob->loop, ob->sweep_timer);
+    free(ob->peers);
+    free(ob->msgs);
+    free(ob);
+}
+
+/*
+ * coap_outbound_send
+ * ------------------
+ * Copia el CON, le asigna MID y lo encola en su peer; sale de inmediato si
+ * NSTART y el pacing lo permiten.
+ */
+int coap_outbound_send(CoapOutbound *ob, const struct sockaddr *peer, socklen_t peer_len,
+                       const uint8_t *wire, size_t wire_len,
+                       OutboundDone done, void *user_data) {
+    if (!ob || !peer_addr_valid(peer, peer_len) || !wire || wire_len < 4 ||
+        (size_t)peer_len > sizeof(struct sockaddr_storage)) {
+        return PLATFORM_EINVAL;
+    }
+    OutboundPeer *p = peer_get(ob, peer, peer_len);
+    if (!p) return PLATFORM_ENOMEM;
+    if (p->inflight >= ob->cfg.nstart && p->queued >= ob->cfg.max_queue) return PLATFORM_EAGAIN;
+
+    OutboundMsg *msg = malloc(sizeof(*msg) + wire_len);
+    if (!msg) return PLATFORM_ENOMEM;
+    memset(msg, 0, sizeof(*msg));
+    msg->ob = ob;
+    msg->peer = p;
+    msg->mid = p->next_mid++;
+    msg->timer_id = -1;
+    msg->done = done;
+    msg->user_data = user_data;
+    msg->len = wire_len;
+    memcpy(msg->wire, wire, wire_len);
+    msg->wire[2] = (uint8_t)(msg->mid >> 8);
+    msg->wire[3] = (uint8_t)(msg->mid & 0xFF);
+
+    size_t b = msg_key_hash(p, msg->mid) & (ob->msg_buckets - 1);
+    msg->hnext = ob->msgs[b];
+    ob->msgs[b] = msg;
+    if (++ob->msg_count > ob->msg_buckets) rehash_msgs(ob);
+
+    if (p->queue_tail) p->queue_tail->qnext = msg;
+    else p->queue_head = msg;
+    p->queue_tail = msg;
+    p->queued++;
+    ob->queued++;
+    peer_pump(ob, p);
+    // peer_pump sólo transmite (no libera): 'msg' sigue siendo válido
+    if (!msg->inflight) metrics_count(METRIC_OUTBOUND_QUEUED, 1);
+    return msg->mid;
+}
+
+/*
+ * coap_outbound_next_mid
+ * ----------------------
+ * Reserva un MID del espacio del peer para un mensaje sin seguimiento.
+ */
+int coap_outbound_next_mid(CoapOutbound *ob, const struct sockaddr *peer, socklen_t peer_len) {
+    if (!ob || !peer_addr_valid(peer, peer_len) ||
+        (size_t)peer_len > sizeof(struct sockaddr_storage)) {
+        return PLATFORM_EINVAL;
+    }
+    OutboundPeer *p = peer_get(ob, peer, peer_len);
+    if (!p) return PLATFORM_ENOMEM;
+    p->last_active_ns = clock_monotonic_ns();
+    return p->next_mid++;
+}
+
+/*
+ * coap_outbound_on_message
+ * ------------------------
+ * Un ACK (vacío o con respuesta) o RST del peer cierra el CON con ese MID.
+ * Un ACK de un mensaje aún en cola (MID no enviado) se ignora.
+ */
+bool coap_outbound_on_message(CoapOutbound *ob, const CoapMessage *msg,
+                              const struct sockaddr *peer, socklen_t peer_len) {
+    if (!ob || !msg || !peer_addr_valid(peer, peer_len)) return false;
+    if (msg->type != COAP_TYPE_ACKNOWLEDGMENT && msg->type != COAP_TYPE_RESET) return false;
+    OutboundPeer *p = peer_find(ob, peer);
+    if (!p) return false;
+    OutboundMsg *m = msg_find(ob, p, msg->message_id);
+    if (!m || !m->inflight) return false;
+    if (msg->type == COAP_TYPE_ACKNOWLEDGMENT) {
+        record_rtt(p, m, clock_monotonic_ns());
+        finish(ob, m, OUTBOUND_ACKED);
+    } else {
+        finish(ob, m, OUTBOUND_RESET);
+    }
+    return true;
+}
+
+size_t coap_outbound_inflight(const CoapOutbound *ob) {
+    return ob ? ob->inflight : 0;
+}
+
+size_t coap_outbound_queued(const CoapOutbound *ob) {
+    return ob ? ob->queued : 0;
+}
+
+size_t coap_outbound_peer_count(const CoapOutbound *ob) {
+    return ob ? ob->peer_count : 0;
+}
+
+uint32_t coap_outbound_peer_rto_ms(const CoapOutbound *ob, const struct sockaddr *peer,
+                                   socklen_t peer_len) {
+    if (!ob || !peer_addr_valid(peer, peer_len)) return 0;
+    const OutboundPeer *p = peer_find(ob, peer);
+    return p ? p->rto_ms : 0;
+}
@@ -4,11 +4,36 @@
  * Responsabilidades
  * - Crear y gestionar un socket UDP no bloqueante.
  * - Registrar el socket en el EventLoop y procesar datagramas recibidos.
- * - Decodificar mensajes CoAP, enrutar la petición y codificar la respuesta.
+ * - Decodificar mensajes CoAP, enrutar la petición y codificar la respuesta
+ *   (scatter/gather: el payload se envía con sendmsg sin copiarlo).
  * - Evitar amplificación: datagramas inválidos se descartan silenciosamente.
+ * - Registrar métricas: latencia por etapa (decode/dispatch/encode/send), por
+ *   ruta y por clase de respuesta, y contadores de descarte.
+ *
+ * - Opcionalmente, servir HTTP/1.1 (métricas y consultas) en el mismo loop.
+ * - Opcionalmente, modo busy-poll (server_set_busy_poll): girar sobre recv no
+ *   bloqueante antes de dormir en el event loop, cambiando un core por menor
+ *   latencia de despertar.
+ * - Opcionalmente, pool de workers (server_set_workers) para rutas costosas.
+ * - Opcionalmente, admisión por peer (server_set_rate_limit): token bucket por
+ *   dirección consultado antes de decodificar; un peer desbocado recibe 5.03
+ *   (CON) o se descarta (NON) sin costar decode ni dispatch.
+ * - Opcionalmente, control de sobrecarga (server_set_overload): con lag del
+ *   loop o backlog sostenidos, las rutas de baja prioridad reciben 5.03 con
+ *   Max-Age calculado en lugar de competir con la ingesta.
+ * - Respuestas separadas (RFC 7252 §5.2.2): si un handler difiere su
+ *   respuesta (dispatcher_defer), se confirma la request CON con un ACK vacío
+ *   y la respuesta se envía después como CON propia por el motor de salida
+ *   (coap_outbound: retransmisión, NSTART, RTO por peer y pacing), o NON si
+ *   la request fue NON.
  *
  * Concurrencia
- * - Diseño single-threaded, orientado a eventos. No se usan hilos internos.
+ * - Orientado a eventos: recepción, decodificación y envío ocurren en el hilo
+ *   del loop. Sin pool, el dispatch también.
+ * - Con pool, las rutas marcadas offload (dispatcher_route_offload) se
+ *   decodifican en el loop y se encolan; un worker ejecuta el handler y
+ *   devuelve la respuesta con event_loop_post para que el loop la envíe. Las
+ *   rutas baratas (POST de telemetría) siguen inline, sin saltos entre hilos.
  *
  * Errores y logging
  * - En modo --verbose, se registran RX/TX de CoAP y advertencias de codec/dispatcher.
@@ -21,25 +46,477 @@
 #include "event_loop.h"
 #include "coap_codec.h"
 #include "dispatcher.h"
+#include "metrics.h"
+#include "http.h"
 #include "log.h"
+#include "clock.h"
+#include "work_pool.h"
+#include "coap_outbound.h"
+#include "ratelimit.h"
+#include "overload.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 
 #define RECV_BUFFER_SIZE COAP_MAX_MESSAGE_SIZE
 #define SEND_BUFFER_SIZE COAP_MAX_MESSAGE_SIZE
+// Errores de recvfrom consecutivos tolerados por callback antes de ceder
+#define RECV_MAX_ERRORS 16
+// Busy-poll: cada cuántos sondeos vacíos se atiende el resto del loop
+// (timers, HTTP) con una vuelta no bloqueante
+#define BUSY_POLL_LOOP_EVERY 64
+// Busy-poll en modo continuo: espera máxima de cada vuelta bloqueante
+#define BUSY_POLL_SLEEP_MS 1000
+// Período del timer que mide el lag del loop (control de sobrecarga)
+#define OVERLOAD_PROBE_MS 10
+// Datagramas leídos por lote antes de ordenarlos por prioridad
+#define RX_BATCH 32
+// Presupuesto por defecto de cada callback de lectura: al agotarse se cede
+// el hilo (timers, HTTP, tareas) y el socket se re-arma para la vuelta
+// siguiente (ver server_set_rx_budget)
+#define RX_BUDGET_DATAGRAMS 256
+#define RX_BUDGET_US 1000
+// Período de publicación de la utilización del loop en métricas
+#define LOOP_STATS_MS 100
+
+// Datagrama leído y todavía sin procesar (ver drain_socket)
+typedef struct {
+    uint8_t data[RECV_BUFFER_SIZE];
+    size_t len;
+    struct sockaddr_storage peer;
+    socklen_t peer_len;
+    uint64_t rx_ns;         // Lectura del socket (espera en cola)
+} RxSlot;
+
+// Datagramas por turno de cada prioridad (round-robin ponderado): la ingesta
+// va primero, pero las lecturas avanzan al menos uno por vuelta
+static const unsigned k_rx_weight[DISPATCH_PRIORITY_COUNT] = {
+    [DISPATCH_PRIORITY_HIGH] = 8,
+    [DISPATCH_PRIORITY_NORMAL] = 2,
+    [DISPATCH_PRIORITY_LOW] = 1,
+};
 
 struct Server {
     EventLoop *loop;
     int sock;
     bool verbose;
     uint16_t port;
+    HttpServer *http;       // Listener HTTP opcional (server_enable_http)
+    uint64_t busy_poll_ns;  // Presupuesto de giro sin tráfico (0 = deshabilitado)
+    atomic_bool stop;       // server_stop en modo busy-poll
+    WorkPool *pool;         // Workers para rutas offload (NULL = todo inline)
+    atomic_size_t offload_inflight; // Jobs encolados cuya respuesta no se envió
+    CoapOutbound *outbound; // CON propios (respuestas separadas) y sus MIDs
+    RateLimiter *ratelimit; // Admisión por peer (NULL = deshabilitada)
+    OverloadController *overload; // Descarte por prioridad (NULL = deshabilitado)
+    int overload_timer;     // Sonda de lag (-1 sin control de sobrecarga)
+    uint64_t overload_deadline_ns; // Próximo disparo esperado de la sonda
+    uint32_t rx_budget_datagrams; // Por callback de lectura (0 = sin límite)
+    uint32_t rx_budget_us;        // Por callback de lectura (0 = sin límite)
+    size_t rx_run;          // Datagramas desde el último EAGAIN (backlog)
+    int stats_timer;        // Publicación de EventLoopStats
+    EventLoopStats loop_stats; // Última muestra publicada
+    RxSlot rx[RX_BATCH];    // Lote de recepción (sólo el hilo del loop)
+    uint8_t rx_queue[DISPATCH_PRIORITY_COUNT][RX_BATCH]; // Índices en rx por clase
 };
 
+// Respuesta separada: creada por server_defer (en el hilo que despacha),
+// completada desde cualquier hilo y entregada al motor de salida en el hilo
+// del loop (que guarda su propia copia: el Separate se libera al enviarla)
+typedef struct Separate {
+    DispatchDeferred base;  // Primero: dispatcher_complete recibe &base
+    Server *srv;
+    struct sockaddr_storage peer;
+    socklen_t peer_len;
+    CoapType req_type;
+    uint8_t token[COAP_MAX_TOKEN_LENGTH];
+    uint8_t token_length;
+    DispatchRoute route;
+    uint64_t t0;            // Recepción de la request
+    CoapMessage resp;
+} Separate;
+
+// Contexto de server_defer mientras se despacha una request
+typedef struct {
+    Server *srv;
+    const struct sockaddr *peer;
+    socklen_t peer_len;
+    uint64_t t0;
+} DeferContext;
+
+// Request delegada al pool: el worker completa 'resp' y el loop la envía
+typedef struct {
+    Server *srv;
+    CoapMessage req;
+    CoapMessage resp;
+    DispatchRoute route;
+    struct sockaddr_storage peer;
+    socklen_t peer_len;
+    uint64_t t0;            // Recepción (latencia total de la request)
+    bool deferred;          // El handler difirió: la respuesta va por Separate
+} OffloadJob;
+
+/*
+ * send_empty
+ * ----------
+ * Envía un mensaje vacío (código 0.00, sin token) de tipo 'type' con 'mid'.
+ * Seguro desde cualquier hilo.
+ */
+static void send_empty(Server *srv, CoapType type, uint16_t mid,
+                       const struct sockaddr *peer, socklen_t peer_len) {
+    const uint8_t msg[4] = {
+        (uint8_t)((COAP_VERSION << 6) | ((unsigned)type << 4)), 0,
+        (uint8_t)(mid >> 8), (uint8_t)(mid & 0xFF)
+    };
+    if (platform_socket_sendto(srv->sock, msg, sizeof(msg), peer, peer_len) < 0) {
+        metrics_count(METRIC_DROP_SEND, 1);
+    }
+}
+
+/*
+ * separate_done
+ * -------------
+ * (Hilo del loop) Resultado de una respuesta separada CON.
+ */
+static void separate_done(void *user_data, OutboundResult result) {
+    Server *srv = (Server *)user_data;
+    if (result != OUTBOUND_TIMEOUT) return;
+    metrics_count(METRIC_SEPARATE_TIMEOUT, 1);
+    if (srv->verbose) LOG_WARN_RL("separate response: no ACK after %u retransmissions\n",
+                                  (unsigned)COAP_MAX_RETRANSMIT);
+}
+
+/*
+ * separate_send
+ * -------------
+ * (Hilo del loop) Envía la respuesta separada con el token de la request. Si
+ * es CON la entrega al motor de salida (MID, retransmisión, NSTART, pacing);
+ * si es NON sale directo con un MID del mismo espacio del peer.
+ */
+static void separate_send(void *arg) {
+    Separate *sep = (Separate *)arg;
+    Server *srv = sep->srv;
+    const struct sockaddr *peer = (const struct sockaddr *)&sep->peer;
+    CoapMessage *m = &sep->resp;
+    m->version = COAP_VERSION;
+    m->type = sep->req_type == COAP_TYPE_CONFIRMABLE ? COAP_TYPE_CONFIRMABLE
+                                                     : COAP_TYPE_NON_CONFIRMABLE;
+    m->message_id = 0;      // CON: lo asigna el motor al encolar
+    if (m->type == COAP_TYPE_NON_CONFIRMABLE) {
+        int mid = coap_outbound_next_mid(srv->outbound, peer, sep->peer_len);
+        m->message_id = mid < 0 ? 0 : (uint16_t)mid;
+    }
+    m->token_length = sep->token_length;
+    memcpy(m->token, sep->token, sep->token_length);
+
+    uint8_t wire[COAP_MAX_MESSAGE_SIZE];
+    int n = coap_encode(m, wire, sizeof(wire));
+    if (n <= 0) {
+        metrics_count(METRIC_DROP_ENCODE, 1);
+        if (srv->verbose) LOG_WARN_RL("separate response: coap_encode error %d\n", n);
+        free(sep);
+        return;
+    }
+    if (m->type == COAP_TYPE_CONFIRMABLE) {
+        int mid = coap_outbound_send(srv->outbound, peer, sep->peer_len, wire, (size_t)n,
+                                     separate_done, srv);
+        if (mid < 0) {
+            metrics_count(METRIC_DROP_SEND, 1);
+            if (srv->verbose) LOG_WARN_RL("separate response: outbound queue error %d\n", mid);
+            free(sep);
+            return;
+        }
+        m->message_id = (uint16_t)mid;
+    } else if (platform_socket_sendto(srv->sock, wire, (size_t)n, peer, sep->peer_len) < 0) {
+        metrics_count(METRIC_DROP_SEND, 1);
+    }
+    if (srv->verbose && log_level_enabled(LOG_LEVEL_INFO)) log_coap_tx(m, peer, sep->peer_len);
+    metrics_count(METRIC_SEPARATE, 1);
+    metrics_record_request(sep->route, m->code, platform_get_monotonic_ns() - sep->t0);
+    free(sep);
+}
+
+/*
+ * separate_complete
+ * -----------------
+ * (Cualquier hilo) dispatcher_complete: copia la respuesta y la entrega al
+ * loop para enviarla.
+ */
+static void separate_complete(DispatchDeferred *deferred, const CoapMessage *resp) {
+    Separate *sep = (Separate *)deferred;
+    if (!resp) {
+        coap_message_init(&sep->resp);
+        sep->resp.code = COAP_ERROR_INTERNAL;
+    } else {
+        sep->resp = *resp;
+        sep->resp.payload = NULL;
+        sep->resp.payload_length = 0;
+        if (resp->payload && resp->payload_length <= sizeof(sep->resp.payload_buffer)) {
+            memmove(sep->resp.payload_buffer, resp->payload, resp->payload_length);
+            sep->resp.payload = sep->resp.payload_buffer;
+            sep->resp.payload_length = resp->payload_length;
+        }
+    }
+    if (event_loop_post(sep->srv->loop, separate_send, sep) != PLATFORM_OK) {
+        metrics_count(METRIC_DROP_SEND, 1);
+        free(sep);
+    }
+}
+
+/*
+ * server_defer
+ * ------------
+ * Proveedor de dispatcher_defer: crea el handle y confirma de inmediato la
+ * request CON con un ACK vacío, así el cliente deja de retransmitirla.
+ */
+static DispatchDeferred *server_defer(void *ctx, const CoapMessage *req) {
+    const DeferContext *dc = (const DeferContext *)ctx;
+    if ((size_t)dc->peer_len > sizeof(struct sockaddr_storage)) return NULL;
+    Separate *sep = (Separate *)calloc(1, sizeof(Separate));
+    if (!sep) return NULL;
+    sep->base.complete = separate_complete;
+    sep->srv = dc->srv;
+    memcpy(&sep->peer, dc->peer, dc->peer_len);
+    sep->peer_len = dc->peer_len;
+    sep->req_type = req->type;
+    sep->token_length = req->token_length;
+    memcpy(sep->token, req->token, req->token_length);
+    sep->route = dispatcher_match_route(req);
+    sep->t0 = dc->t0;
+    if (req->type == COAP_TYPE_CONFIRMABLE) {
+        send_empty(dc->srv, COAP_TYPE_ACKNOWLEDGMENT, req->message_id, dc->peer, dc->peer_len);
+    }
+    return &sep->base;
+}
+
+/*
+ * init_error_response
+ * -------------------
+ * Respuesta mínima sin pasar por el dispatcher: MID y token de la request,
+ * ACK para CON y NON para NON.
+ */
+static void init_error_response(const CoapMessage *req, CoapMessage *resp, CoapCode code) {
+    coap_message_init(resp);
+    resp->version = COAP_VERSION;
+    resp->message_id = req->message_id;
+    resp->token_length = req->token_length;
+    if (req->token_length > 0) {
+        memcpy(resp->token, req->token, req->token_length);
+    }
+    if (req->type == COAP_TYPE_CONFIRMABLE) {
+        resp->type = COAP_TYPE_ACKNOWLEDGMENT;
+    } else {
+        resp->type = COAP_TYPE_NON_CONFIRMABLE;
+    }
+    resp->code = code;
+}
+
+/*
+ * dispatch_request
+ * ----------------
+ * Enruta 'req' y deja la respuesta en 'resp' (4.00 mínima si el dispatcher
+ * falla). Registra la etapa de dispatch. Seguro desde cualquier hilo.
+ * Retorna false si el handler difirió la respuesta (no hay nada que enviar).
+ */
+static bool dispatch_request(Server *srv, const CoapMessage *req, CoapMessage *resp,
+                             DispatchRoute *route,
+                             const struct sockaddr *peer, socklen_t peer_len, uint64_t t0) {
+    const uint64_t t_start = platform_get_monotonic_ns();
+    coap_message_init(resp);
+    *route = DISPATCH_ROUTE_UNMATCHED;
+    DeferContext defer = { srv, peer, peer_len, t0 };
+    dispatcher_set_defer(server_defer, &defer);
+    int rc = dispatcher_handle_request_routed(req, resp, route);
+    dispatcher_set_defer(NULL, NULL);
+    if (rc == DISPATCH_DEFERRED) {
+        metrics_record_stage(METRIC_STAGE_DISPATCH, platform_get_monotonic_ns() - t_start);
+        return false;
+    }
+    if (rc != 0) {
+        metrics_count(METRIC_DROP_DISPATCH, 1);
+        if (srv->verbose) LOG_WARN_RL("dispatcher error %d, sending 4.00 Bad Request\n", rc);
+        init_error_response(req, resp, COAP_ERROR_BAD_REQUEST);
+    }
+    metrics_record_stage(METRIC_STAGE_DISPATCH, platform_get_monotonic_ns() - t_start);
+    return true;
+}
+
+/*
+ * send_response
+ * -------------
+ * Codifica 'resp' (scatter/gather) y la envía a 'peer'. Registra las etapas
+ * de encode/send y la latencia total de la request desde t0.
+ */
+static void send_response(Server *srv, const CoapMessage *resp, DispatchRoute route,
+                          const struct sockaddr *peer, socklen_t peer_len, uint64_t t0) {
+    const uint64_t t_start = platform_get_monotonic_ns();
+    // Sólo header y opciones se serializan; el payload viaja por referencia.
+    // El buffer admite un datagrama completo: las opciones de una respuesta
+    // pueden ocupar casi todo COAP_MAX_MESSAGE_SIZE si el payload es corto.
+    uint8_t hdr[SEND_BUFFER_SIZE];
+    struct iovec iov[COAP_ENCODE_IOV_MAX];
+    size_t iov_count = 0;
+    int out_n = coap_encode_iov(resp, hdr, sizeof(hdr), iov, &iov_count);
+    if (out_n > SEND_BUFFER_SIZE) out_n = COAP_CODEC_E2SMALL;
+    const uint64_t t_encoded = platform_get_monotonic_ns();
+    metrics_record_stage(METRIC_STAGE_ENCODE, t_encoded - t_start);
+    if (out_n <= 0) {
+        metrics_count(METRIC_DROP_ENCODE, 1);
+        if (srv->verbose) LOG_WARN_RL("coap_encode error %d\n", out_n);
+        return;
+    }
+
+    // Log de salida (solo 2.xx)
+    if (srv->verbose && log_level_enabled(LOG_LEVEL_INFO)) {
+        log_coap_tx(resp, peer, peer_len);
+    }
+
+    ssize_t sent = platform_socket_sendmsg(srv->sock, iov, iov_count, peer, peer_len);
+    const uint64_t t_sent = platform_get_monotonic_ns();
+    metrics_record_stage(METRIC_STAGE_SEND, t_sent - t_encoded);
+    if (sent < 0) metrics_count(METRIC_DROP_SEND, 1);
+    metrics_record_request(route, resp->code, t_sent - t0);
+}
+
+/*
+ * offload_complete
+ * ----------------
+ * (Hilo del loop) Envía la respuesta de un job terminado y lo libera.
+ */
+static void offload_complete(void *arg) {
+    OffloadJob *job = (OffloadJob *)arg;
+    Server *srv = job->srv;
+    if (!job->deferred) {
+        send_response(srv, &job->resp, job->route, (const struct sockaddr *)&job->peer,
+                      job->peer_len, job->t0);
+    }
+    free(job);
+    atomic_fetch_sub(&srv->offload_inflight, 1);
+}
+
+/*
+ * offload_run
+ * -----------
+ * (Worker) Ejecuta el handler y devuelve el job al loop. Si no se puede
+ * encolar (sin memoria), envía desde el worker: sendmsg sobre UDP es seguro
+ * entre hilos.
+ */
+static void offload_run(void *arg) {
+    OffloadJob *job = (OffloadJob *)arg;
+    job->deferred = !dispatch_request(job->srv, &job->req, &job->resp, &job->route,
+                                      (const struct sockaddr *)&job->peer, job->peer_len,
+                                      job->t0);
+    if (event_loop_post(job->srv->loop, offload_complete, job) != PLATFORM_OK) {
+        offload_complete(job);
+    }
+}
+
+/*
+ * offload_request
+ * ---------------
+ * Copia la request decodificada y el peer a un job y lo encola en el pool.
+ * Retorna false si no se pudo (el llamador la procesa inline).
+ */
+static bool offload_request(Server *srv, const CoapMessage *req,
+                            const struct sockaddr *peer, socklen_t peer_len, uint64_t t0) {
+    if ((size_t)peer_len > sizeof(struct sockaddr_storage)) return false;
+    OffloadJob *job = (OffloadJob *)malloc(sizeof(OffloadJob));
+    if (!job) return false;
+    job->srv = srv;
+    job->req = *req;
+    // El payload decodificado vive en el buffer interno del mensaje
+    if (req->payload == req->payload_buffer) job->req.payload = job->req.payload_buffer;
+    memcpy(&job->peer, peer, peer_len);
+    job->peer_len = peer_len;
+    job->t0 = t0;
+    job->deferred = false;
+    atomic_fetch_add(&srv->offload_inflight, 1);
+    if (work_pool_submit(srv->pool, offload_run, job) != PLATFORM_OK) {
+        atomic_fetch_sub(&srv->offload_inflight, 1);
+        free(job);
+        return false;
+    }
+    metrics_count(METRIC_OFFLOADED, 1);
+    return true;
+}
+
+/*
+ * send_rate_limited
+ * -----------------
+ * 5.03 Service Unavailable en un ACK con el MID y token de la request y
+ * Max-Age = segundos hasta que el peer vuelva a tener fichas. Se arma a mano
+ * desde la cabecera: el datagrama rechazado nunca se decodifica.
+ */
+static void send_rate_limited(Server *srv, const uint8_t *buf, size_t tkl, uint32_t max_age,
+                              const struct sockaddr *peer, socklen_t peer_len) {
+    uint8_t out[4 + COAP_MAX_TOKEN_LENGTH + 6];
+    size_t pos = 0;
+    out[pos++] = (uint8_t)((COAP_VERSION << 6) | (COAP_TYPE_ACKNOWLEDGMENT << 4) | tkl);
+    out[pos++] = COAP_ERROR_SERVICE_UNAVAILABLE;
+    out[pos++] = buf[2];
+    out[pos++] = buf[3];
+    memcpy(out + pos, buf + 4, tkl);
+    pos += tkl;
+    // Max-Age (14): delta extendido de 1 byte (13 + 1), valor mínimo big-endian
+    size_t len = max_age > 0xFFFFFF ? 4 : max_age > 0xFFFF ? 3 : max_age > 0xFF ? 2 : 1;
+    out[pos++] = (uint8_t)((13 << 4) | len);
+    out[pos++] = (uint8_t)(COAP_OPTION_MAX_AGE - 13);
+    for (size_t i = len; i > 0; i--) out[pos++] = (uint8_t)(max_age >> (8 * (i - 1)));
+    if (platform_socket_sendto(srv->sock, out, pos, peer, peer_len) < 0) {
+        metrics_count(METRIC_DROP_SEND, 1);
+    }
+}
+
+/*
+ * admit_datagram
+ * --------------
+ * Admisión por peer antes de decodificar. ACK/RST pasan siempre (cierran
+ * intercambios propios). Sin fichas: las requests CON con cabecera válida
+ * reciben 5.03 con Max-Age; el resto se descarta. Retorna false si se
+ * rechazó.
+ */
+static bool admit_datagram(Server *srv, const uint8_t *buf, size_t n,
+                           const struct sockaddr *peer, socklen_t peer_len) {
+    const unsigned type = n > 0 ? (buf[0] >> 4) & 0x3 : 0;
+    if (type == COAP_TYPE_ACKNOWLEDGMENT || type == COAP_TYPE_RESET) return true;
+    uint32_t wait_s = ratelimit_check(srv->ratelimit, peer, clock_now_ms());
+    if (wait_s == 0) return true;
+    metrics_count(METRIC_RATE_LIMITED, 1);
+    const size_t tkl = n >= 4 ? buf[0] & 0x0F : 0;
+    if (type == COAP_TYPE_CONFIRMABLE && n >= 4 + tkl && tkl <= COAP_MAX_TOKEN_LENGTH &&
+        (buf[0] >> 6) == COAP_VERSION && buf[1] != 0 && (buf[1] >> 5) == 0) {
+        send_rate_limited(srv, buf, tkl, wait_s, peer, peer_len);
+    }
+    return false;
+}
+
+/*
+ * shed_request
+ * ------------
+ * Descarte por sobrecarga: 5.03 con Max-Age (segundos sugeridos antes de
+ * reintentar, según la presión) sin ejecutar el handler. Se registra como
+ * request de la ruta con clase 5xx.
+ */
+static void shed_request(Server *srv, const CoapMessage *req, DispatchRoute route,
+                         const struct sockaddr *peer, socklen_t peer_len, uint64_t t0) {
+    metrics_count(METRIC_SHED, 1);
+    CoapMessage resp;
+    init_error_response(req, &resp, COAP_ERROR_SERVICE_UNAVAILABLE);
+    uint32_t max_age = overload_max_age(srv->overload);
+    uint8_t value[4];
+    size_t len = 0;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (len > 0 || (max_age >> shift) != 0) value[len++] = (uint8_t)(max_age >> shift);
+    }
+    (void)coap_message_add_option(&resp, COAP_OPTION_MAX_AGE, value, len);
+    send_response(srv, &resp, route, peer, peer_len, t0);
+}
+
 /*
  * process_datagram
  * -----------------
@@ -55,83 +532,220 @@ struct Server {
  * Comportamiento
  * - Loggea RX/TX en modo verbose.
  * - Construye una respuesta 4.00 si el dispatcher retorna error lógico.
+ * - Registra métricas de etapa, ruta/clase y descartes (metrics.h).
+ * - Con pool de workers, las rutas offload se delegan tras decodificar.
  */
 static void process_datagram(Server *srv,
                              const uint8_t *buf, size_t n,
                              const struct sockaddr *peer, socklen_t peer_len) {
+    metrics_count(METRIC_RX_DATAGRAMS, 1);
+    if (srv->ratelimit && !admit_datagram(srv, buf, n, peer, peer_len)) return;
+    const uint64_t t0 = platform_get_monotonic_ns();
+
     CoapMessage req; coap_message_init(&req);
     int rc = coap_decode(&req, buf, n);
+    const uint64_t t_decoded = platform_get_monotonic_ns();
+    metrics_record_stage(METRIC_STAGE_DECODE, t_decoded - t0);
     if (rc != 0) {
-        if (srv->verbose) LOG_WARN("coap_decode error %d\n", rc);
+        metrics_count(METRIC_DROP_DECODE, 1);
+        if (srv->verbose) LOG_WARN_RL("coap_decode error %d\n", rc);
         return;
     }
 
-    // Log de entrada (request CoAP válido)
-    if (srv->verbose) {
+    // Log de entrada (request CoAP válido); el chequeo de nivel evita
+    // formatear el peer y el path cuando INFO está filtrado
+    if (srv->verbose && log_level_enabled(LOG_LEVEL_INFO)) {
         log_coap_rx(&req, peer, peer_len);
     }
 
-    CoapMessage resp; coap_message_init(&resp);
-    rc = dispatcher_handle_request(&req, &resp);
-    if (rc != 0) {
-        if (srv->verbose) LOG_WARN("dispatcher error %d, sending 4.00 Bad Request\n", rc);
-        // Construir respuesta de error mínima
-        coap_message_init(&resp);
-        resp.version = COAP_VERSION;
-        resp.message_id = req.message_id;
-        resp.token_length = req.token_length;
-        if (req.token_length > 0) {
-            memcpy(resp.token, req.token, req.token_length);
-        }
-        if (req.type == COAP_TYPE_CONFIRMABLE) {
-            resp.type = COAP_TYPE_ACKNOWLEDGMENT;
-        } else {
-            resp.type = COAP_TYPE_NON_CONFIRMABLE;
-        }
-        resp.code = COAP_ERROR_BAD_REQUEST;
+    // ACK/RST vacíos: confirman (o rechazan) un CON propio; nunca se
+    // responden
+    if (req.code == 0 && (req.type == COAP_TYPE_ACKNOWLEDGMENT || req.type == COAP_TYPE_RESET)) {
+        coap_outbound_on_message(srv->outbound, &req, peer, peer_len);
+        return;
     }
 
-    uint8_t out[SEND_BUFFER_SIZE];
-    int out_n = coap_encode(&resp, out, sizeof(out));
-    if (out_n <= 0) {
-        if (srv->verbose) LOG_WARN("coap_encode error %d\n", out_n);
+    const DispatchRoute matched = dispatcher_match_route(&req);
+    if (srv->overload &&
+        overload_should_shed(srv->overload, dispatcher_route_priority(matched))) {
+        shed_request(srv, &req, matched, peer, peer_len, t0);
         return;
     }
 
-    // Log de salida (solo 2.xx)
-    if (srv->verbose) {
-        log_coap_tx(&resp, peer, peer_len);
+    if (srv->pool && dispatcher_route_offload(matched) &&
+        offload_request(srv, &req, peer, peer_len, t0)) {
+        return;
     }
 
-    (void)platform_socket_sendto(srv->sock, out, (size_t)out_n, peer, peer_len);
+    CoapMessage resp;
+    DispatchRoute route;
+    if (dispatch_request(srv, &req, &resp, &route, peer, peer_len, t0)) {
+        send_response(srv, &resp, route, peer, peer_len, t0);
+    }
 }
 
+static size_t drain_socket(Server *srv, size_t max_datagrams, uint64_t max_ns, bool *more);
+
 /*
  * on_readable
  * -----------
  * Callback registrado en el EventLoop para el socket UDP del servidor. Extrae
- * todos los datagramas pendientes y delega su procesamiento a process_datagram.
+ * los datagramas pendientes, dentro del presupuesto, y delega su
+ * procesamiento a process_datagram.
  *
  * Notas
- * - Usa un bucle hasta que recvfrom retorna EAGAIN (no más datos).
+ * - El socket se registra en modo edge-triggered: hay que drenar hasta que
+ *   recvfrom retorne EAGAIN, o no habrá nueva notificación hasta que llegue
+ *   otro datagrama. Si el presupuesto se agota antes, el fd se re-arma con
+ *   event_loop_mark_pending: el loop atiende timers y el resto de la I/O y
+ *   vuelve a llamar a este callback. Datagramas vacíos y errores transitorios
+ *   (p. ej. ICMP port unreachable de un envío previo) no cortan el drenado.
+ * - El backlog del control de sobrecarga es el total hasta EAGAIN, aunque
+ *   abarque varias invocaciones.
  */
 static void on_readable(int fd, EventType events, void *user_data) {
     (void)events;
     Server *srv = (Server *)user_data;
     if (!srv || fd != srv->sock) return;
+    bool more;
+    srv->rx_run += drain_socket(srv, srv->rx_budget_datagrams,
+                                (uint64_t)srv->rx_budget_us * 1000ull, &more);
+    if (more) {
+        metrics_count(METRIC_RX_BUDGET_EXHAUSTED, 1);
+        if (event_loop_mark_pending(srv->loop, fd) == PLATFORM_OK) return;
+        // Sin memoria para re-armar: drenar sin límite para no perder el flanco
+        srv->rx_run += drain_socket(srv, 0, 0, &more);
+    }
+    if (srv->overload) overload_record_backlog(srv->overload, srv->rx_run);
+    srv->rx_run = 0;
+}
 
-    uint8_t buf[RECV_BUFFER_SIZE];
-    struct sockaddr_storage peer;
+/*
+ * publish_loop_stats
+ * ------------------
+ * (Timer periódico) Vuelca a métricas el tiempo ocupado/ocioso del loop
+ * desde la muestra anterior y reporta los logs suprimidos pendientes (en modo
+ * síncrono nadie más lo hace; log_rate_limit_flush se autolimita).
+ */
+static void publish_loop_stats(void *user_data) {
+    Server *srv = (Server *)user_data;
+    EventLoopStats now;
+    event_loop_get_stats(srv->loop, &now);
+    metrics_count(METRIC_LOOP_BUSY_NS, now.busy_ns - srv->loop_stats.busy_ns);
+    metrics_count(METRIC_LOOP_IDLE_NS, now.idle_ns - srv->loop_stats.idle_ns);
+    srv->loop_stats = now;
+    log_rate_limit_flush();
+}
+
+/*
+ * overload_probe
+ * --------------
+ * (Timer periódico) Mide el lag del loop como el retraso del disparo
+ * respecto del deadline esperado y actualiza el nivel de sobrecarga.
+ */
+static void overload_probe(void *user_data) {
+    Server *srv = (Server *)user_data;
+    const uint64_t now = clock_monotonic_ns();
+    const uint64_t period = (uint64_t)OVERLOAD_PROBE_MS * 1000000ull;
+    uint64_t lag_ns = now > srv->overload_deadline_ns ? now - srv->overload_deadline_ns : 0;
+    srv->overload_deadline_ns = now + period;
+    overload_record_lag(srv->overload, lag_ns / 1000);
+    unsigned before = overload_level(srv->overload);
+    unsigned level = overload_update(srv->overload);
+    if (level != OVERLOAD_LEVEL_NONE) metrics_count(METRIC_OVERLOADED_NS, period);
+    if (level != before && srv->verbose) {
+        LOG_WARN("overload level %u -> %u (pressure %u%%)\n", before, level,
+                 (unsigned)overload_pressure_pct(srv->overload));
+    }
+}
+
+/*
+ * read_batch
+ * ----------
+ * Lee hasta 'limit' (<= RX_BATCH) datagramas y los encola por prioridad (peek
+ * de cabecera y Uri-Path, sin decodificar). Retorna cuántos leyó; '*drained'
+ * indica que el socket quedó vacío (EAGAIN). Si corta por errores
+ * persistentes no lo está: con el socket en modo flanco quedan datagramas sin
+ * un evento que los anuncie.
+ */
+static size_t read_batch(Server *srv, size_t limit, size_t depth[DISPATCH_PRIORITY_COUNT],
+                         int *errors, bool *drained) {
+    size_t count = 0;
+    *drained = false;
+    while (count < limit) {
+        RxSlot *slot = &srv->rx[count];
+        slot->peer_len = (socklen_t)sizeof(slot->peer);
+        ssize_t n = platform_socket_recvfrom(srv->sock, slot->data, sizeof(slot->data),
+                                             (struct sockaddr *)&slot->peer,
+                                             &slot->peer_len);
+        if (n == PLATFORM_EAGAIN) { *drained = true; break; }
+        if (n < 0) {
+            if (++*errors >= RECV_MAX_ERRORS) break;
+            continue;
+        }
+        if (n == 0) continue;
+        slot->len = (size_t)n;
+        slot->rx_ns = platform_get_monotonic_ns();
+        DispatchPriority prio = dispatcher_peek_priority(slot->data, slot->len);
+        srv->rx_queue[prio][depth[prio]++] = (uint8_t)count;
+        count++;
+    }
+    return count;
+}
+
+/*
+ * drain_socket
+ * ------------
+ * Lee y procesa datagramas hasta EAGAIN, por lotes. Cada lote se ordena en
+ * colas por prioridad y se atiende con round-robin ponderado (k_rx_weight):
+ * bajo contención la ingesta no espera detrás de las lecturas del dashboard,
+ * y éstas tampoco quedan sin servicio. Corta antes si se agota el
+ * presupuesto ('max_datagrams' o 'max_ns'; 0 = sin límite, el tiempo se
+ * revisa entre lotes) o tras RECV_MAX_ERRORS errores de lectura, y lo indica
+ * en '*more' para que el llamador vuelva sin esperar otro flanco. Retorna
+ * cuántos se procesaron.
+ */
+static size_t drain_socket(Server *srv, size_t max_datagrams, uint64_t max_ns, bool *more) {
+    const uint64_t start = max_ns ? platform_get_monotonic_ns() : 0;
+    int errors = 0;
+    size_t processed = 0;
+    bool drained = false;
+    *more = false;
+    while (!drained) {
+        size_t limit = RX_BATCH;
+        if (max_datagrams) {
+            if (processed >= max_datagrams) { *more = true; break; }
+            if (max_datagrams - processed < limit) limit = max_datagrams - processed;
+        }
+        if (max_ns && processed > 0 && platform_get_monotonic_ns() - start >= max_ns) {
+            *more = true;
+            break;
+        }
+        size_t depth[DISPATCH_PRIORITY_COUNT] = {0};
+        size_t count = read_batch(srv, limit, depth, &errors, &drained);
+        if (count == 0) { *more = errors >= RECV_MAX_ERRORS; break; }
+        for (int p = 0; p < DISPATCH_PRIORITY_COUNT; p++) {
+            if (depth[p] > 0) metrics_record_queue_depth((DispatchPriority)p, depth[p]);
+        }
 
-    for (;;) {
-        socklen_t peer_len = (socklen_t)sizeof(peer);
-        ssize_t n = platform_socket_recvfrom(srv->sock, buf, sizeof(buf),
-                                             (struct sockaddr *)&peer,
-                                             &peer_len);
-        if (n == PLATFORM_EAGAIN) break;
-        if (n <= 0) break;
-        process_datagram(srv, buf, (size_t)n, (const struct sockaddr *)&peer, peer_len);
+        size_t head[DISPATCH_PRIORITY_COUNT] = {0};
+        size_t left = count;
+        while (left > 0) {
+            for (int p = 0; p < DISPATCH_PRIORITY_COUNT; p++) {
+                for (unsigned w = 0; w < k_rx_weight[p] && head[p] < depth[p]; w++) {
+                    const RxSlot *slot = &srv->rx[srv->rx_queue[p][head[p]++]];
+                    metrics_record_queue_wait((DispatchPriority)p,
+                                              platform_get_monotonic_ns() - slot->rx_ns);
+                    process_datagram(srv, slot->data, slot->len,
+                                     (const struct sockaddr *)&slot->peer, slot->peer_len);
+                    left--;
+                }
+            }
+        }
+        processed += count;
+        if (errors >= RECV_MAX_ERRORS && !drained) { *more = true; break; }
     }
+    return processed;
 }
 
 /*
@@ -187,9 +801,20 @@ Server *server_create(uint16_t port, bool verbose) {
 
     srv->sock = sock;
     srv->port = query_bound_port(sock);
+    srv->outbound = coap_outbound_create(srv->loop, sock, NULL);
+    srv->overload_timer = -1;
+    srv->rx_budget_datagrams = RX_BUDGET_DATAGRAMS;
+    srv->rx_budget_us = RX_BUDGET_US;
+    srv->stats_timer = event_loop_add_timer(srv->loop, LOOP_STATS_MS, true,
+                                            publish_loop_stats, srv);
 
-    int rc = event_loop_add_fd(srv->loop, srv->sock, EVENT_READ, on_readable, srv);
+    int rc = srv->outbound && srv->stats_timer > 0
+                 ? event_loop_add_fd(srv->loop, srv->sock,
+                                     (EventType)(EVENT_READ | EVENT_EDGE),
+                                     on_readable, srv)
+                 : PLATFORM_ENOMEM;
     if (rc != PLATFORM_OK) {
+        coap_outbound_destroy(srv->outbound);
         platform_socket_close(sock);
         event_loop_destroy(srv->loop);
         free(srv);
@@ -203,22 +828,105 @@ Server *server_create(uint16_t port, bool verbose) {
     return srv;
 }
 
+/*
+ * shutdown_pool
+ * -------------
+ * Destruye el pool (los workers terminan los jobs encolados) y corre el loop
+ * hasta enviar todas las respuestas devueltas, para no perder ni filtrar jobs.
+ */
+static void shutdown_pool(Server *srv) {
+    if (!srv->pool) return;
+    work_pool_destroy(srv->pool);
+    srv->pool = NULL;
+    while (atomic_load(&srv->offload_inflight) > 0) {
+        if (event_loop_run(srv->loop, 0) != PLATFORM_OK) break;
+    }
+}
+
 /*
  * server_destroy
  * --------------
- * Libera recursos asociados al servidor: desregistra el FD del loop, cierra el
- * socket y destruye el EventLoop.
+ * Libera recursos asociados al servidor: desregistra el FD del loop, vacía el
+ * pool de workers, cierra el socket y destruye el EventLoop.
  */
 void server_destroy(Server *srv) {
     if (!srv) return;
+    http_server_destroy(srv->http);
     if (srv->loop && srv->sock >= 0) {
         event_loop_remove_fd(srv->loop, srv->sock);
     }
+    shutdown_pool(srv);
+    coap_outbound_destroy(srv->outbound);
+    ratelimit_destroy(srv->ratelimit);
+    if (srv->overload_timer > 0) event_loop_remove_timer(srv->loop, srv->overload_timer);
+    overload_destroy(srv->overload);
+    if (srv->stats_timer > 0) event_loop_remove_timer(srv->loop, srv->stats_timer);
     if (srv->sock >= 0) platform_socket_close(srv->sock);
     if (srv->loop) event_loop_destroy(srv->loop);
     free(srv);
 }
 
+/*
+ * run_busy_poll
+ * -------------
+ * Alterna dos fases:
+ * - Giro: recv no bloqueante en bucle mientras llegue tráfico; termina tras
+ *   busy_poll_ns sin datagramas. Cada BUSY_POLL_LOOP_EVERY sondeos vacíos se
+ *   da una vuelta no bloqueante al loop para timers y HTTP.
+ * - Espera: una vuelta bloqueante del loop (despierta por I/O o timers).
+ * Con run_timeout_ms >= 0 hace un giro y una vuelta (con ese timeout si el
+ * giro no obtuvo tráfico). El tiempo de cada fase se publica en métricas.
+ * Cada tanda drenada hasta EAGAIN alimenta el backlog del control de
+ * sobrecarga, como en on_readable.
+ */
+static int run_busy_poll(Server *srv, int run_timeout_ms) {
+    atomic_store(&srv->stop, false);
+    do {
+        const uint64_t spin_start = clock_monotonic_ns();
+        uint64_t now = spin_start, idle_since = spin_start;
+        size_t received = 0;
+        unsigned empty_polls = 0;
+        while (now - idle_since < srv->busy_poll_ns && !atomic_load_explicit(&srv->stop, memory_order_relaxed)) {
+            bool more;
+            size_t n = drain_socket(srv, srv->rx_budget_datagrams,
+                                    (uint64_t)srv->rx_budget_us * 1000ull, &more);
+            now = clock_monotonic_ns();
+            if (n > 0) {
+                received += n;
+                idle_since = now;
+            }
+            // Mismo backlog que on_readable: datagramas hasta EAGAIN, aunque
+            // abarque varios sondeos; los sondeos vacíos no son un despertar
+            srv->rx_run += n;
+            if (!more && srv->rx_run > 0) {
+                if (srv->overload) overload_record_backlog(srv->overload, srv->rx_run);
+                srv->rx_run = 0;
+            }
+            if (more) metrics_count(METRIC_RX_BUDGET_EXHAUSTED, 1);
+            // Con respuestas de workers pendientes o el presupuesto agotado se
+            // atiende el loop en cada sondeo: bajo tráfico continuo el giro no
+            // terminaría nunca
+            bool offloads = atomic_load_explicit(&srv->offload_inflight, memory_order_relaxed) > 0;
+            if (offloads || more || (n == 0 && ++empty_polls % BUSY_POLL_LOOP_EVERY == 0)) {
+                int rc = event_loop_run(srv->loop, 0);
+                if (rc != PLATFORM_OK) return rc;
+                now = clock_monotonic_ns();
+            }
+        }
+        metrics_count(METRIC_BUSY_POLL_SPIN_NS, now - spin_start);
+        metrics_count(METRIC_BUSY_POLL_RX, received);
+        if (atomic_load(&srv->stop)) break;
+
+        int wait_ms = run_timeout_ms >= 0 ? (received > 0 ? 0 : run_timeout_ms) : BUSY_POLL_SLEEP_MS;
+        metrics_count(METRIC_BUSY_POLL_SLEEPS, 1);
+        const uint64_t sleep_start = clock_monotonic_ns();
+        int rc = event_loop_run(srv->loop, wait_ms);
+        metrics_count(METRIC_BUSY_POLL_SLEEP_NS, clock_monotonic_ns() - sleep_start);
+        if (rc != PLATFORM_OK) return rc;
+    } while (run_timeout_ms < 0 && !atomic_load(&srv->stop));
+    return PLATFORM_OK;
+}
+
 /*
  * server_run
  * ----------
@@ -231,6 +939,7 @@ void server_destroy(Server *srv) {
  */
 int server_run(Server *srv, int run_timeout_ms) {
     if (!srv) return PLATFORM_EINVAL;
+    if (srv->busy_poll_ns > 0) return run_busy_poll(srv, run_timeout_ms);
     return event_loop_run(srv->loop, run_timeout_ms);
 }
 
@@ -241,9 +950,102 @@ int server_run(Server *srv, int run_timeout_ms) {
  */
 void server_stop(Server *srv) {
     if (!srv) return;
+    atomic_store(&srv->stop, true);
     event_loop_stop(srv->loop);
 }
 
+/*
+ * server_set_busy_poll
+ * --------------------
+ * Habilita (budget_us > 0) o deshabilita el modo busy-poll. SO_BUSY_POLL se
+ * pide al kernel con el mismo presupuesto; si lo rechaza (sin soporte o sin
+ * CAP_NET_ADMIN) se continúa sólo con el giro en espacio de usuario.
+ */
+int server_set_busy_poll(Server *srv, uint32_t budget_us) {
+    if (!srv) return PLATFORM_EINVAL;
+    srv->busy_poll_ns = (uint64_t)budget_us * 1000ull;
+    if (budget_us > 0 && platform_socket_set_busy_poll(srv->sock, budget_us) != PLATFORM_OK) {
+        LOG_WARN("busy-poll: kernel SO_BUSY_POLL unavailable, spinning in user space only\n");
+    }
+    return PLATFORM_OK;
+}
+
+/*
+ * server_set_workers
+ * ------------------
+ * Crea (o reemplaza) el pool de workers para las rutas offload. 0 lo
+ * deshabilita: todo vuelve a ejecutarse inline. Los jobs en curso del pool
+ * anterior se completan y envían antes de reemplazarlo. Llamar desde el hilo
+ * del loop (o con el loop detenido).
+ */
+int server_set_workers(Server *srv, unsigned workers) {
+    if (!srv || workers > WORK_POOL_MAX_WORKERS) return PLATFORM_EINVAL;
+    shutdown_pool(srv);
+    if (workers == 0) return PLATFORM_OK;
+    srv->pool = work_pool_create(workers);
+    return srv->pool ? PLATFORM_OK : PLATFORM_ERROR;
+}
+
+/*
+ * server_set_rate_limit
+ * ---------------------
+ * Reemplaza (o quita, con rate == 0) el limitador por peer y lo publica
+ * para /api/v1/status. Llamar desde el hilo del loop (o con el loop detenido).
+ */
+int server_set_rate_limit(Server *srv, uint32_t rate, uint32_t burst) {
+    if (!srv) return PLATFORM_EINVAL;
+    RateLimiter *rl = NULL;
+    if (rate > 0) {
+        rl = ratelimit_create(rate, burst, RATELIMIT_DEFAULT_SLOTS);
+        if (!rl) return PLATFORM_ENOMEM;
+    }
+    ratelimit_destroy(srv->ratelimit);
+    srv->ratelimit = rl;
+    if (rl) ratelimit_set_active(rl);
+    return PLATFORM_OK;
+}
+
+/*
+ * server_set_overload
+ * -------------------
+ * Habilita (o reemplaza, o quita con lag_ms == 0) el control de sobrecarga:
+ * arma la sonda periódica de lag y registra el backlog de cada drenado.
+ */
+int server_set_overload(Server *srv, uint32_t lag_ms, uint32_t backlog) {
+    if (!srv) return PLATFORM_EINVAL;
+    if (srv->overload_timer > 0) event_loop_remove_timer(srv->loop, srv->overload_timer);
+    srv->overload_timer = -1;
+    overload_destroy(srv->overload);
+    srv->overload = NULL;
+    if (lag_ms == 0) return PLATFORM_OK;
+
+    OverloadConfig cfg = { lag_ms * 1000u, backlog };
+    srv->overload = overload_create(&cfg);
+    if (!srv->overload) return PLATFORM_ENOMEM;
+    srv->overload_deadline_ns = clock_monotonic_ns() + (uint64_t)OVERLOAD_PROBE_MS * 1000000ull;
+    srv->overload_timer = event_loop_add_timer(srv->loop, OVERLOAD_PROBE_MS, true,
+                                               overload_probe, srv);
+    if (srv->overload_timer < 0) {
+        overload_destroy(srv->overload);
+        srv->overload = NULL;
+        return PLATFORM_ERROR;
+    }
+    return PLATFORM_OK;
+}
+
+/*
+ * server_set_rx_budget
+ * --------------------
+ * Ajusta el presupuesto de cada callback de lectura (0 = sin límite en esa
+ * dimensión; ambos en 0 drenan hasta EAGAIN como antes).
+ */
+int server_set_rx_budget(Server *srv, uint32_t max_datagrams, uint32_t max_us) {
+    if (!srv) return PLATFORM_EINVAL;
+    srv->rx_budget_datagrams = max_datagrams;
+    srv->rx_budget_us = max_us;
+    return PLATFORM_OK;
+}
+
 /*
  * server_get_port
  * ---------------
@@ -251,4 +1053,25 @@ void server_stop(Server *srv) {
  */
 uint16_t server_get_port(const Server *srv) {
     return srv ? srv->port : 0;
-}
\ No newline at end of file
+}
+
+/*
+ * server_enable_http
+ * ------------------
+ * Agrega un listener HTTP/1.1 de sólo lectura (métricas Prometheus y
+ * consultas JSON) en el mismo EventLoop. Sólo puede habilitarse una vez.
+ */
+int server_enable_http(Server *srv, uint16_t port) {
+    if (!srv || srv->http) return PLATFORM_EINVAL;
+    srv->http = http_server_create(srv->loop, port, srv->verbose);
+    return srv->http ? PLATFORM_OK : PLATFORM_ERROR;
+}
+
+/*
+ * server_get_http_port
+ * --------------------
+ * Puerto TCP del listener HTTP (0 si no está habilitado).
+ */
+uint16_t server_get_http_port(const Server *srv) {
+    return srv ? http_server_get_port(srv->http) : 0;
+}
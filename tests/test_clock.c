@@ -0,0 +1,91 @@
+#include "clock.h"
+#include "event_loop.h"
+#include "time_source.h"
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+
+static void sleep_ms(long ms) {
+	struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+	nanosleep(&ts, NULL);
+}
+
+static void test_sources(void) {
+	uint64_t m1 = clock_monotonic_ns();
+	uint64_t m2 = clock_monotonic_ns();
+	assert(m2 >= m1);
+	assert(clock_monotonic_ms() >= m1 / 1000000ull);
+
+	// Reloj de pared ~ time(NULL) (en ms)
+	uint64_t wall = clock_wall_ms();
+	uint64_t secs = (uint64_t)time(NULL);
+	assert(wall / 1000 + 1 >= secs && wall / 1000 <= secs + 1);
+	printf("✓ test_sources\n");
+}
+
+static void test_cache_refresh_and_fallback(void) {
+	// Sin refresh vigente: lectura real
+	uint64_t a = clock_now_ns();
+	sleep_ms(2);
+	assert(clock_now_ns() > a);
+
+	// Con refresh: valor fijo hasta el próximo refresh
+	clock_refresh();
+	uint64_t c1 = clock_now_ns();
+	uint64_t w1 = clock_wall_now_ms();
+	sleep_ms(2);
+	assert(clock_now_ns() == c1);
+	assert(clock_wall_now_ms() == w1);
+	assert(time_source_now_ms() == w1);
+	clock_refresh();
+	assert(clock_now_ns() >= c1 + 2000000ull);
+
+	// Invalidado: vuelve al reloj real
+	clock_invalidate();
+	uint64_t r = clock_now_ns();
+	sleep_ms(1);
+	assert(clock_now_ns() > r);
+	printf("✓ test_cache_refresh_and_fallback\n");
+}
+
+typedef struct {
+	int fired;
+	uint64_t seen_ns[2];
+} CacheProbe;
+
+static void on_timer(void *user_data) {
+	CacheProbe *p = user_data;
+	// Dos lecturas en el mismo callback ven el mismo instante
+	p->seen_ns[0] = clock_now_ns();
+	sleep_ms(1);
+	p->seen_ns[1] = clock_now_ns();
+	p->fired++;
+}
+
+static void test_loop_refreshes_once_per_wakeup(void) {
+	EventLoop *loop = event_loop_create();
+	assert(loop);
+	CacheProbe probe = {0};
+	uint64_t before = clock_monotonic_ns();
+	assert(event_loop_add_timer(loop, 5, false, on_timer, &probe) > 0);
+	for (int i = 0; i < 50 && probe.fired == 0; i++) event_loop_run(loop, 10);
+	assert(probe.fired == 1);
+	assert(probe.seen_ns[0] == probe.seen_ns[1]);
+	assert(probe.seen_ns[0] >= before + 5000000ull);
+
+	// Al retornar del loop el hilo deja de ver el valor cacheado
+	uint64_t after = clock_now_ns();
+	sleep_ms(1);
+	assert(clock_now_ns() > after);
+	event_loop_destroy(loop);
+	printf("✓ test_loop_refreshes_once_per_wakeup\n");
+}
+
+int main(void) {
+	printf("=== Tests de reloj ===\n");
+	test_sources();
+	test_cache_refresh_and_fallback();
+	test_loop_refreshes_once_per_wakeup();
+	printf("✓ Todos los tests de reloj pasaron\n");
+	return 0;
+}
@@ -176,6 +176,82 @@ msg.code = COAP_METHOD_GET;
 	printf("✓ test_no_payload_marker_when_empty\n");
 }
 
+static void test_encode_iov_matches_contiguous(void) {
+	CoapMessage msg;
+	build_basic_message(&msg);
+
+	uint8_t flat[COAP_MAX_MESSAGE_SIZE];
+	int n = coap_encode(&msg, flat, sizeof(flat));
+	assert(n > 0);
+
+	uint8_t hdr[64];
+	struct iovec iov[COAP_ENCODE_IOV_MAX];
+	size_t iov_count = 0;
+	int total = coap_encode_iov(&msg, hdr, sizeof(hdr), iov, &iov_count);
+	assert(total == n);
+	assert(iov_count == 2);
+	// El payload no se copia: iov[1] apunta al buffer del mensaje
+	assert(iov[1].iov_base == msg.payload);
+	assert(iov[0].iov_len + iov[1].iov_len == (size_t)n);
+	assert(memcmp(flat, iov[0].iov_base, iov[0].iov_len) == 0);
+	assert(memcmp(flat + iov[0].iov_len, iov[1].iov_base, iov[1].iov_len) == 0);
+
+	// Sin payload => un solo elemento y sin payload marker
+	msg.payload = NULL;
+	msg.payload_length = 0;
+	total = coap_encode_iov(&msg, hdr, sizeof(hdr), iov, &iov_count);
+	assert(total > 0 && iov_count == 1);
+	assert(hdr[total - 1] != COAP_PAYLOAD_MARKER);
+
+	// Buffer de header insuficiente
+	assert(coap_encode_iov(&msg, hdr, 4, iov, &iov_count) == COAP_CODEC_E2SMALL);
+	printf("✓ test_encode_iov_matches_contiguous\n");
+}
+
+static void test_fast_path_matches_generic(void) {
+	// Request común (CON GET con Uri-Path y Accept) y variantes que fuerzan el
+	// decodificador genérico (respuesta, opción extendida 14, RST).
+	CoapMessage msg;
+	build_basic_message(&msg);
+	uint8_t bufs[4][COAP_MAX_MESSAGE_SIZE];
+	int lens[4];
+	lens[0] = coap_encode(&msg, bufs[0], sizeof(bufs[0]));
+	msg.code = COAP_RESPONSE_CONTENT;
+	lens[1] = coap_encode(&msg, bufs[1], sizeof(bufs[1]));
+	msg.code = COAP_METHOD_POST;
+	uint8_t big[COAP_MAX_OPTION_VALUE_LENGTH];
+	memset(big, 'x', sizeof(big));
+	assert(coap_message_add_option(&msg, COAP_OPTION_URI_QUERY, big, sizeof(big)) == 0);
+	msg.type = COAP_TYPE_NON_CONFIRMABLE;
+	lens[2] = coap_encode(&msg, bufs[2], sizeof(bufs[2]));
+	msg.type = COAP_TYPE_RESET;
+	lens[3] = coap_encode(&msg, bufs[3], sizeof(bufs[3]));
+
+	for (size_t i = 0; i < 4; i++) {
+		assert(lens[i] > 0);
+		CoapMessage a, b;
+		assert(coap_decode(&a, bufs[i], (size_t)lens[i]) == 0);
+		assert(coap_decode_generic(&b, bufs[i], (size_t)lens[i]) == 0);
+		assert_messages_equal(&a, &b);
+		// Errores siempre iguales en ambos caminos (truncado dentro de opciones)
+		assert(coap_decode(&a, bufs[i], 9) == coap_decode_generic(&b, bufs[i], 9));
+	}
+
+	// Opción de longitud 0 como último byte del datagrama (sin payload)
+	CoapMessage z;
+	coap_message_init(&z);
+	z.code = COAP_METHOD_GET;
+	assert(coap_message_add_option(&z, COAP_OPTION_IF_NONE_MATCH, NULL, 0) == 0);
+	uint8_t zb[16];
+	int zn = coap_encode(&z, zb, sizeof(zb));
+	assert(zn == 5);
+	CoapMessage zd;
+	assert(coap_decode(&zd, zb, (size_t)zn) == 0);
+	assert(zd.option_count == 1 && zd.options[0].number == COAP_OPTION_IF_NONE_MATCH);
+	assert(coap_decode_generic(&zd, zb, (size_t)zn) == 0);
+	printf("✓ test_fast_path_matches_generic\n");
+}
+
 int main(void) {
 	printf("=== Tests de codec CoAP ===\n");
 
@@ -188,6 +264,8 @@ int main(void) {
 	test_length_over_270_decode_error();
 	test_small_output_buffer_encode_error();
 	test_no_payload_marker_when_empty();
+	test_encode_iov_matches_contiguous();
+	test_fast_path_matches_generic();
 
 	printf("✓ Todos los tests de codec pasaron\n");
 	return 0;
@@ -1,9 +1,14 @@
 #include "dispatcher.h"
 #include "handlers.h"
 #include "coap_codec.h"
+#include "telemetry_storage.h"
+#include "metrics.h"
+#include "ratelimit.h"
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 
 static void build_request(CoapMessage *req, CoapType type, CoapCode method,
                           const char *uri_path, const uint8_t *payload, size_t payload_len) {
@@ -47,6 +52,15 @@ static void assert_token_and_id_mirrored(const CoapMessage *req, const CoapMessa
     assert(memcmp(req->token, resp->token, req->token_length) == 0);
 }
 
+// Copia el payload como string para buscar en él
+static const char *payload_text(const CoapMessage *resp) {
+    static char text[COAP_MAX_MESSAGE_SIZE + 1];
+    size_t len = resp->payload ? resp->payload_length : 0;
+    memcpy(text, resp->payload_buffer, len);
+    text[len] = '\0';
+    return text;
+}
+
 static void test_get_hello(void) {
     CoapMessage req, resp;
     build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/hello", NULL, 0);
@@ -118,6 +132,223 @@ static void test_method_not_allowed(void) {
     printf("✓ test_method_not_allowed\n");
 }
 
+static void test_conditional_get_telemetry(void) {
+    telemetry_storage_init();
+    CoapMessage req, resp;
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/telemetry", NULL, 0);
+    assert(dispatcher_handle_request(&req, &resp) == 0);
+    assert(resp.code == COAP_RESPONSE_CONTENT);
+    const CoapOptionDef *etag = coap_message_find_option(&resp, COAP_OPTION_ETAG);
+    assert(etag && etag->length > 0 && etag->length <= 8);
+    CoapOptionDef first = *etag;
+
+    // Mismo ETag => 2.03 Valid sin payload, repitiendo el ETag
+    assert(coap_message_add_option(&req, COAP_OPTION_ETAG, first.value, first.length) == 0);
+    assert(dispatcher_handle_request(&req, &resp) == 0);
+    assert(resp.code == COAP_RESPONSE_VALID);
+    assert(resp.payload == NULL && resp.payload_length == 0);
+    etag = coap_message_find_option(&resp, COAP_OPTION_ETAG);
+    assert(etag && etag->length == first.length);
+    assert(memcmp(etag->value, first.value, first.length) == 0);
+
+    // /status no es condicional: uptime_ms cambia sin cambiar la generación
+    CoapMessage sreq;
+    build_request(&sreq, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/status", NULL, 0);
+    assert(coap_message_add_option(&sreq, COAP_OPTION_ETAG, first.value, first.length) == 0);
+    assert(dispatcher_handle_request(&sreq, &resp) == 0);
+    assert(resp.code == COAP_RESPONSE_CONTENT);
+    assert(resp.payload_length > 0);
+    assert(coap_message_find_option(&resp, COAP_OPTION_ETAG) == NULL);
+
+    // Un nuevo dato cambia la generación => representación completa
+    const char *json = "{\"temperatura\":1,\"humedad\":2,\"voltaje\":3,\"cantidad_producida\":4}";
+    assert(telemetry_storage_add(json, strlen(json)) == 0);
+    assert(dispatcher_handle_request(&req, &resp) == 0);
+    assert(resp.code == COAP_RESPONSE_CONTENT);
+    assert(resp.payload && resp.payload_length > 2);
+    etag = coap_message_find_option(&resp, COAP_OPTION_ETAG);
+    assert(etag);
+    assert(etag->length != first.length || memcmp(etag->value, first.value, first.length) != 0);
+    printf("✓ test_conditional_get_telemetry\n");
+}
+
+static void test_routes_and_metrics(void) {
+    CoapMessage req, resp;
+    DispatchRoute route = DISPATCH_ROUTE_COUNT;
+
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/telemetry", NULL, 0);
+    assert(dispatcher_handle_request_routed(&req, &resp, &route) == 0);
+    assert(route == DISPATCH_ROUTE_TELEMETRY_GET);
+    assert(strcmp(dispatcher_route_name(route), "telemetry_get") == 0);
+
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_DELETE, "/api/v1/telemetry", NULL, 0);
+    assert(dispatcher_handle_request_routed(&req, &resp, &route) == 0);
+    assert(resp.code == COAP_ERROR_METHOD_NOT_ALLOWED);
+    assert(route == DISPATCH_ROUTE_UNMATCHED);
+
+    metrics_reset();
+    metrics_count(METRIC_DROP_DECODE, 2);
+    metrics_record_request(DISPATCH_ROUTE_HEALTH, COAP_RESPONSE_CONTENT, 5000);
+
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/metrics", NULL, 0);
+    assert(dispatcher_handle_request_routed(&req, &resp, &route) == 0);
+    assert(route == DISPATCH_ROUTE_METRICS);
+    assert(resp.code == COAP_RESPONSE_CONTENT);
+    assert(resp.payload && resp.payload_length > 0);
+    const char *body = payload_text(&resp);
+    assert(strstr(body, "\"counters\":{\"drop_decode\":2}"));
+    assert(strstr(body, "\"2xx\":[1,"));
+    assert(!strstr(body, "\"routes\""));
+
+    // Latencia por ruta y colas en sus propios recursos (misma ruta de métricas)
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/metrics/routes", NULL, 0);
+    assert(dispatcher_handle_request_routed(&req, &resp, &route) == 0);
+    assert(route == DISPATCH_ROUTE_METRICS && resp.code == COAP_RESPONSE_CONTENT);
+    assert(strstr(payload_text(&resp), "\"routes\":{\"health\":[1,"));
+
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/metrics/queues", NULL, 0);
+    assert(dispatcher_handle_request_routed(&req, &resp, &route) == 0);
+    assert(route == DISPATCH_ROUTE_METRICS && resp.code == COAP_RESPONSE_CONTENT);
+    assert(strstr(payload_text(&resp), "\"queue_wait\":{},\"queue_depth\":{}"));
+    printf("✓ test_routes_and_metrics\n");
+}
+
+typedef struct {
+    DispatchDeferred base;
+    int completions;
+    CoapCode code;
+    size_t payload_length;
+} FakeDeferred;
+
+static void fake_complete(DispatchDeferred *deferred, const CoapMessage *resp) {
+    FakeDeferred *fake = (FakeDeferred *)deferred;
+    fake->completions++;
+    fake->code = resp->code;
+    fake->payload_length = resp->payload_length;
+}
+
+static DispatchDeferred *fake_defer(void *ctx, const CoapMessage *req) {
+    (void)req;
+    return &((FakeDeferred *)ctx)->base;
+}
+
+static void test_deferred_response(void) {
+    CoapMessage req, resp;
+    DispatchRoute route;
+    const uint8_t payload[] = "later";
+
+    // Sin proveedor: el handler responde en línea
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_POST, "/test/separate", payload, 5);
+    assert(dispatcher_handle_request_routed(&req, &resp, &route) == 0);
+    assert(route == DISPATCH_ROUTE_TEST_SEPARATE);
+    assert(resp.code == COAP_RESPONSE_CONTENT && resp.payload_length == 5);
+
+    // Con proveedor: retorna DISPATCH_DEFERRED y completa una única vez
+    FakeDeferred fake = { { fake_complete }, 0, 0, 0 };
+    dispatcher_set_defer(fake_defer, &fake);
+    assert(dispatcher_handle_request_routed(&req, &resp, &route) == DISPATCH_DEFERRED);
+    dispatcher_set_defer(NULL, NULL);
+    assert(fake.completions == 1 && fake.code == COAP_RESPONSE_CONTENT && fake.payload_length == 5);
+    assert(dispatcher_defer(&req) == NULL);
+    assert(strcmp(dispatcher_route_name(DISPATCH_ROUTE_TEST_SEPARATE), "test_separate") == 0);
+    printf("✓ test_deferred_response\n");
+}
+
+static DispatchPriority peek(const CoapMessage *msg) {
+    uint8_t wire[COAP_MAX_MESSAGE_SIZE];
+    int n = coap_encode(msg, wire, sizeof(wire));
+    assert(n > 0);
+    DispatchPriority prio = dispatcher_peek_priority(wire, (size_t)n);
+    // El peek coincide con la prioridad de la ruta resuelta por el decode
+    if (msg->code != 0 && msg->type != COAP_TYPE_ACKNOWLEDGMENT) {
+        assert(prio == dispatcher_route_priority(dispatcher_match_route(msg)));
+    }
+    return prio;
+}
+
+static void test_peek_priority(void) {
+    CoapMessage req;
+    const uint8_t payload[] = "{\"t\":21.5}";
+
+    build_request(&req, COAP_TYPE_NON_CONFIRMABLE, COAP_METHOD_POST, "/api/v1/telemetry", payload, 11);
+    assert(peek(&req) == DISPATCH_PRIORITY_HIGH);
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/telemetry", NULL, 0);
+    assert(peek(&req) == DISPATCH_PRIORITY_LOW);
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/health", NULL, 0);
+    assert(peek(&req) == DISPATCH_PRIORITY_HIGH);
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/hello", NULL, 0);
+    assert(peek(&req) == DISPATCH_PRIORITY_LOW);
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_POST, "/test/echo", payload, 11);
+    assert(peek(&req) == DISPATCH_PRIORITY_NORMAL);
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/no/such/route/with-a-long-segment", NULL, 0);
+    assert(peek(&req) == DISPATCH_PRIORITY_NORMAL);
+
+    // Opciones antes (Uri-Host) y después (Content-Format) del Uri-Path
+    build_request(&req, COAP_TYPE_CONFIRMABLE, COAP_METHOD_POST, "/api/v1/telemetry", payload, 11);
+    assert(coap_message_add_option(&req, COAP_OPTION_URI_HOST, (const uint8_t *)"sensors.example.org", 19) == 0);
+    uint8_t fmt = 50;
+    assert(coap_message_add_option(&req, COAP_OPTION_CONTENT_FORMAT, &fmt, 1) == 0);
+    assert(peek(&req) == DISPATCH_PRIORITY_HIGH);
+
+    // ACK vacío: libera estado propio, va primero
+    coap_message_init(&req);
+    req.type = COAP_TYPE_ACKNOWLEDGMENT;
+    req.message_id = 0x0BAD;
+    assert(peek(&req) == DISPATCH_PRIORITY_HIGH);
+
+    // Malformados: NORMAL (el decode completo los descarta)
+    const uint8_t bad_version[] = { 0x80, 0x01, 0x00, 0x01 };
+    const uint8_t truncated[] = { 0x40, 0x02, 0x00, 0x01, 0xBD };
+    assert(dispatcher_peek_priority(bad_version, sizeof(bad_version)) == DISPATCH_PRIORITY_NORMAL);
+    assert(dispatcher_peek_priority(truncated, sizeof(truncated)) == DISPATCH_PRIORITY_NORMAL);
+    assert(dispatcher_peek_priority(NULL, 0) == DISPATCH_PRIORITY_NORMAL);
+    assert(strcmp(dispatcher_priority_name(DISPATCH_PRIORITY_LOW), "low") == 0);
+    printf("✓ test_peek_priority\n");
+}
+
+// /status refleja los offenders del limitador aunque la telemetría (y con
+// ella su generación/ETag) no cambie y el cliente reenvíe un ETag viejo
+static void test_status_reflects_offenders(void) {
+    telemetry_storage_init();
+    CoapMessage treq, resp;
+    build_request(&treq, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/telemetry", NULL, 0);
+    assert(dispatcher_handle_request(&treq, &resp) == 0);
+    const CoapOptionDef *etag = coap_message_find_option(&resp, COAP_OPTION_ETAG);
+    assert(etag);
+    CoapOptionDef old = *etag;
+    uint64_t gen = telemetry_storage_get_generation();
+
+    RateLimiter *rl = ratelimit_create(1, 1, 0);
+    assert(rl);
+    ratelimit_set_active(rl);
+
+    CoapMessage sreq;
+    build_request(&sreq, COAP_TYPE_CONFIRMABLE, COAP_METHOD_GET, "/api/v1/status", NULL, 0);
+    assert(coap_message_add_option(&sreq, COAP_OPTION_ETAG, old.value, old.length) == 0);
+    assert(dispatcher_handle_request(&sreq, &resp) == 0);
+    assert(resp.code == COAP_RESPONSE_CONTENT);
+    assert(strstr(payload_text(&resp), "\"rate_limited\":[]"));
+
+    // Un peer excede su ráfaga: cambia el estado sin tocar el storage
+    struct sockaddr_in peer;
+    memset(&peer, 0, sizeof(peer));
+    peer.sin_family = AF_INET;
+    peer.sin_port = htons(5683);
+    assert(inet_pton(AF_INET, "10.1.2.3", &peer.sin_addr) == 1);
+    assert(ratelimit_check(rl, (const struct sockaddr *)&peer, 1000) == 0);
+    assert(ratelimit_check(rl, (const struct sockaddr *)&peer, 1000) > 0);
+    assert(telemetry_storage_get_generation() == gen);
+
+    assert(dispatcher_handle_request(&sreq, &resp) == 0);
+    assert(resp.code == COAP_RESPONSE_CONTENT);
+    assert(strstr(payload_text(&resp), "10.1.2.3"));
+    assert(coap_message_find_option(&resp, COAP_OPTION_ETAG) == NULL);
+
+    ratelimit_set_active(NULL);
+    ratelimit_destroy(rl);
+    printf("✓ test_status_reflects_offenders\n");
+}
+
 int main(void) {
     printf("=== Tests de dispatcher ===\n");
 
@@ -126,7 +357,12 @@ int main(void) {
     test_post_echo();
     test_not_found();
     test_method_not_allowed();
+    test_conditional_get_telemetry();
+    test_status_reflects_offenders();
+    test_routes_and_metrics();
+    test_deferred_response();
+    test_peek_priority();
 
     printf("✓ Todos los tests de dispatcher pasaron\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -1,10 +1,14 @@
 #include "event_loop.h"
 #include "platform.h"
+#include "clock.h"
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 static int read_count = 0;
 static int timer_count = 0;
@@ -92,6 +96,356 @@ static void test_read_event_once(void) {
 	printf("✓ test_read_event_once\n");
 }
 
+typedef struct {
+	EventLoop *loop;
+	int ticks;
+	int stop_after;
+	uint64_t fired_ns;
+} TickState;
+
+static void on_tick(void *user_data) {
+	TickState *st = user_data;
+	if (++st->ticks == st->stop_after) event_loop_stop(st->loop);
+}
+
+static void on_deadline(void *user_data) {
+	TickState *st = user_data;
+	st->fired_ns = clock_monotonic_ns();
+	event_loop_stop(st->loop);
+}
+
+static void on_busy(int fd, EventType events, void *user_data) {
+	(void)fd; (void)events;
+	(*(int *)user_data)++; // no lee: el fd queda siempre listo
+}
+
+static void test_us_periodic_timer(void) {
+	EventLoop *loop = event_loop_create();
+	assert(loop != NULL);
+
+	// 40 ticks de 500 µs: ~20 ms (con timeouts en ms tardaría >= 40 ms)
+	TickState st = { loop, 0, 40, 0 };
+	int tid = event_loop_add_timer_us(loop, 500, true, on_tick, &st);
+	assert(tid > 0);
+	uint64_t t0 = clock_monotonic_ns();
+	event_loop_run(loop, -1);
+	uint64_t elapsed_ms = (clock_monotonic_ns() - t0) / 1000000ull;
+	assert(st.ticks == 40);
+	assert(elapsed_ms >= 19 && elapsed_ms < 38);
+	event_loop_remove_timer(loop, tid);
+	event_loop_destroy(loop);
+	printf("✓ test_us_periodic_timer (%llu ms)\n", (unsigned long long)elapsed_ms);
+}
+
+static void test_timer_fires_while_fd_busy(void) {
+	EventLoop *loop = event_loop_create();
+	assert(loop != NULL);
+
+	int pipes[2];
+	assert(pipe(pipes) == 0);
+	assert(write(pipes[1], "x", 1) == 1);
+	int busy = 0;
+	assert(event_loop_add_fd(loop, pipes[0], EVENT_READ, on_busy, &busy) == 0);
+
+	TickState st = { loop, 0, 0, 0 };
+	uint64_t expected = clock_monotonic_ns() + 5000000ull;
+	assert(event_loop_add_timer(loop, 5, false, on_deadline, &st) > 0);
+	event_loop_run(loop, -1);
+	assert(st.fired_ns >= expected);
+	assert(st.fired_ns - expected < 2000000ull); // < 2 ms de retraso
+	assert(busy > 0);
+
+	close(pipes[0]);
+	close(pipes[1]);
+	event_loop_destroy(loop);
+	printf("✓ test_timer_fires_while_fd_busy\n");
+}
+
+static void on_read_one(int fd, EventType events, void *user_data) {
+	(void)events;
+	char c;
+	assert(read(fd, &c, 1) == 1); // lee sólo 1 byte aunque haya más
+	(*(int *)user_data)++;
+}
+
+static void test_high_fd_and_edge(void) {
+	// fd >= 1024 (antes rechazado por MAX_FDS)
+	struct rlimit rl;
+	assert(getrlimit(RLIMIT_NOFILE, &rl) == 0);
+	if (rl.rlim_cur < 2100 && rl.rlim_max >= 2100) {
+		rl.rlim_cur = 2100;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+	int pipes[2];
+	assert(pipe(pipes) == 0);
+	int high = dup2(pipes[0], 2048);
+	if (high < 0) {
+		printf("✓ test_high_fd_and_edge (omitido: RLIMIT_NOFILE)\n");
+		close(pipes[0]); close(pipes[1]);
+		return;
+	}
+	fcntl(high, F_SETFL, fcntl(high, F_GETFL, 0) | O_NONBLOCK);
+
+	EventLoop *loop = event_loop_create();
+	assert(loop != NULL);
+	int reads = 0;
+	assert(event_loop_add_fd(loop, high, (EventType)(EVENT_READ | EVENT_EDGE), on_read_one, &reads) == 0);
+	assert(event_loop_add_fd(loop, high, EVENT_READ, on_read_one, &reads) == PLATFORM_EINVAL);
+
+	// Edge-triggered: 3 bytes pero un solo flanco => una sola notificación
+	assert(write(pipes[1], "abc", 3) == 3);
+	event_loop_run(loop, 20);
+	event_loop_run(loop, 20);
+	assert(reads == 1);
+	// Datos nuevos => nuevo flanco
+	assert(write(pipes[1], "d", 1) == 1);
+	event_loop_run(loop, 20);
+	assert(reads == 2);
+
+	// Level-triggered tras modify: notifica mientras queden datos
+	assert(event_loop_modify_fd(loop, high, EVENT_READ) == 0);
+	event_loop_run(loop, 20);
+	event_loop_run(loop, 20);
+	assert(reads == 4);
+
+	assert(event_loop_remove_fd(loop, high) == 0);
+	event_loop_destroy(loop);
+	close(high); close(pipes[0]); close(pipes[1]);
+	printf("✓ test_high_fd_and_edge\n");
+}
+
+static void test_exclusive_shared_fd(void) {
+	int pipes[2];
+	assert(pipe(pipes) == 0);
+	fcntl(pipes[0], F_SETFL, fcntl(pipes[0], F_GETFL, 0) | O_NONBLOCK);
+	EventLoop *a = event_loop_create();
+	EventLoop *b = event_loop_create();
+	int reads = 0;
+	assert(event_loop_add_fd(a, pipes[0], (EventType)(EVENT_READ | EVENT_EXCLUSIVE), on_read_one, &reads) == 0);
+	assert(event_loop_add_fd(b, pipes[0], (EventType)(EVENT_READ | EVENT_EXCLUSIVE), on_read_one, &reads) == 0);
+	// Un registro exclusivo puede modificarse (se re-registra)
+	assert(event_loop_modify_fd(a, pipes[0], (EventType)(EVENT_READ | EVENT_EXCLUSIVE)) == 0);
+	assert(write(pipes[1], "x", 1) == 1);
+	event_loop_run(a, 20);
+	assert(reads == 1);
+	event_loop_destroy(a);
+	event_loop_destroy(b);
+	close(pipes[0]); close(pipes[1]);
+	printf("✓ test_exclusive_shared_fd\n");
+}
+
+#define POST_PRODUCERS 4
+#define POST_PER_PRODUCER 20000
+
+typedef struct {
+	EventLoop *loop;
+	int id;
+} PostProducer;
+
+static int post_last[POST_PRODUCERS];
+static int post_total;
+static atomic_int post_done;
+
+// Codifica (productor, secuencia) en el puntero 'arg'
+static void on_post(void *arg) {
+	intptr_t v = (intptr_t)arg;
+	int id = (int)(v % POST_PRODUCERS);
+	int seq = (int)(v / POST_PRODUCERS);
+	assert(seq == post_last[id] + 1); // FIFO por productor
+	post_last[id] = seq;
+	post_total++;
+}
+
+static void *post_producer(void *arg) {
+	PostProducer *p = (PostProducer *)arg;
+	for (int i = 0; i < POST_PER_PRODUCER; i++) {
+		intptr_t v = (intptr_t)i * POST_PRODUCERS + p->id;
+		assert(event_loop_post(p->loop, on_post, (void *)v) == PLATFORM_OK);
+	}
+	atomic_fetch_add(&post_done, 1);
+	return NULL;
+}
+
+static void test_cross_thread_post(void) {
+	EventLoop *loop = event_loop_create();
+	assert(loop);
+	for (int i = 0; i < POST_PRODUCERS; i++) post_last[i] = -1;
+	post_total = 0;
+	atomic_store(&post_done, 0);
+
+	pthread_t th[POST_PRODUCERS];
+	PostProducer args[POST_PRODUCERS];
+	for (int i = 0; i < POST_PRODUCERS; i++) {
+		args[i].loop = loop;
+		args[i].id = i;
+		assert(pthread_create(&th[i], NULL, post_producer, &args[i]) == 0);
+	}
+	const int expected = POST_PRODUCERS * POST_PER_PRODUCER;
+	uint64_t start = clock_monotonic_ms();
+	while (post_total < expected) {
+		assert(clock_monotonic_ms() - start < 10000);
+		event_loop_run(loop, 100); // Sin posts pendientes bloquearía hasta el timeout
+	}
+	for (int i = 0; i < POST_PRODUCERS; i++) pthread_join(th[i], NULL);
+	assert(post_total == expected);
+	for (int i = 0; i < POST_PRODUCERS; i++) assert(post_last[i] == POST_PER_PRODUCER - 1);
+	event_loop_destroy(loop);
+	printf("✓ test_cross_thread_post\n");
+}
+
+typedef struct {
+	EventLoop *loop;
+	int runs;
+} RepostState;
+
+// Re-encola desde el propio hilo del loop: cada tarea corre en otra vuelta
+// cuando supera el lote, sin postergar indefinidamente la I/O.
+static void on_repost(void *arg) {
+	RepostState *st = (RepostState *)arg;
+	if (++st->runs < EVENT_LOOP_POST_BATCH + 10)
+		assert(event_loop_post(st->loop, on_repost, st) == PLATFORM_OK);
+}
+
+static void test_post_from_loop_thread(void) {
+	EventLoop *loop = event_loop_create();
+	assert(loop);
+	RepostState st = { loop, 0 };
+	assert(event_loop_post(loop, on_repost, &st) == PLATFORM_OK);
+	event_loop_run(loop, 0);
+	assert(st.runs == EVENT_LOOP_POST_BATCH); // Un lote por despertar
+	event_loop_run(loop, 0);
+	assert(st.runs == EVENT_LOOP_POST_BATCH + 10);
+
+	// Pendientes al destruir: se liberan sin ejecutarse
+	int untouched = 0;
+	assert(event_loop_post(loop, on_repost, &untouched) == PLATFORM_OK);
+	assert(event_loop_post(NULL, on_repost, NULL) == PLATFORM_EINVAL);
+	assert(event_loop_post(loop, NULL, NULL) == PLATFORM_EINVAL);
+	event_loop_destroy(loop);
+	assert(untouched == 0);
+	printf("✓ test_post_from_loop_thread\n");
+}
+
+typedef struct {
+	EventLoop *loop;
+	int reads;
+	int timer_reads;     // reads vistos por el último disparo del timer
+	int ticks;
+} PendingState;
+
+// Consume un byte por invocación (presupuesto de 1) y se re-arma
+static void on_read_budgeted(int fd, EventType events, void *user_data) {
+	PendingState *st = user_data;
+	assert(events & EVENT_READ);
+	char c;
+	if (read(fd, &c, 1) != 1) return; // EAGAIN: drenado
+	st->reads++;
+	uint64_t t0 = clock_monotonic_ns();
+	while (clock_monotonic_ns() - t0 < 20000ull) {} // ~20 µs de trabajo
+
+	assert(event_loop_mark_pending(st->loop, fd) == PLATFORM_OK);
+	assert(event_loop_mark_pending(st->loop, fd) == PLATFORM_OK); // idempotente
+}
+
+static void on_pending_tick(void *user_data) {
+	PendingState *st = user_data;
+	st->ticks++;
+	st->timer_reads = st->reads;
+}
+
+static void test_mark_pending(void) {
+	EventLoop *loop = event_loop_create();
+	assert(loop != NULL);
+	int pipes[2];
+	assert(pipe(pipes) == 0);
+	fcntl(pipes[0], F_SETFL, fcntl(pipes[0], F_GETFL, 0) | O_NONBLOCK);
+	PendingState st = { loop, 0, 0, 0 };
+	assert(event_loop_add_fd(loop, pipes[0], (EventType)(EVENT_READ | EVENT_EDGE),
+	                         on_read_budgeted, &st) == 0);
+	assert(event_loop_mark_pending(loop, pipes[1]) == PLATFORM_EINVAL);
+	assert(event_loop_mark_pending(NULL, pipes[0]) == PLATFORM_EINVAL);
+
+	// Un solo flanco para 3 bytes: el re-armado los consume de a uno por
+	// vuelta, sin bloquear en la espera (timeout de 1 s nunca se cumple)
+	assert(write(pipes[1], "abc", 3) == 3);
+	uint64_t t0 = clock_monotonic_ns();
+	for (int i = 0; i < 3; i++) {
+		event_loop_run(loop, 1000);
+		assert(st.reads == i + 1);
+	}
+	event_loop_run(loop, 1000); // EAGAIN: ya no se re-arma
+	assert(clock_monotonic_ns() - t0 < 500000000ull);
+	assert(st.reads == 3);
+
+	// Con el fd siempre re-armado un timer sigue disparando entre vueltas
+	char many[256];
+	memset(many, 'x', sizeof(many));
+	assert(write(pipes[1], many, sizeof(many)) == (ssize_t)sizeof(many));
+	assert(event_loop_add_timer_us(loop, 200, true, on_pending_tick, &st) > 0);
+	while (st.reads < 3 + (int)sizeof(many)) event_loop_run(loop, 1000);
+	assert(st.ticks > 0 && st.timer_reads < 3 + (int)sizeof(many));
+
+	// Quitado mientras está pendiente: no se reinvoca
+	assert(write(pipes[1], "yz", 2) == 2);
+	event_loop_run(loop, 1000);
+	int reads = st.reads;
+	assert(event_loop_remove_fd(loop, pipes[0]) == 0);
+	event_loop_run(loop, 0);
+	assert(st.reads == reads);
+
+	EventLoopStats stats;
+	event_loop_get_stats(loop, &stats);
+	assert(stats.iterations >= 3 + sizeof(many));
+	assert(stats.busy_ns > 0);
+	event_loop_destroy(loop);
+	close(pipes[0]); close(pipes[1]);
+	printf("✓ test_mark_pending\n");
+}
+
+// Datos nuevos mientras el fd está pendiente: el flanco y la entrada de
+// pendientes no deben sumar callbacks; uno por vuelta aunque llegue carga
+static void test_mark_pending_new_data(void) {
+	EventLoop *loop = event_loop_create();
+	assert(loop != NULL);
+	int pipes[2];
+	assert(pipe(pipes) == 0);
+	fcntl(pipes[0], F_SETFL, fcntl(pipes[0], F_GETFL, 0) | O_NONBLOCK);
+	PendingState st = { loop, 0, 0, 0 };
+	assert(event_loop_add_fd(loop, pipes[0], (EventType)(EVENT_READ | EVENT_EDGE),
+	                         on_read_budgeted, &st) == 0);
+
+	assert(write(pipes[1], "ab", 2) == 2);
+	for (int i = 0; i < 64; i++) {
+		int reads = st.reads;
+		assert(write(pipes[1], "c", 1) == 1); // Nuevo flanco con el fd pendiente
+		event_loop_run(loop, 1000);
+		assert(st.reads == reads + 1);
+	}
+
+	event_loop_destroy(loop);
+	close(pipes[0]); close(pipes[1]);
+	printf("✓ test_mark_pending_new_data\n");
+}
+
+static void test_loop_stats(void) {
+	EventLoop *loop = event_loop_create();
+	assert(loop != NULL);
+	EventLoopStats stats;
+	event_loop_get_stats(loop, &stats);
+	assert(stats.busy_ns == 0 && stats.idle_ns == 0 && stats.iterations == 0);
+
+	// Sin eventos: la vuelta es casi toda espera
+	event_loop_run(loop, 20);
+	event_loop_get_stats(loop, &stats);
+	assert(stats.iterations == 1);
+	assert(stats.idle_ns >= 15000000ull);
+	assert(stats.busy_ns < stats.idle_ns);
+	event_loop_get_stats(NULL, &stats);
+	assert(stats.iterations == 0);
+	event_loop_destroy(loop);
+	printf("✓ test_loop_stats\n");
+}
+
 int main(void) {
 	printf("=== Tests de event loop ===\n");
 	platform_init();
@@ -100,6 +454,15 @@ int main(void) {
 	test_add_remove_fd();
 	test_timer();
 	test_read_event_once();
+	test_us_periodic_timer();
+	test_timer_fires_while_fd_busy();
+	test_high_fd_and_edge();
+	test_exclusive_shared_fd();
+	test_cross_thread_post();
+	test_post_from_loop_thread();
+	test_mark_pending();
+	test_mark_pending_new_data();
+	test_loop_stats();
 
 	platform_cleanup();
 	printf("✓ Todos los tests de event loop pasaron\n");
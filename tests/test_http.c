@@ -0,0 +1,255 @@
+#include "server.h"
+#include "http.h"
+#include "platform.h"
+#include "telemetry_storage.h"
+#include "time_source.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+// Período del timer de barrido del listener (HTTP_SWEEP_MS en http.c)
+#define HTTP_SWEEP_TEST_MS 500
+
+static int tcp_connect(uint16_t port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    assert(s >= 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(connect(s, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0);
+    return s;
+}
+
+static void send_all(int s, const char *data) {
+    size_t len = strlen(data);
+    assert(send(s, data, len, 0) == (ssize_t)len);
+}
+
+// Corre el loop hasta recibir 'responses' respuestas completas (por
+// Content-Length) o detectar cierre. Retorna bytes leídos en 'out'.
+static size_t run_and_read(Server *srv, int s, char *out, size_t out_size,
+                           int responses, bool *closed) {
+    size_t len = 0;
+    *closed = false;
+    for (int i = 0; i < 200; i++) {
+        server_run(srv, 5);
+        ssize_t n = recv(s, out + len, out_size - len - 1, 0);
+        if (n == 0) { *closed = true; break; }
+        if (n > 0) len += (size_t)n;
+        out[len] = '\0';
+
+        int complete = 0;
+        const char *p = out;
+        for (;;) {
+            const char *hdr_end = strstr(p, "\r\n\r\n");
+            if (!hdr_end) break;
+            const char *cl = strstr(p, "Content-Length: ");
+            size_t body = 0;
+            if (cl && cl < hdr_end) body = (size_t)strtoul(cl + 16, NULL, 10);
+            if ((size_t)(hdr_end + 4 - out) + body > len) break;
+            complete++;
+            p = hdr_end + 4 + body;
+        }
+        if (complete >= responses) break;
+    }
+    return len;
+}
+
+static void test_metrics_keep_alive(Server *srv, uint16_t port) {
+    int s = tcp_connect(port);
+    char buf[65536];
+    bool closed;
+
+    send_all(s, "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+    size_t n = run_and_read(srv, s, buf, sizeof(buf), 1, &closed);
+    assert(n > 0 && !closed);
+    assert(strncmp(buf, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    assert(strstr(buf, "Content-Type: text/plain; version=0.0.4"));
+    assert(strstr(buf, "Connection: keep-alive"));
+    assert(strstr(buf, "# TYPE teleserver_request_duration_seconds summary"));
+    assert(strstr(buf, "teleserver_datagrams_dropped_total{reason=\"decode\"}"));
+
+    // Misma conexión: segunda request (keep-alive) y dos pipelined
+    send_all(s, "GET /api/v1/health HTTP/1.1\r\n\r\n");
+    n = run_and_read(srv, s, buf, sizeof(buf), 1, &closed);
+    assert(n > 0 && !closed);
+    assert(strstr(buf, "{\"status\":\"ok\",\"service\":\"TeleServer\"}"));
+
+    send_all(s, "GET /api/v1/status HTTP/1.1\r\n\r\nGET /nope HTTP/1.1\r\n\r\n");
+    n = run_and_read(srv, s, buf, sizeof(buf), 2, &closed);
+    assert(strstr(buf, "HTTP/1.1 200 OK") && strstr(buf, "\"telemetry_stored\":"));
+    assert(strstr(buf, "HTTP/1.1 404 Not Found"));
+    close(s);
+    printf("✓ test_metrics_keep_alive\n");
+}
+
+static void test_telemetry_query(Server *srv, uint16_t port) {
+    telemetry_storage_clear();
+    const char *docs[] = { "{\"a\":1}", "{\"a\":2}", "{\"a\":3}" };
+    for (int i = 0; i < 3; i++) assert(telemetry_storage_add(docs[i], strlen(docs[i])) == 0);
+
+    int s = tcp_connect(port);
+    char buf[65536];
+    bool closed;
+    send_all(s, "GET /api/v1/telemetry?limit=2 HTTP/1.1\r\n\r\n");
+    size_t n = run_and_read(srv, s, buf, sizeof(buf), 1, &closed);
+    assert(n > 0);
+    assert(strstr(buf, "HTTP/1.1 200 OK"));
+    assert(!strstr(buf, "{\"a\":1}") && strstr(buf, "{\"a\":2}") && strstr(buf, "{\"a\":3}"));
+
+    // If-None-Match con el ETag vigente => 304 sin cuerpo
+    const char *etag = strstr(buf, "ETag: ");
+    assert(etag);
+    char value[32];
+    assert(sscanf(etag + 6, "%31s", value) == 1);
+    char req[128];
+    snprintf(req, sizeof(req), "GET /api/v1/telemetry HTTP/1.1\r\nIf-None-Match: %s\r\n\r\n", value);
+    send_all(s, req);
+    n = run_and_read(srv, s, buf, sizeof(buf), 1, &closed);
+    assert(strncmp(buf, "HTTP/1.1 304 Not Modified\r\n", 27) == 0);
+    assert(!strstr(buf, "Content-Length"));
+
+    // Nuevo dato => el ETag deja de coincidir
+    assert(telemetry_storage_add(docs[0], strlen(docs[0])) == 0);
+    send_all(s, req);
+    n = run_and_read(srv, s, buf, sizeof(buf), 1, &closed);
+    assert(strstr(buf, "HTTP/1.1 200 OK"));
+    close(s);
+    printf("✓ test_telemetry_query\n");
+}
+
+static void test_errors_and_close(Server *srv, uint16_t port) {
+    char buf[4096];
+    bool closed;
+
+    int s = tcp_connect(port);
+    send_all(s, "POST /api/v1/telemetry HTTP/1.1\r\n\r\n");
+    run_and_read(srv, s, buf, sizeof(buf), 1, &closed);
+    assert(strstr(buf, "HTTP/1.1 405 Method Not Allowed") && strstr(buf, "Allow: GET, HEAD"));
+
+    send_all(s, "HEAD /api/v1/health HTTP/1.1\r\nConnection: close\r\n\r\n");
+    size_t n = run_and_read(srv, s, buf, sizeof(buf), 1, &closed);
+    assert(n > 0 && strstr(buf, "Connection: close"));
+    assert(!strstr(buf, "TeleServer\"}")); // HEAD: sin cuerpo
+    run_and_read(srv, s, buf, sizeof(buf), 2, &closed);
+    assert(closed);
+    close(s);
+
+    s = tcp_connect(port);
+    send_all(s, "garbage\r\n\r\n");
+    run_and_read(srv, s, buf, sizeof(buf), 1, &closed);
+    assert(strstr(buf, "HTTP/1.1 400 Bad Request"));
+    close(s);
+    printf("✓ test_errors_and_close\n");
+}
+
+// Pipelining sin leer respuestas: al llenarse el backlog de salida el server
+// deja de leer, así que el cliente termina bloqueado en send (EAGAIN) aunque
+// el loop siga corriendo.
+static void test_pipelined_backlog(Server *srv, uint16_t port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    assert(s >= 0);
+    int small = 4096;
+    assert(setsockopt(s, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small)) == 0);
+    assert(setsockopt(s, SOL_SOCKET, SO_SNDBUF, &small, sizeof(small)) == 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(connect(s, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    assert(fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0);
+
+    const char *req = "GET /metrics HTTP/1.1\r\n\r\n";
+    const size_t req_len = strlen(req);
+    size_t sent = 0;
+    int stalled = 0;
+    for (int round = 0; round < 10000 && stalled < 2000; round++) {
+        size_t before = sent;
+        ssize_t n;
+        while ((n = send(s, req, req_len, 0)) > 0) sent += (size_t)n;
+        assert(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+        stalled = sent == before ? stalled + 1 : 0;
+        server_run(srv, 0);
+    }
+    // 2000 vueltas seguidas sin que el server libere espacio: sin el límite,
+    // a 8 requests por vuelta consumiría lo encolado en el socket mucho antes
+    assert(stalled == 2000);
+    assert(sent > 0);
+    close(s);
+    printf("✓ test_pipelined_backlog\n");
+}
+
+static uint64_t g_fake_ms;
+static uint64_t fake_now_ms(void) { return g_fake_ms; }
+
+// Corre el loop hasta que el server cierre 's' o se agote 'max_ms'
+static bool wait_closed(Server *srv, int s, int max_ms) {
+    char buf[4096];
+    for (int waited = 0; waited < max_ms; waited += 10) {
+        server_run(srv, 10);
+        ssize_t n = recv(s, buf, sizeof(buf), 0);
+        if (n == 0 || (n < 0 && errno == ECONNRESET)) return true;
+    }
+    return false;
+}
+
+// Cabecera incompleta y conexión ociosa se cierran por el timer de barrido
+static void test_timeouts(Server *srv, uint16_t port) {
+    TimeSource ts = { fake_now_ms };
+    g_fake_ms = 1000000;
+    time_source_set(&ts);
+
+    int partial = tcp_connect(port);
+    int idle = tcp_connect(port);
+    send_all(partial, "GET /api/v1/health HTTP/1.1\r\nHost:");
+    send_all(idle, "GET /api/v1/health HTTP/1.1\r\n\r\n");
+    char buf[4096];
+    bool closed;
+    run_and_read(srv, idle, buf, sizeof(buf), 1, &closed);
+    assert(!closed && strstr(buf, "HTTP/1.1 200 OK"));
+
+    // Pasado el timeout de cabecera sólo cae la request incompleta
+    g_fake_ms += HTTP_HEADER_TIMEOUT_MS;
+    assert(wait_closed(srv, partial, 2 * HTTP_SWEEP_TEST_MS));
+    assert(!wait_closed(srv, idle, 2 * HTTP_SWEEP_TEST_MS));
+
+    g_fake_ms += HTTP_IDLE_TIMEOUT_MS;
+    assert(wait_closed(srv, idle, 2 * HTTP_SWEEP_TEST_MS));
+    close(partial);
+    close(idle);
+    time_source_set(NULL);
+    printf("✓ test_timeouts\n");
+}
+
+int main(void) {
+    printf("=== Tests de HTTP ===\n");
+    telemetry_storage_init();
+    Server *srv = server_create(0, false);
+    assert(srv);
+    assert(server_get_http_port(srv) == 0);
+    assert(server_enable_http(srv, 0) == PLATFORM_OK);
+    uint16_t port = server_get_http_port(srv);
+    assert(port != 0);
+
+    test_metrics_keep_alive(srv, port);
+    test_telemetry_query(srv, port);
+    test_errors_and_close(srv, port);
+    test_pipelined_backlog(srv, port);
+    test_timeouts(srv, port);
+
+    server_destroy(srv);
+    printf("✓ Todos los tests de HTTP pasaron\n");
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include "log.h"
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define THREADS 4
+#define PER_THREAD 5000
+
+// Lee todo el contenido de 'f' en un buffer nuevo (terminado en '\0')
+static char *slurp(FILE *f) {
+    fflush(f);
+    long size = ftell(f);
+    assert(size >= 0);
+    char *buf = malloc((size_t)size + 1);
+    assert(buf);
+    rewind(f);
+    assert(fread(buf, 1, (size_t)size, f) == (size_t)size);
+    buf[size] = '\0';
+    return buf;
+}
+
+static void test_async_formats_match_sync(void) {
+    FILE *f = tmpfile();
+    assert(f);
+    log_set_stream(f);
+    log_set_level(LOG_LEVEL_DEBUG);
+
+    const char json[] = "{\"t\":1}trailing";
+    char expected[1024];
+    snprintf(expected, sizeof(expected),
+             "[INFO] d=%d u=%u ld=%ld zu=%zu llx=%llx p=%p f=%5.2f c=%c pct=%% s=%s w=[%-6s] js=%.*s ww=%*d\n"
+             "[WARN] long double %.1Lf\n",
+             -42, 7u, -100000L, (size_t)1472, 0xdeadbeefULL, (void *)json, 3.14159, 'x', "hola", "ab",
+             7, json, 4, 9, 2.5L);
+
+    assert(log_start_async() == 0);
+    LOG_INFO("d=%d u=%u ld=%ld zu=%zu llx=%llx p=%p f=%5.2f c=%c pct=%% s=%s w=[%-6s] js=%.*s ww=%*d\n",
+             -42, 7u, -100000L, (size_t)1472, 0xdeadbeefULL, (void *)json, 3.14159, 'x', "hola", "ab",
+             7, json, 4, 9);
+    LOG_WARN("long double %.1Lf\n", 2.5L); // no soportado => fallback de texto
+    LOG_DEBUG("%s", "");
+    log_stop_async();
+
+    char *got = slurp(f);
+    char expected_full[1200];
+    // DEBUG puede estar eliminado en compilación (LOG_COMPILE_LEVEL)
+    snprintf(expected_full, sizeof(expected_full), "%s%s", expected,
+             log_level_enabled(LOG_LEVEL_DEBUG) ? "[DEBUG] " : "");
+    assert(strcmp(got, expected_full) == 0);
+    free(got);
+    fclose(f);
+    log_set_stream(NULL);
+    printf("✓ test_async_formats_match_sync\n");
+}
+
+static void *producer(void *arg) {
+    int id = (int)(intptr_t)arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        LOG_INFO("thread=%d seq=%d path=%s\n", id, i, "api/v1/telemetry");
+    }
+    return NULL;
+}
+
+static void test_async_multi_producer(void) {
+    FILE *f = tmpfile();
+    assert(f);
+    log_set_stream(f);
+    log_set_level(LOG_LEVEL_INFO);
+    uint64_t dropped_before = log_dropped_count();
+
+    assert(log_start_async() == 0);
+    pthread_t th[THREADS];
+    for (int i = 0; i < THREADS; i++) assert(pthread_create(&th[i], NULL, producer, (void *)(intptr_t)i) == 0);
+    for (int i = 0; i < THREADS; i++) pthread_join(th[i], NULL);
+    log_stop_async();
+
+    // Cada línea es íntegra y el orden por hilo se preserva; líneas + descartes
+    // (más las líneas resumen de descarte) suman lo enviado.
+    char *got = slurp(f);
+    int last[THREADS];
+    for (int i = 0; i < THREADS; i++) last[i] = -1;
+    size_t lines = 0;
+    for (char *line = strtok(got, "\n"); line; line = strtok(NULL, "\n")) {
+        int id, seq;
+        if (strncmp(line, "[WARN] log: ", 12) == 0) continue;
+        assert(sscanf(line, "[INFO] thread=%d seq=%d path=api/v1/telemetry", &id, &seq) == 2);
+        assert(id >= 0 && id < THREADS && seq > last[id]);
+        last[id] = seq;
+        lines++;
+    }
+    uint64_t dropped = log_dropped_count() - dropped_before;
+    assert(lines + dropped == (size_t)THREADS * PER_THREAD);
+    free(got);
+    fclose(f);
+    log_set_stream(NULL);
+    printf("✓ test_async_multi_producer (%zu escritas, %llu descartadas)\n",
+           lines, (unsigned long long)dropped);
+}
+
+static int g_evaluated;
+static int side_effect(void) { return ++g_evaluated; }
+
+static void test_filtered_sites_skip_arguments(void) {
+    FILE *f = tmpfile();
+    assert(f);
+    log_set_stream(f);
+    log_set_level(LOG_LEVEL_WARN);
+    g_evaluated = 0;
+
+    assert(!log_level_enabled(LOG_LEVEL_INFO) && log_level_enabled(LOG_LEVEL_WARN));
+    LOG_INFO("n=%d\n", side_effect());  // filtrado: no evalúa argumentos
+    LOG_DEBUG("n=%d\n", side_effect());
+    assert(g_evaluated == 0);
+    LOG_WARN("n=%d\n", side_effect());
+    assert(g_evaluated == 1);
+
+    char *got = slurp(f);
+    assert(strcmp(got, "[WARN] n=1\n") == 0);
+    free(got);
+    fclose(f);
+    log_set_stream(NULL);
+    log_set_level(LOG_LEVEL_INFO);
+    printf("✓ test_filtered_sites_skip_arguments\n");
+}
+
+static void emit_limited(int i) {
+    LOG_AT_RL(LOG_LEVEL_WARN, 1, 3, "storm %d\n", i);
+}
+
+static void test_rate_limited_site(void) {
+    FILE *f = tmpfile();
+    assert(f);
+    log_set_stream(f);
+    log_set_level(LOG_LEVEL_INFO);
+
+    // Ráfaga de 3 y 1 msg/s: de 100 llamadas seguidas pasan las 3 primeras
+    for (int i = 0; i < 100; i++) emit_limited(i);
+    char *got = slurp(f);
+    assert(strcmp(got, "[WARN] storm 0\n[WARN] storm 1\n[WARN] storm 2\n") == 0);
+    free(got);
+
+    // Tras recargar una ficha, el sitio reporta los suprimidos antes del mensaje
+    struct timespec ts = { 1, 100000000L };
+    nanosleep(&ts, NULL);
+    emit_limited(100);
+    got = slurp(f);
+    const char *summary = strstr(got, "[WARN] 97 messages suppressed at test_log.c:");
+    assert(summary);
+    assert(strstr(summary, "\n[WARN] storm 100\n"));
+    free(got);
+
+    // Sitios distintos no comparten estado
+    LOG_WARN_RL("other site\n");
+    got = slurp(f);
+    assert(strstr(got, "[WARN] other site\n"));
+    free(got);
+    fclose(f);
+    log_set_stream(NULL);
+    printf("✓ test_rate_limited_site\n");
+}
+
+static void sleep_past_flush_period(void) {
+    const long wait_ms = LOG_RL_FLUSH_MS + 100;
+    struct timespec ts = { wait_ms / 1000, (wait_ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static int count_summaries(const char *text) {
+    int n = 0;
+    for (const char *p = text; (p = strstr(p, "messages suppressed at test_log.c:")); p++) n++;
+    return n;
+}
+
+static void emit_quiet_after_storm(int i) {
+    LOG_AT_RL(LOG_LEVEL_WARN, 1, 2, "burst %d\n", i);
+}
+
+static void test_rate_limit_flush(void) {
+    FILE *f = tmpfile();
+    assert(f);
+    log_set_stream(f);
+    log_set_level(LOG_LEVEL_INFO);
+
+    // El sitio suprime y luego calla: el resumen sale por el vaciado periódico
+    for (int i = 0; i < 10; i++) emit_quiet_after_storm(i);
+    sleep_past_flush_period();
+    log_rate_limit_flush();
+    char *got = slurp(f);
+    assert(strstr(got, "[WARN] burst 1\n[WARN] 8 messages suppressed at test_log.c:"));
+    free(got);
+
+    // Dentro del mismo período el vaciado no hace nada; pasado, reporta
+    for (int i = 0; i < 10; i++) emit_quiet_after_storm(i);
+    log_rate_limit_flush();
+    got = slurp(f);
+    assert(count_summaries(got) == 1);
+    free(got);
+
+    sleep_past_flush_period();
+    log_rate_limit_flush();
+    got = slurp(f);
+    assert(count_summaries(got) == 2);
+    free(got);
+    fclose(f);
+    log_set_stream(NULL);
+    printf("✓ test_rate_limit_flush\n");
+}
+
+static void *log_once(void *arg) {
+    LOG_INFO("short-lived thread %d\n", (int)(intptr_t)arg);
+    return NULL;
+}
+
+// Hilos que loguean y terminan uno tras otro: el ring de cada uno queda libre
+// y lo adopta el siguiente, así la cantidad de rings no crece con los hilos
+static void test_async_rings_reused(void) {
+    FILE *f = tmpfile();
+    assert(f);
+    log_set_stream(f);
+    log_set_level(LOG_LEVEL_INFO);
+
+    assert(log_start_async() == 0);
+    size_t rings_before = log_ring_count();
+    for (int i = 0; i < 32; i++) {
+        pthread_t th;
+        assert(pthread_create(&th, NULL, log_once, (void *)(intptr_t)i) == 0);
+        pthread_join(th, NULL);
+    }
+    assert(log_ring_count() <= rings_before + 1);
+    log_stop_async();
+
+    char *got = slurp(f);
+    int lines = 0;
+    for (char *p = got; (p = strstr(p, "short-lived thread")); p++) lines++;
+    assert(lines == 32);
+    free(got);
+    fclose(f);
+    log_set_stream(NULL);
+    printf("✓ test_async_rings_reused (%zu rings)\n", log_ring_count());
+}
+
+// El escritor ocioso bloquea y un registro nuevo lo despierta enseguida, sin
+// esperar el vencimiento del vaciado de suprimidos (LOG_RL_FLUSH_MS)
+static void test_async_wakes_writer(void) {
+    int fds[2];
+    assert(pipe(fds) == 0);
+    FILE *w = fdopen(fds[1], "w");
+    assert(w);
+    log_set_stream(w);
+    log_set_level(LOG_LEVEL_INFO);
+
+    assert(log_start_async() == 0);
+    for (int i = 0; i < 3; i++) {
+        struct timespec idle = { 0, 50000000L };
+        nanosleep(&idle, NULL);
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        LOG_INFO("wake %d\n", i);
+        struct pollfd pfd = { fds[0], POLLIN, 0 };
+        assert(poll(&pfd, 1, LOG_RL_FLUSH_MS / 2) == 1);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        char buf[64];
+        ssize_t n = read(fds[0], buf, sizeof(buf) - 1);
+        assert(n > 0);
+        buf[n] = '\0';
+        char expected[32];
+        snprintf(expected, sizeof(expected), "[INFO] wake %d\n", i);
+        assert(strcmp(buf, expected) == 0);
+        long ms = (t1.tv_sec - t0.tv_sec) * 1000L + (t1.tv_nsec - t0.tv_nsec) / 1000000L;
+        assert(ms < LOG_RL_FLUSH_MS / 2);
+    }
+    log_stop_async();
+    log_set_stream(NULL);
+    fclose(w);
+    close(fds[0]);
+    printf("✓ test_async_wakes_writer\n");
+}
+
+int main(void) {
+    printf("=== Tests de logging ===\n");
+    test_async_formats_match_sync();
+    test_async_multi_producer();
+    test_filtered_sites_skip_arguments();
+    test_rate_limited_site();
+    test_rate_limit_flush();
+    test_async_rings_reused();
+    test_async_wakes_writer();
+    printf("✓ Todos los tests de logging pasaron\n");
+    return 0;
+}
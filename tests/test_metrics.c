@@ -0,0 +1,139 @@
+#include "metrics.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS 4
+#define PER_THREAD 50000
+
+// |value - expected| dentro del error relativo del histograma (1/16)
+static void assert_close(uint64_t value, uint64_t expected) {
+    uint64_t diff = value > expected ? value - expected : expected - value;
+    assert(diff * 16 <= expected + 16);
+}
+
+static void test_percentiles_uniform(void) {
+    metrics_reset();
+    // 1..10000 µs uniforme => p50 ~ 5000 µs, p99 ~ 9900 µs, p999 ~ 9990 µs
+    for (uint64_t us = 1; us <= 10000; us++) {
+        metrics_record_stage(METRIC_STAGE_DISPATCH, us * 1000);
+    }
+    MetricsSummary s;
+    metrics_stage_summary(METRIC_STAGE_DISPATCH, &s);
+    assert(s.count == 10000);
+    assert(s.max_ns == 10000000);
+    assert(s.sum_ns == 10000ull * 10001 / 2 * 1000);
+    assert_close(s.p50_ns, 5000000);
+    assert_close(s.p99_ns, 9900000);
+    assert_close(s.p999_ns, 9990000);
+    assert(s.p50_ns <= s.p99_ns && s.p99_ns <= s.p999_ns && s.p999_ns <= s.max_ns);
+
+    // Valores pequeños tienen bucket exacto
+    metrics_reset();
+    for (int i = 0; i < 100; i++) metrics_record_stage(METRIC_STAGE_ENCODE, 7);
+    metrics_stage_summary(METRIC_STAGE_ENCODE, &s);
+    assert(s.count == 100 && s.p50_ns == 7 && s.p999_ns == 7);
+
+    // Saturación: valores enormes no se pierden
+    metrics_record_stage(METRIC_STAGE_SEND, UINT64_MAX / 2);
+    metrics_stage_summary(METRIC_STAGE_SEND, &s);
+    assert(s.count == 1 && s.max_ns == UINT64_MAX / 2);
+    printf("✓ test_percentiles_uniform\n");
+}
+
+static void test_class_of(void) {
+    assert(metrics_class_of(COAP_RESPONSE_CONTENT) == METRIC_CLASS_2XX);
+    assert(metrics_class_of(COAP_ERROR_NOT_FOUND) == METRIC_CLASS_4XX);
+    assert(metrics_class_of(COAP_ERROR_INTERNAL) == METRIC_CLASS_5XX);
+    printf("✓ test_class_of\n");
+}
+
+static void *recorder(void *arg) {
+    (void)arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        metrics_count(METRIC_RX_DATAGRAMS, 1);
+        metrics_record_request(DISPATCH_ROUTE_TELEMETRY_POST, COAP_RESPONSE_CREATED, (uint64_t)(i % 1000) * 100);
+    }
+    return NULL;
+}
+
+static void test_per_thread_shards(void) {
+    metrics_reset();
+    pthread_t th[THREADS];
+    for (int i = 0; i < THREADS; i++) assert(pthread_create(&th[i], NULL, recorder, NULL) == 0);
+    for (int i = 0; i < THREADS; i++) pthread_join(th[i], NULL);
+
+    assert(metrics_counter_value(METRIC_RX_DATAGRAMS) == (uint64_t)THREADS * PER_THREAD);
+    MetricsSummary s;
+    metrics_route_summary(DISPATCH_ROUTE_TELEMETRY_POST, &s);
+    assert(s.count == (uint64_t)THREADS * PER_THREAD);
+    metrics_class_summary(METRIC_CLASS_2XX, &s);
+    assert(s.count == (uint64_t)THREADS * PER_THREAD);
+    metrics_class_summary(METRIC_CLASS_4XX, &s);
+    assert(s.count == 0);
+
+    char json[COAP_MAX_MESSAGE_SIZE];
+    int n = metrics_format_json(METRICS_JSON_PIPELINE, json, sizeof(json));
+    assert(n > 0 && (size_t)n < sizeof(json));
+    assert(strstr(json, "\"counters\":{\"rx\":200000}"));
+    assert(strstr(json, "\"2xx\":[200000,"));
+    assert(!strstr(json, "\"4xx\""));
+    n = metrics_format_json(METRICS_JSON_ROUTES, json, sizeof(json));
+    assert(n > 0 && strstr(json, "\"telemetry_post\":[200000,"));
+    assert(metrics_format_json(METRICS_JSON_PIPELINE, json, 16) < 0);
+    printf("✓ test_per_thread_shards\n");
+}
+
+// Registro completo (todos los contadores al máximo, todos los histogramas con
+// muestras saturadas): cada sección entra en el payload de una respuesta CoAP
+// con token máximo y Content-Format
+static void test_json_fits_datagram(void) {
+    metrics_reset();
+    for (int c = 0; c < METRIC_COUNTER_COUNT; c++) metrics_count((MetricCounter)c, UINT64_MAX);
+    const uint64_t saturated = (uint64_t)1 << METRICS_MAX_EXPONENT;
+    // Una respuesta de cada clase: 2xx, 4xx, 5xx y other (vacío)
+    const CoapCode codes[] = { COAP_RESPONSE_CONTENT, COAP_ERROR_NOT_FOUND,
+                               COAP_ERROR_INTERNAL, (CoapCode)0 };
+    for (int k = 0; k < 1000; k++) {
+        uint64_t ns = k % 2 ? saturated : 123456789ull;
+        for (int i = 0; i < METRIC_STAGE_COUNT; i++) metrics_record_stage((MetricStage)i, ns);
+        for (int i = 0; i < DISPATCH_ROUTE_COUNT; i++) {
+            for (size_t c = 0; c < sizeof(codes) / sizeof(codes[0]); c++) {
+                metrics_record_request((DispatchRoute)i, codes[c], ns);
+            }
+        }
+        for (int i = 0; i < DISPATCH_PRIORITY_COUNT; i++) {
+            metrics_record_queue_wait((DispatchPriority)i, ns);
+            metrics_record_queue_depth((DispatchPriority)i, SIZE_MAX);
+        }
+    }
+    for (int c = 0; c < METRIC_CLASS_COUNT; c++) {
+        MetricsSummary s;
+        metrics_class_summary((MetricClass)c, &s);
+        assert(s.count > 0);
+    }
+
+    // Header (4) + token (8) + Content-Format (2) + marcador de payload (1)
+    const size_t budget = COAP_MAX_MESSAGE_SIZE - 4 - COAP_MAX_TOKEN_LENGTH - 2 - 1;
+    char json[COAP_MAX_MESSAGE_SIZE];
+    int largest = 0;
+    for (int sec = 0; sec < METRICS_JSON_SECTION_COUNT; sec++) {
+        int n = metrics_format_json((MetricsJsonSection)sec, json, budget + 1);
+        assert(n > 0 && (size_t)n <= budget);
+        if (n > largest) largest = n;
+    }
+    metrics_reset();
+    printf("✓ test_json_fits_datagram (máx %d de %zu bytes)\n", largest, budget);
+}
+
+int main(void) {
+    printf("=== Tests de métricas ===\n");
+    test_percentiles_uniform();
+    test_class_of();
+    test_per_thread_shards();
+    test_json_fits_datagram();
+    printf("✓ Todos los tests de métricas pasaron\n");
+    return 0;
+}
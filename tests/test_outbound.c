@@ -0,0 +1,255 @@
+#include "coap_outbound.h"
+#include "event_loop.h"
+#include "platform.h"
+#include "metrics.h"
+#include "clock.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+typedef struct {
+    int calls;
+    OutboundResult last;
+} DoneLog;
+
+static void on_done(void *user_data, OutboundResult result) {
+    DoneLog *log = (DoneLog *)user_data;
+    log->calls++;
+    log->last = result;
+}
+
+// Socket UDP del "peer" en loopback; 'addr' queda con su dirección
+static int peer_socket(struct sockaddr_in *addr) {
+    int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    assert(s >= 0);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(s, (struct sockaddr *)addr, sizeof(*addr)) == 0);
+    socklen_t len = sizeof(*addr);
+    assert(getsockname(s, (struct sockaddr *)addr, &len) == 0);
+    int flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, flags | O_NONBLOCK);
+    return s;
+}
+
+static int engine_socket(void) {
+    int s = platform_socket_create_udp();
+    assert(s >= 0);
+    assert(platform_socket_bind(s, 0) == PLATFORM_OK);
+    assert(platform_socket_set_nonblocking(s) == PLATFORM_OK);
+    return s;
+}
+
+static OutboundConfig test_config(void) {
+    OutboundConfig cfg;
+    coap_outbound_config_default(&cfg);
+    cfg.ack_timeout_ms = 20;
+    cfg.ack_random_pct = 100;   // Sin aleatorizar: tiempos deterministas
+    cfg.max_retransmit = 2;
+    cfg.pace_rate = 0;
+    return cfg;
+}
+
+// CON mínimo (GET vacío) con MID 0: el motor lo reescribe
+static const uint8_t k_con[4] = { 0x40, 0x01, 0x00, 0x00 };
+
+// Corre el loop durante 'ms' como máximo
+static void run_for(EventLoop *loop, uint64_t ms) {
+    uint64_t end = clock_monotonic_ms() + ms;
+    while (clock_monotonic_ms() < end) event_loop_run(loop, 5);
+}
+
+// Cuenta datagramas recibidos por el peer; deja el MID del último en *mid
+static int drain(int s, uint16_t *mid) {
+    int n = 0;
+    uint8_t buf[64];
+    while (recv(s, buf, sizeof(buf), 0) >= 4) {
+        if (mid) *mid = (uint16_t)((buf[2] << 8) | buf[3]);
+        n++;
+    }
+    return n;
+}
+
+static CoapMessage empty_reply(CoapType type, uint16_t mid) {
+    CoapMessage m;
+    coap_message_init(&m);
+    m.type = type;
+    m.message_id = mid;
+    return m;
+}
+
+static void test_retransmit_and_timeout(void) {
+    EventLoop *loop = event_loop_create();
+    int sock = engine_socket();
+    struct sockaddr_in peer;
+    int ps = peer_socket(&peer);
+    OutboundConfig cfg = test_config();
+    CoapOutbound *ob = coap_outbound_create(loop, sock, &cfg);
+    assert(ob);
+
+    uint64_t retransmit_before = metrics_counter_value(METRIC_RETRANSMIT);
+    DoneLog log = {0};
+    int mid = coap_outbound_send(ob, (struct sockaddr *)&peer, sizeof(peer), k_con, sizeof(k_con),
+                                 on_done, &log);
+    assert(mid >= 0);
+    assert(coap_outbound_inflight(ob) == 1);
+
+    // RTO 20 ms < 1 s => backoff x3: 20 + 60 + 180 ms hasta abandonar
+    run_for(loop, 500);
+    assert(log.calls == 1 && log.last == OUTBOUND_TIMEOUT);
+    uint16_t seen = 0;
+    assert(drain(ps, &seen) == 3);
+    assert(seen == (uint16_t)mid);
+    assert(metrics_counter_value(METRIC_RETRANSMIT) == retransmit_before + 2);
+    assert(coap_outbound_inflight(ob) == 0);
+
+    coap_outbound_destroy(ob);
+    assert(log.calls == 1);
+    close(ps);
+    platform_socket_close(sock);
+    event_loop_destroy(loop);
+    printf("✓ test_retransmit_and_timeout\n");
+}
+
+static void test_nstart_and_ack(void) {
+    EventLoop *loop = event_loop_create();
+    int sock = engine_socket();
+    struct sockaddr_in peer;
+    int ps = peer_socket(&peer);
+    OutboundConfig cfg = test_config();
+    cfg.ack_timeout_ms = 2000;
+    CoapOutbound *ob = coap_outbound_create(loop, sock, &cfg);
+    assert(ob);
+    const struct sockaddr *pa = (const struct sockaddr *)&peer;
+
+    DoneLog log = {0};
+    int mids[3];
+    for (int i = 0; i < 3; i++) {
+        mids[i] = coap_outbound_send(ob, pa, sizeof(peer), k_con, sizeof(k_con), on_done, &log);
+        assert(mids[i] >= 0);
+    }
+    // MIDs consecutivos del espacio del peer; NSTART = 1
+    assert((uint16_t)(mids[1] - mids[0]) == 1 && (uint16_t)(mids[2] - mids[1]) == 1);
+    assert(coap_outbound_inflight(ob) == 1 && coap_outbound_queued(ob) == 2);
+    assert(coap_outbound_peer_count(ob) == 1);
+    uint16_t seen = 0;
+    assert(drain(ps, &seen) == 1 && seen == (uint16_t)mids[0]);
+
+    // ACK de un mensaje aún en cola (no enviado): se ignora
+    CoapMessage ack = empty_reply(COAP_TYPE_ACKNOWLEDGMENT, (uint16_t)mids[1]);
+    assert(!coap_outbound_on_message(ob, &ack, pa, sizeof(peer)));
+
+    // El ACK del primero libera el siguiente y actualiza el RTO (estimador fuerte)
+    ack = empty_reply(COAP_TYPE_ACKNOWLEDGMENT, (uint16_t)mids[0]);
+    assert(coap_outbound_on_message(ob, &ack, pa, sizeof(peer)));
+    assert(log.calls == 1 && log.last == OUTBOUND_ACKED);
+    assert(coap_outbound_inflight(ob) == 1 && coap_outbound_queued(ob) == 1);
+    assert(drain(ps, &seen) == 1 && seen == (uint16_t)mids[1]);
+    uint32_t rto = coap_outbound_peer_rto_ms(ob, pa, sizeof(peer));
+    assert(rto >= 10 && rto < 2000);
+
+    // ACK duplicado: ya no hay CON con ese MID
+    ack = empty_reply(COAP_TYPE_ACKNOWLEDGMENT, (uint16_t)mids[0]);
+    assert(!coap_outbound_on_message(ob, &ack, pa, sizeof(peer)));
+
+    // RST cierra con OUTBOUND_RESET
+    CoapMessage rst = empty_reply(COAP_TYPE_RESET, (uint16_t)mids[1]);
+    assert(coap_outbound_on_message(ob, &rst, pa, sizeof(peer)));
+    assert(log.calls == 2 && log.last == OUTBOUND_RESET);
+    assert(drain(ps, &seen) == 1 && seen == (uint16_t)mids[2]);
+
+    // Destroy cancela lo que quede en vuelo
+    coap_outbound_destroy(ob);
+    assert(log.calls == 3 && log.last == OUTBOUND_CANCELLED);
+    close(ps);
+    platform_socket_close(sock);
+    event_loop_destroy(loop);
+    printf("✓ test_nstart_and_ack\n");
+}
+
+static void test_pacing(void) {
+    EventLoop *loop = event_loop_create();
+    int sock = engine_socket();
+    struct sockaddr_in peer;
+    int ps = peer_socket(&peer);
+    OutboundConfig cfg = test_config();
+    cfg.ack_timeout_ms = 5000;
+    cfg.nstart = 16;
+    cfg.pace_rate = 50;         // Una ficha cada 20 ms
+    cfg.pace_burst = 2;
+    CoapOutbound *ob = coap_outbound_create(loop, sock, &cfg);
+    assert(ob);
+    const struct sockaddr *pa = (const struct sockaddr *)&peer;
+
+    uint64_t queued_before = metrics_counter_value(METRIC_OUTBOUND_QUEUED);
+    DoneLog log = {0};
+    for (int i = 0; i < 5; i++) {
+        assert(coap_outbound_send(ob, pa, sizeof(peer), k_con, sizeof(k_con), on_done, &log) >= 0);
+    }
+    // Ráfaga de 2; el resto espera fichas
+    assert(coap_outbound_inflight(ob) == 2 && coap_outbound_queued(ob) == 3);
+    assert(metrics_counter_value(METRIC_OUTBOUND_QUEUED) == queued_before + 3);
+    assert(drain(ps, NULL) == 2);
+
+    run_for(loop, 30);
+    assert(coap_outbound_inflight(ob) >= 3);
+    run_for(loop, 100);
+    assert(coap_outbound_inflight(ob) == 5 && coap_outbound_queued(ob) == 0);
+    assert(drain(ps, NULL) == 3);
+
+    coap_outbound_destroy(ob);
+    assert(log.calls == 5 && log.last == OUTBOUND_CANCELLED);
+    close(ps);
+    platform_socket_close(sock);
+    event_loop_destroy(loop);
+    printf("✓ test_pacing\n");
+}
+
+static void test_queue_limit_and_invalid_args(void) {
+    EventLoop *loop = event_loop_create();
+    int sock = engine_socket();
+    struct sockaddr_in peer;
+    int ps = peer_socket(&peer);
+    OutboundConfig cfg = test_config();
+    cfg.ack_timeout_ms = 5000;
+    cfg.max_queue = 2;
+    CoapOutbound *ob = coap_outbound_create(loop, sock, &cfg);
+    assert(ob);
+    const struct sockaddr *pa = (const struct sockaddr *)&peer;
+
+    DoneLog log = {0};
+    for (int i = 0; i < 3; i++) {
+        assert(coap_outbound_send(ob, pa, sizeof(peer), k_con, sizeof(k_con), on_done, &log) >= 0);
+    }
+    assert(coap_outbound_send(ob, pa, sizeof(peer), k_con, sizeof(k_con), on_done, &log) == PLATFORM_EAGAIN);
+    assert(coap_outbound_send(ob, pa, sizeof(peer), k_con, 3, on_done, &log) == PLATFORM_EINVAL);
+    assert(coap_outbound_send(NULL, pa, sizeof(peer), k_con, sizeof(k_con), NULL, NULL) == PLATFORM_EINVAL);
+    assert(coap_outbound_next_mid(ob, pa, 2) == PLATFORM_EINVAL);
+    assert(coap_outbound_next_mid(ob, pa, sizeof(peer)) >= 0);
+    assert(coap_outbound_create(NULL, sock, NULL) == NULL);
+
+    coap_outbound_destroy(ob);
+    assert(log.calls == 3);
+    coap_outbound_destroy(NULL);
+    close(ps);
+    platform_socket_close(sock);
+    event_loop_destroy(loop);
+    printf("✓ test_queue_limit_and_invalid_args\n");
+}
+
+int main(void) {
+    printf("=== Tests de outbound ===\n");
+    test_retransmit_and_timeout();
+    test_nstart_and_ack();
+    test_pacing();
+    test_queue_limit_and_invalid_args();
+    printf("✓ Todos los tests de outbound pasaron\n");
+    return 0;
+}
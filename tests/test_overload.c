@@ -0,0 +1,68 @@
+#include "overload.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+static void test_backlog_levels_and_hysteresis(void) {
+    OverloadConfig cfg = { 20000, 100 };
+    OverloadController *oc = overload_create(&cfg);
+    assert(oc);
+    assert(overload_update(oc) == OVERLOAD_LEVEL_NONE);
+    assert(!overload_should_shed(oc, DISPATCH_PRIORITY_LOW));
+
+    // Backlog sostenido de 120 => 120% => nivel 1 (sólo LOW)
+    for (int i = 0; i < 40; i++) overload_record_backlog(oc, 120);
+    assert(overload_update(oc) == OVERLOAD_LEVEL_SHED_LOW);
+    assert(overload_pressure_pct(oc) == 120);
+    assert(overload_should_shed(oc, DISPATCH_PRIORITY_LOW));
+    assert(!overload_should_shed(oc, DISPATCH_PRIORITY_NORMAL));
+    assert(!overload_should_shed(oc, DISPATCH_PRIORITY_HIGH));
+
+    // 250% => nivel 2 (LOW y NORMAL; HIGH nunca)
+    for (int i = 0; i < 40; i++) overload_record_backlog(oc, 250);
+    assert(overload_update(oc) == OVERLOAD_LEVEL_SHED_NORMAL);
+    assert(overload_should_shed(oc, DISPATCH_PRIORITY_NORMAL));
+    assert(!overload_should_shed(oc, DISPATCH_PRIORITY_HIGH));
+
+    // Histéresis: 150% no alcanza para bajar del nivel 2 (umbral de salida 100%)
+    for (int i = 0; i < 40; i++) overload_record_backlog(oc, 150);
+    assert(overload_update(oc) == OVERLOAD_LEVEL_SHED_NORMAL);
+    // 80% baja a 1 (umbral de salida del nivel 1: 50%), y 30% a 0
+    for (int i = 0; i < 40; i++) overload_record_backlog(oc, 80);
+    assert(overload_update(oc) == OVERLOAD_LEVEL_SHED_LOW);
+    assert(overload_update(oc) == OVERLOAD_LEVEL_SHED_LOW);
+    for (int i = 0; i < 40; i++) overload_record_backlog(oc, 30);
+    assert(overload_update(oc) == OVERLOAD_LEVEL_NONE);
+    overload_destroy(oc);
+    printf("✓ test_backlog_levels_and_hysteresis\n");
+}
+
+static void test_lag_and_max_age(void) {
+    OverloadController *oc = overload_create(NULL); // 20 ms / 256
+    assert(oc);
+    for (int i = 0; i < 40; i++) overload_record_lag(oc, 30000);
+    assert(overload_update(oc) == OVERLOAD_LEVEL_SHED_LOW);
+    assert(overload_pressure_pct(oc) == 150);
+    // Base 3 s (2 s por cada 100%) con jitter de hasta 50%
+    for (int i = 0; i < 100; i++) {
+        uint32_t age = overload_max_age(oc);
+        assert(age >= 3 && age <= 4);
+    }
+    // Presión extrema: acotado a OVERLOAD_MAX_AGE_S
+    for (int i = 0; i < 40; i++) overload_record_lag(oc, 10000000);
+    overload_update(oc);
+    for (int i = 0; i < 100; i++) assert(overload_max_age(oc) == OVERLOAD_MAX_AGE_S);
+    overload_destroy(oc);
+
+    assert(!overload_should_shed(NULL, DISPATCH_PRIORITY_LOW));
+    assert(overload_max_age(NULL) == 1);
+    printf("✓ test_lag_and_max_age\n");
+}
+
+int main(void) {
+    printf("=== Tests de overload ===\n");
+    test_backlog_levels_and_hysteresis();
+    test_lag_and_max_age();
+    printf("✓ Todos los tests de overload pasaron\n");
+    return 0;
+}
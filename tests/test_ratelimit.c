@@ -0,0 +1,115 @@
+#include "ratelimit.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+static struct sockaddr_in v4(const char *ip, uint16_t port) {
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    assert(inet_pton(AF_INET, ip, &sa.sin_addr) == 1);
+    return sa;
+}
+
+static void test_burst_and_refill(void) {
+    RateLimiter *rl = ratelimit_create(10, 3, 64);
+    assert(rl);
+    struct sockaddr_in a = v4("10.0.0.1", 5683);
+    const struct sockaddr *pa = (const struct sockaddr *)&a;
+
+    for (int i = 0; i < 3; i++) assert(ratelimit_check(rl, pa, 1000) == 0);
+    // Sin fichas: 100 ms para la próxima => Max-Age mínimo de 1 s
+    assert(ratelimit_check(rl, pa, 1000) == 1);
+    assert(ratelimit_check(rl, pa, 1050) == 1);
+    // 100 ms a 10/s recargan una ficha
+    assert(ratelimit_check(rl, pa, 1100) == 0);
+    assert(ratelimit_check(rl, pa, 1100) == 1);
+    // Mucho tiempo después el bucket se llena sólo hasta la ráfaga
+    for (int i = 0; i < 3; i++) assert(ratelimit_check(rl, pa, 60000) == 0);
+    assert(ratelimit_check(rl, pa, 60000) != 0);
+
+    // Otro puerto de la misma dirección comparte bucket
+    struct sockaddr_in b = v4("10.0.0.1", 40000);
+    assert(ratelimit_check(rl, (const struct sockaddr *)&b, 60000) != 0);
+    ratelimit_destroy(rl);
+    printf("✓ test_burst_and_refill\n");
+}
+
+static void test_max_age_slow_rate(void) {
+    RateLimiter *rl = ratelimit_create(1, 1, 0);
+    assert(rl);
+    struct sockaddr_in6 a;
+    memset(&a, 0, sizeof(a));
+    a.sin6_family = AF_INET6;
+    assert(inet_pton(AF_INET6, "2001:db8::7", &a.sin6_addr) == 1);
+    const struct sockaddr *pa = (const struct sockaddr *)&a;
+    assert(ratelimit_check(rl, pa, 0) == 0);
+    assert(ratelimit_check(rl, pa, 0) == 1);
+    assert(ratelimit_check(rl, pa, 400) == 1);
+    assert(ratelimit_check(rl, pa, 1000) == 0);
+
+    RateLimitOffender top[RATELIMIT_TOP_N];
+    assert(ratelimit_top_offenders(rl, top, RATELIMIT_TOP_N) == 1);
+    assert(strcmp(top[0].peer, "2001:db8::7") == 0 && top[0].limited == 2);
+    ratelimit_destroy(rl);
+    printf("✓ test_max_age_slow_rate\n");
+}
+
+static void test_fixed_table_recycles(void) {
+    // 8 slots: miles de direcciones no hacen crecer la tabla; un peer nuevo
+    // siempre obtiene un bucket (recicla el de tráfico más antiguo)
+    RateLimiter *rl = ratelimit_create(1, 1, 8);
+    assert(rl);
+    char ip[32];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(ip, sizeof(ip), "10.1.%d.%d", i / 256, i % 256);
+        struct sockaddr_in a = v4(ip, 1);
+        assert(ratelimit_check(rl, (const struct sockaddr *)&a, (uint64_t)i) == 0);
+    }
+    ratelimit_destroy(rl);
+    printf("✓ test_fixed_table_recycles\n");
+}
+
+static void test_top_offenders(void) {
+    RateLimiter *rl = ratelimit_create(1, 1, 256);
+    assert(rl);
+    char ip[32];
+    // Peer i es rechazado i veces
+    for (int i = 1; i <= 8; i++) {
+        snprintf(ip, sizeof(ip), "192.168.0.%d", i);
+        struct sockaddr_in a = v4(ip, 1);
+        for (int j = 0; j <= i; j++) ratelimit_check(rl, (const struct sockaddr *)&a, 0);
+    }
+    RateLimitOffender top[RATELIMIT_TOP_N];
+    size_t n = ratelimit_top_offenders(rl, top, RATELIMIT_TOP_N);
+    assert(n == RATELIMIT_TOP_N);
+    for (size_t i = 0; i < n; i++) {
+        snprintf(ip, sizeof(ip), "192.168.0.%zu", 8 - i);
+        assert(strcmp(top[i].peer, ip) == 0 && top[i].limited == 8 - i);
+    }
+
+    char json[512];
+    assert(ratelimit_format_offenders(json, sizeof(json)) == 2);
+    assert(strcmp(json, "[]") == 0);
+    ratelimit_set_active(rl);
+    assert(ratelimit_format_offenders(json, sizeof(json)) > 0);
+    assert(strncmp(json, "[{\"peer\":\"192.168.0.8\",\"limited\":8},", 36) == 0);
+    assert(ratelimit_format_offenders(json, 16) == -1);
+    ratelimit_destroy(rl);
+    assert(ratelimit_active() == NULL);
+    printf("✓ test_top_offenders\n");
+}
+
+int main(void) {
+    printf("=== Tests de rate limit ===\n");
+    assert(ratelimit_create(0, 10, 0) == NULL);
+    test_burst_and_refill();
+    test_max_age_slow_rate();
+    test_fixed_table_recycles();
+    test_top_offenders();
+    printf("✓ Todos los tests de rate limit pasaron\n");
+    return 0;
+}
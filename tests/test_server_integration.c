@@ -2,8 +2,12 @@
 #include "coap_codec.h"
 #include "coap.h"
 #include "platform.h"
+#include "metrics.h"
+#include "work_pool.h"
+#include "ratelimit.h"
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -134,6 +138,357 @@ static void test_post_echo(Server *srv, int client) {
     printf("✓ server POST /echo\n");
 }
 
+static void test_busy_poll(Server *srv, int client) {
+    assert(server_set_busy_poll(srv, 2000) == PLATFORM_OK);
+    uint64_t rx_before = metrics_counter_value(METRIC_BUSY_POLL_RX);
+    uint64_t sleeps_before = metrics_counter_value(METRIC_BUSY_POLL_SLEEPS);
+
+    // Mismas requests que en modo normal: las respuestas no cambian
+    test_get_hello(srv, client);
+    test_post_echo(srv, client);
+
+    // Cada request ya estaba encolada al entrar a server_run: la toma el giro.
+    // Sin más tráfico el giro se agota (>= 2 ms) y se duerme.
+    uint64_t spin_ns = metrics_counter_value(METRIC_BUSY_POLL_SPIN_NS);
+    assert(spin_ns >= 2000000ull);
+    assert(metrics_counter_value(METRIC_BUSY_POLL_SLEEPS) > sleeps_before);
+    assert(metrics_counter_value(METRIC_BUSY_POLL_RX) >= rx_before + 2);
+
+    char prom[16384];
+    assert(metrics_format_prometheus(prom, sizeof(prom)) > 0);
+    assert(strstr(prom, "teleserver_busy_poll_seconds_total{state=\"spin\"}"));
+
+    assert(server_set_busy_poll(srv, 0) == PLATFORM_OK);
+    printf("✓ server busy-poll (%.1f ms girando)\n", (double)spin_ns / 1e6);
+}
+
+static ssize_t send_separate_request(Server *srv, int client, CoapType type, uint16_t mid) {
+    CoapMessage req; coap_message_init(&req);
+    req.type = type;
+    req.code = COAP_METHOD_POST;
+    req.message_id = mid;
+    req.token_length = 2;
+    req.token[0] = 0x77; req.token[1] = 0x88;
+    coap_message_add_option(&req, COAP_OPTION_URI_PATH, (const uint8_t *)"test", 4);
+    coap_message_add_option(&req, COAP_OPTION_URI_PATH, (const uint8_t *)"separate", 8);
+    memcpy(req.payload_buffer, "sep", 3);
+    req.payload = req.payload_buffer;
+    req.payload_length = 3;
+    uint8_t out[COAP_MAX_MESSAGE_SIZE];
+    int n = coap_encode(&req, out, sizeof(out));
+    assert(n > 0);
+
+    struct sockaddr_in dst; memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(server_get_port(srv));
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return sendto(client, out, (size_t)n, 0, (struct sockaddr *)&dst, sizeof(dst));
+}
+
+static void recv_message(Server *srv, int client, CoapMessage *msg, int attempts) {
+    uint8_t in[COAP_MAX_MESSAGE_SIZE];
+    struct sockaddr_in src; socklen_t slen = sizeof(src);
+    ssize_t r = -1;
+    for (int i = 0; i < attempts && r <= 0; i++) {
+        r = recvfrom(client, in, sizeof(in), 0, (struct sockaddr *)&src, &slen);
+        if (r <= 0) server_run(srv, 20);
+    }
+    assert(r > 0);
+    coap_message_init(msg);
+    assert(coap_decode(msg, in, (size_t)r) == 0);
+}
+
+static void test_separate_response(Server *srv, int client) {
+    uint64_t separate_before = metrics_counter_value(METRIC_SEPARATE);
+    uint64_t retransmit_before = metrics_counter_value(METRIC_RETRANSMIT);
+
+    // CON: primero un ACK vacío con el MID de la request...
+    assert(send_separate_request(srv, client, COAP_TYPE_CONFIRMABLE, 0x4000) > 0);
+    CoapMessage ack;
+    recv_message(srv, client, &ack, 20);
+    assert(ack.type == COAP_TYPE_ACKNOWLEDGMENT && ack.code == 0);
+    assert(ack.message_id == 0x4000 && ack.token_length == 0);
+
+    // ...luego la respuesta como CON propia, con el token de la request
+    CoapMessage resp;
+    recv_message(srv, client, &resp, 20);
+    assert(resp.type == COAP_TYPE_CONFIRMABLE && resp.code == COAP_RESPONSE_CONTENT);
+    assert(resp.token_length == 2 && resp.token[0] == 0x77 && resp.token[1] == 0x88);
+    assert(resp.payload_length == 3 && memcmp(resp.payload, "sep", 3) == 0);
+
+    // Sin ACK del cliente se retransmite (ACK_TIMEOUT..x1.5) con el mismo MID
+    CoapMessage again;
+    recv_message(srv, client, &again, 200);
+    assert(again.type == COAP_TYPE_CONFIRMABLE && again.message_id == resp.message_id);
+    assert(metrics_counter_value(METRIC_RETRANSMIT) == retransmit_before + 1);
+
+    // El ACK vacío cierra el intercambio (y no genera respuesta)
+    uint8_t empty_ack[4] = { 0x60, 0x00, (uint8_t)(resp.message_id >> 8), (uint8_t)resp.message_id };
+    struct sockaddr_in dst; memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(server_get_port(srv));
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(sendto(client, empty_ack, sizeof(empty_ack), 0, (struct sockaddr *)&dst, sizeof(dst)) == 4);
+    uint8_t in[COAP_MAX_MESSAGE_SIZE];
+    struct sockaddr_in src; socklen_t slen = sizeof(src);
+    assert(run_and_recv(srv, client, in, sizeof(in), &src, &slen) < 0);
+
+    // NON: sin ACK; la respuesta llega como NON
+    assert(send_separate_request(srv, client, COAP_TYPE_NON_CONFIRMABLE, 0x4001) > 0);
+    recv_message(srv, client, &resp, 20);
+    assert(resp.type == COAP_TYPE_NON_CONFIRMABLE && resp.code == COAP_RESPONSE_CONTENT);
+    assert(resp.token_length == 2 && resp.token[0] == 0x77);
+
+    assert(metrics_counter_value(METRIC_SEPARATE) == separate_before + 2);
+    printf("✓ server separate response (ACK vacío + CON retransmitida)\n");
+}
+
+#define OFFLOAD_REQUESTS 32
+
+static void test_workers_offload(Server *srv, int client) {
+    assert(server_set_workers(srv, 2) == PLATFORM_OK);
+    uint64_t offloaded_before = metrics_counter_value(METRIC_OFFLOADED);
+
+    // Ruta barata: sigue inline
+    test_get_hello(srv, client);
+    assert(metrics_counter_value(METRIC_OFFLOADED) == offloaded_before);
+
+    struct sockaddr_in dst; memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(server_get_port(srv));
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // Ráfaga de GET de telemetría: se ejecutan en el pool y cada respuesta
+    // vuelve con su message ID
+    bool seen[OFFLOAD_REQUESTS] = { false };
+    for (int i = 0; i < OFFLOAD_REQUESTS; i++) {
+        uint8_t out[COAP_MAX_MESSAGE_SIZE];
+        CoapMessage req; build_get(&req, "/api/v1/telemetry", COAP_TYPE_CONFIRMABLE);
+        req.message_id = (uint16_t)(0x3000 + i);
+        int n = coap_encode(&req, out, sizeof(out));
+        assert(n > 0);
+        assert(sendto(client, out, (size_t)n, 0, (struct sockaddr *)&dst, sizeof(dst)) == n);
+    }
+    int received = 0;
+    for (int iter = 0; iter < 200 && received < OFFLOAD_REQUESTS; iter++) {
+        server_run(srv, 20);
+        uint8_t in[COAP_MAX_MESSAGE_SIZE];
+        ssize_t r;
+        while ((r = recv(client, in, sizeof(in), 0)) > 0) {
+            CoapMessage resp; coap_message_init(&resp);
+            assert(coap_decode(&resp, in, (size_t)r) == 0);
+            assert(resp.code == COAP_RESPONSE_CONTENT);
+            assert(resp.type == COAP_TYPE_ACKNOWLEDGMENT);
+            int idx = resp.message_id - 0x3000;
+            assert(idx >= 0 && idx < OFFLOAD_REQUESTS && !seen[idx]);
+            seen[idx] = true;
+            received++;
+        }
+    }
+    assert(received == OFFLOAD_REQUESTS);
+    assert(metrics_counter_value(METRIC_OFFLOADED) == offloaded_before + OFFLOAD_REQUESTS);
+
+    // Deshabilitar con jobs recién encolados: se completan y envían
+    uint8_t out[COAP_MAX_MESSAGE_SIZE];
+    CoapMessage req; build_get(&req, "/api/v1/telemetry", COAP_TYPE_NON_CONFIRMABLE);
+    int n = coap_encode(&req, out, sizeof(out));
+    assert(sendto(client, out, (size_t)n, 0, (struct sockaddr *)&dst, sizeof(dst)) == n);
+    server_run(srv, 20);
+    assert(server_set_workers(srv, 0) == PLATFORM_OK);
+    uint8_t in[COAP_MAX_MESSAGE_SIZE];
+    struct sockaddr_in src; socklen_t slen = sizeof(src);
+    assert(run_and_recv(srv, client, in, sizeof(in), &src, &slen) > 0);
+    assert(server_set_workers(srv, WORK_POOL_MAX_WORKERS + 1) == PLATFORM_EINVAL);
+    printf("✓ server workers offload\n");
+}
+
+#define RATE_BURST 3
+
+// GET 'path' CON desde 'client' y devuelve el código de la respuesta (0 si no
+// llegó ninguna); si llega 5.03 deja el Max-Age en *max_age
+static int get_code(Server *srv, int client, const char *path, uint16_t mid, unsigned *max_age) {
+    uint8_t out[COAP_MAX_MESSAGE_SIZE];
+    CoapMessage req; build_get(&req, path, COAP_TYPE_CONFIRMABLE);
+    req.message_id = mid;
+    int n = coap_encode(&req, out, sizeof(out));
+    assert(n > 0);
+    struct sockaddr_in dst; memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(server_get_port(srv));
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(sendto(client, out, (size_t)n, 0, (struct sockaddr *)&dst, sizeof(dst)) == n);
+
+    uint8_t in[COAP_MAX_MESSAGE_SIZE];
+    struct sockaddr_in src; socklen_t slen = sizeof(src);
+    ssize_t r = run_and_recv(srv, client, in, sizeof(in), &src, &slen);
+    if (r <= 0) return 0;
+    CoapMessage resp; coap_message_init(&resp);
+    assert(coap_decode(&resp, in, (size_t)r) == 0);
+    assert(resp.type == COAP_TYPE_ACKNOWLEDGMENT && resp.message_id == mid);
+    assert(resp.token_length == 1 && resp.token[0] == 0x42);
+    if (resp.code == COAP_ERROR_SERVICE_UNAVAILABLE && max_age) {
+        const CoapOptionDef *opt = coap_message_find_option(&resp, COAP_OPTION_MAX_AGE);
+        assert(opt && opt->length >= 1);
+        *max_age = 0;
+        for (uint16_t i = 0; i < opt->length; i++) *max_age = (*max_age << 8) | opt->value[i];
+    }
+    return resp.code;
+}
+
+static void test_rate_limit(Server *srv, int client) {
+    uint64_t limited_before = metrics_counter_value(METRIC_RATE_LIMITED);
+    assert(server_set_rate_limit(srv, 1, RATE_BURST) == PLATFORM_OK);
+
+    // La ráfaga pasa; luego 5.03 con Max-Age hasta la próxima ficha (1/s)
+    for (int i = 0; i < RATE_BURST; i++) {
+        assert(get_code(srv, client, "/hello", (uint16_t)(0x5000 + i), NULL) == COAP_RESPONSE_CONTENT);
+    }
+    unsigned max_age = 0;
+    assert(get_code(srv, client, "/hello", 0x5010, &max_age) == COAP_ERROR_SERVICE_UNAVAILABLE);
+    assert(max_age == 1);
+    assert(metrics_counter_value(METRIC_RATE_LIMITED) == limited_before + 1);
+
+    // Un peer con otra dirección conserva su propio bucket
+    int other = udp_client_socket();
+    struct sockaddr_in src; memset(&src, 0, sizeof(src));
+    src.sin_family = AF_INET;
+    src.sin_addr.s_addr = inet_addr("127.0.0.2");
+    if (bind(other, (struct sockaddr *)&src, sizeof(src)) == 0) {
+        assert(get_code(srv, other, "/hello", 0x5020, NULL) == COAP_RESPONSE_CONTENT);
+    }
+    close(other);
+
+    // El peer rechazado aparece como top offender en /api/v1/status
+    char offenders[512];
+    assert(ratelimit_format_offenders(offenders, sizeof(offenders)) > 0);
+    assert(strstr(offenders, "\"peer\":\"127.0.0.1\",\"limited\":1") != NULL);
+
+    assert(server_set_rate_limit(srv, 0, 0) == PLATFORM_OK);
+    assert(ratelimit_active() == NULL);
+    assert(get_code(srv, client, "/hello", 0x5030, NULL) == COAP_RESPONSE_CONTENT);
+    printf("✓ server rate limit (5.03 con Max-Age, buckets por peer, offenders)\n");
+}
+
+// 'busy_poll_us' > 0: la ráfaga la drena el giro de busy-poll en lugar de
+// on_readable, y el backlog debe medirse igual
+static void test_overload_shedding(Server *srv, int client, uint32_t busy_poll_us, uint16_t mid) {
+    uint64_t shed_before = metrics_counter_value(METRIC_SHED);
+    // Sin umbral de lag alcanzable; backlog de 1 datagrama por despertar
+    assert(server_set_overload(srv, 60000, 1) == PLATFORM_OK);
+    assert(server_set_busy_poll(srv, busy_poll_us) == PLATFORM_OK);
+
+    // Ráfaga: varios datagramas por despertar => presión >= 200%
+    uint8_t out[COAP_MAX_MESSAGE_SIZE];
+    CoapMessage req; build_get(&req, "/api/v1/health", COAP_TYPE_NON_CONFIRMABLE);
+    int n = coap_encode(&req, out, sizeof(out));
+    assert(n > 0);
+    struct sockaddr_in dst; memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(server_get_port(srv));
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < 8; i++) {
+        assert(sendto(client, out, (size_t)n, 0, (struct sockaddr *)&dst, sizeof(dst)) == n);
+    }
+    // Dejar correr la sonda de lag (10 ms) y descartar las respuestas
+    uint8_t in[COAP_MAX_MESSAGE_SIZE];
+    for (int i = 0; i < 5; i++) server_run(srv, 20);
+    while (recv(client, in, sizeof(in), 0) > 0) {}
+
+    // Prioridad baja (status, legacy) => 5.03 con Max-Age; la ingesta y
+    // health siguen atendiéndose
+    unsigned max_age = 0;
+    assert(get_code(srv, client, "/api/v1/status", mid, &max_age) == COAP_ERROR_SERVICE_UNAVAILABLE);
+    assert(max_age >= 1 && max_age <= 60);
+    assert(get_code(srv, client, "/hello", (uint16_t)(mid + 1), NULL) == COAP_ERROR_SERVICE_UNAVAILABLE);
+    assert(get_code(srv, client, "/api/v1/health", (uint16_t)(mid + 2), NULL) == COAP_RESPONSE_CONTENT);
+    assert(metrics_counter_value(METRIC_SHED) == shed_before + 2);
+
+    assert(server_set_overload(srv, 0, 0) == PLATFORM_OK);
+    assert(get_code(srv, client, "/api/v1/status", (uint16_t)(mid + 3), NULL) == COAP_RESPONSE_CONTENT);
+    assert(server_set_busy_poll(srv, 0) == PLATFORM_OK);
+    printf("✓ server overload shedding%s (5.03 + Max-Age para prioridad baja)\n",
+           busy_poll_us ? " con busy-poll" : "");
+}
+
+static void test_priority_queues(Server *srv, int client) {
+    struct sockaddr_in dst; memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(server_get_port(srv));
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // Lecturas (LOW) encoladas antes que health (HIGH) en el mismo lote
+    uint8_t out[COAP_MAX_MESSAGE_SIZE];
+    CoapMessage req;
+    for (int i = 0; i < 6; i++) {
+        build_get(&req, i < 4 ? "/hello" : "/api/v1/health", COAP_TYPE_NON_CONFIRMABLE);
+        req.message_id = (uint16_t)(0x7000 + i);
+        int n = coap_encode(&req, out, sizeof(out));
+        assert(n > 0);
+        assert(sendto(client, out, (size_t)n, 0, (struct sockaddr *)&dst, sizeof(dst)) == n);
+    }
+
+    uint16_t order[6];
+    int got = 0;
+    uint8_t in[COAP_MAX_MESSAGE_SIZE];
+    for (int tries = 0; tries < 20 && got < 6; tries++) {
+        server_run(srv, 20);
+        ssize_t r;
+        while (got < 6 && (r = recv(client, in, sizeof(in), 0)) > 0) {
+            CoapMessage resp; coap_message_init(&resp);
+            assert(coap_decode(&resp, in, (size_t)r) == 0);
+            order[got++] = resp.message_id;
+        }
+    }
+    assert(got == 6);
+    // Health se atiende primero; las lecturas conservan su orden relativo
+    assert(order[0] == 0x7004 && order[1] == 0x7005);
+    for (int i = 0; i < 4; i++) assert(order[2 + i] == 0x7000 + i);
+
+    MetricsSummary depth, wait;
+    metrics_queue_depth_summary(DISPATCH_PRIORITY_LOW, &depth);
+    metrics_queue_wait_summary(DISPATCH_PRIORITY_HIGH, &wait);
+    assert(depth.count >= 1 && depth.max_ns >= 4);
+    assert(wait.count >= 2);
+    printf("✓ server priority queues (ingesta antes que lecturas en el lote)\n");
+}
+
+static void test_rx_budget(Server *srv, int client) {
+    uint64_t exhausted_before = metrics_counter_value(METRIC_RX_BUDGET_EXHAUSTED);
+    assert(server_set_rx_budget(srv, 2, 0) == PLATFORM_OK);
+
+    struct sockaddr_in dst; memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(server_get_port(srv));
+    dst.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    uint8_t out[COAP_MAX_MESSAGE_SIZE];
+    CoapMessage req; build_get(&req, "/hello", COAP_TYPE_NON_CONFIRMABLE);
+    int n = coap_encode(&req, out, sizeof(out));
+    assert(n > 0);
+    for (int i = 0; i < 6; i++) {
+        assert(sendto(client, out, (size_t)n, 0, (struct sockaddr *)&dst, sizeof(dst)) == n);
+    }
+
+    // Dos datagramas por vuelta: el socket se re-arma sin un flanco nuevo
+    uint8_t in[COAP_MAX_MESSAGE_SIZE];
+    int got = 0;
+    for (int round = 1; round <= 3; round++) {
+        assert(server_run(srv, 1000) == PLATFORM_OK);
+        while (recv(client, in, sizeof(in), 0) > 0) got++;
+        assert(got == 2 * round);
+    }
+    assert(server_run(srv, 0) == PLATFORM_OK);
+    assert(metrics_counter_value(METRIC_RX_BUDGET_EXHAUSTED) == exhausted_before + 3);
+
+    // Utilización del loop publicada periódicamente
+    for (int i = 0; i < 8; i++) server_run(srv, 20);
+    assert(metrics_counter_value(METRIC_LOOP_IDLE_NS) > 0);
+    assert(metrics_counter_value(METRIC_LOOP_BUSY_NS) > 0);
+
+    assert(server_set_rx_budget(srv, 256, 1000) == PLATFORM_OK);
+    assert(server_set_rx_budget(NULL, 1, 1) == PLATFORM_EINVAL);
+    printf("✓ server rx budget (re-armado por lote y utilización del loop)\n");
+}
+
 int main(void) {
     printf("=== Tests de integración del servidor ===\n");
     platform_init();
@@ -145,6 +500,14 @@ int main(void) {
 
     test_get_hello(srv, client);
     test_post_echo(srv, client);
+    test_busy_poll(srv, client);
+    test_workers_offload(srv, client);
+    test_separate_response(srv, client);
+    test_rate_limit(srv, client);
+    test_overload_shedding(srv, client, 0, 0x6000);
+    test_overload_shedding(srv, client, 2000, 0x6010);
+    test_priority_queues(srv, client);
+    test_rx_budget(srv, client);
 
     close(client);
     server_destroy(srv);
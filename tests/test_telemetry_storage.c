@@ -0,0 +1,295 @@
+#include "telemetry_storage.h"
+#include "time_source.h"
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PRODUCERS 4
+#define PER_PRODUCER 20000
+
+static atomic_bool g_done;
+static atomic_ulong g_checked;
+
+// JSON determinístico a partir de (productor, n): permite detectar entradas
+// mezcladas (torn) regenerando el contenido esperado.
+static size_t make_json(char *out, size_t out_size, int p, int n) {
+    char fill[256];
+    size_t fill_len = (size_t)((p * 7 + n) % 200);
+    memset(fill, 'a' + (p * 31 + n) % 26, fill_len);
+    fill[fill_len] = '\0';
+    int len = snprintf(out, out_size, "{\"p\":%d,\"n\":%d,\"f\":\"%s\"}", p, n, fill);
+    assert(len > 0 && (size_t)len < out_size);
+    return (size_t)len;
+}
+
+static void check_entry(const TelemetryEntry *e) {
+    int p = -1, n = -1;
+    assert(e->json_length < TELEMETRY_MAX_JSON_SIZE);
+    assert(sscanf(e->json, "{\"p\":%d,\"n\":%d", &p, &n) == 2);
+    char expected[TELEMETRY_MAX_JSON_SIZE];
+    size_t len = make_json(expected, sizeof(expected), p, n);
+    assert(e->json_length == len);
+    assert(memcmp(e->json, expected, len) == 0);
+}
+
+static void test_ring_order_and_clear(void) {
+    telemetry_storage_init();
+    char json[64];
+    for (int i = 0; i < TELEMETRY_MAX_ENTRIES + 5; i++) {
+        size_t len = make_json(json, sizeof(json), 0, i % 50 == 0 ? 1 : 2);
+        assert(telemetry_storage_add(json, len) == 0);
+    }
+    TelemetryStats st;
+    telemetry_storage_get_stats(&st);
+    assert(st.total_received == TELEMETRY_MAX_ENTRIES + 5);
+    assert(st.current_count == TELEMETRY_MAX_ENTRIES);
+
+    static TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
+    assert(telemetry_storage_get_all(entries, TELEMETRY_MAX_ENTRIES) == TELEMETRY_MAX_ENTRIES);
+    for (size_t i = 1; i < TELEMETRY_MAX_ENTRIES; i++) {
+        assert(entries[i].timestamp_ms >= entries[i - 1].timestamp_ms);
+    }
+
+    uint64_t gen = telemetry_storage_get_generation();
+    telemetry_storage_clear();
+    assert(telemetry_storage_get_generation() != gen);
+    telemetry_storage_get_stats(&st);
+    assert(st.total_received == 0 && st.current_count == 0);
+    assert(telemetry_storage_get_all(entries, TELEMETRY_MAX_ENTRIES) == 0);
+
+    size_t len = make_json(json, sizeof(json), 1, 1);
+    assert(telemetry_storage_add(json, len) == 0);
+    assert(telemetry_storage_get_all(entries, TELEMETRY_MAX_ENTRIES) == 1);
+    check_entry(&entries[0]);
+    printf("✓ test_ring_order_and_clear\n");
+}
+
+static void *producer(void *arg) {
+    int p = (int)(intptr_t)arg;
+    char json[TELEMETRY_MAX_JSON_SIZE];
+    for (int n = 0; n < PER_PRODUCER; n++) {
+        size_t len = make_json(json, sizeof(json), p, n);
+        assert(telemetry_storage_add(json, len) == 0);
+    }
+    return NULL;
+}
+
+static void *reader(void *arg) {
+    (void)arg;
+    static TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
+    while (!atomic_load(&g_done)) {
+        size_t n = telemetry_storage_get_all(entries, TELEMETRY_MAX_ENTRIES);
+        for (size_t i = 0; i < n; i++) check_entry(&entries[i]);
+        atomic_fetch_add(&g_checked, n);
+    }
+    return NULL;
+}
+
+static void run_concurrent_producers(TelemetryStorageMode mode) {
+    telemetry_storage_init_mode(mode);
+    atomic_store(&g_done, false);
+    atomic_store(&g_checked, 0);
+
+    pthread_t prod[PRODUCERS], rd;
+    assert(pthread_create(&rd, NULL, reader, NULL) == 0);
+    for (int p = 0; p < PRODUCERS; p++) {
+        assert(pthread_create(&prod[p], NULL, producer, (void *)(intptr_t)p) == 0);
+    }
+    for (int p = 0; p < PRODUCERS; p++) pthread_join(prod[p], NULL);
+    atomic_store(&g_done, true);
+    pthread_join(rd, NULL);
+
+    TelemetryStats st;
+    telemetry_storage_get_stats(&st);
+    assert(st.total_received == (size_t)PRODUCERS * PER_PRODUCER);
+    assert(st.current_count == TELEMETRY_MAX_ENTRIES);
+
+    static TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
+    assert(telemetry_storage_get_all(entries, TELEMETRY_MAX_ENTRIES) == TELEMETRY_MAX_ENTRIES);
+    for (size_t i = 0; i < TELEMETRY_MAX_ENTRIES; i++) {
+        check_entry(&entries[i]);
+        // En modo compartido el orden es el de los tickets: un productor puede
+        // tomar su timestamp después que otro con ticket posterior.
+        if (i > 0 && mode == TELEMETRY_MODE_SHARDED) {
+            assert(entries[i].timestamp_ms >= entries[i - 1].timestamp_ms);
+        }
+    }
+    printf("✓ concurrent producers, modo %s (%lu entradas verificadas)\n",
+           mode == TELEMETRY_MODE_SHARDED ? "sharded" : "shared",
+           (unsigned long)atomic_load(&g_checked));
+}
+
+// Timestamps controlados por hilo para validar el merge entre shards
+static _Thread_local uint64_t t_next_ts;
+static uint64_t thread_now(void) { return t_next_ts; }
+
+static void *shard_writer(void *arg) {
+    uint64_t parity = (uint64_t)(intptr_t)arg;
+    char json[TELEMETRY_MAX_JSON_SIZE];
+    for (int i = 0; i < TELEMETRY_MAX_ENTRIES; i++) {
+        t_next_ts = 2 * (uint64_t)i + parity;
+        size_t len = make_json(json, sizeof(json), (int)parity, i);
+        assert(telemetry_storage_add(json, len) == 0);
+    }
+    return NULL;
+}
+
+static void test_sharded_merge_order(void) {
+    TimeSource ts = { .now_ms = thread_now };
+    time_source_set(&ts);
+    telemetry_storage_init_mode(TELEMETRY_MODE_SHARDED);
+
+    // Dos hilos (dos shards): pares e impares intercalados en el tiempo
+    pthread_t a, b;
+    assert(pthread_create(&a, NULL, shard_writer, (void *)(intptr_t)0) == 0);
+    pthread_join(a, NULL);
+    assert(pthread_create(&b, NULL, shard_writer, (void *)(intptr_t)1) == 0);
+    pthread_join(b, NULL);
+
+    TelemetryStats st;
+    telemetry_storage_get_stats(&st);
+    assert(st.total_received == 2 * TELEMETRY_MAX_ENTRIES);
+    assert(st.current_count == TELEMETRY_MAX_ENTRIES);
+    assert(st.last_received_ms == 2 * TELEMETRY_MAX_ENTRIES - 1);
+
+    // Vista global: las 100 más recientes (ts 100..199) en orden estricto
+    static TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
+    assert(telemetry_storage_get_all(entries, TELEMETRY_MAX_ENTRIES) == TELEMETRY_MAX_ENTRIES);
+    for (size_t i = 0; i < TELEMETRY_MAX_ENTRIES; i++) {
+        assert(entries[i].timestamp_ms == TELEMETRY_MAX_ENTRIES + i);
+        check_entry(&entries[i]);
+    }
+
+    uint64_t gen = telemetry_storage_get_generation();
+    telemetry_storage_clear();
+    assert(telemetry_storage_get_generation() != gen);
+    assert(telemetry_storage_get_all(entries, TELEMETRY_MAX_ENTRIES) == 0);
+
+    time_source_set(NULL);
+    printf("✓ test_sharded_merge_order\n");
+}
+
+// Snapshots con clears concurrentes: un productor (n consecutivos) y un hilo
+// que limpia cada CLEAR_EVERY publicaciones; cada snapshot consistente debe
+// ser contiguo y sus estadísticas y generación coherentes. El productor no
+// supera CLEAR_EVERY entradas por ventana: sin vuelta del ring, un hueco sólo
+// puede venir de mezclar estado previo y posterior a un clear.
+#define CLEAR_EVERY 64
+
+static atomic_bool g_reader_ready;
+static atomic_ullong g_cleared_at;
+
+static void *clearer(void *arg) {
+    (void)arg;
+    while (!atomic_load(&g_done)) {
+        if (telemetry_storage_get_generation() - atomic_load(&g_cleared_at) >= CLEAR_EVERY) {
+            telemetry_storage_clear();
+            atomic_store(&g_cleared_at, telemetry_storage_get_generation());
+        }
+        sched_yield();
+    }
+    return NULL;
+}
+
+// Cede la CPU cada pocas entradas: con un solo núcleo, el lector ve estados
+// intermedios y no sólo el final de cada quantum
+static void *paced_producer(void *arg) {
+    (void)arg;
+    char json[TELEMETRY_MAX_JSON_SIZE];
+    for (int n = 0; n < PER_PRODUCER; n++) {
+        while (telemetry_storage_get_generation() - atomic_load(&g_cleared_at) >= CLEAR_EVERY) {
+            sched_yield();
+        }
+        size_t len = make_json(json, sizeof(json), 0, n);
+        assert(telemetry_storage_add(json, len) == 0);
+        if (n % 16 == 15) sched_yield();
+    }
+    return NULL;
+}
+
+static void *snapshot_reader(void *arg) {
+    (void)arg;
+    static TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
+    uint64_t last_gen = 0;
+    atomic_store(&g_reader_ready, true);
+    while (!atomic_load(&g_done)) {
+        TelemetrySnapshot snap;
+        size_t n = telemetry_storage_snapshot(entries, TELEMETRY_MAX_ENTRIES, &snap);
+        assert(n == snap.entry_count);
+        if (!snap.consistent) {
+            assert(n == 0);
+            continue;
+        }
+        assert(snap.generation >= last_gen);
+        assert(snap.stats.current_count == n);
+        assert(snap.stats.current_count <= snap.stats.capacity);
+        assert(snap.stats.total_received >= snap.stats.current_count);
+        last_gen = snap.generation;
+
+        int prev = -1;
+        for (size_t i = 0; i < n; i++) {
+            int p = -1, seq = -1;
+            check_entry(&entries[i]);
+            assert(sscanf(entries[i].json, "{\"p\":%d,\"n\":%d", &p, &seq) == 2);
+            if (prev >= 0) assert(seq == prev + 1);
+            prev = seq;
+        }
+        if (n > 0) assert(snap.stats.last_received_ms == entries[n - 1].timestamp_ms);
+        atomic_fetch_add(&g_checked, n);
+    }
+    return NULL;
+}
+
+static void test_snapshot_with_concurrent_clear(void) {
+    telemetry_storage_init();
+    atomic_store(&g_done, false);
+    atomic_store(&g_reader_ready, false);
+    atomic_store(&g_cleared_at, telemetry_storage_get_generation());
+    atomic_store(&g_checked, 0);
+
+    pthread_t prod, clr, rd;
+    assert(pthread_create(&rd, NULL, snapshot_reader, NULL) == 0);
+    assert(pthread_create(&clr, NULL, clearer, NULL) == 0);
+    while (!atomic_load(&g_reader_ready)) sched_yield();
+    assert(pthread_create(&prod, NULL, paced_producer, NULL) == 0);
+    pthread_join(prod, NULL);
+    atomic_store(&g_done, true);
+    pthread_join(clr, NULL);
+    pthread_join(rd, NULL);
+    // El lector debe haber validado entradas con el productor activo
+    assert(atomic_load(&g_checked) > 0);
+
+    // En reposo: snapshot, stats y serialización coinciden exactamente
+    static TelemetryEntry entries[TELEMETRY_MAX_ENTRIES];
+    TelemetrySnapshot snap;
+    size_t n = telemetry_storage_snapshot(entries, TELEMETRY_MAX_ENTRIES, &snap);
+    assert(snap.consistent);
+    assert(n == snap.stats.current_count);
+    assert(snap.generation == telemetry_storage_get_generation());
+
+    static char json[TELEMETRY_MAX_ENTRIES * (TELEMETRY_MAX_JSON_SIZE + 32)];
+    uint64_t gen = 0;
+    assert(telemetry_storage_serialize_snapshot(json, sizeof(json), &gen) > 0);
+    assert(gen == snap.generation);
+
+    telemetry_storage_clear();
+    telemetry_storage_snapshot(NULL, 0, &snap);
+    assert(snap.entry_count == 0 && snap.stats.current_count == 0);
+    assert(snap.stats.total_received == 0 && snap.generation != gen);
+    printf("✓ test_snapshot_with_concurrent_clear (%lu entradas verificadas)\n",
+           (unsigned long)atomic_load(&g_checked));
+}
+
+int main(void) {
+    printf("=== Tests de telemetry storage ===\n");
+    test_ring_order_and_clear();
+    run_concurrent_producers(TELEMETRY_MODE_SHARED);
+    run_concurrent_producers(TELEMETRY_MODE_SHARDED);
+    test_sharded_merge_order();
+    test_snapshot_with_concurrent_clear();
+    printf("✓ Todos los tests de telemetry storage pasaron\n");
+    return 0;
+}
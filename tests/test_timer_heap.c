@@ -0,0 +1,163 @@
+#include "timer_heap.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MS 1000000ull
+
+typedef struct {
+	int order[16];
+	int count;
+} Trace;
+
+static Trace g_trace;
+
+static void record(void *user_data) {
+	g_trace.order[g_trace.count++] = (int)(intptr_t)user_data;
+}
+
+static void test_order_and_cancel(void) {
+	TimerHeap *h = timer_heap_create();
+	assert(h);
+	g_trace.count = 0;
+	int a = timer_heap_add(h, 30 * MS, 0, record, (void *)1);
+	int b = timer_heap_add(h, 10 * MS, 0, record, (void *)2);
+	int c = timer_heap_add(h, 20 * MS, 0, record, (void *)3);
+	int d = timer_heap_add(h, 10 * MS, 0, record, (void *)4); // empate: orden de armado
+	assert(a > 0 && b > 0 && c > 0 && d > 0);
+	assert(timer_heap_count(h) == 4);
+
+	assert(timer_heap_cancel(h, c));
+	assert(!timer_heap_cancel(h, c)); // ya cancelado
+	assert(timer_heap_count(h) == 3);
+
+	uint64_t next = 0;
+	assert(timer_heap_next_deadline(h, &next) && next == 10 * MS);
+	assert(timer_heap_run_expired(h, 5 * MS) == 0);
+	assert(timer_heap_run_expired(h, 25 * MS) == 2);
+	assert(timer_heap_run_expired(h, 100 * MS) == 1);
+	assert(g_trace.count == 3);
+	assert(g_trace.order[0] == 2 && g_trace.order[1] == 4 && g_trace.order[2] == 1);
+	assert(!timer_heap_next_deadline(h, &next));
+	assert(timer_heap_count(h) == 0);
+	timer_heap_destroy(h);
+	printf("✓ test_order_and_cancel\n");
+}
+
+static void test_stable_ids(void) {
+	TimerHeap *h = timer_heap_create();
+	int old = timer_heap_add(h, 10 * MS, 0, record, NULL);
+	assert(timer_heap_cancel(h, old));
+	// Otro slot (el liberado espera en la FIFO) u otra generación: el ID
+	// viejo no afecta al nuevo
+	int fresh = timer_heap_add(h, 10 * MS, 0, record, NULL);
+	assert(fresh != old);
+	assert(!timer_heap_cancel(h, old));
+	assert(timer_heap_count(h) == 1);
+	assert(!timer_heap_cancel(h, 0) && !timer_heap_cancel(h, -1) && !timer_heap_cancel(h, 12345));
+	assert(timer_heap_cancel(h, fresh));
+	timer_heap_destroy(h);
+	printf("✓ test_stable_ids\n");
+}
+
+// Un timer que se arma y cancela en bucle (retransmisiones) no agota la
+// generación de un slot: un ID viejo no cancela al timer vivo
+static void test_stale_id_after_churn(void) {
+	TimerHeap *h = timer_heap_create();
+	int old = timer_heap_add(h, 10 * MS, 0, record, NULL);
+	assert(timer_heap_cancel(h, old));
+	for (int i = 0; i < (4 << TIMER_HEAP_GEN_BITS); i++) {
+		int id = timer_heap_add(h, 10 * MS, 0, record, NULL);
+		assert(id > 0 && id != old);
+		assert(!timer_heap_cancel(h, old));
+		assert(timer_heap_count(h) == 1);
+		assert(timer_heap_cancel(h, id));
+	}
+	timer_heap_destroy(h);
+	printf("✓ test_stale_id_after_churn\n");
+}
+
+typedef struct {
+	TimerHeap *heap;
+	int id;
+	int fired;
+	int limit;
+} Periodic;
+
+static void on_periodic(void *user_data) {
+	Periodic *p = user_data;
+	if (++p->fired == p->limit) assert(timer_heap_cancel(p->heap, p->id));
+}
+
+static void on_rearm_zero(void *user_data) {
+	Periodic *p = user_data;
+	p->fired++;
+	// Armado desde un callback con vencimiento inmediato: no corre en esta pasada
+	assert(timer_heap_add(p->heap, 0, 0, on_rearm_zero, p) > 0);
+}
+
+static void test_periodic_and_reentrancy(void) {
+	TimerHeap *h = timer_heap_create();
+	Periodic p = { h, 0, 0, 3 };
+	p.id = timer_heap_add(h, 10 * MS, 10 * MS, on_periodic, &p);
+	assert(p.id > 0);
+	assert(timer_heap_run_expired(h, 10 * MS) == 1);
+	assert(timer_heap_run_expired(h, 15 * MS) == 0);
+	// Loop atrasado: un solo disparo, sin ráfaga de recuperación
+	assert(timer_heap_run_expired(h, 55 * MS) == 1);
+	assert(timer_heap_run_expired(h, 64 * MS) == 0);
+	assert(timer_heap_run_expired(h, 65 * MS) == 1);
+	assert(p.fired == 3 && timer_heap_count(h) == 0); // se canceló a sí mismo
+	assert(timer_heap_run_expired(h, 1000 * MS) == 0);
+
+	Periodic r = { h, 0, 0, 0 };
+	assert(timer_heap_add(h, 0, 0, on_rearm_zero, &r) > 0);
+	assert(timer_heap_run_expired(h, 1 * MS) == 1);
+	assert(timer_heap_run_expired(h, 1 * MS) == 1);
+	assert(r.fired == 2 && timer_heap_count(h) == 1);
+	timer_heap_destroy(h);
+	printf("✓ test_periodic_and_reentrancy\n");
+}
+
+static void count_fire(void *user_data) {
+	(*(int *)user_data)++;
+}
+
+static void test_many_timers(void) {
+	enum { N = 100000 };
+	TimerHeap *h = timer_heap_create();
+	int *ids = malloc(N * sizeof(int));
+	assert(ids);
+	int fired = 0;
+	srand(7);
+	for (int i = 0; i < N; i++) {
+		ids[i] = timer_heap_add(h, (uint64_t)(rand() % 100000) * MS, 0, count_fire, &fired);
+		assert(ids[i] > 0);
+	}
+	// Cancela 3 de cada 4: fuerza compactación del heap
+	for (int i = 0; i < N; i++) if (i % 4 != 0) assert(timer_heap_cancel(h, ids[i]));
+	assert(timer_heap_count(h) == N / 4);
+
+	uint64_t prev = 0, next;
+	size_t total = 0;
+	while (timer_heap_next_deadline(h, &next)) {
+		assert(next >= prev);
+		prev = next;
+		total += timer_heap_run_expired(h, next);
+	}
+	assert(total == N / 4 && fired == N / 4);
+	free(ids);
+	timer_heap_destroy(h);
+	printf("✓ test_many_timers\n");
+}
+
+int main(void) {
+	printf("=== Tests de timer heap ===\n");
+	test_order_and_cancel();
+	test_stable_ids();
+	test_stale_id_after_churn();
+	test_periodic_and_reentrancy();
+	test_many_timers();
+	printf("✓ Todos los tests de timer heap pasaron\n");
+	return 0;
+}
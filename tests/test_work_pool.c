@@ -0,0 +1,72 @@
+#include "work_pool.h"
+#include "platform.h"
+#include <assert.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#define TASKS 20000
+#define CHILDREN 4
+
+static atomic_int g_ran;
+static atomic_int g_children;
+static WorkPool *g_pool;
+
+static void task(void *arg) {
+	atomic_fetch_add((atomic_int *)arg, 1);
+}
+
+// Encola tareas hijas desde un worker: van a su propio deque y los demás
+// workers pueden robarlas
+static void parent(void *arg) {
+	(void)arg;
+	for (int i = 0; i < CHILDREN; i++)
+		assert(work_pool_submit(g_pool, task, &g_children) == PLATFORM_OK);
+}
+
+static void test_external_submit(void) {
+	WorkPool *pool = work_pool_create(4);
+	assert(pool && work_pool_size(pool) == 4);
+	atomic_store(&g_ran, 0);
+	for (int i = 0; i < TASKS; i++) assert(work_pool_submit(pool, task, &g_ran) == PLATFORM_OK);
+	work_pool_destroy(pool); // Ejecuta lo pendiente antes de unir los hilos
+	assert(atomic_load(&g_ran) == TASKS);
+	printf("✓ test_external_submit\n");
+}
+
+static void test_nested_submit_and_steal(void) {
+	g_pool = work_pool_create(3);
+	assert(g_pool);
+	atomic_store(&g_children, 0);
+	for (int i = 0; i < TASKS / CHILDREN; i++)
+		assert(work_pool_submit(g_pool, parent, NULL) == PLATFORM_OK);
+	// Esperar a que todo corra (los hijos se encolan mientras tanto)
+	while (atomic_load(&g_children) < TASKS) sched_yield();
+	assert(work_pool_completed(g_pool) >= (uint64_t)TASKS);
+	uint64_t steals = work_pool_steals(g_pool);
+	work_pool_destroy(g_pool);
+	g_pool = NULL;
+	printf("✓ test_nested_submit_and_steal (%llu robos)\n", (unsigned long long)steals);
+}
+
+static void test_invalid_args(void) {
+	assert(work_pool_create(0) == NULL);
+	assert(work_pool_create(WORK_POOL_MAX_WORKERS + 1) == NULL);
+	assert(work_pool_submit(NULL, task, NULL) == PLATFORM_EINVAL);
+	WorkPool *pool = work_pool_create(1);
+	assert(pool);
+	assert(work_pool_submit(pool, NULL, NULL) == PLATFORM_EINVAL);
+	work_pool_destroy(pool);
+	work_pool_destroy(NULL);
+	printf("✓ test_invalid_args\n");
+}
+
+int main(void) {
+	printf("=== Tests de work pool ===\n");
+	test_external_submit();
+	test_nested_submit_and_steal();
+	test_invalid_args();
+	printf("✓ Todos los tests de work pool pasaron\n");
+	return 0;
+}
@@ -0,0 +1,758 @@
+/*
+ * teleload.c — Generador de carga CoAP multi-hilo contra un tele_server local.
+ *
+ * Modelo
+ * - N dispositivos simulados repartidos entre T hilos. Cada hilo tiene un
+ *   socket UDP conectado al servidor y envía, a ritmo constante (lazo
+ *   abierto), la mezcla configurada de POST de telemetría CON, POST NON y
+ *   GET CON. Los mensajes se arman y se leen con el codec del proyecto.
+ * - Envío y recepción en lotes con sendmmsg/recvmmsg (Linux; en otros
+ *   sistemas, un send/recv por datagrama).
+ * - Cada request lleva como token su número de secuencia de 8 bytes, que
+ *   indexa un anillo de slots en vuelo: la respuesta se empareja en O(1) y
+ *   una respuesta tardía o duplicada no coincide con el slot reutilizado.
+ * - La latencia se mide desde el instante programado del envío (no desde el
+ *   real), así un generador atrasado no oculta la espera (coordinated
+ *   omission). Histogramas log-lineales con el mismo esquema que metrics.
+ * - Una request sin respuesta dentro de --timeout cuenta como perdida; no hay
+ *   retransmisiones, la pérdida medida es la del servidor y el kernel.
+ * - El rate limit del servidor agrupa por dirección IP. Contra un servidor
+ *   en 127.0.0.0/8, el hilo i envía desde 127.0.0.(2+i): cada grupo de
+ *   dispositivos de un hilo es un peer distinto. Con otro destino todos los
+ *   hilos comparten la IP de origen del host.
+ *
+ * Uso típico:
+ *   ./bin/tele_server --port 5683 &
+ *   ./bin/teleload --devices 1000 --threads 4 --rate 20000 --duration 10
+ */
+#include "coap.h"
+#include "coap_codec.h"
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TL_MAX_THREADS 64
+#define TL_MAX_BATCH   64
+#define TL_SLOT_BITS   16   // requests en vuelo por hilo
+#define TL_SLOTS       (1u << TL_SLOT_BITS)
+#define TL_SUB_COUNT   (1u << METRICS_SUB_BITS)
+#define TL_SOURCE_BASE 0x7F000002u  // 127.0.0.2: origen del hilo 0 contra loopback
+
+// Tipos de request de la mezcla
+typedef enum {
+    KIND_CON = 0,   // POST /api/v1/telemetry confirmable
+    KIND_NON,       // POST /api/v1/telemetry no confirmable
+    KIND_GET,       // GET confirmable a --get-path
+    KIND_COUNT
+} RequestKind;
+
+static const char *const k_kind_names[KIND_COUNT] = { "con", "non", "get" };
+
+typedef struct {
+    char host[64];
+    char port[8];
+    unsigned devices;
+    unsigned threads;
+    double rate;            // requests/s totales
+    double duration_s;
+    unsigned mix[KIND_COUNT];
+    char get_path[64];
+    uint64_t timeout_ns;
+    unsigned batch;
+    bool histogram;
+    bool json;
+} LoadConfig;
+
+// Histograma log-lineal (ns), acumulado por un único hilo
+typedef struct {
+    uint64_t buckets[METRICS_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+} Histogram;
+
+typedef struct {
+    uint64_t sent;
+    uint64_t responded;
+    uint64_t lost;
+    uint64_t classes[4];    // 2.xx, 4.xx, 5.xx, otros
+    uint64_t shed;          // 5.03 (rate limit o sobrecarga)
+    Histogram latency;
+} KindStats;
+
+typedef struct {
+    uint64_t unmatched;     // Token desconocido (tardía tras timeout o duplicada)
+    uint64_t malformed;
+    uint64_t resets;
+    uint64_t send_errors;
+    uint64_t skipped;       // Programadas y no enviadas (sin slot libre o atraso)
+} LoadCounters;
+
+typedef struct {
+    uint64_t seq;           // Token de la request que ocupa el slot
+    uint64_t t_sched_ns;
+    uint64_t t_sent_ns;
+    uint8_t kind;
+    bool busy;
+} Slot;
+
+typedef struct {
+    const LoadConfig *cfg;
+    unsigned index;
+    unsigned device_first;
+    unsigned device_count;
+    double rate;
+    uint64_t start_ns;
+    int sock;
+    uint16_t next_mid;
+    uint32_t rng;
+
+    // Anillo de slots en vuelo indexado por secuencia
+    Slot *slots;
+    uint64_t next_seq;
+    uint64_t oldest_seq;
+    uint64_t in_flight;
+
+    KindStats stats[KIND_COUNT];
+    LoadCounters counters;
+
+    CoapMessage tx_msg;
+    CoapMessage rx_msg;
+    uint8_t tx_buf[TL_MAX_BATCH][COAP_MAX_MESSAGE_SIZE];
+    size_t tx_len[TL_MAX_BATCH];
+    uint64_t tx_seq[TL_MAX_BATCH];
+    uint8_t rx_buf[TL_MAX_BATCH][COAP_MAX_MESSAGE_SIZE];
+} Worker;
+
+static struct sockaddr_storage g_addr;
+static socklen_t g_addr_len;
+static bool g_per_thread_source;  // Destino IPv4 loopback: un origen por hilo
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * hist_bucket / hist_value
+ * ------------------------
+ * Mapeo valor <-> bucket idéntico al de metrics.c (error relativo <= 6.25%).
+ * hist_value devuelve el mayor valor equivalente del bucket.
+ */
+static size_t hist_bucket(uint64_t v) {
+    if (v < TL_SUB_COUNT) return (size_t)v;
+    unsigned e = 63u - (unsigned)__builtin_clzll(v);
+    if (e >= METRICS_MAX_EXPONENT) return METRICS_HIST_BUCKETS - 1;
+    size_t sub = (size_t)(v >> (e - METRICS_SUB_BITS)) & (TL_SUB_COUNT - 1);
+    return ((size_t)(e - METRICS_SUB_BITS + 1) << METRICS_SUB_BITS) + sub;
+}
+
+static uint64_t hist_value(size_t idx) {
+    if (idx < TL_SUB_COUNT) return idx;
+    unsigned e = (unsigned)(idx >> METRICS_SUB_BITS) + METRICS_SUB_BITS - 1;
+    uint64_t sub = idx & (TL_SUB_COUNT - 1);
+    uint64_t width = 1ull << (e - METRICS_SUB_BITS);
+    return ((TL_SUB_COUNT + sub) << (e - METRICS_SUB_BITS)) + width - 1;
+}
+
+static void hist_record(Histogram *h, uint64_t ns) {
+    h->buckets[hist_bucket(ns)]++;
+    h->sum_ns += ns;
+    if (h->count == 0 || ns < h->min_ns) h->min_ns = ns;
+    if (ns > h->max_ns) h->max_ns = ns;
+    h->count++;
+}
+
+static void hist_merge(Histogram *dst, const Histogram *src) {
+    if (src->count == 0) return;
+    for (size_t i = 0; i < METRICS_HIST_BUCKETS; i++) dst->buckets[i] += src->buckets[i];
+    if (dst->count == 0 || src->min_ns < dst->min_ns) dst->min_ns = src->min_ns;
+    if (src->max_ns > dst->max_ns) dst->max_ns = src->max_ns;
+    dst->sum_ns += src->sum_ns;
+    dst->count += src->count;
+}
+
+// Percentil q (0..1); el máximo exacto para q = 1
+static uint64_t hist_percentile(const Histogram *h, double q) {
+    if (h->count == 0) return 0;
+    if (q >= 1.0) return h->max_ns;
+    uint64_t rank = (uint64_t)(q * (double)h->count);
+    if (rank >= h->count) rank = h->count - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > rank) {
+            uint64_t v = hist_value(i);
+            return v > h->max_ns ? h->max_ns : v;
+        }
+    }
+    return h->max_ns;
+}
+
+static uint32_t xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return *state = x;
+}
+
+static RequestKind pick_kind(Worker *w) {
+    const unsigned *mix = w->cfg->mix;
+    unsigned total = mix[KIND_CON] + mix[KIND_NON] + mix[KIND_GET];
+    unsigned r = xorshift(&w->rng) % total;
+    if (r < mix[KIND_CON]) return KIND_CON;
+    return r < mix[KIND_CON] + mix[KIND_NON] ? KIND_NON : KIND_GET;
+}
+
+// Una opción Uri-Path por segmento de 'path' (sin '/' inicial)
+static void add_path(CoapMessage *msg, const char *path) {
+    while (*path) {
+        const char *slash = strchr(path, '/');
+        size_t len = slash ? (size_t)(slash - path) : strlen(path);
+        if (len > 0) coap_message_add_option(msg, COAP_OPTION_URI_PATH, (const uint8_t *)path, len);
+        path += len + (slash ? 1 : 0);
+    }
+}
+
+/*
+ * build_request
+ * -------------
+ * Arma y codifica en 'out' la request 'seq' del dispositivo 'device'. El
+ * token es la secuencia (8 bytes). Retorna la longitud o <= 0 en error.
+ */
+static int build_request(Worker *w, RequestKind kind, unsigned device, uint64_t seq,
+                         uint8_t *out, size_t out_size) {
+    CoapMessage *m = &w->tx_msg;
+    coap_message_init(m);
+    m->type = kind == KIND_NON ? COAP_TYPE_NON_CONFIRMABLE : COAP_TYPE_CONFIRMABLE;
+    m->message_id = w->next_mid++;
+    m->token_length = 8;
+    memcpy(m->token, &seq, 8);
+    if (kind == KIND_GET) {
+        m->code = COAP_METHOD_GET;
+        add_path(m, w->cfg->get_path);
+    } else {
+        m->code = COAP_METHOD_POST;
+        add_path(m, "api/v1/telemetry");
+        uint8_t fmt = COAP_FORMAT_JSON;
+        coap_message_add_option(m, COAP_OPTION_CONTENT_FORMAT, &fmt, 1);
+        int n = snprintf((char *)m->payload_buffer, sizeof(m->payload_buffer),
+                         "{\"device\":\"esp32-%05u\",\"temperatura\":%.1f,\"humedad\":%.1f,"
+                         "\"voltaje\":3.7,\"cantidad_producida\":%u}",
+                         device, 20.0 + (double)(seq % 100) / 10.0,
+                         50.0 + (double)(seq % 200) / 10.0, (unsigned)(seq % 1000));
+        m->payload = m->payload_buffer;
+        m->payload_length = (size_t)n;
+    }
+    return coap_encode(m, out, out_size);
+}
+
+/*
+ * send_batch
+ * ----------
+ * Envía los n datagramas armados. Los que el kernel no acepta liberan su slot
+ * y cuentan como error de envío.
+ */
+static void send_batch(Worker *w, unsigned n) {
+    int sent = 0;
+#if defined(__linux__)
+    struct mmsghdr msgs[TL_MAX_BATCH];
+    struct iovec iov[TL_MAX_BATCH];
+    memset(msgs, 0, sizeof(msgs[0]) * n);
+    for (unsigned i = 0; i < n; i++) {
+        iov[i].iov_base = w->tx_buf[i];
+        iov[i].iov_len = w->tx_len[i];
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while ((unsigned)sent < n) {
+        int r = sendmmsg(w->sock, msgs + sent, n - (unsigned)sent, 0);
+        if (r <= 0) break;
+        sent += r;
+    }
+#else
+    while ((unsigned)sent < n && send(w->sock, w->tx_buf[sent], w->tx_len[sent], 0) >= 0) sent++;
+#endif
+    uint64_t t = now_ns();
+    for (unsigned i = 0; i < n; i++) {
+        Slot *s = &w->slots[w->tx_seq[i] & (TL_SLOTS - 1)];
+        if ((int)i < sent) {
+            s->t_sent_ns = t;
+            w->stats[s->kind].sent++;
+        } else {
+            s->busy = false;
+            w->in_flight--;
+            w->counters.send_errors++;
+        }
+    }
+}
+
+static void send_ack(Worker *w, uint16_t mid) {
+    const uint8_t ack[4] = { (uint8_t)(0x40 | (COAP_TYPE_ACKNOWLEDGMENT << 4)), 0,
+                             (uint8_t)(mid >> 8), (uint8_t)mid };
+    if (send(w->sock, ack, sizeof(ack), 0) < 0) w->counters.send_errors++;
+}
+
+/*
+ * handle_response
+ * ---------------
+ * Decodifica un datagrama del servidor y lo empareja por token. Un ACK vacío
+ * anuncia una respuesta separada (se sigue esperando); una respuesta separada
+ * CON se confirma con un ACK vacío.
+ */
+static void handle_response(Worker *w, const uint8_t *buf, size_t len, uint64_t t) {
+    CoapMessage *m = &w->rx_msg;
+    if (coap_decode(m, buf, len) != COAP_CODEC_OK) {
+        w->counters.malformed++;
+        return;
+    }
+    if (m->code == 0) {
+        if (m->type == COAP_TYPE_RESET) w->counters.resets++;
+        return;
+    }
+    if (m->type == COAP_TYPE_CONFIRMABLE) send_ack(w, m->message_id);
+
+    uint64_t seq;
+    if (m->token_length != 8) {
+        w->counters.unmatched++;
+        return;
+    }
+    memcpy(&seq, m->token, 8);
+    Slot *s = &w->slots[seq & (TL_SLOTS - 1)];
+    if (!s->busy || s->seq != seq) {
+        w->counters.unmatched++;
+        return;
+    }
+    KindStats *ks = &w->stats[s->kind];
+    hist_record(&ks->latency, t - s->t_sched_ns);
+    ks->responded++;
+    unsigned cls = coap_code_class(m->code);
+    ks->classes[cls == 2 ? 0 : cls == 4 ? 1 : cls == 5 ? 2 : 3]++;
+    if (m->code == COAP_ERROR_SERVICE_UNAVAILABLE) ks->shed++;
+    s->busy = false;
+    w->in_flight--;
+}
+
+static void receive_all(Worker *w) {
+#if defined(__linux__)
+    struct mmsghdr msgs[TL_MAX_BATCH];
+    struct iovec iov[TL_MAX_BATCH];
+    const unsigned n = w->cfg->batch;
+    for (;;) {
+        memset(msgs, 0, sizeof(msgs[0]) * n);
+        for (unsigned i = 0; i < n; i++) {
+            iov[i].iov_base = w->rx_buf[i];
+            iov[i].iov_len = sizeof(w->rx_buf[i]);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int r = recvmmsg(w->sock, msgs, n, MSG_DONTWAIT, NULL);
+        if (r <= 0) return;
+        uint64_t t = now_ns();
+        for (int i = 0; i < r; i++) handle_response(w, w->rx_buf[i], msgs[i].msg_len, t);
+        if ((unsigned)r < n) return;
+    }
+#else
+    for (;;) {
+        ssize_t r = recv(w->sock, w->rx_buf[0], sizeof(w->rx_buf[0]), MSG_DONTWAIT);
+        if (r < 0) return;
+        handle_response(w, w->rx_buf[0], (size_t)r, now_ns());
+    }
+#endif
+}
+
+// Libera en orden de envío los slots cuyo timeout venció (o todos si 'all')
+static void expire(Worker *w, uint64_t t, bool all) {
+    while (w->oldest_seq < w->next_seq) {
+        Slot *s = &w->slots[w->oldest_seq & (TL_SLOTS - 1)];
+        if (s->busy && s->seq == w->oldest_seq) {
+            if (!all && t - s->t_sent_ns < w->cfg->timeout_ns) return;
+            w->stats[s->kind].lost++;
+            s->busy = false;
+            w->in_flight--;
+        }
+        w->oldest_seq++;
+    }
+}
+
+// Espera datos en el socket como máximo hasta 'deadline' (tope 1 ms)
+static void wait_readable(Worker *w, uint64_t deadline) {
+    uint64_t t = now_ns();
+    if (deadline <= t) return;
+    uint64_t wait = deadline - t;
+    if (wait > 1000000) wait = 1000000;
+    struct pollfd pfd = { .fd = w->sock, .events = POLLIN, .revents = 0 };
+#if defined(__linux__)
+    struct timespec ts = { 0, (long)wait };
+    (void)ppoll(&pfd, 1, &ts, NULL);
+#else
+    (void)poll(&pfd, 1, wait >= 1000000 ? 1 : 0);
+#endif
+}
+
+/*
+ * worker_main
+ * -----------
+ * Lazo abierto: la request k del hilo está programada en start + k/rate y se
+ * asigna a los dispositivos del hilo en round-robin. Al terminar la duración
+ * espera hasta --timeout por las respuestas pendientes.
+ */
+static void *worker_main(void *arg) {
+    Worker *w = (Worker *)arg;
+    const LoadConfig *cfg = w->cfg;
+    const double interval_ns = 1e9 / w->rate;
+    const uint64_t end_send = w->start_ns + (uint64_t)(cfg->duration_s * 1e9);
+    const uint64_t end_all = end_send + cfg->timeout_ns;
+    // Desfase por hilo para no enviar todos los hilos en el mismo instante
+    const double phase = interval_ns * w->index / cfg->threads;
+    uint64_t k = 0;
+    uint64_t next = w->start_ns + (uint64_t)phase;
+
+    for (;;) {
+        uint64_t t = now_ns();
+        if (t >= end_all || (t >= end_send && w->in_flight == 0)) break;
+
+        unsigned n = 0;
+        while (next <= t && next < end_send && n < cfg->batch) {
+            Slot *s = &w->slots[w->next_seq & (TL_SLOTS - 1)];
+            if (s->busy) {
+                w->counters.skipped++;
+            } else {
+                RequestKind kind = pick_kind(w);
+                unsigned device = w->device_first + (unsigned)(k % w->device_count);
+                int len = build_request(w, kind, device, w->next_seq, w->tx_buf[n],
+                                        sizeof(w->tx_buf[n]));
+                if (len > 0) {
+                    *s = (Slot){ .seq = w->next_seq, .t_sched_ns = next, .t_sent_ns = t,
+                                 .kind = (uint8_t)kind, .busy = true };
+                    w->tx_len[n] = (size_t)len;
+                    w->tx_seq[n] = w->next_seq;
+                    w->in_flight++;
+                    n++;
+                }
+                w->next_seq++;
+            }
+            k++;
+            next = w->start_ns + (uint64_t)(phase + (double)k * interval_ns);
+        }
+        if (n > 0) send_batch(w, n);
+
+        receive_all(w);
+        expire(w, now_ns(), false);
+        if (n == cfg->batch) continue; // atrasado: seguir enviando sin esperar
+        wait_readable(w, next < end_send ? next : end_all);
+    }
+    // Programadas que el generador no llegó a enviar (saturado)
+    if (next < end_send) {
+        w->counters.skipped += (uint64_t)((double)(end_send - next) / interval_ns) + 1;
+    }
+    expire(w, 0, true);
+    return NULL;
+}
+
+/*
+ * open_socket
+ * -----------
+ * Socket UDP conectado al servidor. Contra loopback IPv4 se liga antes a
+ * 127.0.0.(2+index) para que el rate limit por IP del servidor vea un peer
+ * por hilo en vez de uno solo para toda la carga.
+ */
+static int open_socket(unsigned index) {
+    int fd = socket(g_addr.ss_family, SOCK_DGRAM, 0);
+    if (fd < 0) return -1;
+    int sz = 4 * 1024 * 1024;
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sz, sizeof(sz));
+    (void)setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sz, sizeof(sz));
+    if (g_per_thread_source) {
+        struct sockaddr_in src = { .sin_family = AF_INET };
+        src.sin_addr.s_addr = htonl(TL_SOURCE_BASE + index);
+        if (bind(fd, (const struct sockaddr *)&src, sizeof(src)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (connect(fd, (const struct sockaddr *)&g_addr, g_addr_len) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * report_text / report_json
+ * -------------------------
+ * Resumen por tipo de request y total: enviadas, respondidas, pérdida,
+ * throughput y distribución de latencia (µs).
+ */
+static const double k_quantiles[] = { 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 0.9999, 1.0 };
+static const char *const k_quantile_names[] = { "p50", "p75", "p90", "p95", "p99", "p99.9",
+                                                "p99.99", "max" };
+#define QUANTILE_COUNT (sizeof(k_quantiles) / sizeof(k_quantiles[0]))
+
+static double loss_pct(const KindStats *s) {
+    return s->sent ? 100.0 * (double)s->lost / (double)s->sent : 0.0;
+}
+
+static void report_text(const LoadConfig *cfg, const KindStats *kinds, const KindStats *total,
+                        const LoadCounters *sum, double elapsed_s) {
+    printf("teleload %s:%s  dispositivos=%u hilos=%u peers=%u tasa=%.0f/s duración=%.1fs "
+           "mezcla con:non:get=%u:%u:%u get=/%s\n",
+           cfg->host, cfg->port, cfg->devices, cfg->threads, g_per_thread_source ? cfg->threads : 1,
+           cfg->rate, cfg->duration_s,
+           cfg->mix[KIND_CON], cfg->mix[KIND_NON], cfg->mix[KIND_GET], cfg->get_path);
+    printf("%-6s %10s %11s %9s %8s %9s %9s %9s %9s\n", "tipo", "enviadas", "respondidas",
+           "perdidas", "pérdida", "p50(µs)", "p99(µs)", "p99.9(µs)", "max(µs)");
+    for (int i = 0; i <= KIND_COUNT; i++) {
+        const KindStats *s = i < KIND_COUNT ? &kinds[i] : total;
+        if (i < KIND_COUNT && s->sent == 0) continue;
+        printf("%-6s %10llu %11llu %9llu %7.3f%% %9.1f %9.1f %9.1f %9.1f\n",
+               i < KIND_COUNT ? k_kind_names[i] : "total",
+               (unsigned long long)s->sent, (unsigned long long)s->responded,
+               (unsigned long long)s->lost, loss_pct(s),
+               hist_percentile(&s->latency, 0.5) / 1e3, hist_percentile(&s->latency, 0.99) / 1e3,
+               hist_percentile(&s->latency, 0.999) / 1e3, s->latency.max_ns / 1e3);
+    }
+    printf("throughput: %.1f enviadas/s, %.1f respondidas/s\n",
+           (double)total->sent / cfg->duration_s, (double)total->responded / elapsed_s);
+    printf("códigos: 2.xx=%llu 4.xx=%llu 5.xx=%llu (5.03=%llu) otros=%llu\n",
+           (unsigned long long)total->classes[0], (unsigned long long)total->classes[1],
+           (unsigned long long)total->classes[2], (unsigned long long)total->shed,
+           (unsigned long long)total->classes[3]);
+    printf("sin match=%llu malformados=%llu reset=%llu errores de envío=%llu omitidas=%llu\n",
+           (unsigned long long)sum->unmatched, (unsigned long long)sum->malformed,
+           (unsigned long long)sum->resets, (unsigned long long)sum->send_errors,
+           (unsigned long long)sum->skipped);
+
+    const Histogram *h = &total->latency;
+    printf("latencia total (µs): min=%.1f media=%.1f",
+           h->count ? h->min_ns / 1e3 : 0.0, h->count ? (double)h->sum_ns / h->count / 1e3 : 0.0);
+    for (size_t q = 0; q < QUANTILE_COUNT; q++) {
+        printf(" %s=%.1f", k_quantile_names[q], hist_percentile(h, k_quantiles[q]) / 1e3);
+    }
+    printf("\n");
+    if (!cfg->histogram || h->count == 0) return;
+    printf("%12s %12s %10s\n", "hasta(µs)", "cantidad", "acumulado");
+    uint64_t seen = 0;
+    for (size_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        if (h->buckets[i] == 0) continue;
+        seen += h->buckets[i];
+        printf("%12.1f %12llu %9.4f%%\n", hist_value(i) / 1e3,
+               (unsigned long long)h->buckets[i], 100.0 * (double)seen / (double)h->count);
+    }
+}
+
+static void json_kind(const char *name, const KindStats *s) {
+    printf("\"%s\":{\"sent\":%llu,\"responded\":%llu,\"lost\":%llu,\"loss_pct\":%.4f,"
+           "\"latency_us\":{", name, (unsigned long long)s->sent,
+           (unsigned long long)s->responded, (unsigned long long)s->lost, loss_pct(s));
+    for (size_t q = 0; q < QUANTILE_COUNT; q++) {
+        printf("%s\"%s\":%.1f", q ? "," : "", k_quantile_names[q],
+               hist_percentile(&s->latency, k_quantiles[q]) / 1e3);
+    }
+    printf("}}");
+}
+
+static void report_json(const LoadConfig *cfg, const KindStats *kinds, const KindStats *total,
+                        const LoadCounters *sum, double elapsed_s) {
+    printf("{\"devices\":%u,\"threads\":%u,\"peers\":%u,\"rate\":%.0f,\"duration_s\":%.1f,"
+           "\"sent_per_s\":%.1f,\"responded_per_s\":%.1f,",
+           cfg->devices, cfg->threads, g_per_thread_source ? cfg->threads : 1, cfg->rate,
+           cfg->duration_s,
+           (double)total->sent / cfg->duration_s, (double)total->responded / elapsed_s);
+    for (int i = 0; i < KIND_COUNT; i++) {
+        json_kind(k_kind_names[i], &kinds[i]);
+        printf(",");
+    }
+    json_kind("total", total);
+    printf(",\"codes\":{\"2xx\":%llu,\"4xx\":%llu,\"5xx\":%llu,\"503\":%llu,\"other\":%llu}",
+           (unsigned long long)total->classes[0], (unsigned long long)total->classes[1],
+           (unsigned long long)total->classes[2], (unsigned long long)total->shed,
+           (unsigned long long)total->classes[3]);
+    printf(",\"unmatched\":%llu,\"malformed\":%llu,\"resets\":%llu,\"send_errors\":%llu,"
+           "\"skipped\":%llu",
+           (unsigned long long)sum->unmatched, (unsigned long long)sum->malformed,
+           (unsigned long long)sum->resets, (unsigned long long)sum->send_errors,
+           (unsigned long long)sum->skipped);
+    // Distribución completa: [límite superior del bucket en ns, cantidad]
+    printf(",\"histogram_ns\":[");
+    bool first = true;
+    for (size_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        if (total->latency.buckets[i] == 0) continue;
+        printf("%s[%llu,%llu]", first ? "" : ",", (unsigned long long)hist_value(i),
+               (unsigned long long)total->latency.buckets[i]);
+        first = false;
+    }
+    printf("]}\n");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--host H] [--port N] [--devices N] [--threads N] [--rate R] "
+                    "[--duration S] [--mix CON:NON:GET] [--get-path P] [--timeout MS] "
+                    "[--batch N] [--histogram] [--json]\n", prog);
+}
+
+static bool parse_args(int argc, char *argv[], LoadConfig *cfg) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(a, "--histogram") == 0) {
+            cfg->histogram = true;
+        } else if (strcmp(a, "--json") == 0) {
+            cfg->json = true;
+        } else if (!has_value) {
+            return false;
+        } else if (strcmp(a, "--host") == 0) {
+            snprintf(cfg->host, sizeof(cfg->host), "%s", argv[++i]);
+        } else if (strcmp(a, "--port") == 0) {
+            long p = atol(argv[++i]);
+            if (p <= 0 || p > 65535) return false;
+            snprintf(cfg->port, sizeof(cfg->port), "%ld", p);
+        } else if (strcmp(a, "--devices") == 0) {
+            long n = atol(argv[++i]);
+            if (n <= 0 || n > 1000000) return false;
+            cfg->devices = (unsigned)n;
+        } else if (strcmp(a, "--threads") == 0) {
+            long n = atol(argv[++i]);
+            if (n <= 0 || n > TL_MAX_THREADS) return false;
+            cfg->threads = (unsigned)n;
+        } else if (strcmp(a, "--rate") == 0) {
+            cfg->rate = atof(argv[++i]);
+            if (!(cfg->rate > 0 && cfg->rate <= 10e6)) return false;
+        } else if (strcmp(a, "--duration") == 0) {
+            cfg->duration_s = atof(argv[++i]);
+            if (!(cfg->duration_s > 0 && cfg->duration_s <= 86400)) return false;
+        } else if (strcmp(a, "--mix") == 0) {
+            unsigned c, n, g;
+            char tail;
+            if (sscanf(argv[++i], "%u:%u:%u%c", &c, &n, &g, &tail) != 3 || c + n + g == 0) {
+                return false;
+            }
+            cfg->mix[KIND_CON] = c;
+            cfg->mix[KIND_NON] = n;
+            cfg->mix[KIND_GET] = g;
+        } else if (strcmp(a, "--get-path") == 0) {
+            const char *p = argv[++i];
+            while (*p == '/') p++;
+            snprintf(cfg->get_path, sizeof(cfg->get_path), "%s", p);
+        } else if (strcmp(a, "--timeout") == 0) {
+            long ms = atol(argv[++i]);
+            if (ms <= 0 || ms > 600000) return false;
+            cfg->timeout_ns = (uint64_t)ms * 1000000ull;
+        } else if (strcmp(a, "--batch") == 0) {
+            long n = atol(argv[++i]);
+            if (n <= 0 || n > TL_MAX_BATCH) return false;
+            cfg->batch = (unsigned)n;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    LoadConfig cfg = {
+        .host = "127.0.0.1", .port = "5683", .devices = 100, .threads = 4, .rate = 1000,
+        .duration_s = 10, .mix = { 60, 30, 10 }, .get_path = "api/v1/health",
+        .timeout_ns = 2000000000ull, .batch = 32,
+    };
+    if (!parse_args(argc, argv, &cfg)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (cfg.threads > cfg.devices) cfg.threads = cfg.devices;
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(cfg.host, cfg.port, &hints, &res) != 0 || !res) {
+        fprintf(stderr, "Cannot resolve %s:%s\n", cfg.host, cfg.port);
+        return EXIT_FAILURE;
+    }
+    memcpy(&g_addr, res->ai_addr, res->ai_addrlen);
+    g_addr_len = res->ai_addrlen;
+    freeaddrinfo(res);
+    g_per_thread_source = g_addr.ss_family == AF_INET &&
+        (ntohl(((const struct sockaddr_in *)&g_addr)->sin_addr.s_addr) >> 24) == 127;
+
+    Worker *workers = calloc(cfg.threads, sizeof(Worker));
+    if (!workers) return EXIT_FAILURE;
+    unsigned device = 0;
+    for (unsigned i = 0; i < cfg.threads; i++) {
+        Worker *w = &workers[i];
+        w->cfg = &cfg;
+        w->index = i;
+        w->device_first = device;
+        w->device_count = cfg.devices / cfg.threads + (i < cfg.devices % cfg.threads ? 1 : 0);
+        device += w->device_count;
+        w->rate = cfg.rate * w->device_count / cfg.devices;
+        w->rng = 0x9E3779B9u * (i + 1);
+        w->next_mid = (uint16_t)xorshift(&w->rng);
+        w->slots = calloc(TL_SLOTS, sizeof(Slot));
+        w->sock = open_socket(i);
+        if (!w->slots || w->sock < 0) {
+            fprintf(stderr, "Failed to set up worker %u: %s\n", i, strerror(errno));
+            if (g_per_thread_source) {
+                struct in_addr src = { .s_addr = htonl(TL_SOURCE_BASE + i) };
+                fprintf(stderr, "Source address %s must be local (127.0.0.0/8 on lo)\n",
+                        inet_ntoa(src));
+            }
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Todos los hilos comparten el instante de inicio del programa de envíos
+    uint64_t start = now_ns() + 10000000ull;
+    pthread_t th[TL_MAX_THREADS];
+    for (unsigned i = 0; i < cfg.threads; i++) {
+        workers[i].start_ns = start;
+        if (pthread_create(&th[i], NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "Failed to start thread %u\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+    for (unsigned i = 0; i < cfg.threads; i++) pthread_join(th[i], NULL);
+    double elapsed_s = (double)(now_ns() - start) / 1e9;
+
+    static KindStats kinds[KIND_COUNT], total;
+    LoadCounters sum = {0};
+    for (unsigned i = 0; i < cfg.threads; i++) {
+        const Worker *w = &workers[i];
+        for (int k = 0; k < KIND_COUNT; k++) {
+            const KindStats *s = &w->stats[k];
+            KindStats *dsts[2] = { &kinds[k], &total };
+            for (int d = 0; d < 2; d++) {
+                dsts[d]->sent += s->sent;
+                dsts[d]->responded += s->responded;
+                dsts[d]->lost += s->lost;
+                dsts[d]->shed += s->shed;
+                for (int c = 0; c < 4; c++) dsts[d]->classes[c] += s->classes[c];
+                hist_merge(&dsts[d]->latency, &s->latency);
+            }
+        }
+        sum.unmatched += w->counters.unmatched;
+        sum.malformed += w->counters.malformed;
+        sum.resets += w->counters.resets;
+        sum.send_errors += w->counters.send_errors;
+        sum.skipped += w->counters.skipped;
+        close(w->sock);
+        free(w->slots);
+    }
+    free(workers);
+
+    if (cfg.json) report_json(&cfg, kinds, &total, &sum, elapsed_s);
+    else report_text(&cfg, kinds, &total, &sum, elapsed_s);
+    return EXIT_SUCCESS;
+}